@@ -523,16 +523,112 @@ eab_contact_compare_address (EContact *contact1,
 	return EAB_CONTACT_MATCH_NOT_APPLICABLE;
 }
 
+/*** Telephone Comparisons ***/
+
+/* Numbers with fewer digits are too ambiguous to be compared */
+#define MIN_PHONE_DIGITS 7
+
+/* Returns a newly allocated string with only the digits of the @phone,
+ * or %NULL, when it has too few of them. */
+static gchar *
+phone_dup_digits (const gchar *phone)
+{
+	GString *digits;
+
+	if (!phone || !*phone)
+		return NULL;
+
+	digits = g_string_sized_new (strlen (phone));
+
+	for (; *phone; phone++) {
+		if (g_ascii_isdigit (*phone))
+			g_string_append_c (digits, *phone);
+	}
+
+	if (digits->len < MIN_PHONE_DIGITS) {
+		g_string_free (digits, TRUE);
+		return NULL;
+	}
+
+	return g_string_free (digits, FALSE);
+}
+
+/* Returns the digits of all the phone numbers of the @contact */
+static GPtrArray *
+contact_dup_phones_digits (EContact *contact)
+{
+	GPtrArray *phones;
+	GList *attrs, *link;
+
+	phones = g_ptr_array_new_with_free_func (g_free);
+	attrs = e_contact_get_attributes (contact, E_CONTACT_TEL);
+
+	for (link = attrs; link; link = g_list_next (link)) {
+		gchar *value, *digits;
+
+		value = e_vcard_attribute_get_value (link->data);
+		digits = phone_dup_digits (value);
+		g_free (value);
+
+		if (digits)
+			g_ptr_array_add (phones, digits);
+	}
+
+	g_list_free_full (attrs, (GDestroyNotify) e_vcard_attribute_free);
+
+	return phones;
+}
+
+/* The numbers match when one ends with the other, like when
+ * only one of them is written with the country code. */
+static gboolean
+match_phone_digits (const gchar *digits1,
+                    const gchar *digits2)
+{
+	gsize len1, len2;
+
+	len1 = strlen (digits1);
+	len2 = strlen (digits2);
+
+	if (len1 > len2)
+		return strcmp (digits1 + len1 - len2, digits2) == 0;
+
+	return strcmp (digits2 + len2 - len1, digits1) == 0;
+}
+
 EABContactMatchType
 eab_contact_compare_telephone (EContact *contact1,
                                EContact *contact2)
 {
+	EABContactMatchType match = EAB_CONTACT_MATCH_NOT_APPLICABLE;
+	GPtrArray *phones1, *phones2;
+	guint ii, jj;
+
 	g_return_val_if_fail (contact1 && E_IS_CONTACT (contact1), EAB_CONTACT_MATCH_NOT_APPLICABLE);
 	g_return_val_if_fail (contact2 && E_IS_CONTACT (contact2), EAB_CONTACT_MATCH_NOT_APPLICABLE);
 
-	/* Unimplemented */
+	phones1 = contact_dup_phones_digits (contact1);
+	phones2 = contact_dup_phones_digits (contact2);
 
-	return EAB_CONTACT_MATCH_NOT_APPLICABLE;
+	if (phones1->len && phones2->len) {
+		match = EAB_CONTACT_MATCH_NONE;
+
+		/* A shared number alone is not enough to say it's the same
+		 * person, people share office and home numbers. */
+		for (ii = 0; ii < phones1->len && match == EAB_CONTACT_MATCH_NONE; ii++) {
+			for (jj = 0; jj < phones2->len; jj++) {
+				if (match_phone_digits (phones1->pdata[ii], phones2->pdata[jj])) {
+					match = EAB_CONTACT_MATCH_VAGUE;
+					break;
+				}
+			}
+		}
+	}
+
+	g_ptr_array_unref (phones1);
+	g_ptr_array_unref (phones2);
+
+	return match;
 }
 
 EABContactMatchType
@@ -583,6 +679,29 @@ match_search_info_free (MatchSearchInfo *info)
 	}
 }
 
+/* Returns a set of the UID-s of the @avoid contacts, or %NULL, when none */
+static GHashTable *
+avoid_uids_new (GList *avoid)
+{
+	GHashTable *avoid_uids = NULL;
+	GList *link;
+
+	for (link = avoid; link; link = g_list_next (link)) {
+		const gchar *avoid_uid;
+
+		avoid_uid = e_contact_get_const (link->data, E_CONTACT_UID);
+		if (!avoid_uid)
+			continue;
+
+		if (!avoid_uids)
+			avoid_uids = g_hash_table_new (g_str_hash, g_str_equal);
+
+		g_hash_table_add (avoid_uids, (gpointer) avoid_uid);
+	}
+
+	return avoid_uids;
+}
+
 static void
 query_cb (GObject *source_object,
           GAsyncResult *result,
@@ -594,6 +713,7 @@ query_cb (GObject *source_object,
 	EBookClient *book_client = E_BOOK_CLIENT (source_object);
 	GSList *remaining_contacts = NULL;
 	GSList *contacts = NULL;
+	GHashTable *avoid_uids;
 	GError *error = NULL;
 	const GSList *ii;
 
@@ -617,33 +737,24 @@ query_cb (GObject *source_object,
 		return;
 	}
 
+	avoid_uids = avoid_uids_new (info->avoid);
+
 	/* remove the contacts we're to avoid from the list, if they're present */
 	for (ii = contacts; ii != NULL; ii = g_slist_next (ii)) {
 		EContact *this_contact = E_CONTACT (ii->data);
 		const gchar *this_uid;
-		GList *iterator;
-		gboolean avoid = FALSE;
 
 		this_uid = e_contact_get_const (this_contact, E_CONTACT_UID);
 		if (!this_uid)
 			continue;
 
-		for (iterator = info->avoid; iterator; iterator = iterator->next) {
-			const gchar *avoid_uid;
-
-			avoid_uid = e_contact_get_const (iterator->data, E_CONTACT_UID);
-			if (!avoid_uid)
-				continue;
-
-			if (!strcmp (avoid_uid, this_uid)) {
-				avoid = TRUE;
-				break;
-			}
-		}
-		if (!avoid)
+		if (!avoid_uids || !g_hash_table_contains (avoid_uids, this_uid))
 			remaining_contacts = g_slist_prepend (remaining_contacts, g_object_ref (this_contact));
 	}
 
+	if (avoid_uids)
+		g_hash_table_destroy (avoid_uids);
+
 	remaining_contacts = g_slist_reverse (remaining_contacts);
 
 	for (ii = remaining_contacts; ii != NULL; ii = g_slist_next (ii)) {
@@ -668,100 +779,104 @@ query_cb (GObject *source_object,
 		g_object_unref (best_contact);
 }
 
-#define MAX_QUERY_PARTS 10
+/* Adds the queries for the book contacts which can match the @contact
+ * to the @queries; the same parts eab_contact_compare() looks at. */
 static void
-use_common_book_client (EBookClient *book_client,
-                        MatchSearchInfo *info)
+match_query_add_contact (GPtrArray *queries,
+                         EContact *contact)
 {
-	EContact *contact = info->contact;
-	EContactName *contact_name;
-	GList *contact_email;
-	gchar *query_parts[MAX_QUERY_PARTS + 1];
-	gint p = 0;
-	gchar *contact_file_as, *qj;
-	EBookQuery *query = NULL;
-	gint i;
+	const gchar *file_as;
 
-	if (book_client == NULL) {
-		info->cb (info->contact, NULL, EAB_CONTACT_MATCH_NONE, info->closure);
-		match_search_info_free (info);
-		return;
-	}
-
-	contact_file_as = e_contact_get (contact, E_CONTACT_FILE_AS);
-	if (contact_file_as) {
-		query_parts[p++] = g_strdup_printf ("(contains \"file_as\" \"%s\")", contact_file_as);
-		g_free (contact_file_as);
-	}
+	file_as = e_contact_get_const (contact, E_CONTACT_FILE_AS);
+	if (file_as && *file_as)
+		g_ptr_array_add (queries, e_book_query_field_test (E_CONTACT_FILE_AS, E_BOOK_QUERY_CONTAINS, file_as));
 
 	if (!e_contact_get (contact, E_CONTACT_IS_LIST)) {
+		EContactName *contact_name;
+		GList *contact_email, *link;
+
 		contact_name = e_contact_get (contact, E_CONTACT_NAME);
 		if (contact_name) {
 			if (contact_name->given && *contact_name->given)
-				query_parts[p++] = g_strdup_printf ("(contains \"full_name\" \"%s\")", contact_name->given);
+				g_ptr_array_add (queries, e_book_query_field_test (E_CONTACT_FULL_NAME, E_BOOK_QUERY_CONTAINS, contact_name->given));
 
 			if (contact_name->additional && *contact_name->additional)
-				query_parts[p++] = g_strdup_printf ("(contains \"full_name\" \"%s\")", contact_name->additional);
+				g_ptr_array_add (queries, e_book_query_field_test (E_CONTACT_FULL_NAME, E_BOOK_QUERY_CONTAINS, contact_name->additional));
 
 			if (contact_name->family && *contact_name->family)
-				query_parts[p++] = g_strdup_printf ("(contains \"full_name\" \"%s\")", contact_name->family);
+				g_ptr_array_add (queries, e_book_query_field_test (E_CONTACT_FULL_NAME, E_BOOK_QUERY_CONTAINS, contact_name->family));
 
 			e_contact_name_free (contact_name);
 		}
 
 		contact_email = e_contact_get (contact, E_CONTACT_EMAIL);
-		if (contact_email) {
-			GList *iter;
-			for (iter = contact_email; iter && p < MAX_QUERY_PARTS; iter = iter->next) {
-				gchar *addr = g_strdup (iter->data);
-				if (addr && *addr) {
-					gchar *s = addr;
-					while (*s) {
-						if (*s == '@') {
-							*s = '\0';
-							break;
-						}
-						++s;
-					}
-					query_parts[p++] = g_strdup_printf ("(beginswith \"email\" \"%s\")", addr);
-					g_free (addr);
-				}
-			}
+		for (link = contact_email; link; link = g_list_next (link)) {
+			const gchar *addr = link->data;
+			gchar *username;
+			gint len;
+
+			if (!addr || !*addr)
+				continue;
+
+			for (len = 0; addr[len] && addr[len] != '@'; len++);
+
+			username = g_strndup (addr, len);
+			g_ptr_array_add (queries, e_book_query_field_test (E_CONTACT_EMAIL, E_BOOK_QUERY_BEGINS_WITH, username));
+			g_free (username);
 		}
-		g_list_foreach (contact_email, (GFunc) g_free, NULL);
-		g_list_free (contact_email);
+		g_list_free_full (contact_email, g_free);
 	}
+}
 
-	/* Build up our full query from the parts. */
-	query_parts[p] = NULL;
-	qj = g_strjoinv (" ", query_parts);
-	for (i = 0; query_parts[i] != NULL; i++)
-		g_free (query_parts[i]);
-	if (p > 1) {
-		gchar *s;
-		s = g_strdup_printf ("(or %s)", qj);
-		query = e_book_query_from_string (s);
-		g_free (s);
-	}
-	else if (p == 1) {
-		query = e_book_query_from_string (qj);
-	}
-	else {
-		query = NULL;
+/* Returns a query for the book contacts which can match any of the @contacts,
+ * or %NULL when none can be matched */
+static EBookQuery *
+match_query_new_for_contacts (const GSList *contacts)
+{
+	GPtrArray *queries;
+	EBookQuery *query = NULL;
+	const GSList *link;
+
+	queries = g_ptr_array_new ();
+
+	for (link = contacts; link; link = g_slist_next (link))
+		match_query_add_contact (queries, link->data);
+
+	if (queries->len == 1)
+		query = queries->pdata[0];
+	else if (queries->len > 1)
+		query = e_book_query_or (queries->len, (EBookQuery **) queries->pdata, TRUE);
+
+	g_ptr_array_free (queries, TRUE);
+
+	return query;
+}
+
+static void
+use_common_book_client (EBookClient *book_client,
+                        MatchSearchInfo *info)
+{
+	GSList contacts = { 0, };
+	EBookQuery *query;
+
+	if (book_client == NULL) {
+		info->cb (info->contact, NULL, EAB_CONTACT_MATCH_NONE, info->closure);
+		match_search_info_free (info);
+		return;
 	}
 
+	contacts.data = info->contact;
+	query = match_query_new_for_contacts (&contacts);
+
 	if (query) {
 		gchar *query_str = e_book_query_to_string (query);
 
 		e_book_client_get_contacts (book_client, query_str, NULL, query_cb, info);
 
 		g_free (query_str);
+		e_book_query_unref (query);
 	} else
 		query_cb (G_OBJECT (book_client), NULL, info);
-
-	g_free (qj);
-	if (query)
-		e_book_query_unref (query);
 }
 
 static void
@@ -834,3 +949,474 @@ eab_contact_locate_match_full (ESourceRegistry *registry,
 	g_object_unref (source);
 }
 
+
+/*** Bulk matching ***/
+
+typedef struct _MatchIndexEntry {
+	EContact *contact;
+	GPtrArray *keys; /* gchar * */
+} MatchIndexEntry;
+
+struct _EABContactMatchIndex {
+	/* gchar *uid ~> MatchIndexEntry * */
+	GHashTable *entries;
+	/* gchar *key ~> GPtrArray { MatchIndexEntry * } */
+	GHashTable *buckets;
+};
+
+static void
+match_index_entry_free (gpointer ptr)
+{
+	MatchIndexEntry *entry = ptr;
+
+	if (entry) {
+		g_object_unref (entry->contact);
+		g_ptr_array_unref (entry->keys);
+		g_slice_free (MatchIndexEntry, entry);
+	}
+}
+
+static void
+match_index_add_key (GPtrArray *keys,
+                     const gchar *prefix,
+                     const gchar *value)
+{
+	gchar *key;
+	guint ii;
+
+	key = g_strconcat (prefix, value, NULL);
+
+	for (ii = 0; ii < keys->len; ii++) {
+		if (g_str_equal (keys->pdata[ii], key)) {
+			g_free (key);
+			return;
+		}
+	}
+
+	g_ptr_array_add (keys, key);
+}
+
+/* Adds a key for a name part, which matches regardless of the letter case */
+static void
+match_index_add_name_key (GPtrArray *keys,
+                          const gchar *prefix,
+                          const gchar *name)
+{
+	gchar *folded, *collate_key;
+
+	if (!name || !*name || !g_utf8_validate (name, -1, NULL))
+		return;
+
+	folded = g_utf8_casefold (name, -1);
+	collate_key = g_utf8_collate_key (folded, -1);
+
+	match_index_add_key (keys, prefix, collate_key);
+
+	g_free (collate_key);
+	g_free (folded);
+}
+
+/* Returns the keys under which a contact can be found, which cover
+ * everything eab_contact_compare() can find a match on. With @for_lookup
+ * the keys include also the known synonyms of the given name. */
+static GPtrArray *
+match_index_dup_keys (EContact *contact,
+                      gboolean for_lookup)
+{
+	GPtrArray *keys;
+	gchar *file_as;
+
+	keys = g_ptr_array_new_with_free_func (g_free);
+
+	file_as = e_contact_get (contact, E_CONTACT_FILE_AS);
+	if (file_as && *file_as) {
+		if (g_utf8_validate (file_as, -1, NULL)) {
+			gchar *collate_key;
+
+			collate_key = g_utf8_collate_key (file_as, -1);
+			match_index_add_key (keys, "f:", collate_key);
+			g_free (collate_key);
+		} else {
+			match_index_add_key (keys, "F:", file_as);
+		}
+	}
+	g_free (file_as);
+
+	if (!e_contact_get (contact, E_CONTACT_IS_LIST)) {
+		EContactName *name;
+		GPtrArray *phones;
+		GList *emails, *link;
+		guint ii;
+
+		name = e_contact_get (contact, E_CONTACT_NAME);
+		if (name) {
+			/* The given name is enough, because a name match without
+			 * the family name requires both given and additional names
+			 * to match. */
+			match_index_add_name_key (keys, "n:", name->family);
+			match_index_add_name_key (keys, "g:", name->given);
+
+			if (for_lookup && name->given && *name->given) {
+				for (ii = 0; name_synonyms[ii][0]; ii++) {
+					if (!e_utf8_casefold_collate (name_synonyms[ii][0], name->given))
+						match_index_add_name_key (keys, "g:", name_synonyms[ii][1]);
+					else if (!e_utf8_casefold_collate (name_synonyms[ii][1], name->given))
+						match_index_add_name_key (keys, "g:", name_synonyms[ii][0]);
+				}
+			}
+
+			e_contact_name_free (name);
+		}
+
+		emails = e_contact_get (contact, E_CONTACT_EMAIL);
+		for (link = emails; link; link = g_list_next (link)) {
+			const gchar *addr = link->data;
+			gchar *username;
+			gint len;
+
+			if (!addr || !*addr)
+				continue;
+
+			/* Same as match_email_username() */
+			for (len = 0; addr[len] && addr[len] != '@'; len++);
+
+			username = g_ascii_strdown (addr, len);
+			match_index_add_key (keys, "e:", username);
+			g_free (username);
+		}
+		g_list_free_full (emails, g_free);
+
+		/* The shortest number which can match */
+		phones = contact_dup_phones_digits (contact);
+		for (ii = 0; ii < phones->len; ii++) {
+			const gchar *digits = phones->pdata[ii];
+
+			match_index_add_key (keys, "t:", digits + strlen (digits) - MIN_PHONE_DIGITS);
+		}
+		g_ptr_array_unref (phones);
+	}
+
+	return keys;
+}
+
+/**
+ * eab_contact_match_index_new:
+ *
+ * Creates a new, empty #EABContactMatchIndex. It keeps the contacts indexed
+ * by their normalized e-mail user names, phone numbers, name parts and
+ * file-as values, thus many contacts can be matched against it without
+ * querying the book for each of them and without comparing them to all
+ * the contacts in the book.
+ *
+ * Returns: (transfer full): a new #EABContactMatchIndex; free it
+ *    with eab_contact_match_index_free(), when no longer needed
+ *
+ * Since: 3.28
+ **/
+EABContactMatchIndex *
+eab_contact_match_index_new (void)
+{
+	EABContactMatchIndex *match_index;
+
+	match_index = g_slice_new0 (EABContactMatchIndex);
+	match_index->entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, match_index_entry_free);
+	match_index->buckets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+
+	return match_index;
+}
+
+/**
+ * eab_contact_match_index_new_from_book_sync:
+ * @book_client: an #EBookClient
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Reads all the contacts of the @book_client with a single query and
+ * indexes them. This can take a while with large books, thus it is
+ * meant to be called in a dedicated thread.
+ *
+ * Returns: (transfer full) (nullable): a new #EABContactMatchIndex, or %NULL
+ *    on error; free it with eab_contact_match_index_free()
+ *
+ * Since: 3.28
+ **/
+EABContactMatchIndex *
+eab_contact_match_index_new_from_book_sync (EBookClient *book_client,
+                                            GCancellable *cancellable,
+                                            GError **error)
+{
+	EABContactMatchIndex *match_index;
+	EBookQuery *query;
+	GSList *contacts = NULL, *link;
+	gchar *sexp;
+	gboolean success;
+
+	g_return_val_if_fail (E_IS_BOOK_CLIENT (book_client), NULL);
+
+	query = e_book_query_any_field_contains ("");
+	sexp = e_book_query_to_string (query);
+	e_book_query_unref (query);
+
+	success = e_book_client_get_contacts_sync (book_client, sexp, &contacts, cancellable, error);
+
+	g_free (sexp);
+
+	if (!success)
+		return NULL;
+
+	match_index = eab_contact_match_index_new ();
+
+	for (link = contacts; link; link = g_slist_next (link)) {
+		if (g_cancellable_is_cancelled (cancellable))
+			break;
+
+		eab_contact_match_index_add (match_index, link->data);
+	}
+
+	g_slist_free_full (contacts, g_object_unref);
+
+	if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+		eab_contact_match_index_free (match_index);
+		return NULL;
+	}
+
+	return match_index;
+}
+
+/**
+ * eab_contact_match_index_new_for_contacts_sync:
+ * @book_client: an #EBookClient
+ * @contacts: (element-type EContact): contacts to be matched
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Reads only those contacts of the @book_client, which can match any
+ * of the @contacts, with a single query, and indexes them. Unlike
+ * eab_contact_match_index_new_from_book_sync(), the memory used and
+ * the cost of the query depend only on the @contacts, not on the size
+ * of the book, thus it suits matching large inputs in batches.
+ *
+ * Returns: (transfer full) (nullable): a new #EABContactMatchIndex, or %NULL
+ *    on error; free it with eab_contact_match_index_free()
+ *
+ * Since: 3.28
+ **/
+EABContactMatchIndex *
+eab_contact_match_index_new_for_contacts_sync (EBookClient *book_client,
+                                               const GSList *contacts,
+                                               GCancellable *cancellable,
+                                               GError **error)
+{
+	EABContactMatchIndex *match_index;
+	EBookQuery *query;
+	GSList *book_contacts = NULL, *link;
+
+	g_return_val_if_fail (E_IS_BOOK_CLIENT (book_client), NULL);
+
+	query = match_query_new_for_contacts (contacts);
+
+	if (query) {
+		gchar *sexp;
+		gboolean success;
+
+		sexp = e_book_query_to_string (query);
+		e_book_query_unref (query);
+
+		success = e_book_client_get_contacts_sync (book_client, sexp, &book_contacts, cancellable, error);
+
+		g_free (sexp);
+
+		if (!success)
+			return NULL;
+	}
+
+	match_index = eab_contact_match_index_new ();
+
+	for (link = book_contacts; link; link = g_slist_next (link))
+		eab_contact_match_index_add (match_index, link->data);
+
+	g_slist_free_full (book_contacts, g_object_unref);
+
+	return match_index;
+}
+
+/**
+ * eab_contact_match_index_free:
+ * @match_index: (nullable): an #EABContactMatchIndex
+ *
+ * Frees the @match_index and releases the contacts it holds.
+ *
+ * Since: 3.28
+ **/
+void
+eab_contact_match_index_free (EABContactMatchIndex *match_index)
+{
+	if (match_index) {
+		g_hash_table_destroy (match_index->buckets);
+		g_hash_table_destroy (match_index->entries);
+		g_slice_free (EABContactMatchIndex, match_index);
+	}
+}
+
+/**
+ * eab_contact_match_index_add:
+ * @match_index: an #EABContactMatchIndex
+ * @contact: an #EContact
+ *
+ * Adds the @contact to the @match_index, replacing any previously added
+ * contact with the same UID. Contacts without UID are ignored, because
+ * they are not stored in any book yet.
+ *
+ * Since: 3.28
+ **/
+void
+eab_contact_match_index_add (EABContactMatchIndex *match_index,
+                             EContact *contact)
+{
+	MatchIndexEntry *entry;
+	const gchar *uid;
+	guint ii;
+
+	g_return_if_fail (match_index != NULL);
+	g_return_if_fail (E_IS_CONTACT (contact));
+
+	uid = e_contact_get_const (contact, E_CONTACT_UID);
+	if (!uid || !*uid)
+		return;
+
+	eab_contact_match_index_remove (match_index, uid);
+
+	entry = g_slice_new0 (MatchIndexEntry);
+	entry->contact = g_object_ref (contact);
+	entry->keys = match_index_dup_keys (contact, FALSE);
+
+	for (ii = 0; ii < entry->keys->len; ii++) {
+		GPtrArray *bucket;
+
+		bucket = g_hash_table_lookup (match_index->buckets, entry->keys->pdata[ii]);
+		if (!bucket) {
+			bucket = g_ptr_array_new ();
+			g_hash_table_insert (match_index->buckets, g_strdup (entry->keys->pdata[ii]), bucket);
+		}
+
+		g_ptr_array_add (bucket, entry);
+	}
+
+	g_hash_table_insert (match_index->entries, g_strdup (uid), entry);
+}
+
+/**
+ * eab_contact_match_index_remove:
+ * @match_index: an #EABContactMatchIndex
+ * @uid: UID of the contact to remove
+ *
+ * Removes the contact with the @uid from the @match_index, if it is there.
+ *
+ * Since: 3.28
+ **/
+void
+eab_contact_match_index_remove (EABContactMatchIndex *match_index,
+                                const gchar *uid)
+{
+	MatchIndexEntry *entry;
+	guint ii;
+
+	g_return_if_fail (match_index != NULL);
+	g_return_if_fail (uid != NULL);
+
+	entry = g_hash_table_lookup (match_index->entries, uid);
+	if (!entry)
+		return;
+
+	for (ii = 0; ii < entry->keys->len; ii++) {
+		GPtrArray *bucket;
+
+		bucket = g_hash_table_lookup (match_index->buckets, entry->keys->pdata[ii]);
+		if (!bucket)
+			continue;
+
+		g_ptr_array_remove_fast (bucket, entry);
+
+		if (!bucket->len)
+			g_hash_table_remove (match_index->buckets, entry->keys->pdata[ii]);
+	}
+
+	g_hash_table_remove (match_index->entries, uid);
+}
+
+/**
+ * eab_contact_match_index_lookup:
+ * @match_index: an #EABContactMatchIndex
+ * @contact: an #EContact to find a match for
+ * @avoid: (element-type EContact) (nullable): contacts not to match
+ * @out_match: (out) (transfer full) (nullable): return location for
+ *    the best matching contact, or %NULL
+ *
+ * Finds the contact in the @match_index which matches the @contact best,
+ * the same as eab_contact_locate_match_full() would find in the book,
+ * only without any book query. Only the contacts sharing at least one
+ * of the indexed values with the @contact are compared to it.
+ *
+ * Returns: how well the best contact matches, %EAB_CONTACT_MATCH_NONE
+ *    when no contact matches
+ *
+ * Since: 3.28
+ **/
+EABContactMatchType
+eab_contact_match_index_lookup (EABContactMatchIndex *match_index,
+                                EContact *contact,
+                                GList *avoid,
+                                EContact **out_match)
+{
+	EABContactMatchType best_match = EAB_CONTACT_MATCH_NONE;
+	EContact *best_contact = NULL;
+	GHashTable *avoid_uids, *compared;
+	GPtrArray *keys;
+	guint ii, jj;
+
+	if (out_match)
+		*out_match = NULL;
+
+	g_return_val_if_fail (match_index != NULL, EAB_CONTACT_MATCH_NONE);
+	g_return_val_if_fail (E_IS_CONTACT (contact), EAB_CONTACT_MATCH_NONE);
+
+	avoid_uids = avoid_uids_new (avoid);
+	compared = g_hash_table_new (g_direct_hash, g_direct_equal);
+	keys = match_index_dup_keys (contact, TRUE);
+
+	for (ii = 0; ii < keys->len && best_match != EAB_CONTACT_MATCH_EXACT; ii++) {
+		GPtrArray *bucket;
+
+		bucket = g_hash_table_lookup (match_index->buckets, keys->pdata[ii]);
+		if (!bucket)
+			continue;
+
+		for (jj = 0; jj < bucket->len && best_match != EAB_CONTACT_MATCH_EXACT; jj++) {
+			MatchIndexEntry *entry = bucket->pdata[jj];
+			EABContactMatchType this_match;
+
+			if (!g_hash_table_add (compared, entry))
+				continue;
+
+			if (avoid_uids && g_hash_table_contains (avoid_uids,
+			    e_contact_get_const (entry->contact, E_CONTACT_UID)))
+				continue;
+
+			this_match = eab_contact_compare (contact, entry->contact);
+			if ((gint) this_match > (gint) best_match) {
+				best_match = this_match;
+				best_contact = entry->contact;
+			}
+		}
+	}
+
+	if (out_match && best_contact)
+		*out_match = g_object_ref (best_contact);
+
+	g_ptr_array_unref (keys);
+	g_hash_table_destroy (compared);
+	if (avoid_uids)
+		g_hash_table_destroy (avoid_uids);
+
+	return best_match;
+}
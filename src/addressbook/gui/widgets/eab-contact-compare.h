@@ -43,6 +43,9 @@ typedef enum {
 	EAB_CONTACT_MATCH_PART_FAMILY_NAME = 1 << 3
 } EABContactMatchPart;
 
+/* Opaque structure */
+typedef struct _EABContactMatchIndex EABContactMatchIndex;
+
 typedef void	(*EABContactMatchQueryCallback)	(EContact *contact,
 						 EContact *match,
 						 EABContactMatchType type,
@@ -96,5 +99,29 @@ void		eab_contact_locate_match_full	(ESourceRegistry *registry,
 						 EABContactMatchQueryCallback cb,
 						 gpointer closure);
 
+EABContactMatchIndex *
+		eab_contact_match_index_new	(void);
+EABContactMatchIndex *
+		eab_contact_match_index_new_from_book_sync
+						(EBookClient *book_client,
+						 GCancellable *cancellable,
+						 GError **error);
+EABContactMatchIndex *
+		eab_contact_match_index_new_for_contacts_sync
+						(EBookClient *book_client,
+						 const GSList *contacts,
+						 GCancellable *cancellable,
+						 GError **error);
+void		eab_contact_match_index_free	(EABContactMatchIndex *match_index);
+void		eab_contact_match_index_add	(EABContactMatchIndex *match_index,
+						 EContact *contact);
+void		eab_contact_match_index_remove	(EABContactMatchIndex *match_index,
+						 const gchar *uid);
+EABContactMatchType
+		eab_contact_match_index_lookup	(EABContactMatchIndex *match_index,
+						 EContact *contact,
+						 GList *avoid,
+						 EContact **out_match);
+
 #endif /* __E_CONTACT_COMPARE_H__ */
 
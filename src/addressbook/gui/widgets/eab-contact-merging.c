@@ -87,19 +87,218 @@ static void match_query_callback (EContact *contact, EContact *match, EABContact
 #define SIMULTANEOUS_MERGING_REQUESTS 20
 #define EVOLUTION_UI_SLOT_PARAM "X-EVOLUTION-UI-SLOT"
 
+/* When this many lookups are pending for one book, like when copying
+ * or importing many contacts, all the book contacts are read and indexed
+ * once, instead of querying the book for each of the contacts. */
+#define BULK_MERGING_REQUESTS 50
+
 static GList *merging_queue = NULL;
 static gint running_merge_requests = 0;
 
+typedef struct {
+	EBookClient *book_client;
+	/* Lookups for the book not freed yet */
+	guint n_lookups;
+	EABContactMatchIndex *match_index;
+	gboolean building;
+	gboolean build_failed;
+	/* Lookups waiting for the index to be built */
+	GSList *waiting;
+	/* Contacts saved into the book while the index is built */
+	GSList *saved_contacts;
+} MergingBookIndex;
+
+/* EBookClient * ~> MergingBookIndex * */
+static GHashTable *merging_book_indexes = NULL;
+
 static void
-add_lookup (EContactMergingLookup *lookup)
+merging_book_index_unref (EBookClient *book_client)
 {
-	if (running_merge_requests < SIMULTANEOUS_MERGING_REQUESTS) {
-		running_merge_requests++;
+	MergingBookIndex *bi;
+
+	bi = merging_book_indexes ? g_hash_table_lookup (merging_book_indexes, book_client) : NULL;
+	g_return_if_fail (bi != NULL);
+
+	bi->n_lookups--;
+
+	/* The build callback frees it */
+	if (bi->n_lookups > 0 || bi->building)
+		return;
+
+	g_hash_table_remove (merging_book_indexes, book_client);
+
+	eab_contact_match_index_free (bi->match_index);
+	g_slist_free_full (bi->saved_contacts, g_object_unref);
+	g_object_unref (bi->book_client);
+	g_free (bi);
+}
+
+/* Records a contact saved into the book, thus the following lookups
+ * from the index see it as well */
+static void
+merging_book_index_saved (EBookClient *book_client,
+                          EContact *contact,
+                          const gchar *uid)
+{
+	MergingBookIndex *bi;
+
+	bi = merging_book_indexes ? g_hash_table_lookup (merging_book_indexes, book_client) : NULL;
+	if (!bi || !contact || !uid || !(bi->match_index || bi->building))
+		return;
+
+	contact = e_contact_duplicate (contact);
+	e_contact_set (contact, E_CONTACT_UID, uid);
+
+	if (bi->match_index)
+		eab_contact_match_index_add (bi->match_index, contact);
+	else
+		bi->saved_contacts = g_slist_prepend (bi->saved_contacts, g_object_ref (contact));
+
+	g_object_unref (contact);
+}
+
+static void
+merging_book_index_removed (EBookClient *book_client,
+                            const gchar *uid)
+{
+	MergingBookIndex *bi;
+
+	bi = merging_book_indexes ? g_hash_table_lookup (merging_book_indexes, book_client) : NULL;
+	if (bi && bi->match_index && uid)
+		eab_contact_match_index_remove (bi->match_index, uid);
+}
+
+static gboolean
+lookup_from_index_idle_cb (gpointer user_data)
+{
+	EContactMergingLookup *lookup = user_data;
+	MergingBookIndex *bi;
+	EContact *match = NULL;
+	EABContactMatchType type;
+
+	bi = g_hash_table_lookup (merging_book_indexes, lookup->book_client);
+	g_return_val_if_fail (bi != NULL && bi->match_index != NULL, FALSE);
+
+	type = eab_contact_match_index_lookup (bi->match_index, lookup->contact, lookup->avoid, &match);
+
+	match_query_callback (lookup->contact, match, type, lookup);
+
+	g_clear_object (&match);
+
+	return FALSE;
+}
+
+static void
+locate_match (EContactMergingLookup *lookup)
+{
+	MergingBookIndex *bi;
+
+	bi = g_hash_table_lookup (merging_book_indexes, lookup->book_client);
+	g_return_if_fail (bi != NULL);
+
+	if (bi->match_index) {
+		g_idle_add (lookup_from_index_idle_cb, lookup);
+	} else if (bi->building) {
+		bi->waiting = g_slist_prepend (bi->waiting, lookup);
+	} else {
 		eab_contact_locate_match_full (
 			lookup->registry, lookup->book_client,
 			lookup->contact, lookup->avoid,
 			match_query_callback, lookup);
 	}
+}
+
+static void
+merging_book_index_build_thread (GTask *task,
+                                 gpointer source_object,
+                                 gpointer task_data,
+                                 GCancellable *cancellable)
+{
+	EABContactMatchIndex *match_index;
+	GError *local_error = NULL;
+
+	match_index = eab_contact_match_index_new_from_book_sync (E_BOOK_CLIENT (source_object), cancellable, &local_error);
+
+	if (match_index)
+		g_task_return_pointer (task, match_index, (GDestroyNotify) eab_contact_match_index_free);
+	else
+		g_task_return_error (task, local_error);
+}
+
+static void
+merging_book_index_build_done_cb (GObject *source_object,
+                                  GAsyncResult *result,
+                                  gpointer user_data)
+{
+	MergingBookIndex *bi = user_data;
+	GSList *waiting, *link;
+	GError *local_error = NULL;
+
+	bi->building = FALSE;
+	bi->match_index = g_task_propagate_pointer (G_TASK (result), &local_error);
+
+	if (bi->match_index) {
+		bi->saved_contacts = g_slist_reverse (bi->saved_contacts);
+
+		for (link = bi->saved_contacts; link; link = g_slist_next (link)) {
+			eab_contact_match_index_add (bi->match_index, link->data);
+		}
+	} else {
+		g_warning ("%s: Failed to index contacts: %s", G_STRFUNC, local_error ? local_error->message : "Unknown error");
+		bi->build_failed = TRUE;
+	}
+
+	g_slist_free_full (bi->saved_contacts, g_object_unref);
+	bi->saved_contacts = NULL;
+
+	waiting = g_slist_reverse (bi->waiting);
+	bi->waiting = NULL;
+
+	for (link = waiting; link; link = g_slist_next (link)) {
+		locate_match (link->data);
+	}
+
+	g_slist_free (waiting);
+	g_clear_error (&local_error);
+
+	/* All the lookups could finish meanwhile */
+	bi->n_lookups++;
+	merging_book_index_unref (bi->book_client);
+}
+
+static void
+add_lookup (EContactMergingLookup *lookup)
+{
+	MergingBookIndex *bi;
+
+	if (!merging_book_indexes)
+		merging_book_indexes = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	bi = g_hash_table_lookup (merging_book_indexes, lookup->book_client);
+	if (!bi) {
+		bi = g_new0 (MergingBookIndex, 1);
+		bi->book_client = g_object_ref (lookup->book_client);
+		g_hash_table_insert (merging_book_indexes, bi->book_client, bi);
+	}
+
+	bi->n_lookups++;
+
+	if (bi->n_lookups >= BULK_MERGING_REQUESTS && !bi->match_index &&
+	    !bi->building && !bi->build_failed) {
+		GTask *task;
+
+		bi->building = TRUE;
+
+		task = g_task_new (bi->book_client, NULL, merging_book_index_build_done_cb, bi);
+		g_task_set_source_tag (task, add_lookup);
+		g_task_run_in_thread (task, merging_book_index_build_thread);
+		g_object_unref (task);
+	}
+
+	if (running_merge_requests < SIMULTANEOUS_MERGING_REQUESTS) {
+		running_merge_requests++;
+		locate_match (lookup);
+	}
 	else {
 		merging_queue = g_list_append (merging_queue, lookup);
 	}
@@ -121,16 +320,15 @@ finished_lookup (void)
 		merging_queue = g_list_remove_link (merging_queue, merging_queue);
 
 		running_merge_requests++;
-		eab_contact_locate_match_full (
-			lookup->registry, lookup->book_client,
-			lookup->contact, lookup->avoid,
-			match_query_callback, lookup);
+		locate_match (lookup);
 	}
 }
 
 static void
 free_lookup (EContactMergingLookup *lookup)
 {
+	merging_book_index_unref (lookup->book_client);
+
 	g_object_unref (lookup->registry);
 	g_object_unref (lookup->book_client);
 	g_object_unref (lookup->contact);
@@ -205,7 +403,8 @@ modify_contact_ready_cb (GObject *source_object,
 	g_return_if_fail (book_client != NULL);
 	g_return_if_fail (lookup != NULL);
 
-	e_book_client_modify_contact_finish (book_client, result, &error);
+	if (e_book_client_modify_contact_finish (book_client, result, &error))
+		merging_book_index_saved (book_client, lookup->contact, e_contact_get_const (lookup->contact, E_CONTACT_UID));
 
 	if (lookup->op == E_CONTACT_MERGING_ADD)
 		final_cb_as_id (book_client, error, lookup);
@@ -229,7 +428,8 @@ add_contact_ready_cb (GObject *source_object,
 	g_return_if_fail (book_client != NULL);
 	g_return_if_fail (lookup != NULL);
 
-	e_book_client_add_contact_finish (book_client, result, &uid, &error);
+	if (e_book_client_add_contact_finish (book_client, result, &uid, &error))
+		merging_book_index_saved (book_client, lookup->contact, uid);
 
 	final_id_cb (book_client, error, uid, lookup);
 
@@ -329,7 +529,8 @@ remove_contact_ready_cb (GObject *source_object,
 	g_return_if_fail (book_client != NULL);
 	g_return_if_fail (lookup != NULL);
 
-	e_book_client_remove_contact_finish (book_client, result, &error);
+	if (e_book_client_remove_contact_finish (book_client, result, &error))
+		merging_book_index_removed (book_client, e_contact_get_const (lookup->contact, E_CONTACT_UID));
 
 	if (error != NULL) {
 		g_warning (
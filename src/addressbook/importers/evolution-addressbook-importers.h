@@ -18,6 +18,8 @@
  */
 
 #include <gtk/gtk.h>
+#include <libebook/libebook.h>
+#include <e-util/e-util.h>
 
 struct _EImportImporter *evolution_ldif_importer_peek (void);
 struct _EImportImporter *evolution_vcard_importer_peek (void);
@@ -25,5 +27,28 @@ struct _EImportImporter *evolution_csv_outlook_importer_peek (void);
 struct _EImportImporter *evolution_csv_mozilla_importer_peek (void);
 struct _EImportImporter *evolution_csv_evolution_importer_peek (void);
 
-/* private utility function for importers only */
+/* private utility functions for importers only */
 GtkWidget *evolution_contact_importer_get_preview_widget (const GSList *contacts);
+
+/* Called in the import thread; returns the next contact, or NULL at the end
+ * of the input. Sets the bytes of the input read so far to out_bytes_read. */
+typedef EContact *(* EvolutionContactImporterNextFunc) (gpointer user_data,
+							 goffset *out_bytes_read,
+							 GCancellable *cancellable);
+/* Called in the import thread after the last contact; returns contacts to import
+ * after all the others have been added, like contact lists referencing them. */
+typedef GSList *(* EvolutionContactImporterFinishFunc) (gpointer user_data,
+							 GCancellable *cancellable);
+/* Called in the main thread when the import is over */
+typedef void (* EvolutionContactImporterDoneFunc) (gpointer user_data,
+						   const GError *error);
+
+void evolution_contact_importer_run (EImport *ei,
+				     EImportTarget *target,
+				     EBookClient *book_client,
+				     goffset total_bytes,
+				     EvolutionContactImporterNextFunc next_func,
+				     EvolutionContactImporterFinishFunc finish_func,
+				     EvolutionContactImporterDoneFunc done_func,
+				     gpointer user_data,
+				     GCancellable *cancellable);
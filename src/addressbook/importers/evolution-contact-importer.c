@@ -0,0 +1,465 @@
+/*
+ * Evolution contact importers - shared import pipeline
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "evolution-config.h"
+
+#include <glib/gi18n.h>
+
+#include "addressbook/gui/widgets/eab-contact-compare.h"
+
+#include "evolution-addressbook-importers.h"
+
+/* How many contacts are sent to the book in one call */
+#define IMPORT_BATCH_SIZE 100
+
+typedef struct _ImportContext {
+	EImport *import;
+	EImportTarget *target;
+	EBookClient *book_client;
+	goffset total_bytes;
+
+	EvolutionContactImporterNextFunc next_func;
+	EvolutionContactImporterFinishFunc finish_func;
+	EvolutionContactImporterDoneFunc done_func;
+	gpointer user_data;
+
+	/* Progress in per-mille, written by the import thread */
+	volatile gint progress;
+	guint progress_id;
+
+	/* Contacts already in the book and those the book
+	 * refused, written by the import thread */
+	volatile gint n_skipped;
+	volatile gint n_failed;
+} ImportContext;
+
+static void
+import_context_free (gpointer ptr)
+{
+	ImportContext *ic = ptr;
+
+	if (ic) {
+		if (ic->progress_id)
+			g_source_remove (ic->progress_id);
+
+		g_clear_object (&ic->import);
+		g_clear_object (&ic->book_client);
+		g_slice_free (ImportContext, ic);
+	}
+}
+
+static gboolean
+import_context_progress_cb (gpointer user_data)
+{
+	ImportContext *ic = user_data;
+	guint n_skipped, n_failed;
+	gchar *what;
+
+	n_skipped = g_atomic_int_get (&ic->n_skipped);
+	n_failed = g_atomic_int_get (&ic->n_failed);
+
+	if (n_skipped > 0 || n_failed > 0) {
+		GString *details = g_string_new ("");
+
+		if (n_skipped > 0) {
+			g_string_append_printf (details, ngettext (
+				"%u contact already in the book",
+				"%u contacts already in the book",
+				n_skipped), n_skipped);
+		}
+
+		if (n_failed > 0) {
+			if (details->len)
+				g_string_append (details, ", ");
+
+			g_string_append_printf (details, ngettext (
+				"%u contact could not be added",
+				"%u contacts could not be added",
+				n_failed), n_failed);
+		}
+
+		/* Translators: The '%s' is replaced with the count of the skipped contacts,
+		   like "3 contacts already in the book, 1 contact could not be added" */
+		what = g_strdup_printf (_("Importing... (%s)"), details->str);
+
+		g_string_free (details, TRUE);
+	} else {
+		what = g_strdup (_("Importing..."));
+	}
+
+	e_import_status (
+		ic->import, ic->target, what,
+		g_atomic_int_get (&ic->progress) / 10);
+
+	g_free (what);
+
+	return TRUE;
+}
+
+/* Returns the vCard of the @contact without the values
+ * the book sets, thus two copies of a contact compare equal. */
+static gchar *
+import_context_dup_contact_data (EContact *contact)
+{
+	EContact *copy;
+	gchar *data;
+
+	copy = e_contact_duplicate (contact);
+	e_vcard_remove_attributes (E_VCARD (copy), NULL, EVC_UID);
+	e_vcard_remove_attributes (E_VCARD (copy), NULL, EVC_REV);
+
+	data = e_vcard_to_string (E_VCARD (copy), EVC_FORMAT_VCARD_30);
+
+	g_object_unref (copy);
+
+	return data;
+}
+
+/* Whether the book already contains the very same contact, like when
+ * the same file is imported for the second time. The @contact gets
+ * the UID of the stored contact then, for the lists referencing it. */
+static gboolean
+import_context_is_duplicate (EABContactMatchIndex *match_index,
+                             EContact *contact)
+{
+	EContact *match = NULL;
+	gboolean is_duplicate = FALSE;
+
+	if (eab_contact_match_index_lookup (match_index, contact, NULL, &match) == EAB_CONTACT_MATCH_EXACT) {
+		gchar *data1, *data2;
+
+		data1 = import_context_dup_contact_data (contact);
+		data2 = import_context_dup_contact_data (match);
+
+		is_duplicate = g_strcmp0 (data1, data2) == 0;
+
+		if (is_duplicate)
+			e_contact_set (contact, E_CONTACT_UID, e_contact_get_const (match, E_CONTACT_UID));
+
+		g_free (data1);
+		g_free (data2);
+	}
+
+	g_clear_object (&match);
+
+	return is_duplicate;
+}
+
+/* Whether the @error means the book cannot be written at all,
+ * not only that it refused some of the contacts. */
+static gboolean
+import_context_is_fatal_error (const GError *error)
+{
+	if (!error)
+		return FALSE;
+
+	if (error->domain == G_IO_ERROR || error->domain == G_DBUS_ERROR)
+		return TRUE;
+
+	if (error->domain == E_CLIENT_ERROR) {
+		switch (error->code) {
+		case E_CLIENT_ERROR_BUSY:
+		case E_CLIENT_ERROR_REPOSITORY_OFFLINE:
+		case E_CLIENT_ERROR_OFFLINE_UNAVAILABLE:
+		case E_CLIENT_ERROR_PERMISSION_DENIED:
+		case E_CLIENT_ERROR_AUTHENTICATION_FAILED:
+		case E_CLIENT_ERROR_AUTHENTICATION_REQUIRED:
+		case E_CLIENT_ERROR_TLS_NOT_AVAILABLE:
+		case E_CLIENT_ERROR_DBUS_ERROR:
+		case E_CLIENT_ERROR_NO_SUCH_BOOK:
+		case E_CLIENT_ERROR_NO_SUCH_SOURCE:
+			return TRUE;
+		default:
+			break;
+		}
+	}
+
+	return FALSE;
+}
+
+/* Returns the @contacts the book does not contain yet, as a new list without
+ * references; the book is queried only for those which can match them. */
+static GSList *
+import_context_filter_duplicates (ImportContext *ic,
+                                  GSList *contacts,
+                                  GCancellable *cancellable)
+{
+	EABContactMatchIndex *match_index;
+	GSList *link, *filtered = NULL;
+	GError *local_error = NULL;
+
+	match_index = eab_contact_match_index_new_for_contacts_sync (ic->book_client, contacts, cancellable, &local_error);
+
+	if (!match_index) {
+		if (!g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_debug ("%s: Failed to look up existing contacts, duplicates will not be skipped: %s",
+				G_STRFUNC, local_error ? local_error->message : "Unknown error");
+		g_clear_error (&local_error);
+
+		return g_slist_copy (contacts);
+	}
+
+	for (link = contacts; link; link = g_slist_next (link)) {
+		if (import_context_is_duplicate (match_index, link->data))
+			g_atomic_int_inc (&ic->n_skipped);
+		else
+			filtered = g_slist_prepend (filtered, link->data);
+	}
+
+	eab_contact_match_index_free (match_index);
+
+	return g_slist_reverse (filtered);
+}
+
+/* Adds the @contacts to the book one by one, skipping those it refuses */
+static gboolean
+import_context_add_one_by_one (ImportContext *ic,
+                               GSList *contacts,
+                               GCancellable *cancellable,
+                               GError **error)
+{
+	GSList *link;
+
+	for (link = contacts; link; link = g_slist_next (link)) {
+		gchar *uid = NULL;
+		GError *local_error = NULL;
+
+		if (e_book_client_add_contact_sync (ic->book_client, link->data, &uid, cancellable, &local_error)) {
+			if (uid)
+				e_contact_set (link->data, E_CONTACT_UID, uid);
+		} else if (import_context_is_fatal_error (local_error)) {
+			g_propagate_error (error, local_error);
+			return FALSE;
+		} else {
+			g_debug ("%s: Failed to add contact: %s", G_STRFUNC, local_error ? local_error->message : "Unknown error");
+			g_atomic_int_inc (&ic->n_failed);
+			g_clear_error (&local_error);
+		}
+
+		g_free (uid);
+	}
+
+	return TRUE;
+}
+
+/* Adds those of the @contacts, which are not in the book yet, to the book and
+ * sets their UID-s to those assigned by the book, thus they can be referenced
+ * later. The contacts already in the book get the UID of the stored contact. */
+static gboolean
+import_context_submit (ImportContext *ic,
+                       GSList *contacts,
+                       GCancellable *cancellable,
+                       GError **error)
+{
+	GSList *to_add, *uids = NULL, *link, *ulink;
+	gboolean success = TRUE;
+	GError *local_error = NULL;
+
+	if (!contacts)
+		return TRUE;
+
+	to_add = import_context_filter_duplicates (ic, contacts, cancellable);
+
+	if (!to_add)
+		return TRUE;
+
+	if (e_book_client_add_contacts_sync (ic->book_client, to_add, &uids, cancellable, &local_error)) {
+		for (link = to_add, ulink = uids; link && ulink; link = g_slist_next (link), ulink = g_slist_next (ulink)) {
+			if (ulink->data)
+				e_contact_set (link->data, E_CONTACT_UID, ulink->data);
+		}
+
+		g_slist_free_full (uids, g_free);
+	} else if (import_context_is_fatal_error (local_error)) {
+		g_propagate_error (error, local_error);
+		success = FALSE;
+	} else {
+		g_clear_error (&local_error);
+
+		/* The book refuses the whole batch when any of its contacts
+		 * cannot be added, thus add them one by one and skip those. */
+		success = import_context_add_one_by_one (ic, to_add, cancellable, error);
+	}
+
+	g_slist_free (to_add);
+
+	return success;
+}
+
+static void
+import_context_thread (GTask *task,
+                       gpointer source_object,
+                       gpointer task_data,
+                       GCancellable *cancellable)
+{
+	ImportContext *ic = task_data;
+	EContact *contact;
+	GSList *batch = NULL;
+	guint batch_len = 0;
+	goffset bytes_read = 0;
+	GError *local_error = NULL;
+	gboolean success = TRUE;
+
+	while (success && !g_cancellable_is_cancelled (cancellable) &&
+	       (contact = ic->next_func (ic->user_data, &bytes_read, cancellable)) != NULL) {
+		batch = g_slist_prepend (batch, contact);
+		batch_len++;
+
+		if (batch_len >= IMPORT_BATCH_SIZE) {
+			batch = g_slist_reverse (batch);
+			success = import_context_submit (ic, batch, cancellable, &local_error);
+			g_slist_free_full (batch, g_object_unref);
+			batch = NULL;
+			batch_len = 0;
+		}
+
+		if (ic->total_bytes > 0)
+			g_atomic_int_set (&ic->progress, (gint) (MIN (bytes_read, ic->total_bytes) * 1000 / ic->total_bytes));
+	}
+
+	batch = g_slist_reverse (batch);
+
+	if (success && !g_cancellable_is_cancelled (cancellable))
+		success = import_context_submit (ic, batch, cancellable, &local_error);
+
+	g_slist_free_full (batch, g_object_unref);
+
+	/* Contacts which depend on the UID-s of the others */
+	if (success && ic->finish_func && !g_cancellable_is_cancelled (cancellable)) {
+		GSList *contacts, *link;
+
+		contacts = ic->finish_func (ic->user_data, cancellable);
+
+		for (link = contacts; link && success; ) {
+			GSList *batch_end = g_slist_nth (link, IMPORT_BATCH_SIZE - 1), *next = NULL;
+
+			if (batch_end) {
+				next = batch_end->next;
+				batch_end->next = NULL;
+			}
+
+			success = import_context_submit (ic, link, cancellable, &local_error);
+
+			if (batch_end)
+				batch_end->next = next;
+
+			link = next;
+		}
+
+		g_slist_free_full (contacts, g_object_unref);
+	}
+
+	if (ic->n_skipped > 0 || ic->n_failed > 0)
+		g_debug ("%s: Skipped %d contacts already in the book, %d contacts the book refused", G_STRFUNC, ic->n_skipped, ic->n_failed);
+
+	if (local_error)
+		g_task_return_error (task, local_error);
+	else
+		g_task_return_boolean (task, TRUE);
+}
+
+static void
+import_context_done_cb (GObject *source_object,
+                        GAsyncResult *result,
+                        gpointer user_data)
+{
+	ImportContext *ic;
+	GError *local_error = NULL;
+
+	ic = g_task_get_task_data (G_TASK (result));
+
+	/* The final counts of the skipped contacts */
+	import_context_progress_cb (ic);
+
+	if (!g_task_propagate_boolean (G_TASK (result), &local_error) &&
+	    g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		g_clear_error (&local_error);
+
+	ic->done_func (ic->user_data, local_error);
+
+	g_clear_error (&local_error);
+}
+
+/**
+ * evolution_contact_importer_run:
+ * @ei: an #EImport
+ * @target: an #EImportTarget
+ * @book_client: an #EBookClient to import the contacts to
+ * @total_bytes: the size of the input, to report progress, or 0
+ * @next_func: (scope async): an #EvolutionContactImporterNextFunc
+ * @finish_func: (scope async) (nullable): an #EvolutionContactImporterFinishFunc
+ * @done_func: (scope async): an #EvolutionContactImporterDoneFunc
+ * @user_data: user data passed to the functions
+ * @cancellable: (nullable): a #GCancellable to cancel the import with
+ *
+ * Imports contacts into the @book_client in a dedicated thread. The @next_func
+ * is called in that thread to parse the contacts one by one; they are added to
+ * the book in batches and released afterwards, thus the memory use does not
+ * grow with the size of the input. The contacts the book already contains
+ * with the same content are skipped; for each batch, the book is queried only
+ * for the contacts which can match it. The contacts the book refuses are
+ * skipped as well; both are counted in the import status. When the
+ * @next_func returns %NULL, the @finish_func, if set, can return contacts
+ * which reference those imported so far, like contact lists. The progress
+ * is reported in the main thread, by the bytes read out of the @total_bytes.
+ *
+ * The @done_func is called in the main thread once the import is finished,
+ * failed or cancelled; it is expected to free the @user_data and to call
+ * e_import_complete().
+ *
+ * Since: 3.28
+ **/
+void
+evolution_contact_importer_run (EImport *ei,
+                                EImportTarget *target,
+                                EBookClient *book_client,
+                                goffset total_bytes,
+                                EvolutionContactImporterNextFunc next_func,
+                                EvolutionContactImporterFinishFunc finish_func,
+                                EvolutionContactImporterDoneFunc done_func,
+                                gpointer user_data,
+                                GCancellable *cancellable)
+{
+	ImportContext *ic;
+	GTask *task;
+
+	g_return_if_fail (E_IS_IMPORT (ei));
+	g_return_if_fail (target != NULL);
+	g_return_if_fail (E_IS_BOOK_CLIENT (book_client));
+	g_return_if_fail (next_func != NULL);
+	g_return_if_fail (done_func != NULL);
+
+	ic = g_slice_new0 (ImportContext);
+	ic->import = g_object_ref (ei);
+	ic->target = target;
+	ic->book_client = g_object_ref (book_client);
+	ic->total_bytes = total_bytes;
+	ic->next_func = next_func;
+	ic->finish_func = finish_func;
+	ic->done_func = done_func;
+	ic->user_data = user_data;
+	ic->progress_id = e_named_timeout_add (250, import_context_progress_cb, ic);
+
+	task = g_task_new (NULL, cancellable, import_context_done_cb, NULL);
+	g_task_set_source_tag (task, evolution_contact_importer_run);
+	g_task_set_task_data (task, ic, import_context_free);
+	g_task_set_return_on_cancel (task, FALSE);
+
+	g_task_run_in_thread (task, import_context_thread);
+
+	g_object_unref (task);
+}
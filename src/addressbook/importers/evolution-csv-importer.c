@@ -49,9 +49,8 @@ typedef struct {
 	EImport *import;
 	EImportTarget *target;
 
-	guint idle_id;
+	GCancellable *cancellable;
 
-	gint state;
 	FILE *file;
 	gulong size;
 	gint count;
@@ -61,14 +60,11 @@ typedef struct {
 	GHashTable *fields_map;
 
 	EBookClient *book_client;
-	GSList *contacts;
 } CSVImporter;
 
 static gint importer;
 static gchar delimiter;
 
-static void csv_import_done (CSVImporter *gci);
-
 typedef struct {
 	const gchar *csv_attribute;
 	EContactField contact_field;
@@ -716,36 +712,19 @@ getNextCSVEntry (CSVImporter *gci,
 	return contact;
 }
 
-static gboolean
-csv_import_contacts (gpointer d)
+/* Called in the import thread */
+static EContact *
+csv_import_next_contact (gpointer user_data,
+                         goffset *out_bytes_read,
+                         GCancellable *cancellable)
 {
-	CSVImporter *gci = d;
-	EContact *contact = NULL;
+	CSVImporter *gci = user_data;
+	EContact *contact;
 
-	while ((contact = getNextCSVEntry (gci, gci->file))) {
-		gchar *uid = NULL;
+	contact = getNextCSVEntry (gci, gci->file);
+	*out_bytes_read = ftell (gci->file);
 
-		e_book_client_add_contact_sync (
-			gci->book_client, contact, &uid, NULL, NULL);
-		if (uid != NULL) {
-			e_contact_set (contact, E_CONTACT_UID, uid);
-			g_free (uid);
-		}
-		gci->contacts = g_slist_prepend (gci->contacts, contact);
-	}
-	if (contact == NULL) {
-		gci->state = 1;
-	}
-	if (gci->state == 1) {
-		csv_import_done (gci);
-		return FALSE;
-	}
-	else {
-		e_import_status (
-			gci->import, gci->target, _("Importing..."),
-			ftell (gci->file) * 100 / gci->size);
-		return TRUE;
-	}
+	return contact;
 }
 
 static void
@@ -860,20 +839,21 @@ csv_supported (EImport *ei,
 }
 
 static void
-csv_import_done (CSVImporter *gci)
+csv_import_done (gpointer user_data,
+                 const GError *error)
 {
-	if (gci->idle_id)
-		g_source_remove (gci->idle_id);
+	CSVImporter *gci = user_data;
+
+	g_datalist_set_data (&gci->target->data, "csv-data", NULL);
 
 	fclose (gci->file);
-	g_object_unref (gci->book_client);
-	g_slist_foreach (gci->contacts, (GFunc) g_object_unref, NULL);
-	g_slist_free (gci->contacts);
+	g_clear_object (&gci->book_client);
+	g_clear_object (&gci->cancellable);
 
 	if (gci->fields_map)
 		g_hash_table_destroy (gci->fields_map);
 
-	e_import_complete (gci->import, gci->target, NULL);
+	e_import_complete (gci->import, gci->target, error);
 	g_object_unref (gci->import);
 
 	g_free (gci);
@@ -890,12 +870,16 @@ book_client_connect_cb (GObject *source_object,
 	client = e_book_client_connect_finish (result, NULL);
 
 	if (client == NULL) {
-		csv_import_done (gci);
+		csv_import_done (gci, NULL);
 		return;
 	}
 
 	gci->book_client = E_BOOK_CLIENT (client);
-	gci->idle_id = g_idle_add (csv_import_contacts, gci);
+
+	evolution_contact_importer_run (
+		gci->import, gci->target, gci->book_client, gci->size,
+		csv_import_next_contact, NULL, csv_import_done,
+		gci, gci->cancellable);
 }
 
 static void
@@ -935,6 +919,7 @@ csv_import (EImport *ei,
 	g_datalist_set_data (&target->data, "csv-data", gci);
 	gci->import = g_object_ref (ei);
 	gci->target = target;
+	gci->cancellable = g_cancellable_new ();
 	gci->file = file;
 	gci->fields_map = NULL;
 	gci->count = 0;
@@ -944,7 +929,7 @@ csv_import (EImport *ei,
 
 	source = g_datalist_get_data (&target->data, "csv-source");
 
-	e_book_client_connect (source, 30, NULL, book_client_connect_cb, gci);
+	e_book_client_connect (source, 30, gci->cancellable, book_client_connect_cb, gci);
 }
 
 static void
@@ -982,7 +967,7 @@ csv_cancel (EImport *ei,
 	CSVImporter *gci = g_datalist_get_data (&target->data, "csv-data");
 
 	if (gci)
-		gci->state = 1;
+		g_cancellable_cancel (gci->cancellable);
 }
 
 static GtkWidget *
@@ -49,23 +49,20 @@ typedef struct {
 	EImport *import;
 	EImportTarget *target;
 
-	guint idle_id;
+	GCancellable *cancellable;
 
 	GHashTable *dn_contact_hash;
 
-	gint state;		/* 0 - initial scan, 1 - list cards, 2 - cancelled/complete */
 	FILE *file;
 	gulong size;
 
 	EBookClient *book_client;
 
+	/* Referenced by the dn_contact_hash */
 	GSList *contacts;
 	GSList *list_contacts;
-	GSList *list_iterator;
 } LDIFImporter;
 
-static void ldif_import_done (LDIFImporter *gci);
-
 static struct {
 	const gchar *ldif_attribute;
 	EContactField contact_field;
@@ -481,73 +478,52 @@ add_to_notes (EContact *contact,
 	g_free (new_text);
 }
 
-static gboolean
-ldif_import_contacts (gpointer d)
+/* Called in the import thread. The list cards are kept till the end,
+ * when the contacts they reference have their UID-s assigned. */
+static EContact *
+ldif_import_next_contact (gpointer user_data,
+                          goffset *out_bytes_read,
+                          GCancellable *cancellable)
 {
-	LDIFImporter *gci = d;
+	LDIFImporter *gci = user_data;
 	EContact *contact;
-	GSList *iter;
-	gint count = 0;
-
-	/* We process all normal cards immediately and keep the list
-	 * ones till the end */
-
-	if (gci->state == 0) {
-		while (count < 50 && (contact = getNextLDIFEntry (
-			gci->dn_contact_hash, gci->file))) {
-			if (e_contact_get (contact, E_CONTACT_IS_LIST)) {
-				gci->list_contacts = g_slist_prepend (
-					gci->list_contacts, contact);
-			} else {
-				gchar *uid = NULL;
-
-				add_to_notes (contact, E_CONTACT_OFFICE);
-				add_to_notes (contact, E_CONTACT_SPOUSE);
-				add_to_notes (contact, E_CONTACT_BLOG_URL);
-
-				e_book_client_add_contact_sync (
-					gci->book_client,
-					contact, &uid, NULL, NULL);
-				if (uid != NULL) {
-					e_contact_set (contact, E_CONTACT_UID, uid);
-					g_free (uid);
-				}
-				gci->contacts = g_slist_prepend (gci->contacts, contact);
-			}
-			count++;
-		}
-		if (contact == NULL) {
-			gci->state = 1;
-			gci->list_iterator = gci->list_contacts;
-		}
+
+	while ((contact = getNextLDIFEntry (gci->dn_contact_hash, gci->file)) != NULL) {
+		if (!e_contact_get (contact, E_CONTACT_IS_LIST))
+			break;
+
+		gci->list_contacts = g_slist_prepend (gci->list_contacts, contact);
 	}
-	if (gci->state == 1) {
-		for (iter = gci->list_iterator; count < 50 && iter; iter = iter->next) {
-			gchar *uid = NULL;
-
-			contact = iter->data;
-			resolve_list_card (gci, contact);
-			e_book_client_add_contact_sync (
-				gci->book_client, contact, &uid, NULL, NULL);
-			if (uid != NULL) {
-				e_contact_set (contact, E_CONTACT_UID, uid);
-				g_free (uid);
-			}
-			count++;
-		}
-		gci->list_iterator = iter;
-		if (iter == NULL)
-			gci->state = 2;
+
+	*out_bytes_read = ftell (gci->file);
+
+	if (contact) {
+		add_to_notes (contact, E_CONTACT_OFFICE);
+		add_to_notes (contact, E_CONTACT_SPOUSE);
+		add_to_notes (contact, E_CONTACT_BLOG_URL);
+
+		gci->contacts = g_slist_prepend (gci->contacts, g_object_ref (contact));
 	}
-	if (gci->state == 2) {
-		ldif_import_done (gci);
-		return FALSE;
-	} else {
-		e_import_status (
-			gci->import, gci->target, _("Importing..."),
-			ftell (gci->file) * 100 / gci->size);
-		return TRUE;
+
+	return contact;
+}
+
+/* Called in the import thread */
+static GSList *
+ldif_import_list_contacts (gpointer user_data,
+                           GCancellable *cancellable)
+{
+	LDIFImporter *gci = user_data;
+	GSList *contacts, *link;
+
+	contacts = g_slist_reverse (gci->list_contacts);
+	gci->list_contacts = NULL;
+
+	for (link = contacts; link; link = g_slist_next (link)) {
+		resolve_list_card (gci, link->data);
 	}
+
+	return contacts;
 }
 
 static void
@@ -655,20 +631,21 @@ ldif_supported (EImport *ei,
 }
 
 static void
-ldif_import_done (LDIFImporter *gci)
+ldif_import_done (gpointer user_data,
+                  const GError *error)
 {
-	if (gci->idle_id)
-		g_source_remove (gci->idle_id);
+	LDIFImporter *gci = user_data;
+
+	g_datalist_set_data (&gci->target->data, "ldif-data", NULL);
 
 	fclose (gci->file);
-	g_object_unref (gci->book_client);
-	g_slist_foreach (gci->contacts, (GFunc) g_object_unref, NULL);
-	g_slist_foreach (gci->list_contacts, (GFunc) g_object_unref, NULL);
-	g_slist_free (gci->contacts);
-	g_slist_free (gci->list_contacts);
+	g_clear_object (&gci->book_client);
+	g_clear_object (&gci->cancellable);
+	g_slist_free_full (gci->contacts, g_object_unref);
+	g_slist_free_full (gci->list_contacts, g_object_unref);
 	g_hash_table_destroy (gci->dn_contact_hash);
 
-	e_import_complete (gci->import, gci->target, NULL);
+	e_import_complete (gci->import, gci->target, error);
 	g_object_unref (gci->import);
 
 	g_free (gci);
@@ -685,12 +662,16 @@ book_client_connect_cb (GObject *source_object,
 	client = e_book_client_connect_finish (result, NULL);
 
 	if (client == NULL) {
-		ldif_import_done (gci);
+		ldif_import_done (gci, NULL);
 		return;
 	}
 
 	gci->book_client = E_BOOK_CLIENT (client);
-	gci->idle_id = g_idle_add (ldif_import_contacts, gci);
+
+	evolution_contact_importer_run (
+		gci->import, gci->target, gci->book_client, gci->size,
+		ldif_import_next_contact, ldif_import_list_contacts,
+		ldif_import_done, gci, gci->cancellable);
 }
 
 static void
@@ -725,6 +706,7 @@ ldif_import (EImport *ei,
 	g_datalist_set_data (&target->data, "ldif-data", gci);
 	gci->import = g_object_ref (ei);
 	gci->target = target;
+	gci->cancellable = g_cancellable_new ();
 	gci->file = file;
 	fseek (file, 0, SEEK_END);
 	gci->size = ftell (file);
@@ -736,7 +718,7 @@ ldif_import (EImport *ei,
 
 	source = g_datalist_get_data (&target->data, "ldif-source");
 
-	e_book_client_connect (source, 30, NULL, book_client_connect_cb, gci);
+	e_book_client_connect (source, 30, gci->cancellable, book_client_connect_cb, gci);
 }
 
 static void
@@ -747,7 +729,7 @@ ldif_cancel (EImport *ei,
 	LDIFImporter *gci = g_datalist_get_data (&target->data, "ldif-data");
 
 	if (gci)
-		gci->state = 2;
+		g_cancellable_cancel (gci->cancellable);
 }
 
 static GtkWidget *
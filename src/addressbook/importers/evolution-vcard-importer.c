@@ -53,32 +53,30 @@ typedef struct {
 	EImport *import;
 	EImportTarget *target;
 
-	guint idle_id;
-
-	gint state;		/* 0 - importing, 1 - cancelled/complete */
-	gint total;
-	gint count;
+	GCancellable *cancellable;
 
 	ESource *primary;
 
-	GSList *contactlist;
-	GSList *iterator;
 	EBookClient *book_client;
 
-	/* when opening book */
+	/* when opening book; either the contents to be converted
+	 * to UTF-8, or the input stream of an UTF-8 file */
 	gchar *contents;
+	GInputStream *input;
 	VCardEncoding encoding;
-} VCardImporter;
+	goffset size;
 
-static void vcard_import_done (VCardImporter *gci);
+	/* used in the import thread */
+	GDataInputStream *stream;
+	goffset stream_size;
+	goffset bytes_read;
+} VCardImporter;
 
 static void
-vcard_import_contact (VCardImporter *gci,
-                      EContact *contact)
+vcard_import_contact (EContact *contact)
 {
 	EContactPhoto *photo;
 	GList *attrs, *attr;
-	gchar *uid = NULL;
 
 	/* Apple's addressbook.app exports PHOTO's without a TYPE
 	 * param, so let's figure out the format here if there's a
@@ -211,43 +209,6 @@ vcard_import_contact (VCardImporter *gci,
 								"OTHER");
 		}
 	}
-
-	/* FIXME Error checking */
-	e_book_client_add_contact_sync (
-		gci->book_client, contact, &uid, NULL, NULL);
-	if (uid != NULL) {
-		e_contact_set (contact, E_CONTACT_UID, uid);
-		g_free (uid);
-	}
-}
-
-static gboolean
-vcard_import_contacts (gpointer data)
-{
-	VCardImporter *gci = data;
-	gint count = 0;
-	GSList *iterator = gci->iterator;
-
-	if (gci->state == 0) {
-		while (count < 50 && iterator) {
-			vcard_import_contact (gci, iterator->data);
-			count++;
-			iterator = iterator->next;
-		}
-		gci->count += count;
-		gci->iterator = iterator;
-		if (iterator == NULL)
-			gci->state = 1;
-	}
-	if (gci->state == 1) {
-		vcard_import_done (gci);
-		return FALSE;
-	} else {
-		e_import_status (
-			gci->import, gci->target, _("Importing..."),
-			gci->count * 100 / gci->total);
-		return TRUE;
-	}
 }
 
 #define BOM (gunichar2)0xFEFF
@@ -354,6 +315,119 @@ guess_vcard_encoding (const gchar *filename)
 	return encoding;
 }
 
+/* Called in the import thread */
+static gboolean
+vcard_import_open_stream (VCardImporter *gci)
+{
+	GInputStream *input;
+
+	if (gci->contents) {
+		gchar *tmp;
+
+		if (gci->encoding == VCARD_ENCODING_UTF16)
+			tmp = utf16_to_utf8 ((gunichar2 *) gci->contents);
+		else
+			tmp = g_locale_to_utf8 (gci->contents, -1, NULL, NULL, NULL);
+
+		g_free (gci->contents);
+		gci->contents = NULL;
+
+		if (!tmp)
+			return FALSE;
+
+		gci->stream_size = strlen (tmp);
+		input = g_memory_input_stream_new_from_data (tmp, gci->stream_size, g_free);
+	} else if (gci->input) {
+		gci->stream_size = gci->size;
+		input = gci->input;
+		gci->input = NULL;
+	} else {
+		return FALSE;
+	}
+
+	gci->stream = g_data_input_stream_new (input);
+	g_data_input_stream_set_newline_type (gci->stream, G_DATA_STREAM_NEWLINE_TYPE_ANY);
+
+	g_object_unref (input);
+
+	return TRUE;
+}
+
+/* Whether the line is the @marker, ignoring case and surrounding white space */
+static gboolean
+vcard_line_is (const gchar *line,
+               const gchar *marker)
+{
+	gsize marker_len = strlen (marker);
+
+	while (g_ascii_isspace (*line))
+		line++;
+
+	if (g_ascii_strncasecmp (line, marker, marker_len) != 0)
+		return FALSE;
+
+	for (line += marker_len; *line; line++) {
+		if (!g_ascii_isspace (*line))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Called in the import thread; reads the input one vCard at a time,
+ * thus the whole file is never held in the memory. */
+static EContact *
+vcard_import_next_contact (gpointer user_data,
+                           goffset *out_bytes_read,
+                           GCancellable *cancellable)
+{
+	VCardImporter *gci = user_data;
+	EContact *contact = NULL;
+	GString *card = NULL;
+	gint depth = 0;
+	gchar *line;
+	gsize length;
+
+	if (!gci->stream && !vcard_import_open_stream (gci))
+		return NULL;
+
+	while (!contact && (line = g_data_input_stream_read_line (gci->stream, &length, cancellable, NULL)) != NULL) {
+		gci->bytes_read += length + 1;
+
+		/* Anything before the first BEGIN:VCARD, like the "Book: " line, is skipped */
+		if (vcard_line_is (line, "BEGIN:VCARD")) {
+			if (!card)
+				card = g_string_sized_new (1024);
+			depth++;
+		}
+
+		if (card) {
+			g_string_append_len (card, line, length);
+			g_string_append_c (card, '\n');
+
+			/* Nested vCards (like AGENT) end with the outer END:VCARD */
+			if (vcard_line_is (line, "END:VCARD") && --depth == 0) {
+				contact = e_contact_new_from_vcard (card->str);
+				vcard_import_contact (contact);
+
+				g_string_free (card, TRUE);
+				card = NULL;
+			}
+		}
+
+		g_free (line);
+	}
+
+	/* An incomplete vCard at the end of the file */
+	if (card)
+		g_string_free (card, TRUE);
+
+	if (gci->stream_size > 0)
+		*out_bytes_read = MIN (gci->bytes_read, gci->stream_size) * gci->size / gci->stream_size;
+
+	return contact;
+}
+
 static void
 primary_selection_changed_cb (ESourceSelector *selector,
                               EImportTarget *target)
@@ -452,16 +526,20 @@ vcard_supported (EImport *ei,
 }
 
 static void
-vcard_import_done (VCardImporter *gci)
+vcard_import_done (gpointer user_data,
+                   const GError *error)
 {
-	if (gci->idle_id)
-		g_source_remove (gci->idle_id);
+	VCardImporter *gci = user_data;
+
+	g_datalist_set_data (&gci->target->data, "vcard-data", NULL);
 
 	g_free (gci->contents);
-	g_object_unref (gci->book_client);
-	g_slist_free_full (gci->contactlist, (GDestroyNotify) g_object_unref);
+	g_clear_object (&gci->input);
+	g_clear_object (&gci->stream);
+	g_clear_object (&gci->book_client);
+	g_clear_object (&gci->cancellable);
 
-	e_import_complete (gci->import, gci->target, NULL);
+	e_import_complete (gci->import, gci->target, error);
 	g_object_unref (gci->import);
 	g_free (gci);
 }
@@ -477,37 +555,16 @@ book_client_connect_cb (GObject *source_object,
 	client = e_book_client_connect_finish (result, NULL);
 
 	if (client == NULL) {
-		vcard_import_done (gci);
+		vcard_import_done (gci, NULL);
 		return;
 	}
 
 	gci->book_client = E_BOOK_CLIENT (client);
 
-	if (gci->encoding == VCARD_ENCODING_UTF16) {
-		gchar *tmp;
-
-		gunichar2 *contents_utf16 = (gunichar2 *) gci->contents;
-		tmp = utf16_to_utf8 (contents_utf16);
-		g_free (gci->contents);
-		gci->contents = tmp;
-
-	} else if (gci->encoding == VCARD_ENCODING_LOCALE) {
-		gchar *tmp;
-		tmp = g_locale_to_utf8 (gci->contents, -1, NULL, NULL, NULL);
-		g_free (gci->contents);
-		gci->contents = tmp;
-	}
-
-	gci->contactlist = eab_contact_list_from_string (gci->contents);
-	g_free (gci->contents);
-	gci->contents = NULL;
-	gci->iterator = gci->contactlist;
-	gci->total = g_slist_length (gci->contactlist);
-
-	if (gci->iterator)
-		gci->idle_id = g_idle_add (vcard_import_contacts, gci);
-	else
-		vcard_import_done (gci);
+	evolution_contact_importer_run (
+		gci->import, gci->target, gci->book_client, gci->size,
+		vcard_import_next_contact, NULL, vcard_import_done,
+		gci, gci->cancellable);
 }
 
 static void
@@ -518,8 +575,10 @@ vcard_import (EImport *ei,
 	VCardImporter *gci;
 	ESource *source;
 	EImportTargetURI *s = (EImportTargetURI *) target;
+	GInputStream *input = NULL;
 	gchar *filename;
-	gchar *contents;
+	gchar *contents = NULL;
+	gsize length = 0;
 	VCardEncoding encoding;
 	GError *error = NULL;
 
@@ -540,8 +599,27 @@ vcard_import (EImport *ei,
 		return;
 	}
 
-	if (!g_file_get_contents (filename, &contents, NULL, &error)) {
+	/* UTF-8 files are read as a stream in the import thread,
+	 * the others need to be converted as a whole */
+	if (encoding == VCARD_ENCODING_UTF8) {
+		GFileInfo *info;
+		GFile *file;
+
+		file = g_file_new_for_path (filename);
+		input = G_INPUT_STREAM (g_file_read (file, NULL, &error));
+		info = input ? g_file_input_stream_query_info (G_FILE_INPUT_STREAM (input), G_FILE_ATTRIBUTE_STANDARD_SIZE, NULL, NULL) : NULL;
+		if (info) {
+			length = g_file_info_get_size (info);
+			g_object_unref (info);
+		}
+		g_object_unref (file);
+	} else {
+		g_file_get_contents (filename, &contents, &length, &error);
+	}
+
+	if (error) {
 		g_free (filename);
+		g_clear_object (&input);
 		e_import_complete (ei, target, error);
 		g_clear_error (&error);
 
@@ -553,12 +631,15 @@ vcard_import (EImport *ei,
 	g_datalist_set_data (&target->data, "vcard-data", gci);
 	gci->import = g_object_ref (ei);
 	gci->target = target;
+	gci->cancellable = g_cancellable_new ();
 	gci->encoding = encoding;
 	gci->contents = contents;
+	gci->input = input;
+	gci->size = length;
 
 	source = g_datalist_get_data (&target->data, "vcard-source");
 
-	e_book_client_connect (source, 30, NULL, book_client_connect_cb, gci);
+	e_book_client_connect (source, 30, gci->cancellable, book_client_connect_cb, gci);
 }
 
 static void
@@ -569,7 +650,7 @@ vcard_cancel (EImport *ei,
 	VCardImporter *gci = g_datalist_get_data (&target->data, "vcard-data");
 
 	if (gci)
-		gci->state = 1;
+		g_cancellable_cancel (gci->cancellable);
 }
 
 static GtkWidget *
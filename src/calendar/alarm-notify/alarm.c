@@ -36,46 +36,136 @@
 /* Our glib timeout */
 static guint timeout_id;
 
-/* The list of pending alarms */
-static GList *alarms = NULL;
+/* The trigger time the timeout_id had been set up for */
+static time_t timeout_trigger;
+
+/* The pending alarms, as a binary min-heap of AlarmRecord-s
+ * ordered by the trigger time, then by the order of addition */
+static GPtrArray *alarms = NULL;
+
+/* AlarmRecord-s currently in the heap; it validates identifiers
+ * passed to alarm_remove(), which can be already gone */
+static GHashTable *alarms_set = NULL;
+
+static guint64 alarms_sequence = 0;
 
 /* A queued alarm structure */
 typedef struct {
 	time_t             trigger;
+	guint64            sequence;
+	guint              heap_index; /* position in the 'alarms' heap */
 	AlarmFunction      alarm_fn;
 	gpointer           data;
 	AlarmDestroyNotify destroy_notify_fn;
 } AlarmRecord;
 
-static void setup_timeout (void);
+static void setup_timeout (gboolean force);
+
+#define HEAP_PARENT(_idx) (((_idx) - 1) / 2)
+#define HEAP_LEFT(_idx) (2 * (_idx) + 1)
+
+static gboolean
+alarm_record_before (const AlarmRecord *ara,
+                     const AlarmRecord *arb)
+{
+	if (ara->trigger != arb->trigger)
+		return ara->trigger < arb->trigger;
+
+	return ara->sequence < arb->sequence;
+}
+
+static AlarmRecord *
+alarms_peek_head (void)
+{
+	if (!alarms || !alarms->len)
+		return NULL;
+
+	return g_ptr_array_index (alarms, 0);
+}
 
-/* Removes the head alarm from the queue.  Does not touch the timeout_id. */
 static void
-pop_alarm (void)
+alarms_heap_set (guint idx,
+                 AlarmRecord *ar)
 {
-	AlarmRecord *ar;
-	GList *l;
+	alarms->pdata[idx] = ar;
+	ar->heap_index = idx;
+}
 
-	if (!alarms) {
-		g_warning ("Nothing to pop from the alarm queue");
-		return;
+static void
+alarms_heap_sift_up (guint idx)
+{
+	AlarmRecord *ar = g_ptr_array_index (alarms, idx);
+
+	while (idx > 0) {
+		AlarmRecord *parent = g_ptr_array_index (alarms, HEAP_PARENT (idx));
+
+		if (!alarm_record_before (ar, parent))
+			break;
+
+		alarms_heap_set (idx, parent);
+		idx = HEAP_PARENT (idx);
 	}
 
-	ar = alarms->data;
+	alarms_heap_set (idx, ar);
+}
+
+static void
+alarms_heap_sift_down (guint idx)
+{
+	AlarmRecord *ar = g_ptr_array_index (alarms, idx);
 
-	l = alarms;
-	alarms = g_list_delete_link (alarms, l);
+	while (HEAP_LEFT (idx) < alarms->len) {
+		AlarmRecord *child;
+		guint child_index = HEAP_LEFT (idx);
 
-	g_free (ar);
+		if (child_index + 1 < alarms->len &&
+		    alarm_record_before (g_ptr_array_index (alarms, child_index + 1), g_ptr_array_index (alarms, child_index)))
+			child_index++;
+
+		child = g_ptr_array_index (alarms, child_index);
+
+		if (!alarm_record_before (child, ar))
+			break;
+
+		alarms_heap_set (idx, child);
+		idx = child_index;
+	}
+
+	alarms_heap_set (idx, ar);
+}
+
+/* Removes the alarm from the queue, without freeing it.
+ * Does not touch the timeout_id. */
+static void
+alarms_heap_remove (AlarmRecord *ar)
+{
+	AlarmRecord *last;
+	guint idx = ar->heap_index;
+
+	g_hash_table_remove (alarms_set, ar);
+
+	last = g_ptr_array_index (alarms, alarms->len - 1);
+	g_ptr_array_set_size (alarms, alarms->len - 1);
+
+	if (last == ar)
+		return;
+
+	alarms_heap_set (idx, last);
+
+	if (idx > 0 && alarm_record_before (last, g_ptr_array_index (alarms, HEAP_PARENT (idx))))
+		alarms_heap_sift_up (idx);
+	else
+		alarms_heap_sift_down (idx);
 }
 
 /* Callback from the alarm timeout */
 static gboolean
 alarm_ready_cb (gpointer data)
 {
+	AlarmRecord *ar;
 	time_t now;
 
-	if (!alarms) {
+	if (!alarms_peek_head ()) {
 		g_warning ("Alarm triggered, but no alarm present\n");
 		return FALSE;
 	}
@@ -85,57 +175,57 @@ alarm_ready_cb (gpointer data)
 	now = time (NULL);
 
 	debug (("Alarm callback!"));
-	while (alarms) {
-		AlarmRecord *notify_id, *ar;
-		AlarmRecord ar_copy;
-
-		ar = alarms->data;
 
+	/* All the alarms of this and of the past seconds are
+	 * processed within this single wakeup */
+	while (ar = alarms_peek_head (), ar) {
 		if (ar->trigger > now)
 			break;
 
 		debug (("Process alarm with trigger %" G_GINT64_FORMAT, (gint64) ar->trigger));
-		notify_id = ar;
-
-		ar_copy = *ar;
-		ar = &ar_copy;
 
-		/* This will free the original AlarmRecord;
-		 * that's why we copy it. */
-		pop_alarm ();
+		/* Dequeue it first, thus alarm_remove() called
+		 * from the callbacks does not find it */
+		alarms_heap_remove (ar);
 
-		(* ar->alarm_fn) (notify_id, ar->trigger, ar->data);
+		(* ar->alarm_fn) (ar, ar->trigger, ar->data);
 
 		if (ar->destroy_notify_fn)
-			(* ar->destroy_notify_fn) (notify_id, ar->data);
+			(* ar->destroy_notify_fn) (ar, ar->data);
+
+		g_free (ar);
 	}
 
-	/* We need this check because one of the alarm_fn above may have
-	 * re-entered and added an alarm of its own, so the timer will
-	 * already be set up.
+	/* One of the alarm_fn above may have re-entered and added
+	 * an alarm of its own, thus the timer can be set up already.
 	 */
-	if (alarms)
-		setup_timeout ();
+	if (alarms_peek_head ())
+		setup_timeout (FALSE);
 
 	return FALSE;
 }
 
-/* Sets up a timeout for the next minute.  We do not need to be concerned with
- * timezones here, as this is just a periodic check on the alarm queue.
+/* Sets up a timeout for the earliest alarm.  We do not need to be concerned
+ * with timezones here, as this is just a periodic check on the alarm queue.
+ * Unless @force is set, a timeout already set up for the same trigger time
+ * is kept, thus adding or removing alarms does not re-arm it needlessly.
  */
 static void
-setup_timeout (void)
+setup_timeout (gboolean force)
 {
 	const AlarmRecord *ar;
 	guint diff;
 	time_t now;
 
-	if (!alarms) {
+	ar = alarms_peek_head ();
+
+	if (!ar) {
 		g_warning ("No alarm to setup\n");
 		return;
 	}
 
-	ar = alarms->data;
+	if (!force && timeout_id != 0 && timeout_trigger == ar->trigger)
+		return;
 
 	/* Remove the existing time out */
 	if (timeout_id != 0) {
@@ -145,8 +235,8 @@ setup_timeout (void)
 
 	/* Ensure that if the trigger managed to get behind the
 	 * current time we timeout immediately */
-	diff = MAX (0, ar->trigger - time (NULL));
 	now = time (NULL);
+	diff = MAX (0, ar->trigger - now);
 
 	/* Add the time out */
 	debug (
@@ -154,42 +244,32 @@ setup_timeout (void)
 		diff / 60, diff % 60, (gint64) ar->trigger, (gint64) now));
 	debug ((" %s", ctime (&ar->trigger)));
 	debug ((" %s", ctime (&now)));
+	timeout_trigger = ar->trigger;
 	timeout_id = e_named_timeout_add_seconds (diff, alarm_ready_cb, NULL);
 }
 
-/* Used from g_list_insert_sorted(); compares the
- * trigger times of two AlarmRecord structures. */
-static gint
-compare_alarm_by_time (gconstpointer a,
-                       gconstpointer b)
-{
-	const AlarmRecord *ara = a;
-	const AlarmRecord *arb = b;
-	time_t diff;
-
-	diff = ara->trigger - arb->trigger;
-	return (diff < 0) ? -1 : (diff > 0) ? 1 : 0;
-}
-
 /* Adds an alarm to the queue and sets up the timer */
 static void
 queue_alarm (AlarmRecord *ar)
 {
-	GList *old_head;
+	if (!alarms) {
+		alarms = g_ptr_array_new ();
+		alarms_set = g_hash_table_new (g_direct_hash, g_direct_equal);
+	}
 
-	/* Track the current head of the list in case there are changes */
-	old_head = alarms;
+	ar->sequence = alarms_sequence++;
 
-	/* Insert the new alarm in order if the alarm's trigger time is
-	 * after the current time */
-	alarms = g_list_insert_sorted (alarms, ar, compare_alarm_by_time);
+	g_ptr_array_add (alarms, ar);
+	g_hash_table_add (alarms_set, ar);
 
-	/* If there first item on the list didn't change, the time out is fine */
-	if (old_head == alarms)
+	alarms_heap_sift_up (alarms->len - 1);
+
+	/* If the first alarm did not change, the time out is fine */
+	if (ar->heap_index != 0)
 		return;
 
 	/* Set the timer for removal upon activation */
-	setup_timeout ();
+	setup_timeout (FALSE);
 }
 
 /**
@@ -237,47 +317,38 @@ alarm_add (time_t trigger,
 void
 alarm_remove (gpointer alarm)
 {
-	AlarmRecord *notify_id, *ar;
-	AlarmRecord ar_copy;
-	AlarmRecord *old_head;
-	GList *l;
+	AlarmRecord *ar;
+	gboolean was_head;
 
 	g_return_if_fail (alarm != NULL);
 
 	ar = alarm;
 
-	l = g_list_find (alarms, ar);
-	if (!l) {
+	if (!alarms_set || !g_hash_table_contains (alarms_set, ar)) {
 		debug ((G_STRLOC ": Requested removal of nonexistent alarm!"));
 		return;
 	}
 
-	old_head = alarms->data;
-
-	notify_id = ar;
+	was_head = ar->heap_index == 0;
 
-	if (old_head == ar) {
-		ar_copy = *ar;
-		ar = &ar_copy;
-
-		/* This will free the original AlarmRecord;
-		 * that's why we copy it. */
-		pop_alarm ();
-	} else {
-		alarms = g_list_delete_link (alarms, l);
-	}
+	alarms_heap_remove (ar);
 
 	/* Reset the timeout */
-	if (!alarms) {
-		g_source_remove (timeout_id);
-		timeout_id = 0;
+	if (!alarms->len) {
+		if (timeout_id != 0) {
+			g_source_remove (timeout_id);
+			timeout_id = 0;
+		}
+	} else if (was_head) {
+		setup_timeout (FALSE);
 	}
 
 	/* Notify about destructiono of the alarm */
 
 	if (ar->destroy_notify_fn)
-		(* ar->destroy_notify_fn) (notify_id, ar->data);
+		(* ar->destroy_notify_fn) (ar, ar->data);
 
+	g_free (ar);
 }
 
 /**
@@ -289,26 +360,26 @@ alarm_remove (gpointer alarm)
 void
 alarm_done (void)
 {
-	GList *l;
+	guint ii;
 
 	if (timeout_id == 0) {
-		if (alarms)
+		if (alarms_peek_head ())
 			g_warning ("No timeout, but queue is not NULL\n");
-		return;
-	}
+	} else {
+		g_source_remove (timeout_id);
+		timeout_id = 0;
 
-	g_source_remove (timeout_id);
-	timeout_id = 0;
+		if (!alarms_peek_head ())
+			g_warning ("timeout present, freed, but no alarms active\n");
+	}
 
-	if (!alarms) {
-		g_warning ("timeout present, freed, but no alarms active\n");
+	if (!alarms)
 		return;
-	}
 
-	for (l = alarms; l; l = l->next) {
+	for (ii = 0; ii < alarms->len; ii++) {
 		AlarmRecord *ar;
 
-		ar = l->data;
+		ar = g_ptr_array_index (alarms, ii);
 
 		if (ar->destroy_notify_fn)
 			(* ar->destroy_notify_fn) (ar, ar->data);
@@ -316,8 +387,11 @@ alarm_done (void)
 		g_free (ar);
 	}
 
-	g_list_free (alarms);
+	g_ptr_array_free (alarms, TRUE);
 	alarms = NULL;
+
+	g_hash_table_destroy (alarms_set);
+	alarms_set = NULL;
 }
 
 /**
@@ -328,6 +402,6 @@ alarm_done (void)
 void
 alarm_reschedule_timeout (void)
 {
-	if (alarms)
-		setup_timeout ();
+	if (alarms_peek_head ())
+		setup_timeout (TRUE);
 }
@@ -0,0 +1,161 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Queues alarms with random trigger times, removes them in random order,
+ * then lets already passed alarms fire, verifying they come in order.
+ * Prints the time each of the steps took.
+ * Usage:
+ *    test-alarm-timer [N_ALARMS]
+ */
+
+#include "evolution-config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "alarm.h"
+
+static gint n_fired = 0;
+static gint n_destroyed = 0;
+static gint n_expected = 0;
+static time_t last_trigger = 0;
+static gboolean out_of_order = FALSE;
+static GMainLoop *main_loop = NULL;
+
+static void
+bench_alarm_cb (gpointer alarm_id,
+                time_t trigger,
+                gpointer data)
+{
+	if (trigger < last_trigger)
+		out_of_order = TRUE;
+
+	last_trigger = trigger;
+	n_fired++;
+}
+
+static void
+bench_destroy_cb (gpointer alarm_id,
+                  gpointer data)
+{
+	n_destroyed++;
+
+	if (n_destroyed == n_expected && main_loop)
+		g_main_loop_quit (main_loop);
+}
+
+static void
+shuffle_ids (GRand *rand,
+             gpointer *ids,
+             gint n_ids)
+{
+	gint ii;
+
+	for (ii = n_ids - 1; ii > 0; ii--) {
+		gint jj = g_rand_int_range (rand, 0, ii + 1);
+		gpointer tmp = ids[ii];
+
+		ids[ii] = ids[jj];
+		ids[jj] = tmp;
+	}
+}
+
+static void
+print_elapsed (const gchar *what,
+               gint n_alarms,
+               gint64 elapsed)
+{
+	printf ("%-28s %d alarms in %.3f s, %.0f alarms/s\n", what, n_alarms,
+		elapsed / (gdouble) G_USEC_PER_SEC,
+		n_alarms / (MAX (elapsed, 1) / (gdouble) G_USEC_PER_SEC));
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	GRand *rand;
+	gpointer *ids;
+	gint64 started;
+	time_t now;
+	gint n_alarms, n_removed, ii;
+	gint res = 0;
+
+	n_alarms = argc > 1 ? MAX (1, atoi (argv[1])) : 100000;
+
+	rand = g_rand_new_with_seed (42);
+	ids = g_new0 (gpointer, n_alarms);
+	now = time (NULL);
+
+	/* Future alarms, like those of a month of shared calendars */
+	started = g_get_monotonic_time ();
+	for (ii = 0; ii < n_alarms; ii++) {
+		ids[ii] = alarm_add (now + 60 + g_rand_int_range (rand, 0, 30 * 24 * 60 * 60),
+			bench_alarm_cb, NULL, bench_destroy_cb);
+	}
+	print_elapsed ("Queued", n_alarms, g_get_monotonic_time () - started);
+
+	shuffle_ids (rand, ids, n_alarms);
+
+	started = g_get_monotonic_time ();
+	for (ii = 0; ii < n_alarms; ii++) {
+		alarm_remove (ids[ii]);
+	}
+	print_elapsed ("Removed", n_alarms, g_get_monotonic_time () - started);
+
+	if (n_destroyed != n_alarms) {
+		fprintf (stderr, "Expected %d destroyed alarms, got %d\n", n_alarms, n_destroyed);
+		res = 1;
+	}
+
+	/* Already passed alarms, with every third removed, fire
+	 * all within the first wakeup */
+	n_destroyed = 0;
+	n_expected = n_alarms;
+
+	for (ii = 0; ii < n_alarms; ii++) {
+		ids[ii] = alarm_add (now - g_rand_int_range (rand, 0, n_alarms),
+			bench_alarm_cb, NULL, bench_destroy_cb);
+	}
+
+	for (ii = 0, n_removed = 0; ii < n_alarms; ii += 3, n_removed++) {
+		alarm_remove (ids[ii]);
+	}
+
+	main_loop = g_main_loop_new (NULL, FALSE);
+
+	started = g_get_monotonic_time ();
+	g_main_loop_run (main_loop);
+	print_elapsed ("Fired", n_fired, g_get_monotonic_time () - started);
+
+	g_main_loop_unref (main_loop);
+	main_loop = NULL;
+
+	if (n_fired != n_alarms - n_removed) {
+		fprintf (stderr, "Expected %d fired alarms, got %d\n", n_alarms - n_removed, n_fired);
+		res = 1;
+	}
+
+	if (out_of_order) {
+		fprintf (stderr, "Alarms fired out of order\n");
+		res = 1;
+	}
+
+	alarm_done ();
+
+	g_free (ids);
+	g_rand_free (rand);
+
+	return res;
+}
@@ -73,6 +73,23 @@ typedef struct _ComponentData {
 	gboolean is_detached;
 } ComponentData;
 
+typedef struct _CachedInstanceData {
+	gint64 instance_start; /* as generated, the key in RecurrencesCacheData::instances */
+	gint64 instance_end;
+	ComponentData *comp_data;
+} CachedInstanceData;
+
+typedef struct _RecurrencesCacheData {
+	gchar *master_str; /* the expanded component as string, to recognize changes */
+	gboolean has_range;
+	time_t range_start; /* already expanded time range */
+	time_t range_end;
+	guint stamp; /* ViewData::cache_stamp when used the last time */
+	gboolean busy; /* being expanded in a thread */
+	gboolean invalidated; /* invalidated while busy */
+	GHashTable *instances; /* gint64 instance_start ~> CachedInstanceData */
+} RecurrencesCacheData;
+
 typedef struct _ViewData {
 	gint ref_count;
 	GRecMutex lock;
@@ -92,6 +109,8 @@ typedef struct _ViewData {
 	GSList *to_expand_recurrences; /* icalcomponent */
 	GSList *expanded_recurrences; /* ComponentData */
 	gint pending_expand_recurrences; /* how many is waiting to be processed */
+	GHashTable *recurrences_cache; /* ECalComponentId of the master ~> RecurrencesCacheData */
+	guint cache_stamp; /* increased with each new view */
 
 	GCancellable *cancellable;
 } ViewData;
@@ -132,6 +151,41 @@ component_data_free (gpointer ptr)
 	}
 }
 
+static void
+cached_instance_data_free (gpointer ptr)
+{
+	CachedInstanceData *ci_data = ptr;
+
+	if (ci_data) {
+		component_data_free (ci_data->comp_data);
+		g_free (ci_data);
+	}
+}
+
+static RecurrencesCacheData *
+recurrences_cache_data_new (gchar *master_str) /* (transfer full) */
+{
+	RecurrencesCacheData *cache_data;
+
+	cache_data = g_new0 (RecurrencesCacheData, 1);
+	cache_data->master_str = master_str;
+	cache_data->instances = g_hash_table_new_full (g_int64_hash, g_int64_equal, NULL, cached_instance_data_free);
+
+	return cache_data;
+}
+
+static void
+recurrences_cache_data_free (gpointer ptr)
+{
+	RecurrencesCacheData *cache_data = ptr;
+
+	if (cache_data) {
+		g_hash_table_destroy (cache_data->instances);
+		g_free (cache_data->master_str);
+		g_free (cache_data);
+	}
+}
+
 static gboolean
 component_data_equal (ComponentData *comp_data1,
 		      ComponentData *comp_data2)
@@ -151,6 +205,10 @@ component_data_equal (ComponentData *comp_data1,
 	    comp_data1->instance_end != comp_data2->instance_end)
 		return FALSE;
 
+	/* Instances reused from the recurrences cache share the component */
+	if (comp_data1->component == comp_data2->component)
+		return TRUE;
+
 	icomp1 = e_cal_component_get_icalcomponent (comp_data1->component);
 	icomp2 = e_cal_component_get_icalcomponent (comp_data2->component);
 
@@ -201,6 +259,9 @@ view_data_new (ECalClient *client)
 	view_data->components = g_hash_table_new_full (
 		(GHashFunc) e_cal_component_id_hash, (GEqualFunc) e_cal_component_id_equal,
 		(GDestroyNotify) e_cal_component_free_id, component_data_free);
+	view_data->recurrences_cache = g_hash_table_new_full (
+		(GHashFunc) e_cal_component_id_hash, (GEqualFunc) e_cal_component_id_equal,
+		(GDestroyNotify) e_cal_component_free_id, recurrences_cache_data_free);
 
 	return view_data;
 }
@@ -254,6 +315,7 @@ view_data_unref (gpointer ptr)
 				g_hash_table_destroy (view_data->lost_components);
 			g_slist_free_full (view_data->to_expand_recurrences, (GDestroyNotify) icalcomponent_free);
 			g_slist_free_full (view_data->expanded_recurrences, component_data_free);
+			g_hash_table_destroy (view_data->recurrences_cache);
 			g_rec_mutex_clear (&view_data->lock);
 			g_free (view_data);
 		}
@@ -276,6 +338,50 @@ view_data_unlock (ViewData *view_data)
 	g_rec_mutex_unlock (&view_data->lock);
 }
 
+/* Expects the view_data to be locked */
+static void
+view_data_invalidate_recurrences_cache (ViewData *view_data,
+					const gchar *uid)
+{
+	RecurrencesCacheData *cache_data;
+	ECalComponentId id;
+
+	g_return_if_fail (view_data != NULL);
+
+	if (!uid)
+		return;
+
+	id.uid = (gchar *) uid;
+	id.rid = NULL;
+
+	cache_data = g_hash_table_lookup (view_data->recurrences_cache, &id);
+	if (cache_data) {
+		if (cache_data->busy)
+			cache_data->invalidated = TRUE;
+		else
+			g_hash_table_remove (view_data->recurrences_cache, &id);
+	}
+}
+
+/* Expects the view_data to be locked; drops cached recurrences
+   of the components, which were not part of the current view */
+static void
+view_data_prune_recurrences_cache (ViewData *view_data)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_return_if_fail (view_data != NULL);
+
+	g_hash_table_iter_init (&iter, view_data->recurrences_cache);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		RecurrencesCacheData *cache_data = value;
+
+		if (!cache_data->busy && cache_data->stamp != view_data->cache_stamp)
+			g_hash_table_iter_remove (&iter);
+	}
+}
+
 static SubscriberData *
 subscriber_data_new (ECalDataModelSubscriber *subscriber,
 		     time_t range_start,
@@ -976,10 +1082,14 @@ cal_data_model_notify_recurrences_cb (gpointer user_data)
 		}
 
 		if (g_atomic_int_dec_and_test (&view_data->pending_expand_recurrences) &&
-		    view_data->is_used && view_data->lost_components && view_data->received_complete) {
-			cal_data_model_remove_components (data_model, view_data->client, view_data->lost_components, NULL);
-			g_hash_table_destroy (view_data->lost_components);
-			view_data->lost_components = NULL;
+		    view_data->is_used && view_data->received_complete) {
+			if (view_data->lost_components) {
+				cal_data_model_remove_components (data_model, view_data->client, view_data->lost_components, NULL);
+				g_hash_table_destroy (view_data->lost_components);
+				view_data->lost_components = NULL;
+			}
+
+			view_data_prune_recurrences_cache (view_data);
 		}
 
 		g_hash_table_destroy (gathered_uids);
@@ -1006,6 +1116,7 @@ typedef struct
 	ECalClient *client;
 	icaltimezone *zone;
 	GSList **pexpanded_recurrences;
+	RecurrencesCacheData *cache_data; /* when set, the instances are added only here */
 } GenerateInstancesData;
 
 static gboolean
@@ -1015,12 +1126,21 @@ cal_data_model_instance_generated (ECalComponent *comp,
 				   gpointer data)
 {
 	GenerateInstancesData *gid = data;
+	CachedInstanceData *ci_data = NULL;
 	ComponentData *comp_data;
 	ECalComponent *comp_copy;
 	icaltimetype tt, tt2;
 
 	g_return_val_if_fail (gid != NULL, FALSE);
 
+	if (gid->cache_data) {
+		gint64 generated_start = instance_start;
+
+		/* Already known from the previously expanded time range */
+		if (g_hash_table_contains (gid->cache_data->instances, &generated_start))
+			return TRUE;
+	}
+
 	comp_copy = e_cal_component_clone (comp);
 	g_return_val_if_fail (comp_copy != NULL, FALSE);
 
@@ -1042,6 +1162,12 @@ cal_data_model_instance_generated (ECalComponent *comp,
 
 	e_cal_component_rescan (comp_copy);
 
+	if (gid->cache_data) {
+		ci_data = g_new0 (CachedInstanceData, 1);
+		ci_data->instance_start = instance_start;
+		ci_data->instance_end = instance_end;
+	}
+
 	cal_comp_get_instance_times (gid->client, e_cal_component_get_icalcomponent (comp_copy),
 		gid->zone, &instance_start, NULL, &instance_end, NULL, NULL);
 
@@ -1049,13 +1175,159 @@ cal_data_model_instance_generated (ECalComponent *comp,
 		instance_end--;
 
 	comp_data = component_data_new (comp_copy, instance_start, instance_end, FALSE);
-	*gid->pexpanded_recurrences = g_slist_prepend (*gid->pexpanded_recurrences, comp_data);
+
+	if (ci_data) {
+		ci_data->comp_data = comp_data;
+		g_hash_table_insert (gid->cache_data->instances, &ci_data->instance_start, ci_data);
+	} else {
+		*gid->pexpanded_recurrences = g_slist_prepend (*gid->pexpanded_recurrences, comp_data);
+	}
 
 	g_object_unref (comp_copy);
 
 	return TRUE;
 }
 
+static void
+cal_data_model_copy_cached_instance_cb (gpointer key,
+					gpointer value,
+					gpointer user_data)
+{
+	CachedInstanceData *ci_data = value;
+	GSList **pexpanded_recurrences = user_data;
+
+	*pexpanded_recurrences = g_slist_prepend (*pexpanded_recurrences,
+		component_data_new (ci_data->comp_data->component,
+			ci_data->comp_data->instance_start,
+			ci_data->comp_data->instance_end,
+			ci_data->comp_data->is_detached));
+}
+
+static gboolean
+cal_data_model_cached_instance_out_of_range_cb (gpointer key,
+						gpointer value,
+						gpointer user_data)
+{
+	CachedInstanceData *ci_data = value;
+	const time_t *range = user_data;
+
+	return ci_data->instance_start > range[1] || ci_data->instance_end < range[0];
+}
+
+/* Expands the recurrences of the 'icomp' into the 'pexpanded_recurrences'.
+   The instances are remembered in the view_data's recurrences cache together
+   with the expanded time range, thus when only the time range changes, only
+   the newly exposed part of it is expanded. */
+static void
+cal_data_model_expand_recurrences (ViewData *view_data,
+				   ECalClient *client,
+				   icaltimezone *zone,
+				   icalcomponent *icomp,
+				   time_t range_start,
+				   time_t range_end,
+				   GSList **pexpanded_recurrences)
+{
+	RecurrencesCacheData *cache_data = NULL;
+	GenerateInstancesData gid;
+	ECalComponentId *id;
+	gchar *master_str;
+
+	gid.client = client;
+	gid.zone = zone;
+	gid.pexpanded_recurrences = pexpanded_recurrences;
+	gid.cache_data = NULL;
+
+	/* Without a time constraint there is nothing to expand lazily */
+	if (range_start == (time_t) 0 && range_end == (time_t) 0) {
+		e_cal_client_generate_instances_for_object_sync (client, icomp, range_start, range_end,
+			cal_data_model_instance_generated, &gid);
+		return;
+	}
+
+	id = e_cal_component_id_new (icalcomponent_get_uid (icomp), NULL);
+	master_str = icalcomponent_as_ical_string_r (icomp);
+
+	view_data_lock (view_data);
+
+	cache_data = g_hash_table_lookup (view_data->recurrences_cache, id);
+	if (cache_data && cache_data->busy) {
+		/* Expanded by another thread right now, do not wait for it */
+		cache_data = NULL;
+	} else {
+		if (cache_data && (g_strcmp0 (cache_data->master_str, master_str) != 0 ||
+		    cache_data->range_start > range_end || cache_data->range_end < range_start)) {
+			g_hash_table_remove (view_data->recurrences_cache, id);
+			cache_data = NULL;
+		}
+
+		if (!cache_data) {
+			cache_data = recurrences_cache_data_new (master_str);
+			master_str = NULL;
+
+			g_hash_table_insert (view_data->recurrences_cache, id, cache_data);
+			id = NULL;
+		}
+
+		cache_data->busy = TRUE;
+		cache_data->stamp = view_data->cache_stamp;
+	}
+
+	view_data_unlock (view_data);
+
+	if (id)
+		e_cal_component_free_id (id);
+	g_free (master_str);
+
+	if (!cache_data) {
+		e_cal_client_generate_instances_for_object_sync (client, icomp, range_start, range_end,
+			cal_data_model_instance_generated, &gid);
+		return;
+	}
+
+	gid.cache_data = cache_data;
+
+	if (!cache_data->has_range) {
+		e_cal_client_generate_instances_for_object_sync (client, icomp, range_start, range_end,
+			cal_data_model_instance_generated, &gid);
+	} else {
+		time_t range[2];
+
+		/* Forget instances which are not needed anymore... */
+		range[0] = range_start;
+		range[1] = range_end;
+
+		g_hash_table_foreach_remove (cache_data->instances,
+			cal_data_model_cached_instance_out_of_range_cb, range);
+
+		/* ...and expand only the newly exposed parts of the time range;
+		   instances crossing the boundaries are skipped as already known */
+		if (range_start < cache_data->range_start)
+			e_cal_client_generate_instances_for_object_sync (client, icomp, range_start, cache_data->range_start,
+				cal_data_model_instance_generated, &gid);
+
+		if (range_end > cache_data->range_end)
+			e_cal_client_generate_instances_for_object_sync (client, icomp, cache_data->range_end, range_end,
+				cal_data_model_instance_generated, &gid);
+	}
+
+	view_data_lock (view_data);
+
+	cache_data->has_range = TRUE;
+	cache_data->range_start = range_start;
+	cache_data->range_end = range_end;
+	cache_data->busy = FALSE;
+
+	g_hash_table_foreach (cache_data->instances, cal_data_model_copy_cached_instance_cb, pexpanded_recurrences);
+
+	if (cache_data->invalidated) {
+		id = e_cal_component_id_new (icalcomponent_get_uid (icomp), NULL);
+		g_hash_table_remove (view_data->recurrences_cache, id);
+		e_cal_component_free_id (id);
+	}
+
+	view_data_unlock (view_data);
+}
+
 static void
 cal_data_model_expand_recurrences_thread (ECalDataModel *data_model,
 					  gpointer user_data)
@@ -1100,17 +1372,12 @@ cal_data_model_expand_recurrences_thread (ECalDataModel *data_model,
 
 	for (link = to_expand_recurrences; link && view_data->is_used; link = g_slist_next (link)) {
 		icalcomponent *icomp = link->data;
-		GenerateInstancesData gid;
 
 		if (!icomp)
 			continue;
 
-		gid.client = client;
-		gid.pexpanded_recurrences = &expanded_recurrences;
-		gid.zone = data_model->priv->zone;
-
-		e_cal_client_generate_instances_for_object_sync (client, icomp, range_start, range_end,
-			cal_data_model_instance_generated, &gid);
+		cal_data_model_expand_recurrences (view_data, client, data_model->priv->zone,
+			icomp, range_start, range_end, &expanded_recurrences);
 	}
 
 	g_slist_free_full (to_expand_recurrences, (GDestroyNotify) icalcomponent_free);
@@ -1190,6 +1457,11 @@ cal_data_model_process_modified_or_added_objects (ECalClientView *view,
 			if (!icomp || !icalcomponent_get_uid (icomp))
 				continue;
 
+			/* Changed component or its detached instance means the cached
+			   recurrences of it cannot be used anymore */
+			if (!is_add || e_cal_util_component_is_instance (icomp))
+				view_data_invalidate_recurrences_cache (view_data, icalcomponent_get_uid (icomp));
+
 			if (data_model->priv->expand_recurrences &&
 			    !e_cal_util_component_is_instance (icomp) &&
 			    e_cal_util_component_has_recurrences (icomp)) {
@@ -1301,6 +1573,8 @@ cal_data_model_view_objects_removed (ECalClientView *view,
 			const ECalComponentId *id = link->data;
 
 			if (id) {
+				view_data_invalidate_recurrences_cache (view_data, id->uid);
+
 				if (!id->rid || !*id->rid) {
 					if (!g_hash_table_contains (gathered_uids, id->uid)) {
 						GatherComponentsData gather_data;
@@ -1413,11 +1687,14 @@ cal_data_model_view_complete (ECalClientView *view,
 
 	view_data->received_complete = TRUE;
 	if (view_data->is_used &&
-	    view_data->lost_components &&
 	    !view_data->pending_expand_recurrences) {
-		cal_data_model_remove_components (data_model, view_data->client, view_data->lost_components, NULL);
-		g_hash_table_destroy (view_data->lost_components);
-		view_data->lost_components = NULL;
+		if (view_data->lost_components) {
+			cal_data_model_remove_components (data_model, view_data->client, view_data->lost_components, NULL);
+			g_hash_table_destroy (view_data->lost_components);
+			view_data->lost_components = NULL;
+		}
+
+		view_data_prune_recurrences_cache (view_data);
 	}
 
 	cal_data_model_emit_view_state_changed (data_model, view, E_CAL_DATA_MODEL_VIEW_STATE_COMPLETE, 0, NULL, error);
@@ -1563,6 +1840,9 @@ cal_data_model_update_client_view (ECalDataModel *data_model,
 
 	view_data_lock (view_data);
 
+	/* Cached recurrences not used by the new view will be pruned */
+	view_data->cache_stamp++;
+
 	if (view_data->cancellable)
 		g_cancellable_cancel (view_data->cancellable);
 	g_clear_object (&view_data->cancellable);
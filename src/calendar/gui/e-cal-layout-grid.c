@@ -0,0 +1,203 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "evolution-config.h"
+
+#include <string.h>
+
+#include "e-cal-layout-grid.h"
+
+#define BITS_PER_WORD (GLIB_SIZEOF_LONG * 8)
+
+struct _ECalLayoutGrid {
+	gint n_positions;
+	gint n_words;	/* words of the bit vector of each position */
+	gulong *words;	/* n_positions * n_words, one bit vector after another */
+	gint *n_slots;	/* the highest occupied slot + 1, for each position */
+};
+
+static void
+cal_layout_grid_ensure_words (ECalLayoutGrid *grid,
+                              gint n_words)
+{
+	gulong *words;
+	gint pos;
+
+	if (n_words <= grid->n_words)
+		return;
+
+	n_words = MAX (n_words, grid->n_words * 2);
+	words = g_new0 (gulong, grid->n_positions * n_words);
+
+	for (pos = 0; pos < grid->n_positions; pos++) {
+		memcpy (
+			words + pos * n_words,
+			grid->words + pos * grid->n_words,
+			sizeof (gulong) * grid->n_words);
+	}
+
+	g_free (grid->words);
+	grid->words = words;
+	grid->n_words = n_words;
+}
+
+/* Returns the bits set in the word @word_index of any of the positions */
+static gulong
+cal_layout_grid_get_used_bits (ECalLayoutGrid *grid,
+                               gint first_position,
+                               gint last_position,
+                               gint word_index)
+{
+	gulong used = 0;
+	gint pos;
+
+	for (pos = first_position; pos <= last_position && used != ~0UL; pos++) {
+		used |= grid->words[pos * grid->n_words + word_index];
+	}
+
+	return used;
+}
+
+ECalLayoutGrid *
+e_cal_layout_grid_new (gint n_positions)
+{
+	ECalLayoutGrid *grid;
+
+	g_return_val_if_fail (n_positions >= 0, NULL);
+
+	grid = g_new0 (ECalLayoutGrid, 1);
+	grid->n_positions = n_positions;
+	grid->n_words = 1;
+	grid->words = g_new0 (gulong, MAX (n_positions, 1));
+	grid->n_slots = g_new0 (gint, MAX (n_positions, 1));
+
+	return grid;
+}
+
+void
+e_cal_layout_grid_free (ECalLayoutGrid *grid)
+{
+	if (!grid)
+		return;
+
+	g_free (grid->words);
+	g_free (grid->n_slots);
+	g_free (grid);
+}
+
+/* Returns the lowest slot, which is free in all positions between
+ * @first_position and @last_position, inclusive, or -1, when there
+ * is none below @max_slots. Use 0 or less @max_slots for no limit. */
+gint
+e_cal_layout_grid_find_free_slot (ECalLayoutGrid *grid,
+                                  gint first_position,
+                                  gint last_position,
+                                  gint max_slots)
+{
+	gint ww, slot;
+
+	g_return_val_if_fail (grid != NULL, -1);
+	g_return_val_if_fail (first_position >= 0 && first_position <= last_position, -1);
+	g_return_val_if_fail (last_position < grid->n_positions, -1);
+
+	/* When all the allocated words are full, then
+	 * the first slot of the next word is free. */
+	slot = grid->n_words * BITS_PER_WORD;
+
+	for (ww = 0; ww < grid->n_words; ww++) {
+		gulong used;
+
+		if (max_slots > 0 && ww * BITS_PER_WORD >= max_slots)
+			break;
+
+		used = cal_layout_grid_get_used_bits (grid, first_position, last_position, ww);
+
+		if (used != ~0UL) {
+			slot = ww * BITS_PER_WORD + g_bit_nth_lsf (~used, -1);
+			break;
+		}
+	}
+
+	if (max_slots > 0 && slot >= max_slots)
+		return -1;
+
+	return slot;
+}
+
+/* Returns the lowest slot from @from_slot, inclusive, which is occupied
+ * in any of the positions between @first_position and @last_position,
+ * inclusive, or -1, when there is none. */
+gint
+e_cal_layout_grid_find_used_slot (ECalLayoutGrid *grid,
+                                  gint first_position,
+                                  gint last_position,
+                                  gint from_slot)
+{
+	gint ww;
+
+	g_return_val_if_fail (grid != NULL, -1);
+	g_return_val_if_fail (first_position >= 0 && first_position <= last_position, -1);
+	g_return_val_if_fail (last_position < grid->n_positions, -1);
+	g_return_val_if_fail (from_slot >= 0, -1);
+
+	for (ww = from_slot / BITS_PER_WORD; ww < grid->n_words; ww++) {
+		gulong used;
+
+		used = cal_layout_grid_get_used_bits (grid, first_position, last_position, ww);
+
+		if (ww == from_slot / BITS_PER_WORD)
+			used &= ~0UL << (from_slot % BITS_PER_WORD);
+
+		if (used)
+			return ww * BITS_PER_WORD + g_bit_nth_lsf (used, -1);
+	}
+
+	return -1;
+}
+
+void
+e_cal_layout_grid_occupy (ECalLayoutGrid *grid,
+                          gint first_position,
+                          gint last_position,
+                          gint slot)
+{
+	gint pos, ww;
+	gulong bit;
+
+	g_return_if_fail (grid != NULL);
+	g_return_if_fail (first_position >= 0 && first_position <= last_position);
+	g_return_if_fail (last_position < grid->n_positions);
+	g_return_if_fail (slot >= 0);
+
+	cal_layout_grid_ensure_words (grid, slot / BITS_PER_WORD + 1);
+
+	ww = slot / BITS_PER_WORD;
+	bit = 1UL << (slot % BITS_PER_WORD);
+
+	for (pos = first_position; pos <= last_position; pos++) {
+		grid->words[pos * grid->n_words + ww] |= bit;
+		grid->n_slots[pos] = MAX (grid->n_slots[pos], slot + 1);
+	}
+}
+
+/* Returns the highest occupied slot of the @position plus one */
+gint
+e_cal_layout_grid_get_n_slots (ECalLayoutGrid *grid,
+                               gint position)
+{
+	g_return_val_if_fail (grid != NULL, 0);
+	g_return_val_if_fail (position >= 0 && position < grid->n_positions, 0);
+
+	return grid->n_slots[position];
+}
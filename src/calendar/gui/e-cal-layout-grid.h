@@ -0,0 +1,51 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef E_CAL_LAYOUT_GRID_H
+#define E_CAL_LAYOUT_GRID_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* A grid of positions (rows of a day, days of a week) and slots (columns or
+ * rows of events placed over the positions), used by the event layouts of
+ * the Day, Week and Month views. Occupied slots of each position are stored
+ * as a bit vector, thus finding a slot free for a range of positions does
+ * not need to probe each slot separately. */
+typedef struct _ECalLayoutGrid ECalLayoutGrid;
+
+ECalLayoutGrid *
+		e_cal_layout_grid_new		(gint n_positions);
+void		e_cal_layout_grid_free		(ECalLayoutGrid *grid);
+gint		e_cal_layout_grid_find_free_slot
+						(ECalLayoutGrid *grid,
+						 gint first_position,
+						 gint last_position,
+						 gint max_slots);
+gint		e_cal_layout_grid_find_used_slot
+						(ECalLayoutGrid *grid,
+						 gint first_position,
+						 gint last_position,
+						 gint from_slot);
+void		e_cal_layout_grid_occupy	(ECalLayoutGrid *grid,
+						 gint first_position,
+						 gint last_position,
+						 gint slot);
+gint		e_cal_layout_grid_get_n_slots	(ECalLayoutGrid *grid,
+						 gint position);
+
+G_END_DECLS
+
+#endif /* E_CAL_LAYOUT_GRID_H */
@@ -42,6 +42,13 @@
 
 struct _ECalModelComponentPrivate {
 	GString *categories_str;
+
+	/* Key in ECalModelPrivate::objects_index, the next component
+	 * with the same key and the slot in ECalModelPrivate::objects_slots,
+	 * while in the model. */
+	gchar *index_key;
+	ECalModelComponent *index_next;
+	guint index_slot;
 };
 
 #define E_CAL_MODEL_GET_PRIVATE(obj) \
@@ -64,6 +71,19 @@ struct _ECalModelPrivate {
 	/* Array for storing the objects. Each element is of type ECalModelComponent */
 	GPtrArray *objects;
 
+	/* Indexes into 'objects', to not search them linearly.
+	 * objects_index: "client\nuid\nrid" ~> ECalModelComponent, the first
+	 *    of them; the others with the same key follow in its index_next
+	 * objects_uids: "client\nuid" ~> count of the components with it */
+	GHashTable *objects_index;
+	GHashTable *objects_uids;
+
+	/* Rows of the 'objects', as a Fenwick tree of gint-s over the slots
+	 * the components got when appended, with an unused index 0. The row
+	 * of a component is the count of the used slots up to its own one,
+	 * thus a removal frees the slot without renumbering the other rows. */
+	GArray *objects_slots;
+
 	icalcomponent_kind kind;
 	icaltimezone *zone;
 
@@ -244,6 +264,8 @@ e_cal_model_component_finalize (GObject *object)
 
 	e_cal_model_component_set_icalcomponent (comp_data, NULL, NULL);
 
+	g_free (comp_data->priv->index_key);
+
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (e_cal_model_component_parent_class)->finalize (object);
 }
@@ -1222,6 +1244,9 @@ cal_model_finalize (GObject *object)
 		g_object_unref (comp_data);
 	}
 	g_ptr_array_free (priv->objects, TRUE);
+	g_hash_table_destroy (priv->objects_index);
+	g_hash_table_destroy (priv->objects_uids);
+	g_array_free (priv->objects_slots, TRUE);
 
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (e_cal_model_parent_class)->finalize (object);
@@ -1902,10 +1927,21 @@ cal_model_value_to_string (ETableModel *etm,
 	return g_strdup ("");
 }
 
+static gchar *
+cal_model_dup_index_key (ECalClient *client,
+			 const gchar *uid,
+			 const gchar *rid)
+{
+	if (rid)
+		return g_strdup_printf ("%p\n%s\n%s", client, uid, rid);
+
+	return g_strdup_printf ("%p\n%s", client, uid);
+}
+
 static gint
-e_cal_model_get_component_index (ECalModel *model,
-				 ECalClient *client,
-				 const ECalComponentId *id)
+cal_model_search_component_index (ECalModel *model,
+				  ECalClient *client,
+				  const ECalComponentId *id)
 {
 	gint ii;
 
@@ -1943,6 +1979,256 @@ e_cal_model_get_component_index (ECalModel *model,
 	return -1;
 }
 
+/* Returns the count of the used slots from 1 up to and including the @slot */
+static guint
+cal_model_slots_count (GArray *slots,
+		       guint slot)
+{
+	gint count = 0;
+
+	for (; slot > 0; slot -= slot & (-slot))
+		count += g_array_index (slots, gint, slot);
+
+	return count;
+}
+
+static void
+cal_model_slots_add (GArray *slots,
+		     guint slot,
+		     gint delta)
+{
+	for (; slot < slots->len; slot += slot & (-slot))
+		g_array_index (slots, gint, slot) += delta;
+}
+
+/* Returns a new used slot, after all the others */
+static guint
+cal_model_slots_append (GArray *slots)
+{
+	guint slot = slots->len;
+	gint value;
+
+	/* The slot covers the range after the one of its lowest bit */
+	value = 1 + cal_model_slots_count (slots, slot - 1) - cal_model_slots_count (slots, slot - (slot & (-slot)));
+
+	g_array_append_val (slots, value);
+
+	return slot;
+}
+
+/* Gives the components consecutive slots again, when most of them are free */
+static void
+cal_model_slots_compact (ECalModel *model)
+{
+	GArray *slots = model->priv->objects_slots;
+	guint ii;
+
+	if (slots->len <= 2 * model->priv->objects->len + 1024)
+		return;
+
+	g_array_set_size (slots, model->priv->objects->len + 1);
+
+	for (ii = 1; ii < slots->len; ii++) {
+		ECalModelComponent *comp_data = g_ptr_array_index (model->priv->objects, ii - 1);
+
+		/* All the slots are used, each covers the range of its lowest bit */
+		g_array_index (slots, gint, ii) = ii & (-ii);
+
+		if (comp_data)
+			comp_data->priv->index_slot = ii;
+	}
+}
+
+/* Returns the row of the @comp_data, or -1 when it's not in the @model */
+static gint
+cal_model_get_object_row (ECalModel *model,
+			  ECalModelComponent *comp_data)
+{
+	guint slot = comp_data->priv->index_slot;
+	guint row;
+
+	if (!slot || slot >= model->priv->objects_slots->len)
+		return -1;
+
+	row = cal_model_slots_count (model->priv->objects_slots, slot) - 1;
+
+	if (row >= model->priv->objects->len ||
+	    g_ptr_array_index (model->priv->objects, row) != comp_data)
+		return -1;
+
+	return row;
+}
+
+static gint
+e_cal_model_get_component_index (ECalModel *model,
+				 ECalClient *client,
+				 const ECalComponentId *id)
+{
+	ECalModelComponent *comp_data;
+	gboolean has_rid;
+	gchar *key;
+
+	if (!id || !id->uid || !*id->uid)
+		return -1;
+
+	/* Components of any client can match, which the index doesn't cover */
+	if (!client)
+		return cal_model_search_component_index (model, client, id);
+
+	has_rid = id->rid && *id->rid;
+
+	key = cal_model_dup_index_key (client, id->uid, has_rid ? id->rid : "");
+	comp_data = g_hash_table_lookup (model->priv->objects_index, key);
+	g_free (key);
+
+	if (comp_data)
+		return cal_model_get_object_row (model, comp_data);
+
+	/* Without RID any component with the UID matches, but the index
+	 * knows only about the one without RID; search for the others,
+	 * when there are any. */
+	if (!has_rid) {
+		gboolean has_uid;
+
+		key = cal_model_dup_index_key (client, id->uid, NULL);
+		has_uid = g_hash_table_contains (model->priv->objects_uids, key);
+		g_free (key);
+
+		if (has_uid)
+			return cal_model_search_component_index (model, client, id);
+	}
+
+	return -1;
+}
+
+/* Appends @comp_data to the objects array and indexes it; the caller
+ * is responsible to notify about the inserted row. Assumes ownership
+ * of the @comp_data. */
+static void
+cal_model_append_object (ECalModel *model,
+			 ECalModelComponent *comp_data)
+{
+	const gchar *uid;
+
+	comp_data->priv->index_slot = cal_model_slots_append (model->priv->objects_slots);
+	g_ptr_array_add (model->priv->objects, comp_data);
+
+	uid = icalcomponent_get_uid (comp_data->icalcomp);
+
+	if (comp_data->client && uid && *uid) {
+		ECalModelComponent *first;
+		struct icaltimetype icalrid;
+		gchar *rid = NULL, *key;
+		guint count;
+
+		icalrid = icalcomponent_get_recurrenceid (comp_data->icalcomp);
+		if (!icaltime_is_null_time (icalrid))
+			rid = icaltime_as_ical_string_r (icalrid);
+
+		key = cal_model_dup_index_key (comp_data->client, uid, rid ? rid : "");
+
+		g_free (comp_data->priv->index_key);
+		comp_data->priv->index_key = key;
+		comp_data->priv->index_next = NULL;
+
+		first = g_hash_table_lookup (model->priv->objects_index, key);
+
+		/* The lookup returns the first one, the same as the linear search;
+		 * the duplicates are kept in the order of the rows, to replace it. */
+		if (first) {
+			while (first->priv->index_next)
+				first = first->priv->index_next;
+
+			first->priv->index_next = comp_data;
+		} else {
+			g_hash_table_insert (model->priv->objects_index, key, comp_data);
+		}
+
+		key = cal_model_dup_index_key (comp_data->client, uid, NULL);
+		count = GPOINTER_TO_UINT (g_hash_table_lookup (model->priv->objects_uids, key));
+		g_hash_table_insert (model->priv->objects_uids, key, GUINT_TO_POINTER (count + 1));
+
+		g_free (rid);
+	}
+}
+
+static void
+cal_model_unindex_object (ECalModel *model,
+			  ECalModelComponent *comp_data)
+{
+	ECalModelComponent *first;
+
+	first = g_hash_table_lookup (model->priv->objects_index, comp_data->priv->index_key);
+
+	if (first == comp_data) {
+		ECalModelComponent *next = comp_data->priv->index_next;
+
+		/* The key is owned by the component, thus replace it too */
+		if (next)
+			g_hash_table_replace (model->priv->objects_index, next->priv->index_key, next);
+		else
+			g_hash_table_remove (model->priv->objects_index, comp_data->priv->index_key);
+	} else {
+		while (first && first->priv->index_next != comp_data)
+			first = first->priv->index_next;
+
+		if (first)
+			first->priv->index_next = comp_data->priv->index_next;
+	}
+
+	comp_data->priv->index_next = NULL;
+
+	g_free (comp_data->priv->index_key);
+	comp_data->priv->index_key = NULL;
+}
+
+/* Removes the component at @index from the objects array and from
+ * the indexes; the caller is responsible to notify about the deleted
+ * row and to unref the returned component. */
+static ECalModelComponent *
+cal_model_remove_object (ECalModel *model,
+			 guint index)
+{
+	ECalModelComponent *comp_data;
+	const gchar *uid;
+
+	g_return_val_if_fail (index < model->priv->objects->len, NULL);
+
+	comp_data = g_ptr_array_remove_index (model->priv->objects, index);
+
+	if (!comp_data)
+		return NULL;
+
+	if (comp_data->priv->index_slot) {
+		cal_model_slots_add (model->priv->objects_slots, comp_data->priv->index_slot, -1);
+		comp_data->priv->index_slot = 0;
+
+		cal_model_slots_compact (model);
+	}
+
+	if (comp_data->priv->index_key)
+		cal_model_unindex_object (model, comp_data);
+
+	uid = comp_data->icalcomp ? icalcomponent_get_uid (comp_data->icalcomp) : NULL;
+
+	if (comp_data->client && uid && *uid) {
+		gchar *key;
+		guint count;
+
+		key = cal_model_dup_index_key (comp_data->client, uid, NULL);
+		count = GPOINTER_TO_UINT (g_hash_table_lookup (model->priv->objects_uids, key));
+
+		if (count > 1)
+			g_hash_table_insert (model->priv->objects_uids, key, GUINT_TO_POINTER (count - 1));
+		else {
+			g_hash_table_remove (model->priv->objects_uids, key);
+			g_free (key);
+		}
+	}
+
+	return comp_data;
+}
+
 static void
 cal_model_data_subscriber_component_added_or_modified (ECalDataModelSubscriber *subscriber,
 						       ECalClient *client,
@@ -1978,7 +2264,7 @@ cal_model_data_subscriber_component_added_or_modified (ECalDataModelSubscriber *
 		comp_data->client = g_object_ref (client);
 		comp_data->icalcomp = icalcomp;
 		e_cal_model_set_instance_times (comp_data, model->priv->zone);
-		g_ptr_array_add (model->priv->objects, comp_data);
+		cal_model_append_object (model, comp_data);
 
 		e_table_model_row_inserted (table_model, model->priv->objects->len - 1);
 	} else {
@@ -2033,7 +2319,7 @@ e_cal_model_data_subscriber_component_removed (ECalDataModelSubscriber *subscrib
 	table_model = E_TABLE_MODEL (model);
 	e_table_model_pre_change (table_model);
 
-	comp_data = g_ptr_array_remove_index (model->priv->objects, index);
+	comp_data = cal_model_remove_object (model, index);
 	if (!comp_data) {
 		e_table_model_no_change (table_model);
 		return;
@@ -2608,6 +2894,10 @@ e_cal_model_init (ECalModel *model)
 	model->priv->end = (time_t) -1;
 
 	model->priv->objects = g_ptr_array_new ();
+	model->priv->objects_index = g_hash_table_new (g_str_hash, g_str_equal);
+	model->priv->objects_uids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	model->priv->objects_slots = g_array_sized_new (FALSE, TRUE, sizeof (gint), 1);
+	g_array_set_size (model->priv->objects_slots, 1);
 	model->priv->kind = ICAL_NO_COMPONENT;
 
 	model->priv->use_24_hour_format = TRUE;
@@ -3601,47 +3891,6 @@ e_cal_model_set_default_source_uid (ECalModel *model,
 	g_object_notify (G_OBJECT (model), "default-source-uid");
 }
 
-static ECalModelComponent *
-search_by_id_and_client (ECalModelPrivate *priv,
-                         ECalClient *client,
-                         const ECalComponentId *id)
-{
-	gint i;
-
-	for (i = 0; i < priv->objects->len; i++) {
-		ECalModelComponent *comp_data = g_ptr_array_index (priv->objects, i);
-
-		if (comp_data) {
-			const gchar *uid;
-			gchar *rid = NULL;
-			struct icaltimetype icalrid;
-			gboolean has_rid = (id->rid && *id->rid);
-
-			uid = icalcomponent_get_uid (comp_data->icalcomp);
-			icalrid = icalcomponent_get_recurrenceid (comp_data->icalcomp);
-			if (!icaltime_is_null_time (icalrid))
-				rid = icaltime_as_ical_string_r (icalrid);
-
-			if (uid && *uid) {
-				if ((!client || comp_data->client == client) && !strcmp (id->uid, uid)) {
-					if (has_rid) {
-						if (!(rid && *rid && !strcmp (rid, id->rid))) {
-							g_free (rid);
-							continue;
-						}
-					}
-					g_free (rid);
-					return comp_data;
-				}
-			}
-
-			g_free (rid);
-		}
-	}
-
-	return NULL;
-}
-
 void
 e_cal_model_remove_all_objects (ECalModel *model)
 {
@@ -3654,7 +3903,7 @@ e_cal_model_remove_all_objects (ECalModel *model)
 	for (index = model->priv->objects->len - 1; index >= 0; index--) {
 		e_table_model_pre_change (table_model);
 
-		comp_data = g_ptr_array_remove_index (model->priv->objects, index);
+		comp_data = cal_model_remove_object (model, index);
 		if (!comp_data) {
 			e_table_model_no_change (table_model);
 			continue;
@@ -3954,13 +4203,78 @@ e_cal_model_get_component_for_client_and_uid (ECalModel *model,
 					      ECalClient *client,
 					      const ECalComponentId *id)
 {
-	ECalModelPrivate *priv;
+	gint index;
 
 	g_return_val_if_fail (E_IS_CAL_MODEL (model), NULL);
 
-	priv = model->priv;
+	index = e_cal_model_get_component_index (model, client, id);
+	if (index < 0)
+		return NULL;
+
+	return g_ptr_array_index (model->priv->objects, index);
+}
+
+/**
+ * e_cal_model_append_component:
+ * @model: an #ECalModel
+ * @comp_data: an #ECalModelComponent to add
+ *
+ * Appends @comp_data as a new row of the @model. The @model
+ * adds its own reference on the @comp_data.
+ **/
+void
+e_cal_model_append_component (ECalModel *model,
+			      ECalModelComponent *comp_data)
+{
+	ETableModel *table_model;
+
+	g_return_if_fail (E_IS_CAL_MODEL (model));
+	g_return_if_fail (E_IS_CAL_MODEL_COMPONENT (comp_data));
+
+	table_model = E_TABLE_MODEL (model);
+
+	e_table_model_pre_change (table_model);
+
+	cal_model_append_object (model, g_object_ref (comp_data));
+
+	e_table_model_row_inserted (table_model, model->priv->objects->len - 1);
+}
+
+/**
+ * e_cal_model_remove_component:
+ * @model: an #ECalModel
+ * @comp_data: an #ECalModelComponent to remove
+ *
+ * Removes @comp_data from the @model.
+ *
+ * Returns: Whether the @comp_data had been part of the @model.
+ **/
+gboolean
+e_cal_model_remove_component (ECalModel *model,
+			      ECalModelComponent *comp_data)
+{
+	ETableModel *table_model;
+	gint index;
+
+	g_return_val_if_fail (E_IS_CAL_MODEL (model), FALSE);
+	g_return_val_if_fail (E_IS_CAL_MODEL_COMPONENT (comp_data), FALSE);
+
+	index = cal_model_get_object_row (model, comp_data);
+
+	if (index < 0)
+		return FALSE;
+
+	table_model = E_TABLE_MODEL (model);
+
+	e_table_model_pre_change (table_model);
+
+	comp_data = cal_model_remove_object (model, index);
 
-	return search_by_id_and_client (priv, client, id);
+	e_table_model_row_deleted (table_model, index);
+
+	g_object_unref (comp_data);
+
+	return TRUE;
 }
 
 /**
@@ -4063,8 +4377,14 @@ e_cal_model_generate_instances_sync (ECalModel *model,
 }
 
 /**
- * e_cal_model_get_object_array
- */
+ * e_cal_model_get_object_array:
+ * @model: an #ECalModel
+ *
+ * Returns: (transfer none): The array of the #ECalModelComponent-s
+ *    of the @model. It should not be modified, use
+ *    e_cal_model_append_component() and e_cal_model_remove_component()
+ *    instead.
+ **/
 GPtrArray *
 e_cal_model_get_object_array (ECalModel *model)
 {
@@ -364,6 +364,10 @@ ECalModelComponent *
 						(ECalModel *model,
 						 ECalClient *client,
 						 const ECalComponentId *id);
+void		e_cal_model_append_component	(ECalModel *model,
+						 ECalModelComponent *comp_data);
+gboolean	e_cal_model_remove_component	(ECalModel *model,
+						 ECalModelComponent *comp_data);
 gchar *		e_cal_model_date_value_to_string (ECalModel *model,
 						 gconstpointer value);
 void		e_cal_model_generate_instances_sync
@@ -27,28 +27,30 @@
 
 #include "evolution-config.h"
 
+#include "e-cal-layout-grid.h"
 #include "e-day-view-layout.h"
 
 static void e_day_view_layout_long_event (EDayViewEvent	  *event,
-					  guint8	  *grid,
+					  ECalLayoutGrid  *grid,
 					  gint		   days_shown,
 					  time_t	  *day_starts,
 					  gint		  *rows_in_top_display);
 
 static void e_day_view_layout_day_event (EDayViewEvent    *event,
-					 EBitArray       **grid,
-					 guint16	  *group_starts,
+					 ECalLayoutGrid   *grid,
+					 gint		  *group_starts,
 					 guint8		  *cols_per_row,
 					 gint		   rows,
 					 gint		   mins_per_row,
 					 gint              max_cols);
 static void e_day_view_expand_day_event (EDayViewEvent    *event,
-					 EBitArray       **grid,
+					 ECalLayoutGrid   *grid,
 					 guint8		  *cols_per_row,
+					 gint		   rows,
 					 gint		   mins_per_row);
 static void e_day_view_recalc_cols_per_row (gint           rows,
 					    guint8	  *cols_per_row,
-					    guint16       *group_starts);
+					    gint          *group_starts);
 
 void
 e_day_view_layout_long_events (GArray *events,
@@ -58,13 +60,11 @@ e_day_view_layout_long_events (GArray *events,
 {
 	EDayViewEvent *event;
 	gint event_num;
-	guint8 *grid;
+	ECalLayoutGrid *grid;
 
-	/* This is a temporary 2-d grid which is used to place events.
-	 * Each element is 0 if the position is empty, or 1 if occupied.
-	 * We allocate the maximum size possible here, assuming that each
-	 * event will need its own row. */
-	grid = g_new0 (guint8, events->len * E_DAY_VIEW_MAX_DAYS);
+	/* This is a temporary grid which is used to place events. It has
+	 * a bit vector of the occupied rows for each day. */
+	grid = e_cal_layout_grid_new (E_DAY_VIEW_MAX_DAYS);
 
 	/* Reset the number of rows in the top display to 0. It will be
 	 * updated as events are layed out below. */
@@ -81,17 +81,17 @@ e_day_view_layout_long_events (GArray *events,
 	}
 
 	/* Free the grid. */
-	g_free (grid);
+	e_cal_layout_grid_free (grid);
 }
 
 static void
 e_day_view_layout_long_event (EDayViewEvent *event,
-                              guint8 *grid,
+                              ECalLayoutGrid *grid,
                               gint days_shown,
                               time_t *day_starts,
                               gint *rows_in_top_display)
 {
-	gint start_day, end_day, free_row, day, row;
+	gint start_day, end_day, free_row;
 
 	event->num_columns = 0;
 
@@ -100,26 +100,14 @@ e_day_view_layout_long_event (EDayViewEvent *event,
 					      &start_day, &end_day))
 		return;
 
-	/* Try each row until we find a free one. */
-	row = 0;
-	do {
-		free_row = row;
-		for (day = start_day; day <= end_day; day++) {
-			if (grid[row * E_DAY_VIEW_MAX_DAYS + day]) {
-				free_row = -1;
-				break;
-			}
-		}
-		row++;
-	} while (free_row == -1);
+	/* Find the first row free in all the days. */
+	free_row = e_cal_layout_grid_find_free_slot (grid, start_day, end_day, -1);
 
 	event->start_row_or_col = free_row;
 	event->num_columns = 1;
 
 	/* Mark the cells as full. */
-	for (day = start_day; day <= end_day; day++) {
-		grid[free_row * E_DAY_VIEW_MAX_DAYS + day] = 1;
-	}
+	e_cal_layout_grid_occupy (grid, start_day, end_day, free_row);
 
 	/* Update the number of rows in the top canvas if necessary. */
 	*rows_in_top_display = MAX (*rows_in_top_display, free_row + 1);
@@ -135,7 +123,7 @@ e_day_view_layout_day_events (GArray *events,
 {
 	EDayViewEvent *event;
 	gint row, event_num, res;
-	EBitArray **grid;
+	ECalLayoutGrid *grid;
 
 	/* This is a temporary array which keeps track of rows which are
 	 * connected. When an appointment spans multiple rows then the number
@@ -143,11 +131,20 @@ e_day_view_layout_day_events (GArray *events,
 	 * of all of them). Each element in the array corresponds to one row
 	 * and contains the index of the first row in the group of connected
 	 * rows. */
-	guint16 group_starts[12 * 24];
+	gint *group_starts;
+
+	if (rows <= 0)
+		return 0;
 
-	/* This is a temporary 2-d grid which is used to place events.
-	 * Each element is 0 if the position is empty, or 1 if occupied. */
-	grid = g_new0 (EBitArray *, rows);
+	/* The columns are counted in the guint8 cols_per_row array and stored
+	 * in the guint8 start_row_or_col of the events, thus cannot go beyond it. */
+	if (max_cols <= 0 || max_cols > G_MAXUINT8)
+		max_cols = G_MAXUINT8;
+
+	/* This is a temporary grid which is used to place events. It has
+	 * a bit vector of the occupied columns for each row. */
+	grid = e_cal_layout_grid_new (rows);
+	group_starts = g_new (gint, rows);
 
 	/* Reset the cols_per_row array, and initialize the connected rows so
 	 * that all rows are not connected - each row is the start of a new
@@ -155,9 +152,6 @@ e_day_view_layout_day_events (GArray *events,
 	for (row = 0; row < rows; row++) {
 		cols_per_row[row] = 0;
 		group_starts[row] = row;
-
-		/* row doesn't contain any event at the moment */
-		grid[row] = e_bit_array_new (0);
 	}
 
 	/* Iterate over the events, finding which rows they cover, and putting
@@ -181,16 +175,17 @@ e_day_view_layout_day_events (GArray *events,
 		event = &g_array_index (events, EDayViewEvent, event_num);
 		e_day_view_expand_day_event (
 			event, grid, cols_per_row,
-			mins_per_row);
+			rows, mins_per_row);
 	}
 
-	/* Free the grid and compute maximum number of columns used. */
+	/* Compute maximum number of columns used and free the grid. */
 	res = 0;
 	for (row = 0; row < rows; row++) {
-		res = MAX (res, e_bit_array_bit_count (grid[row]));
-		g_object_unref (grid[row]);
+		res = MAX (res, e_cal_layout_grid_get_n_slots (grid, row));
 	}
-	g_free (grid);
+
+	e_cal_layout_grid_free (grid);
+	g_free (group_starts);
 
 	return res;
 }
@@ -200,14 +195,14 @@ e_day_view_layout_day_events (GArray *events,
  * sure they are all in one group. */
 static void
 e_day_view_layout_day_event (EDayViewEvent *event,
-                             EBitArray **grid,
-                             guint16 *group_starts,
+                             ECalLayoutGrid *grid,
+                             gint *group_starts,
                              guint8 *cols_per_row,
                              gint rows,
                              gint mins_per_row,
                              gint max_cols)
 {
-	gint start_row, end_row, free_col, col, row, group_start;
+	gint start_row, end_row, free_col, row, group_start;
 
 	start_row = event->start_minute / mins_per_row;
 	end_row = (event->end_minute - 1) / mins_per_row;
@@ -224,20 +219,8 @@ e_day_view_layout_day_event (EDayViewEvent *event,
 	start_row = CLAMP (start_row, 0, rows - 1);
 	end_row = CLAMP (end_row, 0, rows - 1);
 
-	/* Try each column until we find a free one. */
-	for (col = 0; max_cols <= 0 || col < max_cols; col++) {
-		free_col = col;
-		for (row = start_row; row <= end_row; row++) {
-			if (e_bit_array_bit_count (grid[row]) > col &&
-			    e_bit_array_value_at (grid[row], col)) {
-				free_col = -1;
-				break;
-			}
-		}
-
-		if (free_col != -1)
-			break;
-	}
+	/* Find the first column free in all the rows. */
+	free_col = e_cal_layout_grid_find_free_slot (grid, start_row, end_row, max_cols);
 
 	/* If we can't find space for the event, just return. */
 	if (free_col == -1)
@@ -247,6 +230,8 @@ e_day_view_layout_day_event (EDayViewEvent *event,
 	event->start_row_or_col = free_col;
 	event->num_columns = 1;
 
+	e_cal_layout_grid_occupy (grid, start_row, end_row, free_col);
+
 	/* Determine the start index of the group. */
 	group_start = group_starts[start_row];
 
@@ -255,13 +240,6 @@ e_day_view_layout_day_event (EDayViewEvent *event,
 	 * all the events have been layed out. Also make sure all the rows that
 	 * the event covers are in one group. */
 	for (row = start_row; row <= end_row; row++) {
-		/* resize the array if necessary */
-		if (e_bit_array_bit_count (grid[row]) <= free_col)
-			e_bit_array_insert (
-				grid[row], e_bit_array_bit_count (grid[row]),
-				free_col - e_bit_array_bit_count (grid[row]) + 1);
-
-		e_bit_array_change_one_row (grid[row], free_col, TRUE);
 		cols_per_row[row]++;
 		group_starts[row] = group_start;
 	}
@@ -279,7 +257,7 @@ e_day_view_layout_day_event (EDayViewEvent *event,
 static void
 e_day_view_recalc_cols_per_row (gint rows,
                                 guint8 *cols_per_row,
-                                guint16 *group_starts)
+                                gint *group_starts)
 {
 	gint start_row = 0, row, next_start_row, max_events;
 
@@ -300,34 +278,35 @@ e_day_view_recalc_cols_per_row (gint rows,
 /* Expands the event horizontally to fill any free space. */
 static void
 e_day_view_expand_day_event (EDayViewEvent *event,
-                             EBitArray **grid,
+                             ECalLayoutGrid *grid,
                              guint8 *cols_per_row,
+                             gint rows,
                              gint mins_per_row)
 {
-	gint start_row, end_row, col, row;
-	gboolean clashed;
+	gint start_row, end_row, first_col, used_col, last_col;
+
+	/* The event was not placed, see e_day_view_layout_day_event() */
+	if (!event->num_columns)
+		return;
 
 	start_row = event->start_minute / mins_per_row;
 	end_row = (event->end_minute - 1) / mins_per_row;
 	if (end_row < start_row)
 		end_row = start_row;
 
-	/* Try each column until we find a free one. */
-	clashed = FALSE;
-	for (col = event->start_row_or_col + 1; col < cols_per_row[start_row]; col++) {
-		for (row = start_row; row <= end_row; row++) {
-			if (e_bit_array_bit_count (grid[row]) > col &&
-			    e_bit_array_value_at (grid[row], col)) {
-				clashed = TRUE;
-				break;
-			}
-		}
-
-		if (clashed)
-			break;
+	start_row = CLAMP (start_row, 0, rows - 1);
+	end_row = CLAMP (end_row, 0, rows - 1);
 
-		event->num_columns++;
-	}
+	/* Expand up to the first column used in any of the rows. */
+	first_col = event->start_row_or_col + 1;
+	last_col = cols_per_row[start_row];
+
+	used_col = e_cal_layout_grid_find_used_slot (grid, start_row, end_row, first_col);
+	if (used_col != -1 && used_col < last_col)
+		last_col = used_col;
+
+	if (last_col > first_col)
+		event->num_columns += last_col - first_col;
 }
 
 /* Find the start and end days for the event. */
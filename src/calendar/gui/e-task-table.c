@@ -1622,8 +1622,6 @@ hide_completed_rows_ready (GObject *source_object,
 	ECalClient *cal_client;
 	GSList *m, *objects;
 	gboolean changed = FALSE;
-	gint pos;
-	GPtrArray *comp_objects;
 	GError *error = NULL;
 
 	cal_client = E_CAL_CLIENT (source_object);
@@ -1649,9 +1647,6 @@ hide_completed_rows_ready (GObject *source_object,
 		return;
 	}
 
-	comp_objects = e_cal_model_get_object_array (model);
-	g_return_if_fail (comp_objects != NULL);
-
 	for (m = objects; m; m = m->next) {
 		ECalModelComponent *comp_data;
 		ECalComponentId *id;
@@ -1662,16 +1657,9 @@ hide_completed_rows_ready (GObject *source_object,
 		id = e_cal_component_get_id (comp);
 
 		comp_data = e_cal_model_get_component_for_client_and_uid (model, cal_client, id);
-		if (comp_data != NULL) {
-			e_table_model_pre_change (E_TABLE_MODEL (model));
-			pos = get_position_in_array (
-				comp_objects, comp_data);
-			if (g_ptr_array_remove (comp_objects, comp_data))
-				g_object_unref (comp_data);
-			e_table_model_row_deleted (
-				E_TABLE_MODEL (model), pos);
+		if (comp_data != NULL &&
+		    e_cal_model_remove_component (model, comp_data))
 			changed = TRUE;
-		}
 		e_cal_component_free_id (id);
 		g_object_unref (comp);
 	}
@@ -1693,7 +1681,6 @@ show_completed_rows_ready (GObject *source_object,
 	ECalClient *cal_client;
 	ECalModel *model = user_data;
 	GSList *m, *objects;
-	GPtrArray *comp_objects;
 	GError *error = NULL;
 
 	cal_client = E_CAL_CLIENT (source_object);
@@ -1720,9 +1707,6 @@ show_completed_rows_ready (GObject *source_object,
 		return;
 	}
 
-	comp_objects = e_cal_model_get_object_array (model);
-	g_return_if_fail (comp_objects != NULL);
-
 	for (m = objects; m; m = m->next) {
 		ECalModelComponent *comp_data;
 		ECalComponentId *id;
@@ -1733,7 +1717,6 @@ show_completed_rows_ready (GObject *source_object,
 		id = e_cal_component_get_id (comp);
 
 		if (!(e_cal_model_get_component_for_client_and_uid (model, cal_client, id))) {
-			e_table_model_pre_change (E_TABLE_MODEL (model));
 			comp_data = g_object_new (
 				E_TYPE_CAL_MODEL_COMPONENT, NULL);
 			comp_data->client = g_object_ref (cal_client);
@@ -1748,10 +1731,8 @@ show_completed_rows_ready (GObject *source_object,
 			comp_data->completed = NULL;
 			comp_data->color = NULL;
 
-			g_ptr_array_add (comp_objects, comp_data);
-			e_table_model_row_inserted (
-				E_TABLE_MODEL (model),
-				comp_objects->len - 1);
+			e_cal_model_append_component (model, comp_data);
+			g_object_unref (comp_data);
 		}
 		e_cal_component_free_id (id);
 		g_object_unref (comp);
@@ -22,11 +22,12 @@
 
 #include "evolution-config.h"
 
+#include "e-cal-layout-grid.h"
 #include "e-week-view-layout.h"
 #include "calendar-config.h"
 
 static void e_week_view_layout_event	(EWeekViewEvent	*event,
-					 guint8		*grid,
+					 ECalLayoutGrid	*grid,
 					 GArray		*spans,
 					 GArray		*old_spans,
 					 gboolean	 multi_week_view,
@@ -57,21 +58,19 @@ e_week_view_layout_events (GArray *events,
 	EWeekViewEvent *event;
 	EWeekViewEventSpan *span;
 	gint num_days, day, event_num, span_num;
-	guint8 *grid;
+	ECalLayoutGrid *grid;
 	GArray *spans;
 
-	/* This is a temporary 2-d grid which is used to place events.
-	 * Each element is 0 if the position is empty, or 1 if occupied.
-	 * We allocate the maximum size possible here, assuming that each
-	 * event will need its own row. */
-	grid = g_new0 (guint8, E_WEEK_VIEW_MAX_ROWS_PER_CELL * 7
-		       * E_WEEK_VIEW_MAX_WEEKS);
+	num_days = multi_week_view ? weeks_shown * 7 : 7;
+
+	/* This is a temporary grid which is used to place events. It has
+	 * a bit vector of the occupied rows for each day. */
+	grid = e_cal_layout_grid_new (num_days);
 
 	/* We create a new array of spans, which will replace the old one. */
 	spans = g_array_new (FALSE, FALSE, sizeof (EWeekViewEventSpan));
 
 	/* Clear the number of rows used per day. */
-	num_days = multi_week_view ? weeks_shown * 7 : 7;
 	for (day = 0; day < num_days; day++) {
 		rows_per_day[day] = 0;
 	}
@@ -89,7 +88,7 @@ e_week_view_layout_events (GArray *events,
 	}
 
 	/* Free the grid. */
-	g_free (grid);
+	e_cal_layout_grid_free (grid);
 
 	/* Destroy the old spans array, destroying any unused canvas items. */
 	if (old_spans) {
@@ -109,7 +108,7 @@ e_week_view_layout_events (GArray *events,
 
 static void
 e_week_view_layout_event (EWeekViewEvent *event,
-                                 guint8 *grid,
+                                 ECalLayoutGrid *grid,
                                  GArray *spans,
                                  GArray *old_spans,
                                  gboolean multi_week_view,
@@ -120,7 +119,7 @@ e_week_view_layout_event (EWeekViewEvent *event,
                                  gint *rows_per_day)
 {
 	gint start_day, end_day, span_start_day, span_end_day, rows_per_cell;
-	gint free_row, row, day, span_num, spans_index, num_spans, days_shown;
+	gint free_row, day, span_num, spans_index, num_spans, days_shown;
 	EWeekViewEventSpan span, *old_span;
 
 	days_shown = multi_week_view ? weeks_shown * 7 : 7;
@@ -158,27 +157,18 @@ e_week_view_layout_event (EWeekViewEvent *event,
 			"  Span start:%i end:%i\n", span_start_day,
 			span_end_day);
 #endif
-		/* Try each row until we find a free one or we fall off the
-		 * bottom of the available rows. */
-		row = 0;
-		free_row = -1;
-		while (free_row == -1 && row < rows_per_cell) {
-			free_row = row;
-			for (day = span_start_day; day <= span_end_day;
-			     day++) {
-				if (grid[day * rows_per_cell + row]) {
-					free_row = -1;
-					break;
-				}
-			}
-			row++;
-		};
+		/* Find the first row free in all the days of the span,
+		 * unless we fall off the bottom of the available rows. */
+		free_row = e_cal_layout_grid_find_free_slot (
+			grid, span_start_day, span_end_day, rows_per_cell);
 
 		if (free_row != -1) {
 			/* Mark the cells as full. */
+			e_cal_layout_grid_occupy (
+				grid, span_start_day, span_end_day, free_row);
+
 			for (day = span_start_day; day <= span_end_day;
 			     day++) {
-				grid[day * rows_per_cell + free_row] = 1;
 				rows_per_day[day] = MAX (
 					rows_per_day[day],
 					free_row + 1);
@@ -0,0 +1,303 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Feeds synthetic events of two calendars into an ECalModel the same way
+ * the ECalDataModel does and prints how long it took to add, modify and
+ * remove them, for a quarter, a half and all of the events, thus the times
+ * can be compared to show they grow linearly. Every tenth event is a detached
+ * instance of a recurring event. It also verifies the lookup of components
+ * with a duplicate key. The clients are not opened, the model only uses them
+ * as a part of the component key. Usage:
+ *    test-cal-model [N_EVENTS]
+ */
+
+#include "evolution-config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "e-cal-model-calendar.h"
+
+static GCancellable *
+submit_thread_job_cb (GObject *responder,
+		      const gchar *description,
+		      const gchar *alert_ident,
+		      const gchar *alert_arg_0,
+		      EAlertSinkThreadJobFunc func,
+		      gpointer user_data,
+		      GDestroyNotify free_user_data)
+{
+	/* The model is fed directly, nothing runs in a thread */
+	if (free_user_data)
+		free_user_data (user_data);
+
+	return NULL;
+}
+
+static ECalClient *
+create_client (const gchar *uid)
+{
+	ECalClient *client;
+	ESource *source;
+
+	source = e_source_new_with_uid (uid, NULL, NULL);
+	e_source_set_display_name (source, uid);
+
+	client = g_object_new (E_TYPE_CAL_CLIENT,
+		"source", source,
+		"source-type", E_CAL_CLIENT_SOURCE_TYPE_EVENTS,
+		NULL);
+
+	g_object_unref (source);
+
+	return client;
+}
+
+static ECalModel *
+create_model (ECalDataModel *data_model)
+{
+	ECalModel *model;
+
+	model = g_object_new (E_TYPE_CAL_MODEL_CALENDAR,
+		"data-model", data_model,
+		NULL);
+
+	e_cal_model_set_timezone (model, icaltimezone_get_utc_timezone ());
+
+	return model;
+}
+
+static GPtrArray *
+generate_events (gint n_events)
+{
+	GPtrArray *comps;
+	struct icaltimetype start;
+	gint ii;
+
+	comps = g_ptr_array_new_with_free_func (g_object_unref);
+	start = icaltime_from_timet_with_zone (time (NULL), FALSE, icaltimezone_get_utc_timezone ());
+
+	for (ii = 0; ii < n_events; ii++) {
+		icalcomponent *icalcomp;
+		struct icaltimetype dtstart, dtend;
+		gchar *value;
+
+		icalcomp = icalcomponent_new (ICAL_VEVENT_COMPONENT);
+
+		dtstart = start;
+		icaltime_adjust (&dtstart, ii % 365, ii % 24, 0, 0);
+		dtend = dtstart;
+		icaltime_adjust (&dtend, 0, 1, 0, 0);
+
+		if (ii % 10 == 0) {
+			value = g_strdup_printf ("test-cal-model-series-%d", ii / 100);
+			icalcomponent_set_recurrenceid (icalcomp, dtstart);
+		} else {
+			value = g_strdup_printf ("test-cal-model-%d", ii);
+		}
+
+		icalcomponent_set_uid (icalcomp, value);
+		g_free (value);
+
+		value = g_strdup_printf ("Event %d", ii);
+		icalcomponent_set_summary (icalcomp, value);
+		g_free (value);
+
+		icalcomponent_set_dtstart (icalcomp, dtstart);
+		icalcomponent_set_dtend (icalcomp, dtend);
+
+		g_ptr_array_add (comps, e_cal_component_new_from_icalcomponent (icalcomp));
+	}
+
+	return comps;
+}
+
+static void
+print_elapsed (const gchar *what,
+	       gint n_events,
+	       gint64 started)
+{
+	gdouble elapsed = MAX (g_get_monotonic_time () - started, 1) / (gdouble) G_USEC_PER_SEC;
+
+	printf ("%-8s %7d events in %7.3f s, %.2f us/event\n", what, n_events, elapsed, elapsed * G_USEC_PER_SEC / n_events);
+}
+
+static gboolean
+benchmark_model (ECalDataModel *data_model,
+		 ECalClient **clients,
+		 GPtrArray *comps,
+		 gint n_events)
+{
+	ECalDataModelSubscriber *subscriber;
+	ECalModel *model;
+	ECalComponentId *id;
+	gint64 started;
+	gint ii, n_rows;
+	gboolean success = TRUE;
+
+	model = create_model (data_model);
+	subscriber = E_CAL_DATA_MODEL_SUBSCRIBER (model);
+
+	started = g_get_monotonic_time ();
+
+	for (ii = 0; ii < n_events; ii++)
+		e_cal_data_model_subscriber_component_added (subscriber, clients[ii % 2], comps->pdata[ii]);
+
+	print_elapsed ("Add", n_events, started);
+
+	n_rows = e_table_model_row_count (E_TABLE_MODEL (model));
+	if (n_rows != n_events) {
+		fprintf (stderr, "Expected %d rows after add, but the model has %d\n", n_events, n_rows);
+		success = FALSE;
+	}
+
+	started = g_get_monotonic_time ();
+
+	for (ii = 0; ii < n_events; ii++)
+		e_cal_data_model_subscriber_component_modified (subscriber, clients[ii % 2], comps->pdata[ii]);
+
+	print_elapsed ("Modify", n_events, started);
+
+	n_rows = e_table_model_row_count (E_TABLE_MODEL (model));
+	if (n_rows != n_events) {
+		fprintf (stderr, "Expected %d rows after modify, but the model has %d\n", n_events, n_rows);
+		success = FALSE;
+	}
+
+	/* In the order of the rows, where each removal shifts all the rows after it */
+	started = g_get_monotonic_time ();
+
+	for (ii = 0; ii < n_events; ii++) {
+		id = e_cal_component_get_id (comps->pdata[ii]);
+		e_cal_data_model_subscriber_component_removed (subscriber, clients[ii % 2], id->uid, id->rid);
+		e_cal_component_free_id (id);
+	}
+
+	print_elapsed ("Remove", n_events, started);
+
+	n_rows = e_table_model_row_count (E_TABLE_MODEL (model));
+	if (n_rows != 0) {
+		fprintf (stderr, "Expected no rows after remove, but the model has %d\n", n_rows);
+		success = FALSE;
+	}
+
+	g_object_unref (model);
+
+	return success;
+}
+
+static ECalModelComponent *
+create_comp_data (ECalClient *client,
+		  ECalComponent *comp)
+{
+	ECalModelComponent *comp_data;
+
+	comp_data = g_object_new (E_TYPE_CAL_MODEL_COMPONENT, NULL);
+	comp_data->client = g_object_ref (client);
+	comp_data->icalcomp = icalcomponent_new_clone (e_cal_component_get_icalcomponent (comp));
+
+	return comp_data;
+}
+
+/* Like the ETaskTable, which can append a component with a key already in the model */
+static gboolean
+verify_duplicates (ECalDataModel *data_model,
+		   ECalClient *client,
+		   GPtrArray *comps)
+{
+	ECalModel *model;
+	ECalModelComponent *first, *second, *found;
+	ECalComponentId *id;
+	gboolean success = TRUE;
+
+	model = create_model (data_model);
+
+	e_cal_data_model_subscriber_component_added (E_CAL_DATA_MODEL_SUBSCRIBER (model), client, comps->pdata[2]);
+
+	first = create_comp_data (client, comps->pdata[1]);
+	second = create_comp_data (client, comps->pdata[1]);
+
+	e_cal_model_append_component (model, first);
+	e_cal_model_append_component (model, second);
+
+	id = e_cal_component_get_id (comps->pdata[1]);
+
+	found = e_cal_model_get_component_for_client_and_uid (model, client, id);
+	if (found != first) {
+		fprintf (stderr, "Duplicates: The first component not found\n");
+		success = FALSE;
+	}
+
+	e_cal_model_remove_component (model, first);
+
+	found = e_cal_model_get_component_for_client_and_uid (model, client, id);
+	if (found != second) {
+		fprintf (stderr, "Duplicates: The second component not found after removal of the first\n");
+		success = FALSE;
+	}
+
+	if (e_cal_model_get_component_at (model, 1) != second) {
+		fprintf (stderr, "Duplicates: The second component is not at the second row\n");
+		success = FALSE;
+	}
+
+	e_cal_model_remove_component (model, second);
+
+	found = e_cal_model_get_component_for_client_and_uid (model, client, id);
+	if (found) {
+		fprintf (stderr, "Duplicates: A component found after removal of both\n");
+		success = FALSE;
+	}
+
+	e_cal_component_free_id (id);
+	g_object_unref (first);
+	g_object_unref (second);
+	g_object_unref (model);
+
+	return success;
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	ECalDataModel *data_model;
+	ECalClient *clients[2];
+	GPtrArray *comps;
+	gint n_events, ii;
+	gint res = 0;
+
+	n_events = argc > 1 ? MAX (4, atoi (argv[1])) : 100000;
+
+	data_model = e_cal_data_model_new (submit_thread_job_cb, NULL);
+	clients[0] = create_client ("test-cal-model-1");
+	clients[1] = create_client ("test-cal-model-2");
+
+	comps = generate_events (n_events);
+
+	if (!verify_duplicates (data_model, clients[0], comps))
+		res = 1;
+
+	for (ii = 4; ii >= 1; ii /= 2) {
+		if (!benchmark_model (data_model, clients, comps, n_events / ii))
+			res = 1;
+	}
+
+	g_ptr_array_unref (comps);
+	g_object_unref (clients[0]);
+	g_object_unref (clients[1]);
+	g_object_unref (data_model);
+
+	return res;
+}
@@ -0,0 +1,139 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Lays out synthetic events across a week with the Day view and the Week
+ * view layouts and prints how long it took. Usage:
+ *    test-calendar-view-layout [N_EVENTS [MINS_PER_ROW]]
+ */
+
+#include "evolution-config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "e-day-view-layout.h"
+#include "e-week-view-layout.h"
+
+#define N_DAYS 7
+#define DAY_SECONDS (24 * 60 * 60)
+
+static void
+benchmark_day_view (GRand *rand,
+                    gint n_events,
+                    gint mins_per_row)
+{
+	GArray *events[N_DAYS];
+	guint8 *cols_per_row;
+	gint64 started;
+	gint day, ii, rows, max_cols = 0;
+
+	rows = 24 * 60 / mins_per_row;
+	cols_per_row = g_new0 (guint8, rows);
+
+	for (day = 0; day < N_DAYS; day++)
+		events[day] = g_array_new (FALSE, TRUE, sizeof (EDayViewEvent));
+
+	for (ii = 0; ii < n_events; ii++) {
+		EDayViewEvent event = { 0 };
+		gint start = g_rand_int_range (rand, 0, 24 * 60 - 15);
+
+		event.start_minute = start;
+		event.end_minute = MIN (start + g_rand_int_range (rand, 15, 4 * 60), 24 * 60);
+
+		g_array_append_val (events[ii % N_DAYS], event);
+	}
+
+	started = g_get_monotonic_time ();
+
+	for (day = 0; day < N_DAYS; day++) {
+		max_cols = MAX (max_cols, e_day_view_layout_day_events (
+			events[day], rows, mins_per_row, cols_per_row, -1));
+	}
+
+	printf (
+		"Day view: %d events in %d rows per day laid out in %.3f ms, max %d columns\n",
+		n_events, rows, (g_get_monotonic_time () - started) / 1000.0, max_cols);
+
+	for (day = 0; day < N_DAYS; day++)
+		g_array_free (events[day], TRUE);
+
+	g_free (cols_per_row);
+}
+
+static void
+benchmark_week_view (GRand *rand,
+                     gint n_events)
+{
+	GArray *events, *spans;
+	time_t day_starts[N_DAYS + 1];
+	gint rows_per_day[N_DAYS];
+	gint64 started;
+	gint day, ii, max_rows = 0;
+
+	for (day = 0; day <= N_DAYS; day++)
+		day_starts[day] = day * DAY_SECONDS;
+
+	events = g_array_new (FALSE, TRUE, sizeof (EWeekViewEvent));
+
+	for (ii = 0; ii < n_events; ii++) {
+		EWeekViewEvent event = { 0 };
+
+		event.start = g_rand_int_range (rand, 0, N_DAYS * DAY_SECONDS - 60 * 60);
+		event.end = MIN (event.start + g_rand_int_range (rand, 15 * 60, 2 * DAY_SECONDS), N_DAYS * DAY_SECONDS);
+
+		g_array_append_val (events, event);
+	}
+
+	started = g_get_monotonic_time ();
+
+	spans = e_week_view_layout_events (
+		events, NULL, FALSE, 1, FALSE, G_DATE_MONDAY,
+		day_starts, rows_per_day);
+
+	printf (
+		"Week view: %d events laid out in %.3f ms, %u spans\n",
+		n_events, (g_get_monotonic_time () - started) / 1000.0, spans->len);
+
+	for (day = 0; day < N_DAYS; day++)
+		max_rows = MAX (max_rows, rows_per_day[day]);
+
+	printf ("Week view: max %d rows per day\n", max_rows);
+
+	g_array_free (spans, TRUE);
+	g_array_free (events, TRUE);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	GRand *rand;
+	gint n_events = 10000, mins_per_row = 5;
+
+	if (argc > 1)
+		n_events = MAX (atoi (argv[1]), 1);
+
+	if (argc > 2)
+		mins_per_row = CLAMP (atoi (argv[2]), 1, 60);
+
+	/* Fixed seed, to compare the results between runs */
+	rand = g_rand_new_with_seed (1);
+
+	benchmark_day_view (rand, n_events, mins_per_row);
+	benchmark_week_view (rand, n_events);
+
+	g_rand_free (rand);
+
+	return 0;
+}
@@ -133,8 +133,29 @@ typedef struct {
 	gint xofs, yofs;                 /* This gets added to the x
                                            and y for the cell text. */
 	gdouble ellipsis_width[2];      /* The width of the ellipsis. */
+
+	/* Shaped layouts of recently drawn or measured cells. */
+	GHashTable *layout_cache;	/* CachedLayout ~> itself */
+	GQueue layout_cache_lru;	/* CachedLayout *, most recently used first */
+	ETableModel *layout_cache_model;
 } ECellTextView;
 
+/* Building a layout means fetching the style attributes from the model
+ * and shaping the text, which is the most expensive part of drawing
+ * a cell; scrolling or repainting shows the same cells over and over,
+ * thus keep a bounded number of them around. */
+#define LAYOUT_CACHE_MAX_SIZE 1024
+
+typedef struct _CachedLayout {
+	gint row;
+	gint model_col;
+	gint width;
+	guint text_hash;
+	gchar *text;
+	PangoLayout *layout;
+	GList *link;	/* in ECellTextView::layout_cache_lru */
+} CachedLayout;
+
 struct _CellEdit {
 
 	ECellTextView *text_view;
@@ -329,6 +350,107 @@ ect_cancel_edit (ECellTextView *text_view)
 	e_table_item_leave_edit_ (text_view->cell_view.e_table_item_view);
 }
 
+static guint
+cached_layout_hash (gconstpointer ptr)
+{
+	const CachedLayout *cl = ptr;
+
+	return ((cl->row * 33 + cl->model_col) * 33 + cl->width) ^ cl->text_hash;
+}
+
+static gboolean
+cached_layout_equal (gconstpointer ptr1,
+                     gconstpointer ptr2)
+{
+	const CachedLayout *cl1 = ptr1, *cl2 = ptr2;
+
+	return cl1->row == cl2->row &&
+		cl1->model_col == cl2->model_col &&
+		cl1->width == cl2->width &&
+		cl1->text_hash == cl2->text_hash &&
+		g_strcmp0 (cl1->text, cl2->text) == 0;
+}
+
+static void
+cached_layout_free (CachedLayout *cl)
+{
+	if (cl) {
+		g_clear_object (&cl->layout);
+		g_free (cl->text);
+		g_free (cl);
+	}
+}
+
+static void
+layout_cache_remove (ECellTextView *text_view,
+                     CachedLayout *cl)
+{
+	g_hash_table_remove (text_view->layout_cache, cl);
+	g_queue_delete_link (&text_view->layout_cache_lru, cl->link);
+	cached_layout_free (cl);
+}
+
+static void
+layout_cache_clear (ECellTextView *text_view)
+{
+	g_hash_table_remove_all (text_view->layout_cache);
+	g_queue_foreach (&text_view->layout_cache_lru, (GFunc) cached_layout_free, NULL);
+	g_queue_clear (&text_view->layout_cache_lru);
+}
+
+static void
+layout_cache_remove_row (ECellTextView *text_view,
+                         gint row)
+{
+	GList *link, *next;
+
+	/* The style attributes are read from other columns of the row,
+	 * thus forget the layouts of all its columns. */
+	for (link = text_view->layout_cache_lru.head; link; link = next) {
+		CachedLayout *cl = link->data;
+
+		next = g_list_next (link);
+
+		if (cl->row == row)
+			layout_cache_remove (text_view, cl);
+	}
+}
+
+static void
+ect_model_changed_cb (ETableModel *table_model,
+                      ECellTextView *text_view)
+{
+	layout_cache_clear (text_view);
+}
+
+static void
+ect_model_row_changed_cb (ETableModel *table_model,
+                          gint row,
+                          ECellTextView *text_view)
+{
+	layout_cache_remove_row (text_view, row);
+}
+
+static void
+ect_model_cell_changed_cb (ETableModel *table_model,
+                           gint col,
+                           gint row,
+                           ECellTextView *text_view)
+{
+	layout_cache_remove_row (text_view, row);
+}
+
+static void
+ect_model_rows_changed_cb (ETableModel *table_model,
+                           gint row,
+                           gint count,
+                           ECellTextView *text_view)
+{
+	/* Rows after the change moved, their cached layouts would apply
+	 * to different rows now. */
+	layout_cache_clear (text_view);
+}
+
 /*
  * ECell::new_view method
  */
@@ -351,6 +473,30 @@ ect_new_view (ECell *ecell,
 	text_view->xofs = 0.0;
 	text_view->yofs = 0.0;
 
+	text_view->layout_cache = g_hash_table_new (cached_layout_hash, cached_layout_equal);
+	g_queue_init (&text_view->layout_cache_lru);
+
+	/* The view can outlive the ETableItem's reference on the model. */
+	if (table_model) {
+		text_view->layout_cache_model = g_object_ref (table_model);
+
+		g_signal_connect (
+			table_model, "model_changed",
+			G_CALLBACK (ect_model_changed_cb), text_view);
+		g_signal_connect (
+			table_model, "model_row_changed",
+			G_CALLBACK (ect_model_row_changed_cb), text_view);
+		g_signal_connect (
+			table_model, "model_cell_changed",
+			G_CALLBACK (ect_model_cell_changed_cb), text_view);
+		g_signal_connect (
+			table_model, "model_rows_inserted",
+			G_CALLBACK (ect_model_rows_changed_cb), text_view);
+		g_signal_connect (
+			table_model, "model_rows_deleted",
+			G_CALLBACK (ect_model_rows_changed_cb), text_view);
+	}
+
 	return (ECellView *) text_view;
 }
 
@@ -368,6 +514,14 @@ ect_kill_view (ECellView *ecv)
 	if (text_view->cell_view.kill_view_cb_data)
 	    g_list_free (text_view->cell_view.kill_view_cb_data);
 
+	if (text_view->layout_cache_model) {
+		g_signal_handlers_disconnect_by_data (text_view->layout_cache_model, text_view);
+		g_clear_object (&text_view->layout_cache_model);
+	}
+
+	layout_cache_clear (text_view);
+	g_hash_table_destroy (text_view->layout_cache);
+
 	g_free (text_view);
 }
 
@@ -397,6 +551,8 @@ ect_unrealize (ECellView *ecv)
 		ect_cancel_edit (text_view);
 	}
 
+	layout_cache_clear (text_view);
+
 	g_object_unref (text_view->i_cursor);
 
 	if (E_CELL_CLASS (e_cell_text_parent_class)->unrealize)
@@ -609,12 +765,62 @@ build_layout (ECellTextView *text_view,
 	return layout;
 }
 
+static PangoLayout *
+build_layout_cached (ECellTextView *text_view,
+                     gint model_col,
+                     gint row,
+                     const gchar *text,
+                     gint width)
+{
+	CachedLayout key, *cl;
+
+	/* The layouts differ while editing, see build_layout() */
+	if (text_view->edit)
+		return build_layout (text_view, row, text, width);
+
+	key.row = row;
+	key.model_col = model_col;
+	key.width = width;
+	key.text_hash = g_str_hash (text);
+	key.text = (gchar *) text;
+
+	cl = g_hash_table_lookup (text_view->layout_cache, &key);
+	if (cl) {
+		if (cl->link != text_view->layout_cache_lru.head) {
+			g_queue_unlink (&text_view->layout_cache_lru, cl->link);
+			g_queue_push_head_link (&text_view->layout_cache_lru, cl->link);
+		}
+
+		return g_object_ref (cl->layout);
+	}
+
+	while (text_view->layout_cache_lru.length >= LAYOUT_CACHE_MAX_SIZE)
+		layout_cache_remove (text_view, g_queue_peek_tail (&text_view->layout_cache_lru));
+
+	cl = g_new0 (CachedLayout, 1);
+	cl->row = row;
+	cl->model_col = model_col;
+	cl->width = width;
+	cl->text_hash = key.text_hash;
+	cl->text = g_strdup (text);
+	cl->layout = build_layout (text_view, row, text, width);
+
+	g_queue_push_head (&text_view->layout_cache_lru, cl);
+	cl->link = text_view->layout_cache_lru.head;
+	g_hash_table_add (text_view->layout_cache, cl);
+
+	return g_object_ref (cl->layout);
+}
+
+/* The @use_cache should be TRUE only when the caller does not modify
+ * the returned layout; it's ignored while editing. */
 static PangoLayout *
 generate_layout (ECellTextView *text_view,
                  gint model_col,
                  gint view_col,
                  gint row,
-                 gint width)
+                 gint width,
+                 gboolean use_cache)
 {
 	ECellView *ecell_view = (ECellView *) text_view;
 	ECellText *ect = E_CELL_TEXT (ecell_view->ecell);
@@ -628,8 +834,13 @@ generate_layout (ECellTextView *text_view,
 
 	if (row >= 0) {
 		gchar *temp = e_cell_text_get_text (ect, ecell_view->e_table_model, model_col, row);
-		layout = build_layout (text_view, row, temp ? temp : "?", width);
+		if (use_cache)
+			layout = build_layout_cached (text_view, model_col, row, temp ? temp : "?", width);
+		else
+			layout = build_layout (text_view, row, temp ? temp : "?", width);
 		e_cell_text_free_text (ect, ecell_view->e_table_model, model_col, temp);
+	} else if (use_cache) {
+		layout = build_layout_cached (text_view, model_col, row, "Mumbo Jumbo", width);
 	} else
 		layout = build_layout (text_view, row, "Mumbo Jumbo", width);
 
@@ -815,7 +1026,7 @@ ect_draw (ECellView *ecell_view,
 	cairo_rectangle (cr, x1, y1, x2 - x1, y2 - y1);
 	cairo_clip (cr);
 
-	layout = generate_layout (text_view, model_col, view_col, row, x2 - x1);
+	layout = generate_layout (text_view, model_col, view_col, row, x2 - x1, TRUE);
 
 	if (edit && edit->view_col == view_col && edit->row == row) {
 		layout = layout_with_preedit  (text_view, row, edit->text ? edit->text : "?",  x2 - x1);
@@ -896,6 +1107,21 @@ ect_get_bg_color (ECellView *ecell_view,
 	return color_spec;
 }
 
+/*
+ * ECell::style_updated method
+ */
+static void
+ect_style_updated (ECellView *ecell_view)
+{
+	ECellTextView *text_view = (ECellTextView *) ecell_view;
+
+	/* Fonts or their sizes could change. */
+	layout_cache_clear (text_view);
+
+	if (E_CELL_CLASS (e_cell_text_parent_class)->style_updated)
+		E_CELL_CLASS (e_cell_text_parent_class)->style_updated (ecell_view);
+}
+
 /*
  * Selects the entire string
  */
@@ -1152,7 +1378,7 @@ ect_height (ECellView *ecell_view,
 	gint height;
 	PangoLayout *layout;
 
-	layout = generate_layout (text_view, model_col, view_col, row, 0);
+	layout = generate_layout (text_view, model_col, view_col, row, 0, TRUE);
 	pango_layout_get_pixel_size (layout, NULL, &height);
 	g_object_unref (layout);
 	return height + (get_vertical_spacing (GTK_WIDGET (text_view->canvas)) * 2);
@@ -1190,7 +1416,7 @@ ect_enter_edit (ECellView *ecell_view,
 		((ETableItem *) ecell_view->e_table_item_view)->header,
 		view_col)->width - 8;
 
-	edit->layout = generate_layout (text_view, model_col, view_col, row, edit->cell_width);
+	edit->layout = generate_layout (text_view, model_col, view_col, row, edit->cell_width, FALSE);
 
 	edit->xofs_edit = 0.0;
 	edit->yofs_edit = 0.0;
@@ -1518,7 +1744,7 @@ ect_max_width (ECellView *ecell_view,
 	number_of_rows = e_table_model_row_count (ecell_view->e_table_model);
 
 	for (row = 0; row < number_of_rows; row++) {
-		PangoLayout *layout = generate_layout (text_view, model_col, view_col, row, 0);
+		PangoLayout *layout = generate_layout (text_view, model_col, view_col, row, 0, FALSE);
 		gint width;
 
 		pango_layout_get_pixel_size (layout, &width, NULL);
@@ -1544,7 +1770,7 @@ ect_max_width_by_row (ECellView *ecell_view,
 	if (row >= e_table_model_row_count (ecell_view->e_table_model))
 		return 0;
 
-	layout = generate_layout (text_view, model_col, view_col, row, 0);
+	layout = generate_layout (text_view, model_col, view_col, row, 0, TRUE);
 	pango_layout_get_pixel_size (layout, &width, NULL);
 	g_object_unref (layout);
 
@@ -1689,6 +1915,7 @@ e_cell_text_class_init (ECellTextClass *class)
 	ecc->max_width = ect_max_width;
 	ecc->max_width_by_row = ect_max_width_by_row;
 	ecc->get_bg_color = ect_get_bg_color;
+	ecc->style_updated = ect_style_updated;
 
 	class->get_text = ect_real_get_text;
 	class->free_text = ect_real_free_text;
@@ -2104,7 +2331,7 @@ get_position_from_xy (CellEdit *edit,
 	gint trailing;
 	const gchar *text;
 
-	PangoLayout *layout = generate_layout (edit->text_view, edit->model_col, edit->view_col, edit->row, edit->cell_width);
+	PangoLayout *layout = generate_layout (edit->text_view, edit->model_col, edit->view_col, edit->row, edit->cell_width, FALSE);
 	ECellTextView *text_view = edit->text_view;
 	ECellText *ect = (ECellText *) ((ECellView *) text_view)->ecell;
 
@@ -43,7 +43,11 @@
 struct _EContactStorePrivate {
 	gint stamp;
 	EBookQuery *query;
+	gchar *cue;		/* normalized completion cue */
+	gchar *cue_comma;	/* the cue with words joined with ", " */
 	GArray *contact_sources;
+	GArray *offsets;	/* gint; row offset of each contact source, then the count */
+	gboolean offsets_valid;
 };
 
 /* Signals */
@@ -94,21 +98,32 @@ static gboolean     e_contact_store_iter_parent     (GtkTreeModel       *tree_mo
 						     GtkTreeIter        *iter,
 						     GtkTreeIter        *child);
 
+typedef struct _CompletionIndex CompletionIndex;
+
 typedef struct
 {
 	EBookClient *book_client;
 
 	EBookClientView *client_view;
 	GPtrArray *contacts;
+	GHashTable *contacts_index; /* gchar *uid ~> index in contacts + 1 */
 
 	EBookClientView *client_view_pending;
 	GPtrArray *contacts_pending;
+	GHashTable *contacts_pending_index;
+
+	/* Set when the contacts are filtered from the completion index */
+	CompletionIndex *completion_index;
+	gboolean uses_index;
+	gchar *index_cue; /* the cue the contacts were filtered with */
 }
 ContactSource;
 
 static void free_contact_ptrarray (GPtrArray *contacts);
 static void clear_contact_source  (EContactStore *contact_store, ContactSource *source);
 static void stop_view             (EContactStore *contact_store, EBookClientView *view);
+static void stop_contact_source_views (EContactStore *contact_store, ContactSource *source);
+static void release_completion_index (EContactStore *contact_store, ContactSource *source);
 
 static void
 contact_store_dispose (GObject *object)
@@ -127,7 +142,9 @@ contact_store_dispose (GObject *object)
 			priv->contact_sources, ContactSource, priv->contact_sources->len - ii - 1);
 
 		clear_contact_source (E_CONTACT_STORE (object), source);
+		release_completion_index (E_CONTACT_STORE (object), source);
 		free_contact_ptrarray (source->contacts);
+		g_hash_table_destroy (source->contacts_index);
 		g_object_unref (source->book_client);
 	}
 	g_array_set_size (priv->contact_sources, 0);
@@ -137,6 +154,11 @@ contact_store_dispose (GObject *object)
 		priv->query = NULL;
 	}
 
+	g_free (priv->cue);
+	priv->cue = NULL;
+	g_free (priv->cue_comma);
+	priv->cue_comma = NULL;
+
 	/* Chain up to parent's dispose() method. */
 	G_OBJECT_CLASS (e_contact_store_parent_class)->dispose (object);
 }
@@ -149,6 +171,7 @@ contact_store_finalize (GObject *object)
 	priv = E_CONTACT_STORE_GET_PRIVATE (object);
 
 	g_array_free (priv->contact_sources, TRUE);
+	g_array_free (priv->offsets, TRUE);
 
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (e_contact_store_parent_class)->finalize (object);
@@ -233,6 +256,7 @@ e_contact_store_init (EContactStore *contact_store)
 	contact_store->priv = E_CONTACT_STORE_GET_PRIVATE (contact_store);
 	contact_store->priv->stamp = g_random_int ();
 	contact_store->priv->contact_sources = contact_sources;
+	contact_store->priv->offsets = g_array_new (FALSE, TRUE, sizeof (gint));
 }
 
 /**
@@ -258,6 +282,8 @@ row_deleted (EContactStore *contact_store,
 {
 	GtkTreePath *path;
 
+	contact_store->priv->offsets_valid = FALSE;
+
 	path = gtk_tree_path_new ();
 	gtk_tree_path_append_index (path, n);
 	gtk_tree_model_row_deleted (GTK_TREE_MODEL (contact_store), path);
@@ -271,6 +297,8 @@ row_inserted (EContactStore *contact_store,
 	GtkTreePath *path;
 	GtkTreeIter  iter;
 
+	contact_store->priv->offsets_valid = FALSE;
+
 	path = gtk_tree_path_new ();
 	gtk_tree_path_append_index (path, n);
 
@@ -341,26 +369,62 @@ find_contact_source_by_view (EContactStore *contact_store,
 	return -1;
 }
 
-static gint
-find_contact_source_by_offset (EContactStore *contact_store,
-                               gint offset)
+/* Returns prefix sums of the contact counts of the contact sources,
+   that is the offset of each of them, followed by the total count */
+static GArray *
+ensure_contact_source_offsets (EContactStore *contact_store)
 {
-	GArray *array;
+	GArray *array, *offsets;
 	gint i;
 
 	array = contact_store->priv->contact_sources;
+	offsets = contact_store->priv->offsets;
+
+	if (contact_store->priv->offsets_valid && offsets->len == array->len + 1)
+		return offsets;
+
+	g_array_set_size (offsets, array->len + 1);
+
+	g_array_index (offsets, gint, 0) = 0;
 
 	for (i = 0; i < array->len; i++) {
 		ContactSource *source;
 
 		source = &g_array_index (array, ContactSource, i);
-		if (source->contacts->len > offset)
-			return i;
+		g_array_index (offsets, gint, i + 1) = g_array_index (offsets, gint, i) + source->contacts->len;
+	}
+
+	contact_store->priv->offsets_valid = TRUE;
 
-		offset -= source->contacts->len;
+	return offsets;
+}
+
+static gint
+find_contact_source_by_offset (EContactStore *contact_store,
+                               gint offset)
+{
+	GArray *offsets;
+	guint lo, hi;
+
+	offsets = ensure_contact_source_offsets (contact_store);
+
+	if (offset < 0 || offset >= g_array_index (offsets, gint, offsets->len - 1))
+		return -1;
+
+	/* Find the first source starting after the offset, the previous one
+	   is the one with the offset; empty sources share the offset */
+	lo = 0;
+	hi = offsets->len - 1;
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+
+		if (g_array_index (offsets, gint, mid) <= offset)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
 
-	return -1;
+	return lo - 1;
 }
 
 static gint
@@ -384,113 +448,91 @@ static gint
 get_contact_source_offset (EContactStore *contact_store,
                            gint contact_source_index)
 {
-	GArray *array;
-	gint offset = 0;
-	gint i;
+	GArray *offsets;
 
-	array = contact_store->priv->contact_sources;
+	g_return_val_if_fail (contact_source_index < contact_store->priv->contact_sources->len, 0);
 
-	g_return_val_if_fail (contact_source_index < array->len, 0);
+	offsets = ensure_contact_source_offsets (contact_store);
 
-	for (i = 0; i < contact_source_index; i++) {
-		ContactSource *source;
-
-		source = &g_array_index (array, ContactSource, i);
-		offset += source->contacts->len;
-	}
-
-	return offset;
+	return g_array_index (offsets, gint, contact_source_index);
 }
 
 static gint
 count_contacts (EContactStore *contact_store)
 {
-	GArray *array;
-	gint count = 0;
-	gint i;
+	GArray *offsets;
 
-	array = contact_store->priv->contact_sources;
-
-	for (i = 0; i < array->len; i++) {
-		ContactSource *source;
-
-		source = &g_array_index (array, ContactSource, i);
-		count += source->contacts->len;
-	}
+	offsets = ensure_contact_source_offsets (contact_store);
 
-	return count;
+	return g_array_index (offsets, gint, offsets->len - 1);
 }
 
-static gint
-find_contact_by_view_and_uid (EContactStore *contact_store,
-                              EBookClientView *find_view,
-                              const gchar *find_uid)
+static GHashTable *
+contact_uid_index_new (void)
 {
-	GArray *array;
-	ContactSource *source;
-	GPtrArray *contacts;
-	gint source_index;
-	gint i;
-
-	g_return_val_if_fail (find_uid != NULL, -1);
+	return g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+}
 
-	source_index = find_contact_source_by_view (contact_store, find_view);
-	if (source_index < 0)
-		return -1;
+/* Updates the UID index of the contacts from the index 'from' to the end */
+static void
+contact_uid_index_update (GHashTable *uid_index,
+                          GPtrArray *contacts,
+                          guint from)
+{
+	guint ii;
 
-	array = contact_store->priv->contact_sources;
-	source = &g_array_index (array, ContactSource, source_index);
+	for (ii = from; ii < contacts->len; ii++) {
+		EContact *contact = g_ptr_array_index (contacts, ii);
+		const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
 
-	if (find_view == source->client_view)
-		contacts = source->contacts;          /* Current view */
-	else
-		contacts = source->contacts_pending;  /* Pending view */
+		if (uid)
+			g_hash_table_insert (uid_index, g_strdup (uid), GUINT_TO_POINTER (ii + 1));
+	}
+}
 
-	for (i = 0; i < contacts->len; i++) {
-		EContact    *contact = g_ptr_array_index (contacts, i);
-		const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
+static gint
+contact_uid_index_lookup (GHashTable *uid_index,
+                          const gchar *uid)
+{
+	return GPOINTER_TO_INT (g_hash_table_lookup (uid_index, uid)) - 1;
+}
 
-		if (uid && !strcmp (find_uid, uid))
-			return i;
+static void
+free_pending_contacts (ContactSource *source)
+{
+	if (source->contacts_pending) {
+		free_contact_ptrarray (source->contacts_pending);
+		source->contacts_pending = NULL;
 	}
 
-	return -1;
+	if (source->contacts_pending_index) {
+		g_hash_table_destroy (source->contacts_pending_index);
+		source->contacts_pending_index = NULL;
+	}
 }
 
-static GHashTable *
-get_contact_hash (EContactStore *contact_store,
-                  EBookClientView *find_view)
+static gint
+find_contact_by_view_and_uid (EContactStore *contact_store,
+                              EBookClientView *find_view,
+                              const gchar *find_uid)
 {
 	GArray *array;
 	ContactSource *source;
-	GPtrArray *contacts;
 	gint source_index;
-	gint ii;
-	GHashTable *hash;
+
+	g_return_val_if_fail (find_uid != NULL, -1);
 
 	source_index = find_contact_source_by_view (contact_store, find_view);
 	if (source_index < 0)
-		return NULL;
+		return -1;
 
 	array = contact_store->priv->contact_sources;
 	source = &g_array_index (array, ContactSource, source_index);
 
 	if (find_view == source->client_view)
-		contacts = source->contacts;          /* Current view */
-	else
-		contacts = source->contacts_pending;  /* Pending view */
-
-	hash = g_hash_table_new (g_str_hash, g_str_equal);
-
-	for (ii = 0; ii < contacts->len; ii++) {
-		EContact *contact = g_ptr_array_index (contacts, ii);
-		const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
-
-		if (uid)
-			g_hash_table_insert (hash, (gpointer) uid, GINT_TO_POINTER (ii));
-	}
+		return contact_uid_index_lookup (source->contacts_index, find_uid);          /* Current view */
 
-	return hash;
+	return contact_uid_index_lookup (source->contacts_pending_index, find_uid);  /* Pending view */
 }
 
 static gint
@@ -506,13 +548,9 @@ find_contact_by_uid (EContactStore *contact_store,
 		ContactSource *source = &g_array_index (array, ContactSource, i);
 		gint           j;
 
-		for (j = 0; j < source->contacts->len; j++) {
-			EContact    *contact = g_ptr_array_index (source->contacts, j);
-			const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
-
-			if (!strcmp (find_uid, uid))
-				return get_contact_source_offset (contact_store, i) + j;
-		}
+		j = contact_uid_index_lookup (source->contacts_index, find_uid);
+		if (j >= 0)
+			return get_contact_source_offset (contact_store, i) + j;
 	}
 
 	return -1;
@@ -605,21 +643,36 @@ view_contacts_added (EContactStore *contact_store,
 		if (client_view == source->client_view) {
 			/* Current view */
 			g_ptr_array_add (source->contacts, contact);
+			contact_uid_index_update (source->contacts_index, source->contacts, source->contacts->len - 1);
 			row_inserted (contact_store, offset + source->contacts->len - 1);
 		} else {
 			/* Pending view */
 			g_ptr_array_add (source->contacts_pending, contact);
+			contact_uid_index_update (source->contacts_pending_index, source->contacts_pending, source->contacts_pending->len - 1);
 		}
 	}
 }
 
+static gint
+compare_gint_desc_cb (gconstpointer ptr1,
+                      gconstpointer ptr2)
+{
+	gint n1 = *((const gint *) ptr1), n2 = *((const gint *) ptr2);
+
+	return n1 == n2 ? 0 : n1 > n2 ? -1 : 1;
+}
+
 static void
 view_contacts_removed (EContactStore *contact_store,
                        const GSList *uids,
                        EBookClientView *client_view)
 {
 	ContactSource *source;
+	GPtrArray     *contacts;
+	GHashTable    *uid_index;
+	GArray        *removed;
 	gint           offset;
+	gint           i;
 	const GSList  *l;
 
 	if (!find_contact_source_details_by_view (contact_store, client_view, &source, &offset)) {
@@ -627,29 +680,53 @@ view_contacts_removed (EContactStore *contact_store,
 		return;
 	}
 
+	if (client_view == source->client_view) {
+		contacts = source->contacts;
+		uid_index = source->contacts_index;
+	} else {
+		contacts = source->contacts_pending;
+		uid_index = source->contacts_pending_index;
+	}
+
+	removed = g_array_new (FALSE, FALSE, sizeof (gint));
+
 	for (l = uids; l; l = g_slist_next (l)) {
 		const gchar *uid = l->data;
 		gint         n = find_contact_by_view_and_uid (contact_store, client_view, uid);
-		EContact    *contact;
 
 		if (n < 0) {
 			g_warning ("EContactStore got 'contacts_removed' on unknown contact!");
 			continue;
 		}
 
-		if (client_view == source->client_view) {
-			/* Current view */
-			contact = g_ptr_array_index (source->contacts, n);
-			g_object_unref (contact);
-			g_ptr_array_remove_index (source->contacts, n);
+		g_array_append_val (removed, n);
+	}
+
+	/* Remove from the end, thus the indexes of the rest do not change */
+	g_array_sort (removed, compare_gint_desc_cb);
+
+	for (i = 0; i < removed->len; i++) {
+		gint      n = g_array_index (removed, gint, i);
+		EContact *contact;
+
+		if (i > 0 && n == g_array_index (removed, gint, i - 1))
+			continue;
+
+		contact = g_ptr_array_index (contacts, n);
+		g_hash_table_remove (uid_index, e_contact_get_const (contact, E_CONTACT_UID));
+		g_object_unref (contact);
+		g_ptr_array_remove_index (contacts, n);
+
+		/* Emit changes for current view only */
+		if (client_view == source->client_view)
 			row_deleted (contact_store, offset + n);
-		} else {
-			/* Pending view */
-			contact = g_ptr_array_index (source->contacts_pending, n);
-			g_object_unref (contact);
-			g_ptr_array_remove_index (source->contacts_pending, n);
-		}
 	}
+
+	/* Contacts after the first removed had moved */
+	if (removed->len > 0)
+		contact_uid_index_update (uid_index, contacts, g_array_index (removed, gint, removed->len - 1));
+
+	g_array_free (removed, TRUE);
 }
 
 static void
@@ -705,7 +782,7 @@ view_complete (EContactStore *contact_store,
 	ContactSource *source;
 	gint           offset;
 	gint           i;
-	GHashTable *hash;
+	gint           first_removed = -1;
 
 	if (!find_contact_source_details_by_view (contact_store, client_view, &source, &offset)) {
 		g_warning ("EContactStore got 'complete' signal from unknown EBookClientView!");
@@ -726,37 +803,40 @@ view_complete (EContactStore *contact_store,
 	g_signal_emit (contact_store, signals[START_UPDATE], 0, client_view);
 
 	/* Deletions */
-	hash = get_contact_hash (contact_store, source->client_view_pending);
 	for (i = 0; i < source->contacts->len; i++) {
 		EContact    *old_contact = g_ptr_array_index (source->contacts, i);
 		const gchar *old_uid = e_contact_get_const (old_contact, E_CONTACT_UID);
 
-		if (!g_hash_table_contains (hash, old_uid)) {
+		if (!g_hash_table_contains (source->contacts_pending_index, old_uid)) {
 			/* Contact is not in new view; removed */
+			if (first_removed < 0)
+				first_removed = i;
+			g_hash_table_remove (source->contacts_index, old_uid);
 			g_object_unref (old_contact);
 			g_ptr_array_remove_index (source->contacts, i);
 			row_deleted (contact_store, offset + i);
 			i--;  /* Stay in place */
 		}
 	}
-	g_hash_table_unref (hash);
+
+	if (first_removed >= 0)
+		contact_uid_index_update (source->contacts_index, source->contacts, first_removed);
 
 	/* Insertions */
-	hash = get_contact_hash (contact_store, source->client_view);
 	for (i = 0; i < source->contacts_pending->len; i++) {
 		EContact    *new_contact = g_ptr_array_index (source->contacts_pending, i);
 		const gchar *new_uid = e_contact_get_const (new_contact, E_CONTACT_UID);
 
-		if (!g_hash_table_contains (hash, new_uid)) {
+		if (!g_hash_table_contains (source->contacts_index, new_uid)) {
 			/* Contact is not in old view; inserted */
 			g_ptr_array_add (source->contacts, new_contact);
+			contact_uid_index_update (source->contacts_index, source->contacts, source->contacts->len - 1);
 			row_inserted (contact_store, offset + source->contacts->len - 1);
 		} else {
 			/* Contact already in old view; drop the new one */
 			g_object_unref (new_contact);
 		}
 	}
-	g_hash_table_unref (hash);
 
 	g_signal_emit (contact_store, signals[STOP_UPDATE], 0, client_view);
 
@@ -769,6 +849,8 @@ view_complete (EContactStore *contact_store,
 	/* Free array of pending contacts (members have been either moved or unreffed) */
 	g_ptr_array_free (source->contacts_pending, TRUE);
 	source->contacts_pending = NULL;
+	g_hash_table_destroy (source->contacts_pending_index);
+	source->contacts_pending_index = NULL;
 }
 
 /* --------------------- *
@@ -867,13 +949,16 @@ clear_contact_source (EContactStore *contact_store,
 		gint         i;
 
 		g_signal_emit (contact_store, signals[START_UPDATE], 0, source->client_view);
-		gtk_tree_path_append_index (path, source->contacts->len);
+		gtk_tree_path_append_index (path, offset + source->contacts->len);
+
+		g_hash_table_remove_all (source->contacts_index);
 
 		for (i = source->contacts->len - 1; i >= 0; i--) {
 			EContact *contact = g_ptr_array_index (source->contacts, i);
 
 			g_object_unref (contact);
 			g_ptr_array_remove_index_fast (source->contacts, i);
+			contact_store->priv->offsets_valid = FALSE;
 
 			gtk_tree_path_prev (path);
 			gtk_tree_model_row_deleted (GTK_TREE_MODEL (contact_store), path);
@@ -883,6 +968,17 @@ clear_contact_source (EContactStore *contact_store,
 		g_signal_emit (contact_store, signals[STOP_UPDATE], 0, source->client_view);
 	}
 
+	source->uses_index = FALSE;
+	g_free (source->index_cue);
+	source->index_cue = NULL;
+
+	stop_contact_source_views (contact_store, source);
+}
+
+static void
+stop_contact_source_views (EContactStore *contact_store,
+                           ContactSource *source)
+{
 	/* Free main and pending views, clear cached contacts */
 
 	if (source->client_view) {
@@ -895,10 +991,9 @@ clear_contact_source (EContactStore *contact_store,
 	if (source->client_view_pending) {
 		stop_view (contact_store, source->client_view_pending);
 		g_object_unref (source->client_view_pending);
-		free_contact_ptrarray (source->contacts_pending);
+		free_pending_contacts (source);
 
 		source->client_view_pending = NULL;
-		source->contacts_pending = NULL;
 	}
 }
 
@@ -927,20 +1022,23 @@ client_view_ready_cb (GObject *source_object,
 
 		source = &g_array_index (contact_store->priv->contact_sources, ContactSource, source_idx);
 
-		if (source->client_view) {
+		if (source->uses_index) {
+			/* The completion index became ready meanwhile */
+			g_clear_object (&client_view);
+		} else if (source->client_view) {
 			if (source->client_view_pending) {
 				stop_view (contact_store, source->client_view_pending);
 				g_object_unref (source->client_view_pending);
-				free_contact_ptrarray (source->contacts_pending);
 			}
 
+			free_pending_contacts (source);
+
 			source->client_view_pending = client_view;
 
 			if (source->client_view_pending) {
 				source->contacts_pending = g_ptr_array_new ();
+				source->contacts_pending_index = contact_uid_index_new ();
 				start_view (contact_store, client_view);
-			} else {
-				source->contacts_pending = NULL;
 			}
 		} else {
 			source->client_view = client_view;
@@ -954,6 +1052,762 @@ client_view_ready_cb (GObject *source_object,
 	g_object_unref (contact_store);
 }
 
+/* ---------------- *
+ * Completion index *
+ * ---------------- */
+
+/* The completion index holds all contacts with an e-mail address of one
+ * book, populated by a single book view, which is kept running and which
+ * updates the index. It is shared by all contact stores using the same
+ * EBookClient. Contacts are matched by a prefix of their names or of any
+ * word in them, and by any part of their nickname and e-mail addresses,
+ * like the query of the name selector entry does, thus completion needs
+ * no backend round-trip when the cue changes. The sorted keys are updated
+ * with the changed contacts only, not rebuilt on each change. */
+
+#define COMPLETION_INDEX_DATA_KEY "e-contact-store-completion-index"
+#define COMPLETION_INDEX_QUERY "(exists \"email\")"
+#define COMPLETION_KEY_SEPARATORS " ,@._-+"
+
+typedef enum {
+	COMPLETION_INDEX_LOADING,
+	COMPLETION_INDEX_READY,
+	COMPLETION_INDEX_FAILED
+} CompletionIndexState;
+
+typedef struct {
+	EContact *contact;
+	gchar **values; /* normalized */
+	const gchar **keys; /* pointing into the values */
+} CompletionEntry;
+
+typedef struct {
+	const gchar *key; /* owned by the CompletionEntry */
+	CompletionEntry *entry;
+} CompletionKey;
+
+struct _CompletionIndex {
+	gint ref_count;
+	CompletionIndexState state;
+	EBookClientView *client_view;
+	GHashTable *entries; /* gchar *uid ~> CompletionEntry */
+	GArray *sorted_keys; /* CompletionKey; NULL until used */
+	GSList *stores; /* EContactStore *, not referenced */
+};
+
+static void completion_index_changed (CompletionIndex *index, GHashTable *changed, GHashTable *removed);
+
+static gchar *
+completion_normalize (const gchar *value)
+{
+	gchar *normalized;
+
+	if (!value || !*value)
+		return NULL;
+
+	normalized = e_util_utf8_normalize (value);
+	if (normalized)
+		g_strstrip (normalized);
+
+	if (normalized && !*normalized) {
+		g_free (normalized);
+		normalized = NULL;
+	}
+
+	return normalized;
+}
+
+/* With 'substrings' a key for each suffix of the value is added, thus
+   a prefix lookup matches any part of it, otherwise for each word */
+static void
+completion_add_keys (GPtrArray *values,
+                     GPtrArray *keys,
+                     const gchar *value,
+                     gboolean substrings)
+{
+	gchar *normalized;
+	const gchar *ptr;
+
+	normalized = completion_normalize (value);
+	if (!normalized)
+		return;
+
+	g_ptr_array_add (values, normalized);
+	g_ptr_array_add (keys, normalized);
+
+	for (ptr = g_utf8_next_char (normalized); *ptr; ptr = g_utf8_next_char (ptr)) {
+		if (substrings ||
+		    (strchr (COMPLETION_KEY_SEPARATORS, ptr[-1]) &&
+		     !strchr (COMPLETION_KEY_SEPARATORS, *ptr)))
+			g_ptr_array_add (keys, (gpointer) ptr);
+	}
+}
+
+static CompletionEntry *
+completion_entry_new (EContact *contact)
+{
+	CompletionEntry *entry;
+	GPtrArray *values, *keys;
+	GList *emails, *link;
+
+	values = g_ptr_array_new ();
+	keys = g_ptr_array_new ();
+
+	completion_add_keys (values, keys, e_contact_get_const (contact, E_CONTACT_FULL_NAME), FALSE);
+	completion_add_keys (values, keys, e_contact_get_const (contact, E_CONTACT_FILE_AS), FALSE);
+	completion_add_keys (values, keys, e_contact_get_const (contact, E_CONTACT_NICKNAME), TRUE);
+
+	emails = e_contact_get (contact, E_CONTACT_EMAIL);
+	for (link = emails; link; link = g_list_next (link)) {
+		completion_add_keys (values, keys, link->data, TRUE);
+	}
+	g_list_free_full (emails, g_free);
+
+	g_ptr_array_add (values, NULL);
+	g_ptr_array_add (keys, NULL);
+
+	entry = g_new0 (CompletionEntry, 1);
+	entry->contact = g_object_ref (contact);
+	entry->values = (gchar **) g_ptr_array_free (values, FALSE);
+	entry->keys = (const gchar **) g_ptr_array_free (keys, FALSE);
+
+	return entry;
+}
+
+static void
+completion_entry_free (gpointer ptr)
+{
+	CompletionEntry *entry = ptr;
+
+	if (entry) {
+		g_object_unref (entry->contact);
+		g_strfreev (entry->values);
+		g_free (entry->keys);
+		g_free (entry);
+	}
+}
+
+static gboolean
+completion_entry_matches (CompletionEntry *entry,
+                          const gchar *cue,
+                          const gchar *cue_comma)
+{
+	gint ii;
+
+	for (ii = 0; entry->keys[ii]; ii++) {
+		if (g_str_has_prefix (entry->keys[ii], cue) ||
+		    (cue_comma && g_str_has_prefix (entry->keys[ii], cue_comma)))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gint
+completion_key_compare (gconstpointer ptr1,
+                        gconstpointer ptr2)
+{
+	const CompletionKey *key1 = ptr1, *key2 = ptr2;
+
+	return strcmp (key1->key, key2->key);
+}
+
+static void
+completion_index_invalidate_keys (CompletionIndex *index)
+{
+	if (index->sorted_keys) {
+		g_array_free (index->sorted_keys, TRUE);
+		index->sorted_keys = NULL;
+	}
+}
+
+static void
+completion_keys_append_entry (GArray *keys,
+                              CompletionEntry *entry)
+{
+	gint ii;
+
+	for (ii = 0; entry->keys[ii]; ii++) {
+		CompletionKey key;
+
+		key.key = entry->keys[ii];
+		key.entry = entry;
+
+		g_array_append_val (keys, key);
+	}
+}
+
+static GArray *
+completion_index_get_sorted_keys (CompletionIndex *index)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	if (index->sorted_keys)
+		return index->sorted_keys;
+
+	index->sorted_keys = g_array_sized_new (FALSE, FALSE, sizeof (CompletionKey), g_hash_table_size (index->entries) * 4);
+
+	g_hash_table_iter_init (&iter, index->entries);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		completion_keys_append_entry (index->sorted_keys, value);
+	}
+
+	g_array_sort (index->sorted_keys, completion_key_compare);
+
+	return index->sorted_keys;
+}
+
+/* Removes the keys of the 'dropped' entries from the sorted keys and merges
+   in the keys of the 'added' entries, which is linear in the number of keys,
+   instead of sorting all of them again */
+static void
+completion_index_update_keys (CompletionIndex *index,
+                              GHashTable *dropped,
+                              GPtrArray *added)
+{
+	GArray *sorted_keys = index->sorted_keys;
+	GArray *added_keys, *merged;
+	guint ii, jj;
+
+	/* Not used yet, it will be built as a whole */
+	if (!sorted_keys)
+		return;
+
+	if (dropped && g_hash_table_size (dropped) > 0) {
+		for (ii = 0, jj = 0; ii < sorted_keys->len; ii++) {
+			CompletionKey *key = &g_array_index (sorted_keys, CompletionKey, ii);
+
+			if (g_hash_table_contains (dropped, key->entry))
+				continue;
+
+			if (ii != jj)
+				g_array_index (sorted_keys, CompletionKey, jj) = *key;
+			jj++;
+		}
+
+		g_array_set_size (sorted_keys, jj);
+	}
+
+	if (!added || !added->len)
+		return;
+
+	added_keys = g_array_new (FALSE, FALSE, sizeof (CompletionKey));
+
+	for (ii = 0; ii < added->len; ii++) {
+		completion_keys_append_entry (added_keys, g_ptr_array_index (added, ii));
+	}
+
+	g_array_sort (added_keys, completion_key_compare);
+
+	merged = g_array_sized_new (FALSE, FALSE, sizeof (CompletionKey), sorted_keys->len + added_keys->len);
+
+	for (ii = 0, jj = 0; ii < sorted_keys->len || jj < added_keys->len;) {
+		CompletionKey *key;
+
+		if (jj >= added_keys->len ||
+		    (ii < sorted_keys->len && completion_key_compare (
+			&g_array_index (sorted_keys, CompletionKey, ii),
+			&g_array_index (added_keys, CompletionKey, jj)) <= 0))
+			key = &g_array_index (sorted_keys, CompletionKey, ii++);
+		else
+			key = &g_array_index (added_keys, CompletionKey, jj++);
+
+		g_array_append_vals (merged, key, 1);
+	}
+
+	g_array_free (added_keys, TRUE);
+	g_array_free (sorted_keys, TRUE);
+
+	index->sorted_keys = merged;
+}
+
+/* Takes the entry of the 'uid' out of the index; its keys are still
+   in the sorted keys, thus it's freed only after those are updated */
+static CompletionEntry *
+completion_index_steal_entry (CompletionIndex *index,
+                              const gchar *uid)
+{
+	gpointer orig_key = NULL, value = NULL;
+
+	if (!g_hash_table_lookup_extended (index->entries, uid, &orig_key, &value))
+		return NULL;
+
+	g_hash_table_steal (index->entries, uid);
+	g_free (orig_key);
+
+	return value;
+}
+
+/* Adds entries with a key beginning with the 'prefix' into 'found',
+   and into 'ordered' in the order of their keys */
+static void
+completion_index_lookup_prefix (CompletionIndex *index,
+                                const gchar *prefix,
+                                GHashTable *found,
+                                GPtrArray *ordered)
+{
+	GArray *sorted_keys;
+	guint lo, hi, len;
+
+	sorted_keys = completion_index_get_sorted_keys (index);
+	len = strlen (prefix);
+
+	/* Find the first key not sorted before the prefix */
+	lo = 0;
+	hi = sorted_keys->len;
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+
+		if (strcmp (g_array_index (sorted_keys, CompletionKey, mid).key, prefix) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (; lo < sorted_keys->len; lo++) {
+		CompletionKey *key = &g_array_index (sorted_keys, CompletionKey, lo);
+
+		if (strncmp (key->key, prefix, len) != 0)
+			break;
+
+		if (!g_hash_table_contains (found, key->entry)) {
+			g_hash_table_insert (found, key->entry, key->entry);
+			g_ptr_array_add (ordered, key->entry);
+		}
+	}
+}
+
+static void
+completion_index_view_objects_added (EBookClientView *client_view,
+                                     const GSList *contacts,
+                                     CompletionIndex *index)
+{
+	GHashTable *dropped, *changed;
+	GPtrArray *added;
+	const GSList *link;
+
+	dropped = g_hash_table_new_full (g_direct_hash, g_direct_equal, completion_entry_free, NULL);
+	changed = g_hash_table_new (g_str_hash, g_str_equal);
+	added = g_ptr_array_new ();
+
+	for (link = contacts; link; link = g_slist_next (link)) {
+		EContact *contact = link->data;
+		const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
+		CompletionEntry *entry;
+
+		if (!uid)
+			continue;
+
+		entry = completion_index_steal_entry (index, uid);
+		if (entry) {
+			/* When listed twice, the last one counts */
+			g_ptr_array_remove_fast (added, entry);
+			g_hash_table_add (dropped, entry);
+		}
+
+		entry = completion_entry_new (contact);
+
+		g_hash_table_insert (index->entries, g_strdup (uid), entry);
+		g_hash_table_replace (changed, (gpointer) e_contact_get_const (entry->contact, E_CONTACT_UID), entry);
+		g_ptr_array_add (added, entry);
+	}
+
+	completion_index_update_keys (index, dropped, added);
+
+	if (index->state == COMPLETION_INDEX_READY)
+		completion_index_changed (index, changed, NULL);
+
+	g_hash_table_destroy (dropped);
+	g_hash_table_destroy (changed);
+	g_ptr_array_free (added, TRUE);
+}
+
+static void
+completion_index_view_objects_removed (EBookClientView *client_view,
+                                       const GSList *uids,
+                                       CompletionIndex *index)
+{
+	GHashTable *dropped, *removed;
+	const GSList *link;
+
+	dropped = g_hash_table_new_full (g_direct_hash, g_direct_equal, completion_entry_free, NULL);
+	removed = g_hash_table_new (g_str_hash, g_str_equal);
+
+	for (link = uids; link; link = g_slist_next (link)) {
+		const gchar *uid = link->data;
+		CompletionEntry *entry;
+
+		entry = uid ? completion_index_steal_entry (index, uid) : NULL;
+		if (entry) {
+			g_hash_table_add (dropped, entry);
+			g_hash_table_add (removed, (gpointer) uid);
+		}
+	}
+
+	completion_index_update_keys (index, dropped, NULL);
+
+	if (index->state == COMPLETION_INDEX_READY)
+		completion_index_changed (index, NULL, removed);
+
+	g_hash_table_destroy (dropped);
+	g_hash_table_destroy (removed);
+}
+
+static void
+completion_index_view_complete (EBookClientView *client_view,
+                                const GError *error,
+                                CompletionIndex *index)
+{
+	if (index->state != COMPLETION_INDEX_LOADING)
+		return;
+
+	if (error) {
+		/* For example a size limit of the GAL had been reached,
+		   then the stores continue to query the book instead */
+		index->state = COMPLETION_INDEX_FAILED;
+
+		completion_index_invalidate_keys (index);
+		g_hash_table_remove_all (index->entries);
+		return;
+	}
+
+	index->state = COMPLETION_INDEX_READY;
+
+	completion_index_changed (index, NULL, NULL);
+}
+
+static CompletionIndex *
+completion_index_ref (CompletionIndex *index)
+{
+	g_atomic_int_inc (&index->ref_count);
+
+	return index;
+}
+
+static void
+completion_index_unref (gpointer ptr)
+{
+	CompletionIndex *index = ptr;
+
+	if (!index || !g_atomic_int_dec_and_test (&index->ref_count))
+		return;
+
+	if (index->client_view) {
+		GThread *thread;
+
+		g_signal_handlers_disconnect_matched (
+			index->client_view, G_SIGNAL_MATCH_DATA,
+			0, 0, NULL, NULL, index);
+
+		thread = g_thread_new (NULL, contact_store_stop_view_in_thread, index->client_view);
+		g_thread_unref (thread);
+	}
+
+	completion_index_invalidate_keys (index);
+	g_hash_table_destroy (index->entries);
+	g_slist_free (index->stores);
+	g_free (index);
+}
+
+static void
+completion_index_view_ready_cb (GObject *source_object,
+                                GAsyncResult *result,
+                                gpointer user_data)
+{
+	CompletionIndex *index = user_data;
+	EBookClientView *client_view = NULL;
+	GError *error = NULL;
+
+	e_book_client_get_view_finish (
+		E_BOOK_CLIENT (source_object), result, &client_view, &error);
+
+	if (!client_view) {
+		g_warning ("%s: %s", G_STRFUNC, error ? error->message : "Unknown error");
+
+		index->state = COMPLETION_INDEX_FAILED;
+	} else {
+		index->client_view = client_view;
+
+		g_signal_connect (
+			client_view, "objects-added",
+			G_CALLBACK (completion_index_view_objects_added), index);
+		g_signal_connect (
+			client_view, "objects-modified",
+			G_CALLBACK (completion_index_view_objects_added), index);
+		g_signal_connect (
+			client_view, "objects-removed",
+			G_CALLBACK (completion_index_view_objects_removed), index);
+		g_signal_connect (
+			client_view, "complete",
+			G_CALLBACK (completion_index_view_complete), index);
+
+		e_book_client_view_start (client_view, NULL);
+	}
+
+	g_clear_error (&error);
+	completion_index_unref (index);
+}
+
+/* Returns a new reference to the index of the 'book_client', which
+   is created and populated on the first use */
+static CompletionIndex *
+completion_index_get (EContactStore *contact_store,
+                      EBookClient *book_client)
+{
+	CompletionIndex *index;
+
+	index = g_object_get_data (G_OBJECT (book_client), COMPLETION_INDEX_DATA_KEY);
+
+	if (!index) {
+		index = g_new0 (CompletionIndex, 1);
+		index->ref_count = 1;
+		index->state = COMPLETION_INDEX_LOADING;
+		index->entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, completion_entry_free);
+
+		g_object_set_data_full (
+			G_OBJECT (book_client), COMPLETION_INDEX_DATA_KEY,
+			index, completion_index_unref);
+
+		e_book_client_get_view (
+			book_client, COMPLETION_INDEX_QUERY, NULL,
+			completion_index_view_ready_cb, completion_index_ref (index));
+	}
+
+	index->stores = g_slist_prepend (index->stores, contact_store);
+
+	return completion_index_ref (index);
+}
+
+static void
+release_completion_index (EContactStore *contact_store,
+                          ContactSource *source)
+{
+	if (source->completion_index) {
+		source->completion_index->stores = g_slist_remove (source->completion_index->stores, contact_store);
+		completion_index_unref (source->completion_index);
+		source->completion_index = NULL;
+	}
+
+	source->uses_index = FALSE;
+	g_free (source->index_cue);
+	source->index_cue = NULL;
+}
+
+/* Sets the source's contacts to those from the completion index matching
+   the store's cue; when the cue only extends the previous one, the current
+   contacts are narrowed down instead of searching the whole index */
+static void
+filter_contact_source (EContactStore *contact_store,
+                       ContactSource *source,
+                       gboolean can_narrow)
+{
+	CompletionIndex *index = source->completion_index;
+	const gchar *cue = contact_store->priv->cue;
+	const gchar *cue_comma = contact_store->priv->cue_comma;
+	GHashTable *found = NULL;
+	GPtrArray *ordered = NULL;
+	gint source_index, offset, ii;
+	gint first_removed = -1;
+
+	g_return_if_fail (index != NULL);
+	g_return_if_fail (cue != NULL);
+
+	source_index = find_contact_source_by_pointer (contact_store, source);
+	g_return_if_fail (source_index >= 0);
+
+	offset = get_contact_source_offset (contact_store, source_index);
+
+	if (!source->uses_index) {
+		/* Switching from the book views, the current contacts are
+		   a result of the query, the same as the index will give */
+		stop_contact_source_views (contact_store, source);
+		source->uses_index = TRUE;
+		can_narrow = FALSE;
+	}
+
+	if (can_narrow && !(source->index_cue && g_str_has_prefix (cue, source->index_cue)))
+		can_narrow = FALSE;
+
+	if (!can_narrow) {
+		found = g_hash_table_new (g_direct_hash, g_direct_equal);
+		ordered = g_ptr_array_new ();
+
+		completion_index_lookup_prefix (index, cue, found, ordered);
+		if (cue_comma)
+			completion_index_lookup_prefix (index, cue_comma, found, ordered);
+	}
+
+	/* Deletions and changes */
+	for (ii = 0; ii < source->contacts->len; ii++) {
+		EContact *contact = g_ptr_array_index (source->contacts, ii);
+		const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
+		CompletionEntry *entry;
+
+		entry = uid ? g_hash_table_lookup (index->entries, uid) : NULL;
+
+		if (entry && found)
+			entry = g_hash_table_remove (found, entry) ? entry : NULL;
+		else if (entry && !completion_entry_matches (entry, cue, cue_comma))
+			entry = NULL;
+
+		if (!entry) {
+			if (first_removed < 0)
+				first_removed = ii;
+			if (uid)
+				g_hash_table_remove (source->contacts_index, uid);
+			g_object_unref (contact);
+			g_ptr_array_remove_index (source->contacts, ii);
+			row_deleted (contact_store, offset + ii);
+			ii--;  /* Stay in place */
+		} else if (entry->contact != contact) {
+			g_object_unref (contact);
+			source->contacts->pdata[ii] = g_object_ref (entry->contact);
+			row_changed (contact_store, offset + ii);
+		}
+	}
+
+	if (first_removed >= 0)
+		contact_uid_index_update (source->contacts_index, source->contacts, first_removed);
+
+	/* Insertions; only those not known yet are left in the 'found' */
+	if (found) {
+		for (ii = 0; ii < ordered->len; ii++) {
+			CompletionEntry *entry = g_ptr_array_index (ordered, ii);
+
+			if (!g_hash_table_contains (found, entry))
+				continue;
+
+			g_ptr_array_add (source->contacts, g_object_ref (entry->contact));
+			contact_uid_index_update (source->contacts_index, source->contacts, source->contacts->len - 1);
+			row_inserted (contact_store, offset + source->contacts->len - 1);
+		}
+
+		g_ptr_array_free (ordered, TRUE);
+		g_hash_table_destroy (found);
+	}
+
+	g_free (source->index_cue);
+	source->index_cue = g_strdup (cue);
+}
+
+/* Applies the changes of the completion index to the source's contacts;
+   only the 'changed' (uid ~> CompletionEntry) and the 'removed' (uid)
+   contacts are looked at, not the whole index */
+static void
+update_contact_source (EContactStore *contact_store,
+                       ContactSource *source,
+                       GHashTable *changed,
+                       GHashTable *removed)
+{
+	const gchar *cue = contact_store->priv->cue;
+	const gchar *cue_comma = contact_store->priv->cue_comma;
+	GHashTable *shown = NULL;
+	gint source_index, offset, ii;
+
+	g_return_if_fail (cue != NULL);
+
+	source_index = find_contact_source_by_pointer (contact_store, source);
+	g_return_if_fail (source_index >= 0);
+
+	offset = get_contact_source_offset (contact_store, source_index);
+
+	if (changed)
+		shown = g_hash_table_new (g_str_hash, g_str_equal);
+
+	/* Deletions and changes */
+	for (ii = 0; ii < source->contacts->len; ii++) {
+		EContact *contact = g_ptr_array_index (source->contacts, ii);
+		const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
+		CompletionEntry *entry;
+
+		if (!uid)
+			continue;
+
+		if (removed && g_hash_table_contains (removed, uid)) {
+			entry = NULL;
+		} else {
+			entry = changed ? g_hash_table_lookup (changed, uid) : NULL;
+			if (!entry)
+				continue;
+
+			g_hash_table_add (shown, (gpointer) e_contact_get_const (entry->contact, E_CONTACT_UID));
+
+			if (!completion_entry_matches (entry, cue, cue_comma))
+				entry = NULL;
+		}
+
+		if (!entry) {
+			g_object_unref (contact);
+			g_ptr_array_remove_index (source->contacts, ii);
+			row_deleted (contact_store, offset + ii);
+			ii--;  /* Stay in place */
+		} else {
+			g_object_unref (contact);
+			source->contacts->pdata[ii] = g_object_ref (entry->contact);
+			row_changed (contact_store, offset + ii);
+		}
+	}
+
+	/* Insertions */
+	if (changed) {
+		GHashTableIter iter;
+		gpointer key, value;
+
+		g_hash_table_iter_init (&iter, changed);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			CompletionEntry *entry = value;
+
+			if (g_hash_table_contains (shown, key) ||
+			    !completion_entry_matches (entry, cue, cue_comma))
+				continue;
+
+			g_ptr_array_add (source->contacts, g_object_ref (entry->contact));
+			row_inserted (contact_store, offset + source->contacts->len - 1);
+		}
+
+		g_hash_table_destroy (shown);
+	}
+}
+
+/* Both 'changed' and 'removed' are NULL when the index became ready */
+static void
+completion_index_changed (CompletionIndex *index,
+                          GHashTable *changed,
+                          GHashTable *removed)
+{
+	GSList *stores, *link;
+
+	completion_index_ref (index);
+
+	stores = g_slist_copy (index->stores);
+	g_slist_foreach (stores, (GFunc) g_object_ref, NULL);
+
+	for (link = stores; link; link = g_slist_next (link)) {
+		EContactStore *contact_store = link->data;
+		GArray *array = contact_store->priv->contact_sources;
+		gint ii;
+
+		for (ii = 0; ii < array->len; ii++) {
+			ContactSource *source = &g_array_index (array, ContactSource, ii);
+
+			if (source->completion_index != index)
+				continue;
+
+			if (!changed && !removed) {
+				if (contact_store->priv->query && contact_store->priv->cue)
+					filter_contact_source (contact_store, source, FALSE);
+			} else if (source->uses_index) {
+				update_contact_source (contact_store, source, changed, removed);
+			}
+		}
+	}
+
+	g_slist_free_full (stores, g_object_unref);
+
+	completion_index_unref (index);
+}
+
 static void
 query_contact_source (EContactStore *contact_store,
                       ContactSource *source)
@@ -967,13 +1821,27 @@ query_contact_source (EContactStore *contact_store,
 		return;
 	}
 
+	if (contact_store->priv->cue) {
+		if (!source->completion_index)
+			source->completion_index = completion_index_get (contact_store, source->book_client);
+
+		if (source->completion_index->state == COMPLETION_INDEX_READY) {
+			filter_contact_source (contact_store, source, TRUE);
+			return;
+		}
+	}
+
+	if (source->uses_index) {
+		/* The query is not expressible by a cue, thus back to the book views */
+		clear_contact_source (contact_store, source);
+	}
+
 	if (source->client_view) {
 		if (source->client_view_pending) {
 			stop_view (contact_store, source->client_view_pending);
 			g_object_unref (source->client_view_pending);
-			free_contact_ptrarray (source->contacts_pending);
+			free_pending_contacts (source);
 			source->client_view_pending = NULL;
-			source->contacts_pending = NULL;
 		}
 	}
 
@@ -1125,7 +1993,9 @@ e_contact_store_add_client (EContactStore *contact_store,
 	memset (&source, 0, sizeof (ContactSource));
 	source.book_client = g_object_ref (book_client);
 	source.contacts = g_ptr_array_new ();
+	source.contacts_index = contact_uid_index_new ();
 	g_array_append_val (array, source);
+	contact_store->priv->offsets_valid = FALSE;
 
 	indexed_source = &g_array_index (array, ContactSource, array->len - 1);
 
@@ -1163,10 +2033,13 @@ e_contact_store_remove_client (EContactStore *contact_store,
 
 	source = &g_array_index (array, ContactSource, source_index);
 	clear_contact_source (contact_store, source);
+	release_completion_index (contact_store, source);
 	free_contact_ptrarray (source->contacts);
+	g_hash_table_destroy (source->contacts_index);
 	g_object_unref (book_client);
 
 	g_array_remove_index (array, source_index);  /* Preserve order */
+	contact_store->priv->offsets_valid = FALSE;
 
 	return TRUE;
 }
@@ -1183,21 +2056,72 @@ void
 e_contact_store_set_query (EContactStore *contact_store,
                            EBookQuery *book_query)
 {
+	g_return_if_fail (E_IS_CONTACT_STORE (contact_store));
+
+	e_contact_store_set_query_with_cue (contact_store, book_query, NULL);
+}
+
+/**
+ * e_contact_store_set_query_with_cue:
+ * @contact_store: an #EContactStore
+ * @book_query: (nullable): an #EBookQuery
+ * @cue: (nullable): a completion cue the @book_query was built for, or %NULL
+ *
+ * Sets @book_query to be the query used to fetch contacts from the books
+ * assigned to @contact_store, the same as e_contact_store_set_query().
+ *
+ * When @cue is set, the books are not queried with @book_query. Instead,
+ * contacts with an e-mail address, whose name, or any word of it, begins
+ * with the @cue, or whose nickname or e-mail address contains the @cue,
+ * are looked up in an index of each book. The @cue should be set only when
+ * the @book_query does not test other fields than these. The index is populated once per book and is shared by all
+ * the stores. When the @cue extends the previous cue, the current contacts
+ * are only narrowed down. Until the index of a book is populated, or when
+ * the book cannot provide all its contacts, the @book_query is used.
+ *
+ * Since: 3.28
+ **/
+void
+e_contact_store_set_query_with_cue (EContactStore *contact_store,
+                                    EBookQuery *book_query,
+                                    const gchar *cue)
+{
+	EContactStorePrivate *priv;
 	GArray *array;
+	gchar *normalized;
 	gint i;
 
 	g_return_if_fail (E_IS_CONTACT_STORE (contact_store));
 
-	if (book_query == contact_store->priv->query)
+	priv = contact_store->priv;
+	normalized = book_query ? completion_normalize (cue) : NULL;
+
+	if (book_query == priv->query && g_strcmp0 (normalized, priv->cue) == 0) {
+		g_free (normalized);
 		return;
+	}
 
-	if (contact_store->priv->query)
-		e_book_query_unref (contact_store->priv->query);
+	if (priv->query)
+		e_book_query_unref (priv->query);
 
-	contact_store->priv->query = book_query;
+	priv->query = book_query;
 	if (book_query)
 		e_book_query_ref (book_query);
 
+	g_free (priv->cue);
+	g_free (priv->cue_comma);
+	priv->cue = normalized;
+	priv->cue_comma = NULL;
+
+	if (normalized && strchr (normalized, ' ')) {
+		gchar **strv;
+
+		/* The same as the name-style query does for "Family, Given" */
+		strv = g_strsplit (normalized, " ", 0);
+		priv->cue_comma = g_strjoinv (", ", strv);
+		g_strfreev (strv);
+	}
+
 	/* Query books */
 	array = contact_store->priv->contact_sources;
 	for (i = 0; i < array->len; i++) {
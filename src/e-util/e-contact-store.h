@@ -92,6 +92,10 @@ gboolean	e_contact_store_remove_client	(EContactStore *contact_store,
 						 EBookClient *book_client);
 void		e_contact_store_set_query	(EContactStore *contact_store,
 						 EBookQuery *book_query);
+void		e_contact_store_set_query_with_cue
+						(EContactStore *contact_store,
+						 EBookQuery *book_query,
+						 const gchar *cue);
 EBookQuery *	e_contact_store_peek_query	(EContactStore *contact_store);
 
 G_END_DECLS
@@ -27,22 +27,6 @@
 
 #include "e-html-utils.h"
 
-static gchar *
-check_size (gchar **buffer,
-            gint *buffer_size,
-            gchar *out,
-            gint len)
-{
-	if (out + len + 1> *buffer + *buffer_size) {
-		gint index = out - *buffer;
-
-		*buffer_size = MAX (index + len + 1, *buffer_size * 2);
-		*buffer = g_realloc (*buffer, *buffer_size);
-		out = *buffer + index;
-	}
-	return out;
-}
-
 /* auto-urlification hints: the goal is not to be strictly RFC-compliant,
  * but rather to accurately distinguish urls/addresses from non-urls/
  * addresses in real-world email.
@@ -51,44 +35,81 @@ check_size (gchar **buffer,
  * 2 = trailing url garbage:    ,.!?;:>)]}`'-_
  * 4 = allowed dns chars
  * 8 = non-url chars:           "|
+ * 16 = first letter of a recognized URL scheme or "www.": cfhmnstw
+ * 32 = copied to the output as is (printable, except of <>&"@ and space)
  */
-static gint special_chars[] = {
-	9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,    /*  nul - 0x0f */
-	9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,    /* 0x10 - 0x1f */
-	9, 2, 9, 0, 0, 0, 0, 3, 1, 3, 0, 0, 3, 6, 6, 0,    /*   sp - /    */
-	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 3, 3, 1, 0, 3, 2,    /*    0 - ?    */
-	1, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,    /*    @ - O    */
-	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 1, 1, 3, 0, 2,    /*    P - _    */
-	3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,    /*    ` - o    */
-	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 1, 9, 3, 0, 3     /*    p - del  */
+static const guchar special_chars[] = {
+	 9,  9,  9,  9,  9,  9,  9,  9,  9,  9,  9,  9,  9,  9,  9,  9,    /*  nul - 0x0f */
+	 9,  9,  9,  9,  9,  9,  9,  9,  9,  9,  9,  9,  9,  9,  9,  9,    /* 0x10 - 0x1f */
+	 9, 34,  9, 32, 32, 32,  0, 35,  33, 35, 32, 32, 35, 38, 38, 32,   /*   sp - /    */
+	36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 35, 35,  1, 32,  3, 34,    /*    0 - ?    */
+	 1, 36, 36, 52, 36, 36, 52, 36, 52, 36, 36, 36, 36, 52, 52, 36,    /*    @ - O    */
+	36, 36, 36, 52, 52, 36, 36, 52, 36, 36, 36, 33, 33, 35, 32, 34,    /*    P - _    */
+	35, 36, 36, 52, 36, 36, 52, 36, 52, 36, 36, 36, 36, 52, 52, 36,    /*    ` - o    */
+	36, 36, 36, 52, 52, 36, 36, 52, 36, 36, 36, 33, 41, 35, 32,  3     /*    p - del  */
 };
 
 #define is_addr_char(c) (c < 128 && !(special_chars[c] & 1))
 #define is_url_char(c) (c < 128 && !(special_chars[c] & 8))
 #define is_trailing_garbage(c) (c > 127 || (special_chars[c] & 2))
 #define is_domain_name_char(c) (c < 128 && (special_chars[c] & 4))
+#define is_url_start_char(c) (c < 128 && (special_chars[c] & 16))
+#define is_plain_char(c) (c < 128 && (special_chars[c] & 32))
+
+struct _ETextToHtml {
+	GString *html;
+	guint flags;
+	guint32 color;
+
+	/* Not converted yet part of the fed text */
+	GString *pending;
+
+	gint col;
+	gboolean colored;
+	gboolean saw_citation;
+};
+
+/* The end of the last run of URL characters, to not scan the same run
+ * again and again, when there are multiple URL-like starts in it. */
+typedef struct _UrlRun {
+	const guchar *end;
+	const guchar *trimmed_end;
+} UrlRun;
 
 /* (http|https|ftp|nntp)://[^ "|/]+\.([^ "|]*[^ ,.!?;:>)\]}`'"|_-])+ */
 /* www\.[A-Za-z0-9.-]+(/([^ "|]*[^ ,.!?;:>)\]}`'"|_-])+)             */
 
 static gchar *
 url_extract (const guchar **text,
+             const guchar *text_end,
              gboolean full_url,
-	     gboolean use_whole_text)
+             UrlRun *run)
 {
-	const guchar *end = *text, *p;
+	const guchar *end, *p;
 	gchar *out;
 
-	if (use_whole_text) {
-		end = (*text) + strlen ((const gchar *) (*text));
+	if (text_end) {
+		end = text_end;
+
+		/* Back up if we probably went too far. */
+		while (end > *text && is_trailing_garbage (*(end - 1)))
+			end--;
+	} else if (*text < run->end) {
+		end = MAX (run->trimmed_end, *text);
 	} else {
+		end = *text;
+
 		while (*end && is_url_char (*end))
 			end++;
-	}
 
-	/* Back up if we probably went too far. */
-	while (end > *text && is_trailing_garbage (*(end - 1)))
-		end--;
+		run->end = end;
+
+		/* Back up if we probably went too far. */
+		while (end > *text && is_trailing_garbage (*(end - 1)))
+			end--;
+
+		run->trimmed_end = end;
+	}
 
 	if (full_url) {
 		/* Make sure this really looks like a URL. */
@@ -112,7 +133,7 @@ url_extract (const guchar **text,
 
 static gchar *
 email_address_extract (const guchar **cur,
-                       gchar **out,
+                       GString *html,
                        const guchar *linestart)
 {
 	const guchar *start, *end, *dot;
@@ -142,7 +163,7 @@ email_address_extract (const guchar **cur,
 		return NULL;
 
 	addr = g_strndup ((gchar *) start, end - start);
-	*out -= *cur - start;
+	g_string_truncate (html, html->len - (*cur - start));
 	*cur = end;
 
 	return addr;
@@ -178,131 +199,82 @@ is_citation (const guchar *c,
 	return FALSE;
 }
 
-/**
- * e_text_to_html_full:
- * @input: a NUL-terminated input buffer
- * @flags: some combination of the E_TEXT_TO_HTML_* flags defined
- * in e-html-utils.h
- * @color: color for citation highlighting
- *
- * This takes a buffer of text as input and produces a buffer of
- * "equivalent" HTML, subject to certain transformation rules.
- *
- * The set of possible flags is:
- *
- *   - E_TEXT_TO_HTML_PRE: wrap the output HTML in &lt;PRE&gt; and
- *     &lt;/PRE&gt;  Should only be used if @input is the entire
- *     buffer to be converted. If e_text_to_html is being called with
- *     small pieces of data, you should wrap the entire result in
- *     &lt;PRE&gt; yourself.
- *
- *   - E_TEXT_TO_HTML_CONVERT_NL: convert "\n" to "&lt;BR&gt;n" on
- *     output.  (Should not be used with E_TEXT_TO_HTML_PRE, since
- *     that would result in double-newlines.)
- *
- *   - E_TEXT_TO_HTML_CONVERT_SPACES: convert a block of N spaces
- *     into N-1 non-breaking spaces and one normal space. A space
- *     at the start of the buffer is always converted to a
- *     non-breaking space, regardless of the following character,
- *     which probably means you don't want to use this flag on
- *     pieces of data that aren't delimited by at least line breaks.
- *
- *     If E_TEXT_TO_HTML_CONVERT_NL and E_TEXT_TO_HTML_CONVERT_SPACES
- *     are both defined, then TABs will also be converted to spaces.
- *
- *   - E_TEXT_TO_HTML_CONVERT_URLS: wrap &lt;a href="..."&gt; &lt;/a&gt;
- *     around strings that look like URLs.
- *
- *   - E_TEXT_TO_HTML_CONVERT_ADDRESSES: wrap &lt;a href="mailto:..."&gt;
- *     &lt;/a&gt; around strings that look like mail addresses.
- *
- *   - E_TEXT_TO_HTML_MARK_CITATION: wrap &lt;font color="..."&gt;
- *     &lt;/font&gt; around citations (lines beginning with "> ", etc).
- *
- *   - E_TEXT_TO_HTML_ESCAPE_8BIT: flatten everything to US-ASCII
- *
- *   - E_TEXT_TO_HTML_CITE: quote the text with "> " at the start of each
- *     line.
- *
- *   - E_TEXT_TO_HTML_HIDE_URL_SCHEME: hides scheme part of the URL in
- *     the display part of the generated text (thus, instead of "http://www.example.com",
- *     user will only see "www.example.com")
- *
- *   - E_TEXT_TO_HTML_URL_IS_WHOLE_TEXT: set when the whole @input text
- *     represents a URL; any spaces are removed in the href part.
- *
- * Returns: a newly-allocated string containing HTML
- **/
-gchar *
-e_text_to_html_full (const gchar *input,
-                     guint flags,
-                     guint32 color)
+static gboolean
+url_has_scheme (const guchar *cur)
 {
-	const guchar *cur, *next, *linestart;
-	gchar *buffer = NULL;
-	gchar *out = NULL;
-	gint buffer_size = 0, col;
-	gboolean colored = FALSE, saw_citation = FALSE;
-
-	/* Allocate a translation buffer.  */
-	buffer_size = strlen (input) * 2 + 5;
-	buffer = g_malloc (buffer_size);
+	switch (g_ascii_tolower (*cur)) {
+	case 'c':
+		return !g_ascii_strncasecmp ((gchar *) cur, "callto:", 7);
+	case 'f':
+		return !g_ascii_strncasecmp ((gchar *) cur, "ftp://", 6) ||
+		       !g_ascii_strncasecmp ((gchar *) cur, "file:", 5);
+	case 'h':
+		return !g_ascii_strncasecmp ((gchar *) cur, "http://", 7) ||
+		       !g_ascii_strncasecmp ((gchar *) cur, "https://", 8) ||
+		       !g_ascii_strncasecmp ((gchar *) cur, "h323:", 5);
+	case 'm':
+		return !g_ascii_strncasecmp ((gchar *) cur, "mailto:", 7);
+	case 'n':
+		return !g_ascii_strncasecmp ((gchar *) cur, "nntp://", 7) ||
+		       !g_ascii_strncasecmp ((gchar *) cur, "news:", 5);
+	case 's':
+		return !g_ascii_strncasecmp ((gchar *) cur, "sip:", 4);
+	case 't':
+		return !g_ascii_strncasecmp ((gchar *) cur, "tel:", 4);
+	case 'w':
+		return !g_ascii_strncasecmp ((gchar *) cur, "webcal:", 7);
+	}
 
-	out = buffer;
-	if (flags & E_TEXT_TO_HTML_PRE)
-		out += sprintf (out, "<PRE>");
+	return FALSE;
+}
 
-	col = 0;
+/* Converts the text between @start and @end, which begins at the start
+ * of a line, and ends either right after a new line or at the end of the
+ * whole text. The text itself should be NUL-terminated, though it can
+ * continue after the @end, which is used to peek into the next line. */
+static void
+text_to_html_convert (ETextToHtml *converter,
+                      const guchar *start,
+                      const guchar *end)
+{
+	GString *html = converter->html;
+	const guchar *cur, *next, *linestart;
+	guint flags = converter->flags;
+	UrlRun url_run = { NULL, NULL };
 
-	for (cur = linestart = (const guchar *) input; cur && *cur; cur = next) {
+	for (cur = linestart = start; cur < end && *cur; cur = next) {
 		gunichar u;
 
-		if (flags & E_TEXT_TO_HTML_MARK_CITATION && col == 0) {
-			saw_citation = is_citation (cur, saw_citation);
-			if (saw_citation) {
-				if (!colored) {
-					gchar font[25];
-
-					g_snprintf (font, 25, "<FONT COLOR=\"#%06x\">", color);
-
-					out = check_size (&buffer, &buffer_size, out, 25);
-					out += sprintf (out, "%s", font);
-					colored = TRUE;
+		if (flags & E_TEXT_TO_HTML_MARK_CITATION && converter->col == 0) {
+			converter->saw_citation = is_citation (cur, converter->saw_citation);
+			if (converter->saw_citation) {
+				if (!converter->colored) {
+					g_string_append_printf (html, "<FONT COLOR=\"#%06x\">", converter->color);
+					converter->colored = TRUE;
 				}
-			} else if (colored) {
-				const gchar *no_font = "</FONT>";
-
-				out = check_size (&buffer, &buffer_size, out, 9);
-				out += sprintf (out, "%s", no_font);
-				colored = FALSE;
+			} else if (converter->colored) {
+				g_string_append (html, "</FONT>");
+				converter->colored = FALSE;
 			}
 
 			/* Display mbox-mangled ">From" as "From" */
-			if (*cur == '>' && !saw_citation)
+			if (*cur == '>' && !converter->saw_citation)
 				cur++;
-		} else if (flags & E_TEXT_TO_HTML_CITE && col == 0) {
-			out = check_size (&buffer, &buffer_size, out, 5);
-			out += sprintf (out, "&gt; ");
+		} else if (flags & E_TEXT_TO_HTML_CITE && converter->col == 0) {
+			g_string_append (html, "&gt; ");
 		}
 
 		u = g_utf8_get_char ((gchar *) cur);
-		if (g_unichar_isalpha (u) &&
+		if (is_url_start_char (u) &&
 		    (flags & E_TEXT_TO_HTML_CONVERT_URLS)) {
+			const guchar *text_end = NULL;
 			gchar *tmpurl = NULL, *refurl = NULL, *dispurl = NULL;
 
-			if (!g_ascii_strncasecmp ((gchar *) cur, "http://", 7) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "https://", 8) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "ftp://", 6) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "nntp://", 7) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "mailto:", 7) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "news:", 5) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "file:", 5) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "callto:", 7) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "h323:", 5) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "sip:", 4) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "tel:", 4) ||
-			    !g_ascii_strncasecmp ((gchar *) cur, "webcal:", 7)) {
-				tmpurl = url_extract (&cur, TRUE, (flags & E_TEXT_TO_HTML_URL_IS_WHOLE_TEXT) != 0);
+			if ((flags & E_TEXT_TO_HTML_URL_IS_WHOLE_TEXT) != 0)
+				text_end = cur + strlen ((const gchar *) cur);
+
+			if (url_has_scheme (cur)) {
+				tmpurl = url_extract (&cur, text_end, TRUE, &url_run);
 				if (tmpurl) {
 					refurl = e_text_to_html (tmpurl, 0);
 					if ((flags & E_TEXT_TO_HTML_HIDE_URL_SCHEME) != 0) {
@@ -325,7 +297,7 @@ e_text_to_html_full (const gchar *input,
 				}
 			} else if (!g_ascii_strncasecmp ((gchar *) cur, "www.", 4) &&
 				   is_url_char (*(cur + 4))) {
-				tmpurl = url_extract (&cur, FALSE, (flags & E_TEXT_TO_HTML_URL_IS_WHOLE_TEXT) != 0);
+				tmpurl = url_extract (&cur, text_end, FALSE, &url_run);
 				if (tmpurl) {
 					dispurl = e_text_to_html (tmpurl, 0);
 					refurl = g_strdup_printf (
@@ -346,46 +318,55 @@ e_text_to_html_full (const gchar *input,
 					refurl = replaced;
 				}
 
-				out = check_size (
-					&buffer, &buffer_size, out,
-					strlen (refurl) +
-					strlen (dispurl) + 15);
-				out += sprintf (out,
-						"<a href=\"%s\">%s</a>",
-						refurl, dispurl);
-				col += strlen (tmpurl);
+				g_string_append (html, "<a href=\"");
+				g_string_append (html, refurl);
+				g_string_append (html, "\">");
+				g_string_append (html, dispurl);
+				g_string_append (html, "</a>");
+				converter->col += strlen (tmpurl);
 				g_free (tmpurl);
 				g_free (refurl);
 				g_free (dispurl);
 			}
 
-			if (!*cur)
+			if (cur >= end || !*cur)
 				break;
 			u = g_utf8_get_char ((gchar *) cur);
 		}
 
 		if (u == '@' && (flags & E_TEXT_TO_HTML_CONVERT_ADDRESSES)) {
-			gchar *addr, *dispaddr, *outaddr;
+			gchar *addr, *dispaddr;
 
-			addr = email_address_extract (&cur, &out, linestart);
+			addr = email_address_extract (&cur, html, linestart);
 			if (addr) {
 				dispaddr = e_text_to_html (addr, 0);
-				outaddr = g_strdup_printf (
-					"<a href=\"mailto:%s\">%s</a>",
-					addr, dispaddr);
-				out = check_size (&buffer, &buffer_size, out, strlen (outaddr));
-				out += sprintf (out, "%s", outaddr);
-				col += strlen (addr);
+				g_string_append (html, "<a href=\"mailto:");
+				g_string_append (html, addr);
+				g_string_append (html, "\">");
+				g_string_append (html, dispaddr);
+				g_string_append (html, "</a>");
+				converter->col += strlen (addr);
 				g_free (addr);
 				g_free (dispaddr);
-				g_free (outaddr);
 
-				if (!*cur)
+				if (cur >= end || !*cur)
 					break;
 				u = g_utf8_get_char ((gchar *) cur);
 			}
 		}
 
+		/* Copy the run of characters, which need no conversion, at once */
+		if (is_plain_char (u) && !(is_url_start_char (u) && (flags & E_TEXT_TO_HTML_CONVERT_URLS))) {
+			next = cur + 1;
+			while (next < end && is_plain_char (*next) &&
+			       !(is_url_start_char (*next) && (flags & E_TEXT_TO_HTML_CONVERT_URLS)))
+				next++;
+
+			g_string_append_len (html, (const gchar *) cur, next - cur);
+			converter->col += next - cur;
+			continue;
+		}
+
 		if (!g_unichar_validate (u)) {
 			/* Sigh. Someone sent undeclared 8-bit data.
 			 * Assume it's iso-8859-1.
@@ -395,65 +376,54 @@ e_text_to_html_full (const gchar *input,
 		} else
 			next = (const guchar *) g_utf8_next_char (cur);
 
-		out = check_size (&buffer, &buffer_size, out, 10);
-
 		switch (u) {
 		case '<':
-			strcpy (out, "&lt;");
-			out += 4;
-			col++;
+			g_string_append (html, "&lt;");
+			converter->col++;
 			break;
 
 		case '>':
-			strcpy (out, "&gt;");
-			out += 4;
-			col++;
+			g_string_append (html, "&gt;");
+			converter->col++;
 			break;
 
 		case '&':
-			strcpy (out, "&amp;");
-			out += 5;
-			col++;
+			g_string_append (html, "&amp;");
+			converter->col++;
 			break;
 
 		case '"':
-			strcpy (out, "&quot;");
-			out += 6;
-			col++;
+			g_string_append (html, "&quot;");
+			converter->col++;
 			break;
 
 		case '\n':
-			if (flags & E_TEXT_TO_HTML_CONVERT_NL) {
-				strcpy (out, "<br>");
-				out += 4;
-			}
-			*out++ = *cur;
+			if (flags & E_TEXT_TO_HTML_CONVERT_NL)
+				g_string_append (html, "<br>");
+			g_string_append_c (html, *cur);
 			linestart = cur;
-			col = 0;
+			converter->col = 0;
 			break;
 
 		case '\t':
 			if (flags & (E_TEXT_TO_HTML_CONVERT_SPACES |
 				     E_TEXT_TO_HTML_CONVERT_NL)) {
 				do {
-					out = check_size (
-						&buffer, &buffer_size, out, 7);
-					strcpy (out, "&nbsp;");
-					out += 6;
-					col++;
-				} while (col % 8);
+					g_string_append (html, "&nbsp;");
+					converter->col++;
+				} while (converter->col % 8);
 				break;
 			}
 			/* otherwise, FALL THROUGH */
 
 		case ' ':
 			if (flags & E_TEXT_TO_HTML_CONVERT_SPACES) {
-				if (cur == (const guchar *) input ||
+				/* The start is always at the beginning of a line */
+				if (cur == start ||
 				    *(cur + 1) == ' ' || *(cur + 1) == '\t' ||
 				    *(cur - 1) == '\n') {
-					strcpy (out, "&nbsp;");
-					out += 6;
-					col++;
+					g_string_append (html, "&nbsp;");
+					converter->col++;
 					break;
 				}
 			}
@@ -463,25 +433,272 @@ e_text_to_html_full (const gchar *input,
 			if ((u >= 0x20 && u < 0x80) ||
 			    (u == '\r' || u == '\t')) {
 				/* Default case, just copy. */
-				*out++ = u;
+				g_string_append_c (html, u);
 			} else {
 				if (flags & E_TEXT_TO_HTML_ESCAPE_8BIT)
-					*out++ = '?';
+					g_string_append_c (html, '?');
 				else
-					out += g_snprintf (out, 9, "&#%d;", u);
+					g_string_append_printf (html, "&#%d;", u);
 			}
-			col++;
+			converter->col++;
 			break;
 		}
 	}
+}
+
+static void
+text_to_html_init (ETextToHtml *converter,
+                   GString *html,
+                   guint flags,
+                   guint32 color)
+{
+	converter->html = html;
+	converter->flags = flags;
+	converter->color = color;
+	converter->pending = NULL;
+	converter->col = 0;
+	converter->colored = FALSE;
+	converter->saw_citation = FALSE;
 
-	out = check_size (&buffer, &buffer_size, out, 7);
 	if (flags & E_TEXT_TO_HTML_PRE)
-		strcpy (out, "</PRE>");
-	else
-		*out = '\0';
+		g_string_append (html, "<PRE>");
+}
+
+static void
+text_to_html_finish (ETextToHtml *converter)
+{
+	if (converter->flags & E_TEXT_TO_HTML_PRE)
+		g_string_append (converter->html, "</PRE>");
+}
+
+/**
+ * e_text_to_html_new:
+ * @html: a #GString to write the HTML to
+ * @flags: some combination of the E_TEXT_TO_HTML_* flags defined
+ * in e-html-utils.h
+ * @color: color for citation highlighting
+ *
+ * Creates a converter, which converts text fed to it with
+ * e_text_to_html_feed() into HTML, the same way as e_text_to_html_full()
+ * does, appending the result to @html. The text can be fed in chunks
+ * of any size; each complete line is converted as soon as it's fed,
+ * thus the caller can write out and truncate the @html between
+ * the calls, for example into a stream.
+ *
+ * Free the converter with e_text_to_html_finish(), which also
+ * converts the rest of the fed text.
+ *
+ * Returns: (transfer full): a new #ETextToHtml
+ *
+ * Since: 3.28
+ **/
+ETextToHtml *
+e_text_to_html_new (GString *html,
+                    guint flags,
+                    guint32 color)
+{
+	ETextToHtml *converter;
+
+	g_return_val_if_fail (html != NULL, NULL);
+
+	converter = g_slice_new0 (ETextToHtml);
+	text_to_html_init (converter, html, flags, color);
+	converter->pending = g_string_new (NULL);
+
+	return converter;
+}
+
+/**
+ * e_text_to_html_feed:
+ * @converter: an #ETextToHtml
+ * @text: a chunk of the text to convert
+ * @text_len: length of the @text, or -1 when it's NUL-terminated
+ *
+ * Feeds the next chunk of the text into the @converter. The complete
+ * lines are converted and appended to the HTML output immediately,
+ * the rest is held until the next call or e_text_to_html_finish().
+ *
+ * Since: 3.28
+ **/
+void
+e_text_to_html_feed (ETextToHtml *converter,
+                     const gchar *text,
+                     gssize text_len)
+{
+	const gchar *str, *nl, *limit;
+	gsize old_len;
+
+	g_return_if_fail (converter != NULL);
+	g_return_if_fail (converter->pending != NULL);
+
+	if (!text)
+		return;
+
+	if (text_len < 0)
+		text_len = strlen (text);
+
+	if (!text_len)
+		return;
+
+	old_len = converter->pending->len;
+	g_string_append_len (converter->pending, text, text_len);
+
+	/* The whole text can be a URL, thus wait for all of it */
+	if ((converter->flags & E_TEXT_TO_HTML_URL_IS_WHOLE_TEXT) != 0)
+		return;
+
+	/* Only the new chunk can contain the last new line */
+	nl = g_strrstr_len (converter->pending->str + old_len, text_len, "\n");
+	if (!nl)
+		return;
+
+	str = converter->pending->str;
+	limit = nl + 1;
+
+	/* An isolated mbox-mangled ">From" line cannot be told without
+	 * seeing the start of the next line, thus keep it for later. */
+	if ((converter->flags & E_TEXT_TO_HTML_MARK_CITATION) != 0 &&
+	    *limit == '\0') {
+		const gchar *linestart = nl;
+
+		while (linestart > str && linestart[-1] != '\n')
+			linestart--;
+
+		if (strncmp (linestart, ">From ", 6) == 0)
+			limit = linestart;
+	}
+
+	if (limit == str)
+		return;
+
+	text_to_html_convert (converter, (const guchar *) str, (const guchar *) limit);
+
+	g_string_erase (converter->pending, 0, limit - str);
+}
+
+/**
+ * e_text_to_html_finish:
+ * @converter: (transfer full): an #ETextToHtml
+ *
+ * Converts the rest of the text fed to the @converter, appends it
+ * to the HTML output and frees the @converter.
+ *
+ * Since: 3.28
+ **/
+void
+e_text_to_html_finish (ETextToHtml *converter)
+{
+	g_return_if_fail (converter != NULL);
+	g_return_if_fail (converter->pending != NULL);
+
+	text_to_html_convert (converter,
+		(const guchar *) converter->pending->str,
+		(const guchar *) converter->pending->str + converter->pending->len);
+	text_to_html_finish (converter);
+
+	g_string_free (converter->pending, TRUE);
+	g_slice_free (ETextToHtml, converter);
+}
+
+/**
+ * e_text_to_html_append:
+ * @html: a #GString to append the HTML to
+ * @input: a NUL-terminated input buffer
+ * @flags: some combination of the E_TEXT_TO_HTML_* flags defined
+ * in e-html-utils.h
+ * @color: color for citation highlighting
+ *
+ * The same as e_text_to_html_full(), only appends the result
+ * to the @html, which can be reused between the calls.
+ *
+ * Since: 3.28
+ **/
+void
+e_text_to_html_append (GString *html,
+                       const gchar *input,
+                       guint flags,
+                       guint32 color)
+{
+	ETextToHtml converter;
+
+	g_return_if_fail (html != NULL);
+	g_return_if_fail (input != NULL);
+
+	text_to_html_init (&converter, html, flags, color);
+	text_to_html_convert (&converter,
+		(const guchar *) input,
+		(const guchar *) input + strlen (input));
+	text_to_html_finish (&converter);
+}
+
+/**
+ * e_text_to_html_full:
+ * @input: a NUL-terminated input buffer
+ * @flags: some combination of the E_TEXT_TO_HTML_* flags defined
+ * in e-html-utils.h
+ * @color: color for citation highlighting
+ *
+ * This takes a buffer of text as input and produces a buffer of
+ * "equivalent" HTML, subject to certain transformation rules.
+ *
+ * The set of possible flags is:
+ *
+ *   - E_TEXT_TO_HTML_PRE: wrap the output HTML in &lt;PRE&gt; and
+ *     &lt;/PRE&gt;  Should only be used if @input is the entire
+ *     buffer to be converted. If e_text_to_html is being called with
+ *     small pieces of data, you should wrap the entire result in
+ *     &lt;PRE&gt; yourself.
+ *
+ *   - E_TEXT_TO_HTML_CONVERT_NL: convert "\n" to "&lt;BR&gt;n" on
+ *     output.  (Should not be used with E_TEXT_TO_HTML_PRE, since
+ *     that would result in double-newlines.)
+ *
+ *   - E_TEXT_TO_HTML_CONVERT_SPACES: convert a block of N spaces
+ *     into N-1 non-breaking spaces and one normal space. A space
+ *     at the start of the buffer is always converted to a
+ *     non-breaking space, regardless of the following character,
+ *     which probably means you don't want to use this flag on
+ *     pieces of data that aren't delimited by at least line breaks.
+ *
+ *     If E_TEXT_TO_HTML_CONVERT_NL and E_TEXT_TO_HTML_CONVERT_SPACES
+ *     are both defined, then TABs will also be converted to spaces.
+ *
+ *   - E_TEXT_TO_HTML_CONVERT_URLS: wrap &lt;a href="..."&gt; &lt;/a&gt;
+ *     around strings that look like URLs.
+ *
+ *   - E_TEXT_TO_HTML_CONVERT_ADDRESSES: wrap &lt;a href="mailto:..."&gt;
+ *     &lt;/a&gt; around strings that look like mail addresses.
+ *
+ *   - E_TEXT_TO_HTML_MARK_CITATION: wrap &lt;font color="..."&gt;
+ *     &lt;/font&gt; around citations (lines beginning with "> ", etc).
+ *
+ *   - E_TEXT_TO_HTML_ESCAPE_8BIT: flatten everything to US-ASCII
+ *
+ *   - E_TEXT_TO_HTML_CITE: quote the text with "> " at the start of each
+ *     line.
+ *
+ *   - E_TEXT_TO_HTML_HIDE_URL_SCHEME: hides scheme part of the URL in
+ *     the display part of the generated text (thus, instead of "http://www.example.com",
+ *     user will only see "www.example.com")
+ *
+ *   - E_TEXT_TO_HTML_URL_IS_WHOLE_TEXT: set when the whole @input text
+ *     represents a URL; any spaces are removed in the href part.
+ *
+ * Returns: a newly-allocated string containing HTML
+ **/
+gchar *
+e_text_to_html_full (const gchar *input,
+                     guint flags,
+                     guint32 color)
+{
+	GString *html;
+
+	/* Allocate a translation buffer.  */
+	html = g_string_sized_new (strlen (input) * 2 + 5);
+
+	e_text_to_html_append (html, input, flags, color);
 
-	return buffer;
+	return g_string_free (html, FALSE);
 }
 
 gchar *
@@ -40,7 +40,24 @@
 #define E_TEXT_TO_HTML_URL_IS_WHOLE_TEXT (1 << 9)
 #define E_TEXT_TO_HTML_LAST_FLAG         (1 << 10)
 
+typedef struct _ETextToHtml ETextToHtml;
+
 gchar *e_text_to_html_full (const gchar *input, guint flags, guint32 color);
 gchar *e_text_to_html      (const gchar *input, guint flags);
+void   e_text_to_html_append
+                           (GString *html,
+                            const gchar *input,
+                            guint flags,
+                            guint32 color);
+
+ETextToHtml *
+       e_text_to_html_new  (GString *html,
+                            guint flags,
+                            guint32 color);
+void   e_text_to_html_feed (ETextToHtml *converter,
+                            const gchar *text,
+                            gssize text_len);
+void   e_text_to_html_finish
+                           (ETextToHtml *converter);
 
 #endif /* __E_HTML_UTILS__ */
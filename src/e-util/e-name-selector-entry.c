@@ -867,17 +867,22 @@ set_completion_query (ENameSelectorEntry *name_selector_entry,
 		full_name_query_str, file_as_query_str,
 		user_fields_str ? user_fields_str : "");
 
-	g_free (user_fields_str);
 	g_free (file_as_query_str);
 	g_free (full_name_query_str);
 	g_free (encoded_cue_str);
 
 	ENS_DEBUG (g_print ("%s\n", query_str));
 
+	/* Books with a populated completion index are searched in-process by
+	   the cue; the query is used only for those without the index, and
+	   for all of them when it tests also the user query fields */
 	book_query = e_book_query_from_string (query_str);
-	e_contact_store_set_query (name_selector_entry->priv->contact_store, book_query);
+	e_contact_store_set_query_with_cue (
+		name_selector_entry->priv->contact_store, book_query,
+		user_fields_str ? NULL : cue_str);
 	e_book_query_unref (book_query);
 
+	g_free (user_fields_str);
 	g_free (query_str);
 }
 
@@ -18,9 +18,13 @@
 #include "evolution-config.h"
 
 #include <sys/types.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
+
+#include <libxml/parser.h>
 
 #include <libebackend/libebackend.h>
 
@@ -71,13 +75,23 @@ static GSList *ep_disabled;
 /* All classes which implement EPluginHooks, by class.id */
 static GHashTable *eph_types;
 
-struct _plugin_doc {
-	struct _plugin_doc *next;
-	struct _plugin_doc *prev;
-
+/* One <e-plugin> element of an .eplug file */
+typedef struct _EPluginManifest {
 	gchar *filename;
-	xmlDocPtr doc;
-};
+	gchar *id;
+	gchar *type;
+	gint load_level;
+	gboolean system_plugin;
+	gchar *xml;
+} EPluginManifest;
+
+/* The parsed manifests are cached in the user cache directory, thus
+ * the .eplug files are not opened and parsed on each start; the cache
+ * is valid while the plugin directory and the .eplug files in it have
+ * the same modification times and sizes as when it was written. */
+#define EP_MANIFEST_CACHE_FILENAME "eplug-manifests.cache"
+#define EP_MANIFEST_CACHE_VERSION 1
+#define EP_MANIFEST_CACHE_FORMAT "(ussxa(sxxa(ssibs)))"
 
 enum {
 	EP_PROP_0,
@@ -312,7 +326,7 @@ e_plugin_init (EPlugin *ep)
 
 static EPlugin *
 ep_load_plugin (xmlNodePtr root,
-                struct _plugin_doc *pdoc)
+                const gchar *filename)
 {
 	gchar *prop, *id;
 	EPluginClass *class;
@@ -320,7 +334,7 @@ ep_load_plugin (xmlNodePtr root,
 
 	id = e_plugin_xml_prop (root, "id");
 	if (id == NULL) {
-		g_warning ("Invalid e-plugin entry in '%s': no id", pdoc->filename);
+		g_warning ("Invalid e-plugin entry in '%s': no id", filename);
 		return NULL;
 	}
 
@@ -333,7 +347,7 @@ ep_load_plugin (xmlNodePtr root,
 	prop = (gchar *) xmlGetProp (root, (const guchar *)"type");
 	if (prop == NULL) {
 		g_free (id);
-		g_warning ("Invalid e-plugin entry in '%s': no type", pdoc->filename);
+		g_warning ("Invalid e-plugin entry in '%s': no type", filename);
 		return NULL;
 	}
 
@@ -349,7 +363,7 @@ ep_load_plugin (xmlNodePtr root,
 
 	ep = g_object_new (G_TYPE_FROM_CLASS (class), NULL);
 	ep->id = id;
-	ep->path = g_strdup (pdoc->filename);
+	ep->path = g_strdup (filename);
 	ep->enabled = ep_check_enabled (id);
 	if (e_plugin_construct (ep, root) == -1)
 		e_plugin_enable (ep, FALSE);
@@ -358,14 +372,66 @@ ep_load_plugin (xmlNodePtr root,
 	return ep;
 }
 
+static void
+ep_manifest_free (gpointer ptr)
+{
+	EPluginManifest *manifest = ptr;
+
+	if (manifest) {
+		g_free (manifest->filename);
+		g_free (manifest->id);
+		g_free (manifest->type);
+		g_free (manifest->xml);
+		g_free (manifest);
+	}
+}
+
+static void
+ep_load_manifest (EPluginManifest *manifest,
+                  gint load_level)
+{
+	xmlDocPtr doc;
+	EPlugin *ep;
+
+	if (g_hash_table_lookup (ep_plugins, manifest->id)) {
+		g_warning ("Plugin '%s' already defined", manifest->id);
+		return;
+	}
+
+	/* Do not parse plugins of unknown types at all */
+	if (!g_hash_table_lookup (ep_types, manifest->type))
+		return;
+
+	doc = xmlReadMemory (manifest->xml, strlen (manifest->xml), manifest->filename, NULL, 0);
+	if (doc == NULL)
+		return;
+
+	ep = ep_load_plugin (xmlDocGetRootElement (doc), manifest->filename);
+
+	if (ep && load_level == 1)
+		e_plugin_invoke (ep, "load_plugin_type_register_function", NULL);
+
+	if (ep) {
+		/* README: Maybe we can use load_levels to
+		 * achieve the same thing.  But it may be
+		 * confusing for a plugin writer. */
+		if (manifest->system_plugin) {
+			e_plugin_enable (ep, TRUE);
+			ep->flags |= E_PLUGIN_FLAGS_SYSTEM_PLUGIN;
+		} else
+			ep->flags &= ~E_PLUGIN_FLAGS_SYSTEM_PLUGIN;
+	}
+
+	xmlFreeDoc (doc);
+}
+
+/* Parses the <e-plugin> elements of the .eplug file into @manifests */
 static gint
-ep_load (const gchar *filename,
-         gint load_level)
+ep_read_manifests (const gchar *filename,
+                   GPtrArray *manifests)
 {
 	xmlDocPtr doc;
 	xmlNodePtr root;
-	EPlugin *ep = NULL;
-	struct _plugin_doc *pdoc;
 
 	doc = e_xml_parse_file (filename);
 	if (doc == NULL)
@@ -378,53 +444,275 @@ ep_load (const gchar *filename,
 		return -1;
 	}
 
-	pdoc = g_malloc0 (sizeof (*pdoc));
-	pdoc->doc = doc;
-	pdoc->filename = g_strdup (filename);
-
 	for (root = root->children; root; root = root->next) {
-		if (strcmp ((gchar *) root->name, "e-plugin") == 0) {
-			gchar *plugin_load_level, *is_system_plugin;
-
-			plugin_load_level = NULL;
-			plugin_load_level = e_plugin_xml_prop (root, "load_level");
-			if (plugin_load_level) {
-				if ((atoi (plugin_load_level) == load_level)) {
-					ep = ep_load_plugin (root, pdoc);
-
-					if (ep && load_level == 1)
-						e_plugin_invoke (
-							ep, "load_plugin_type_register_function", NULL);
-				}
-			} else if (load_level == 2) {
-				ep = ep_load_plugin (root, pdoc);
-			}
+		EPluginManifest *manifest;
+		xmlBufferPtr buffer;
+		gchar *prop;
 
-			if (ep) {
-				/* README: Maybe we can use load_levels to
-				 * achieve the same thing.  But it may be
-				 * confusing for a plugin writer. */
-				is_system_plugin =
-					e_plugin_xml_prop (root, "system_plugin");
-				if (g_strcmp0 (is_system_plugin, "true") == 0) {
-					e_plugin_enable (ep, TRUE);
-					ep->flags |= E_PLUGIN_FLAGS_SYSTEM_PLUGIN;
-				} else
-					ep->flags &= ~E_PLUGIN_FLAGS_SYSTEM_PLUGIN;
-				g_free (is_system_plugin);
-
-				ep = NULL;
-			}
+		if (strcmp ((gchar *) root->name, "e-plugin") != 0)
+			continue;
+
+		manifest = g_new0 (EPluginManifest, 1);
+		manifest->filename = g_strdup (filename);
+		manifest->id = e_plugin_xml_prop (root, "id");
+		manifest->type = e_plugin_xml_prop (root, "type");
+
+		if (manifest->id == NULL) {
+			g_warning ("Invalid e-plugin entry in '%s': no id", filename);
+			ep_manifest_free (manifest);
+			continue;
+		}
+
+		if (manifest->type == NULL) {
+			g_warning ("Invalid e-plugin entry in '%s': no type", filename);
+			ep_manifest_free (manifest);
+			continue;
 		}
+
+		/* Plugins without load level are loaded with level 2 */
+		prop = e_plugin_xml_prop (root, "load_level");
+		manifest->load_level = prop ? atoi (prop) : 2;
+		g_free (prop);
+
+		prop = e_plugin_xml_prop (root, "system_plugin");
+		manifest->system_plugin = g_strcmp0 (prop, "true") == 0;
+		g_free (prop);
+
+		buffer = xmlBufferCreate ();
+		xmlNodeDump (buffer, doc, root, 0, 0);
+		manifest->xml = g_strdup ((const gchar *) xmlBufferContent (buffer));
+		xmlBufferFree (buffer);
+
+		g_ptr_array_add (manifests, manifest);
 	}
 
-	xmlFreeDoc (pdoc->doc);
-	g_free (pdoc->filename);
-	g_free (pdoc);
+	xmlFreeDoc (doc);
 
 	return 0;
 }
 
+static gchar *
+ep_dup_manifest_cache_filename (void)
+{
+	return g_build_filename (e_get_user_cache_dir (), EP_MANIFEST_CACHE_FILENAME, NULL);
+}
+
+/* Returns the manifests stored in the cache, or NULL when the cache
+ * does not exist or does not describe @files; the @files contains
+ * GVariant-s of the (name, mtime, size) of the .eplug files. */
+static GPtrArray *
+ep_read_manifest_cache (const gchar *path,
+                        gint64 dir_mtime,
+                        GPtrArray *files)
+{
+	GVariant *cache, *cached_files;
+	GPtrArray *manifests = NULL;
+	gchar *filename, *contents = NULL;
+	gsize length = 0;
+	guint32 version = 0;
+	const gchar *cached_version = NULL, *cached_path = NULL;
+	gint64 cached_dir_mtime = 0;
+	gsize ii, n_files;
+
+	filename = ep_dup_manifest_cache_filename ();
+
+	if (!g_file_get_contents (filename, &contents, &length, NULL)) {
+		g_free (filename);
+		return NULL;
+	}
+
+	g_free (filename);
+
+	cache = g_variant_new_from_data (
+		G_VARIANT_TYPE (EP_MANIFEST_CACHE_FORMAT),
+		contents, length, FALSE, g_free, contents);
+	g_variant_ref_sink (cache);
+
+	g_variant_get (cache, "(u&s&sx@a(sxxa(ssibs)))",
+		&version, &cached_version, &cached_path, &cached_dir_mtime, &cached_files);
+
+	n_files = g_variant_n_children (cached_files);
+
+	if (version != EP_MANIFEST_CACHE_VERSION ||
+	    g_strcmp0 (cached_version, VERSION) != 0 ||
+	    g_strcmp0 (cached_path, path) != 0 ||
+	    cached_dir_mtime != dir_mtime ||
+	    n_files != files->len)
+		goto exit;
+
+	manifests = g_ptr_array_new_with_free_func (ep_manifest_free);
+
+	for (ii = 0; ii < n_files; ii++) {
+		GVariant *cached_file, *plugins;
+		const gchar *name, *expected_name;
+		gint64 mtime, size, expected_mtime, expected_size;
+		gsize jj, n_plugins;
+
+		cached_file = g_variant_get_child_value (cached_files, ii);
+		g_variant_get (cached_file, "(&sxx@a(ssibs))", &name, &mtime, &size, &plugins);
+		g_variant_get (files->pdata[ii], "(&sxx)", &expected_name, &expected_mtime, &expected_size);
+
+		if (g_strcmp0 (name, expected_name) != 0 ||
+		    mtime != expected_mtime ||
+		    size != expected_size) {
+			g_variant_unref (plugins);
+			g_variant_unref (cached_file);
+			g_ptr_array_unref (manifests);
+			manifests = NULL;
+			break;
+		}
+
+		n_plugins = g_variant_n_children (plugins);
+
+		for (jj = 0; jj < n_plugins; jj++) {
+			EPluginManifest *manifest;
+
+			manifest = g_new0 (EPluginManifest, 1);
+			manifest->filename = g_build_filename (path, name, NULL);
+
+			g_variant_get_child (plugins, jj, "(ssibs)",
+				&manifest->id, &manifest->type, &manifest->load_level,
+				&manifest->system_plugin, &manifest->xml);
+
+			g_ptr_array_add (manifests, manifest);
+		}
+
+		g_variant_unref (plugins);
+		g_variant_unref (cached_file);
+	}
+
+exit:
+	g_variant_unref (cached_files);
+	g_variant_unref (cache);
+
+	return manifests;
+}
+
+static void
+ep_write_manifest_cache (const gchar *path,
+                         gint64 dir_mtime,
+                         GPtrArray *files,
+                         GPtrArray *manifests)
+{
+	GVariantBuilder files_builder;
+	GVariant *cache;
+	GError *local_error = NULL;
+	gchar *filename;
+	guint ii, jj = 0;
+
+	g_variant_builder_init (&files_builder, G_VARIANT_TYPE ("a(sxxa(ssibs))"));
+
+	for (ii = 0; ii < files->len; ii++) {
+		GVariantBuilder plugins_builder;
+		const gchar *name;
+		gint64 mtime, size;
+		gchar *file_path;
+
+		g_variant_get (files->pdata[ii], "(&sxx)", &name, &mtime, &size);
+		file_path = g_build_filename (path, name, NULL);
+
+		g_variant_builder_init (&plugins_builder, G_VARIANT_TYPE ("a(ssibs)"));
+
+		/* The manifests are in the order of the files */
+		for (; jj < manifests->len; jj++) {
+			EPluginManifest *manifest = manifests->pdata[jj];
+
+			if (g_strcmp0 (manifest->filename, file_path) != 0)
+				break;
+
+			g_variant_builder_add (&plugins_builder, "(ssibs)",
+				manifest->id, manifest->type, manifest->load_level,
+				manifest->system_plugin, manifest->xml);
+		}
+
+		g_variant_builder_add (&files_builder, "(sxxa(ssibs))", name, mtime, size, &plugins_builder);
+
+		g_free (file_path);
+	}
+
+	cache = g_variant_new ("(ussxa(sxxa(ssibs)))",
+		EP_MANIFEST_CACHE_VERSION, VERSION, path, dir_mtime, &files_builder);
+	g_variant_ref_sink (cache);
+
+	filename = ep_dup_manifest_cache_filename ();
+
+	if (g_mkdir_with_parents (e_get_user_cache_dir (), 0700) == -1 ||
+	    !g_file_set_contents (filename, g_variant_get_data (cache), g_variant_get_size (cache), &local_error)) {
+		pd (printf ("failed to write plugin cache '%s': %s\n", filename, local_error ? local_error->message : "Unknown error"));
+	}
+
+	g_clear_error (&local_error);
+	g_variant_unref (cache);
+	g_free (filename);
+}
+
+/* Scans the plugin directory once and returns the manifests of all
+ * the plugins in it, either from the cache or from the .eplug files */
+static GPtrArray *
+ep_load_manifests (const gchar *path)
+{
+	GDir *dir;
+	GPtrArray *files, *manifests;
+	GStatBuf st;
+	const gchar *d;
+	gint64 dir_mtime;
+	guint ii;
+
+	pd (printf ("scanning plugin dir '%s'\n", path));
+
+	if (g_stat (path, &st) != 0)
+		return NULL;
+
+	dir = g_dir_open (path, 0, NULL);
+	if (dir == NULL) {
+		/*g_warning("Could not find plugin path: %s", path);*/
+		return NULL;
+	}
+
+	dir_mtime = st.st_mtime;
+	files = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
+
+	while ((d = g_dir_read_name (dir))) {
+		if (g_str_has_suffix  (d, ".eplug")) {
+			gchar *name;
+
+			name = g_build_filename (path, d, NULL);
+
+			if (g_stat (name, &st) == 0) {
+				g_ptr_array_add (files, g_variant_ref_sink (
+					g_variant_new ("(sxx)", d, (gint64) st.st_mtime, (gint64) st.st_size)));
+			}
+
+			g_free (name);
+		}
+	}
+
+	g_dir_close (dir);
+
+	manifests = ep_read_manifest_cache (path, dir_mtime, files);
+
+	if (!manifests) {
+		manifests = g_ptr_array_new_with_free_func (ep_manifest_free);
+
+		for (ii = 0; ii < files->len; ii++) {
+			const gchar *basename;
+			gchar *name;
+
+			g_variant_get (files->pdata[ii], "(&sxx)", &basename, NULL, NULL);
+
+			name = g_build_filename (path, basename, NULL);
+			ep_read_manifests (name, manifests);
+			g_free (name);
+		}
+
+		ep_write_manifest_cache (path, dir_mtime, files, manifests);
+	}
+
+	g_ptr_array_unref (files);
+
+	return manifests;
+}
+
 static void
 plugin_load_subclass (GType type,
                       GHashTable *hash_table)
@@ -484,6 +772,7 @@ gint
 e_plugin_load_plugins (void)
 {
 	GSettings *settings;
+	GPtrArray *manifests;
 	gchar **strv;
 	gint i;
 
@@ -511,32 +800,23 @@ e_plugin_load_plugins (void)
 	g_strfreev (strv);
 	g_object_unref (settings);
 
-	for (i = 0; i < 3; i++) {
-		GDir *dir;
-		const gchar *d;
-		const gchar *path = EVOLUTION_PLUGINDIR;
-
-		pd (printf ("scanning plugin dir '%s'\n", path));
+	manifests = ep_load_manifests (EVOLUTION_PLUGINDIR);
+	if (!manifests)
+		return 0;
 
-		dir = g_dir_open (path, 0, NULL);
-		if (dir == NULL) {
-			/*g_warning("Could not find plugin path: %s", path);*/
-			continue;
-		}
+	for (i = 0; i < 3; i++) {
+		guint ii;
 
-		while ((d = g_dir_read_name (dir))) {
-			if (g_str_has_suffix  (d, ".eplug")) {
-				gchar *name;
+		for (ii = 0; ii < manifests->len; ii++) {
+			EPluginManifest *manifest = manifests->pdata[ii];
 
-				name = g_build_filename (path, d, NULL);
-				ep_load (name, i);
-				g_free (name);
-			}
+			if (manifest->load_level == i)
+				ep_load_manifest (manifest, i);
 		}
-
-		g_dir_close (dir);
 	}
 
+	g_ptr_array_unref (manifests);
+
 	return 0;
 }
 
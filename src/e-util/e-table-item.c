@@ -70,6 +70,21 @@ typedef struct _ETableItemPrivate ETableItemPrivate;
 
 struct _ETableItemPrivate {
 	GSource *show_cursor_delay_source;
+
+	/* Fenwick tree over the row heights, including the grid line, used
+	 * when the rows do not have uniform height.  Rows which were not
+	 * measured yet count with the estimated height, thus the y-offset
+	 * of any row is known without measuring all the rows before it. */
+	gint *height_tree;		/* 1-based, eti->rows + 1 items */
+	gint height_tree_rows;
+	gint height_tree_extra;
+	gboolean height_tree_valid;
+	gint estimated_row_height;	/* -1 when not known yet */
+
+	/* Height changes of the rows above the visible area, by which
+	 * the canvas is scrolled on the next reflow, to not move the rows
+	 * being looked at. */
+	gint scroll_compensation;
 };
 
 static void eti_check_cursor_bounds (ETableItem *eti);
@@ -504,6 +519,7 @@ eti_reflow (GnomeCanvasItem *item,
             gint flags)
 {
 	ETableItem *eti = E_TABLE_ITEM (item);
+	ETableItemPrivate *priv = E_TABLE_ITEM_GET_PRIVATE (eti);
 
 	if (eti->needs_compute_height) {
 		gint new_height = eti_get_height (eti);
@@ -516,6 +532,14 @@ eti_reflow (GnomeCanvasItem *item,
 		}
 		eti->needs_compute_height = 0;
 	}
+	if (priv->scroll_compensation) {
+		gint scroll_x = 0, scroll_y = 0;
+
+		gnome_canvas_get_scroll_offsets (item->canvas, &scroll_x, &scroll_y);
+		gnome_canvas_scroll_to (item->canvas, scroll_x, scroll_y + priv->scroll_compensation);
+
+		priv->scroll_compensation = 0;
+	}
 	if (eti->needs_compute_width) {
 		gint new_width = e_table_header_total_width (eti->header);
 		if (new_width != eti->width) {
@@ -716,13 +740,211 @@ confirm_height_cache (ETableItem *eti)
 	}
 }
 
+static void
+height_tree_free (ETableItem *eti)
+{
+	ETableItemPrivate *priv = E_TABLE_ITEM_GET_PRIVATE (eti);
+
+	g_free (priv->height_tree);
+	priv->height_tree = NULL;
+	priv->height_tree_rows = 0;
+	priv->height_tree_valid = FALSE;
+	priv->estimated_row_height = -1;
+	priv->scroll_compensation = 0;
+}
+
+/* Rebuilds the tree from the height_cache when it's out of date,
+ * which is O(rows), but does not measure any row except the first */
+static void
+height_tree_ensure (ETableItem *eti)
+{
+	ETableItemPrivate *priv = E_TABLE_ITEM_GET_PRIVATE (eti);
+	gint height_extra = eti->horizontal_draw_grid ? 1 : 0;
+	gint ii, jj;
+
+	confirm_height_cache (eti);
+
+	if (priv->height_tree_valid &&
+	    priv->height_tree_rows == eti->rows &&
+	    priv->height_tree_extra == height_extra)
+		return;
+
+	if (priv->estimated_row_height == -1 && eti->rows > 0) {
+		if (eti->height_cache[0] == -1)
+			eti->height_cache[0] = eti_row_height_real (eti, 0);
+		priv->estimated_row_height = eti->height_cache[0];
+	}
+
+	g_free (priv->height_tree);
+	priv->height_tree = g_new (gint, eti->rows + 1);
+	priv->height_tree[0] = 0;
+
+	for (ii = 1; ii <= eti->rows; ii++) {
+		gint height = eti->height_cache[ii - 1];
+
+		priv->height_tree[ii] = (height == -1 ? priv->estimated_row_height : height) + height_extra;
+	}
+
+	for (ii = 1; ii <= eti->rows; ii++) {
+		jj = ii + (ii & (-ii));
+
+		if (jj <= eti->rows)
+			priv->height_tree[jj] += priv->height_tree[ii];
+	}
+
+	priv->height_tree_rows = eti->rows;
+	priv->height_tree_extra = height_extra;
+	priv->height_tree_valid = TRUE;
+}
+
+static void
+height_tree_add (ETableItem *eti,
+                 gint row,
+                 gint delta)
+{
+	ETableItemPrivate *priv = E_TABLE_ITEM_GET_PRIVATE (eti);
+	gint ii;
+
+	/* It'll be rebuilt from the height_cache */
+	if (!priv->height_tree_valid || priv->height_tree_rows != eti->rows)
+		return;
+
+	for (ii = row + 1; ii <= priv->height_tree_rows; ii += ii & (-ii)) {
+		priv->height_tree[ii] += delta;
+	}
+}
+
+/* Returns the height of rows [0, row), including their grid lines */
+static gint
+height_tree_prefix (ETableItem *eti,
+                    gint row)
+{
+	ETableItemPrivate *priv = E_TABLE_ITEM_GET_PRIVATE (eti);
+	gint ii, total = 0;
+
+	height_tree_ensure (eti);
+
+	if (row > eti->rows)
+		row = eti->rows;
+
+	for (ii = row; ii > 0; ii -= ii & (-ii)) {
+		total += priv->height_tree[ii];
+	}
+
+	return total;
+}
+
+/* Returns the number of rows which fit into @y pixels as a whole,
+ * which is eti->rows when @y is beyond the last row */
+static gint
+height_tree_find (ETableItem *eti,
+                  gint y)
+{
+	ETableItemPrivate *priv = E_TABLE_ITEM_GET_PRIVATE (eti);
+	gint step, pos = 0;
+
+	height_tree_ensure (eti);
+
+	for (step = 1; step * 2 <= eti->rows; step *= 2) {
+		/* find the highest power of two */
+	}
+
+	for (; step > 0 && eti->rows > 0; step /= 2) {
+		if (pos + step <= eti->rows && priv->height_tree[pos + step] <= y) {
+			pos += step;
+			y -= priv->height_tree[pos];
+		}
+	}
+
+	return pos;
+}
+
+/* Returns the visible part of the canvas in item coordinates */
+static void
+eti_get_visible_area (ETableItem *eti,
+                      gint *top,
+                      gint *bottom)
+{
+	GnomeCanvasItem *item = GNOME_CANVAS_ITEM (eti);
+	GtkAllocation allocation;
+	cairo_matrix_t i2c;
+	gdouble base_x = 0, base_y = 0;
+	gint scroll_y = 0;
+
+	gnome_canvas_item_i2c_matrix (item, &i2c);
+	cairo_matrix_transform_point (&i2c, &base_x, &base_y);
+
+	gnome_canvas_get_scroll_offsets (item->canvas, NULL, &scroll_y);
+	gtk_widget_get_allocation (GTK_WIDGET (item->canvas), &allocation);
+
+	*top = scroll_y - floor (base_y);
+	*bottom = *top + allocation.height;
+}
+
+/* Stores a newly measured height of the @row, which was either estimated
+ * or measured before, and schedules relayout when it differs */
+static void
+eti_refine_row_height (ETableItem *eti,
+                       gint row,
+                       gint height)
+{
+	ETableItemPrivate *priv = E_TABLE_ITEM_GET_PRIVATE (eti);
+	gint old_height, delta;
+
+	old_height = eti->height_cache[row];
+	if (old_height == -1)
+		old_height = priv->estimated_row_height;
+
+	eti->height_cache[row] = height;
+
+	if (old_height == -1 || old_height == height)
+		return;
+
+	delta = height - old_height;
+
+	if (priv->height_tree_valid && priv->height_tree_rows == eti->rows) {
+		GnomeCanvasItem *item = GNOME_CANVAS_ITEM (eti);
+
+		if (item->flags & GNOME_CANVAS_ITEM_REALIZED) {
+			gint top, bottom;
+
+			eti_get_visible_area (eti, &top, &bottom);
+
+			/* The row is above the visible area, keep the visible
+			 * rows where they are */
+			if (top > 0 && height_tree_prefix (eti, row + 1) <= top)
+				priv->scroll_compensation += delta;
+		}
+
+		height_tree_add (eti, row, delta);
+	}
+
+	eti->needs_compute_height = 1;
+	e_canvas_item_request_reflow (GNOME_CANVAS_ITEM (eti));
+}
+
+/* How many rows around the visible area to measure in advance */
+#define HEIGHT_CACHE_PREFETCH_PAGES 1
+
 static gboolean
 height_cache_idle (ETableItem *eti)
 {
 	gint changed = 0;
-	gint i;
-	confirm_height_cache (eti);
-	for (i = eti->height_cache_idle_count; i < eti->rows; i++) {
+	gint i, top, bottom, first_row, last_row, page;
+
+	height_tree_ensure (eti);
+
+	/* Only the rows around the visible area are measured, the others
+	 * are measured when they are scrolled to */
+	eti_get_visible_area (eti, &top, &bottom);
+	first_row = height_tree_find (eti, MAX (top, 0));
+	last_row = MIN (height_tree_find (eti, MAX (bottom, 0)), eti->rows - 1);
+	page = MAX (last_row - first_row + 1, 1);
+
+	first_row = MAX (first_row - HEIGHT_CACHE_PREFETCH_PAGES * page, 0);
+	last_row = MIN (last_row + HEIGHT_CACHE_PREFETCH_PAGES * page, eti->rows - 1);
+
+	for (i = first_row; i <= last_row; i++) {
 		if (eti->height_cache[i] == -1) {
 			eti_row_height (eti, i);
 			changed++;
@@ -738,6 +960,13 @@ height_cache_idle (ETableItem *eti)
 	return FALSE;
 }
 
+static void
+eti_schedule_height_cache_idle (ETableItem *eti)
+{
+	if ((!eti->uniform_row_height) && eti->height_cache_idle_id == 0)
+		eti->height_cache_idle_id = g_idle_add_full (G_PRIORITY_LOW, (GSourceFunc) height_cache_idle, eti, NULL);
+}
+
 static void
 free_height_cache (ETableItem *eti)
 {
@@ -752,13 +981,14 @@ free_height_cache (ETableItem *eti)
 		eti->height_cache_idle_count = 0;
 		eti->uniform_row_height_cache = -1;
 
+		height_tree_free (eti);
+
 		if (eti->uniform_row_height && eti->height_cache_idle_id != 0) {
 			g_source_remove (eti->height_cache_idle_id);
 			eti->height_cache_idle_id = 0;
 		}
 
-		if ((!eti->uniform_row_height) && eti->height_cache_idle_id == 0)
-			eti->height_cache_idle_id = g_idle_add_full (G_PRIORITY_LOW, (GSourceFunc) height_cache_idle, eti, NULL);
+		eti_schedule_height_cache_idle (eti);
 	}
 }
 
@@ -786,16 +1016,8 @@ eti_row_height (ETableItem *eti,
 		if (!eti->height_cache) {
 			calculate_height_cache (eti);
 		}
-		if (eti->height_cache[row] == -1) {
-			eti->height_cache[row] = eti_row_height_real (eti, row);
-			if (row > 0 &&
-			    eti->length_threshold != -1 &&
-			    eti->rows > eti->length_threshold &&
-			    eti->height_cache[row] != eti_row_height (eti, 0)) {
-				eti->needs_compute_height = 1;
-				e_canvas_item_request_reflow (GNOME_CANVAS_ITEM (eti));
-			}
-		}
+		if (eti->height_cache[row] == -1)
+			eti_refine_row_height (eti, row, eti_row_height_real (eti, row));
 		return eti->height_cache[row];
 	}
 }
@@ -806,11 +1028,9 @@ eti_row_height (ETableItem *eti,
  * Returns the height of the ETableItem.
  *
  * The ETableItem might compute the whole height by asking every row its
- * size.  There is a special mode (designed to work when there are too
- * many rows in the table that performing the previous step could take
- * too long) set by the ETableItem->length_threshold that would determine
- * when the height is computed by using the first row as the size for
- * every other row in the ETableItem.
+ * size.  When there are more rows than the ETableItem->length_threshold,
+ * which would take too long, the rows which were not measured yet count
+ * with an estimated height instead; they are measured when shown.
  */
 static gint
 eti_get_height (ETableItem *eti)
@@ -825,36 +1045,17 @@ eti_get_height (ETableItem *eti)
 		gint row_height = ETI_ROW_HEIGHT (eti, -1);
 		return ((row_height + height_extra) * rows + height_extra);
 	} else {
-		gint height;
-		gint row;
-		if (eti->length_threshold != -1) {
-			if (rows > eti->length_threshold) {
-				gint row_height = ETI_ROW_HEIGHT (eti, 0);
-				if (eti->height_cache) {
-					height = 0;
-					for (row = 0; row < rows; row++) {
-						if (eti->height_cache[row] == -1) {
-							height += (row_height + height_extra) * (rows - row);
-							break;
-						}
-						else
-							height += eti->height_cache[row] + height_extra;
-					}
-				} else
-					height = (ETI_ROW_HEIGHT (eti, 0) + height_extra) * rows;
+		if (eti->length_threshold == -1 || rows <= eti->length_threshold) {
+			gint row;
 
-				/*
-				 * 1 pixel at the top
-				 */
-				return height + height_extra;
-			}
+			for (row = 0; row < rows; row++)
+				ETI_ROW_HEIGHT (eti, row);
 		}
 
-		height = height_extra;
-		for (row = 0; row < rows; row++)
-			height += ETI_ROW_HEIGHT (eti, row) + height_extra;
-
-		return height;
+		/*
+		 * 1 pixel at the top
+		 */
+		return height_tree_prefix (eti, rows) + height_extra;
 	}
 }
 
@@ -898,12 +1099,10 @@ e_table_item_row_diff (ETableItem *eti,
 	if (eti->uniform_row_height) {
 		return ((end_row - start_row) * (ETI_ROW_HEIGHT (eti, -1) + height_extra));
 	} else {
-		gint row, total;
-		total = 0;
-		for (row = start_row; row < end_row; row++)
-			total += ETI_ROW_HEIGHT (eti, row) + height_extra;
+		if (start_row >= end_row)
+			return 0;
 
-		return total;
+		return height_tree_prefix (eti, end_row) - height_tree_prefix (eti, start_row);
 	}
 }
 
@@ -1250,9 +1449,18 @@ eti_table_model_row_changed (ETableModel *table_model,
 		return;
 	}
 
-	if ((!eti->uniform_row_height) && eti->height_cache && eti->height_cache[row] != -1 && eti_row_height_real (eti, row) != eti->height_cache[row]) {
-		eti_table_model_changed (table_model, eti);
-		return;
+	if ((!eti->uniform_row_height) && eti->height_cache && eti->height_cache[row] != -1) {
+		gint height = eti_row_height_real (eti, row);
+
+		/* Only the rows after this one move */
+		if (height != eti->height_cache[row]) {
+			eti_refine_row_height (eti, row, height);
+			eti_unfreeze (eti);
+
+			eti->needs_redraw = 1;
+			gnome_canvas_item_request_update (GNOME_CANVAS_ITEM (eti));
+			return;
+		}
 	}
 
 	eti_unfreeze (eti);
@@ -1273,9 +1481,18 @@ eti_table_model_cell_changed (ETableModel *table_model,
 		return;
 	}
 
-	if ((!eti->uniform_row_height) && eti->height_cache && eti->height_cache[row] != -1 && eti_row_height_real (eti, row) != eti->height_cache[row]) {
-		eti_table_model_changed (table_model, eti);
-		return;
+	if ((!eti->uniform_row_height) && eti->height_cache && eti->height_cache[row] != -1) {
+		gint height = eti_row_height_real (eti, row);
+
+		/* Only the rows after this one move */
+		if (height != eti->height_cache[row]) {
+			eti_refine_row_height (eti, row, height);
+			eti_unfreeze (eti);
+
+			eti->needs_redraw = 1;
+			gnome_canvas_item_request_update (GNOME_CANVAS_ITEM (eti));
+			return;
+		}
 	}
 
 	eti_unfreeze (eti);
@@ -1303,6 +1520,9 @@ eti_table_model_rows_inserted (ETableModel *table_model,
 		memmove (eti->height_cache + row + count, eti->height_cache + row, (eti->rows - count - row) * sizeof (gint));
 		for (i = row; i < row + count; i++)
 			eti->height_cache[i] = -1;
+
+		/* Row indexes moved, rebuild it from the height_cache */
+		E_TABLE_ITEM_GET_PRIVATE (eti)->height_tree_valid = FALSE;
 	}
 
 	eti_unfreeze (eti);
@@ -1334,6 +1554,9 @@ eti_table_model_rows_deleted (ETableModel *table_model,
 		memmove (eti->height_cache + row, eti->height_cache + row + count, (eti->rows - row) * sizeof (gint));
 	}
 
+	/* Row indexes moved, rebuild it from the height_cache */
+	E_TABLE_ITEM_GET_PRIVATE (eti)->height_tree_valid = FALSE;
+
 	eti_unfreeze (eti);
 
 	eti_idle_maybe_show_cursor (eti);
@@ -1588,6 +1811,8 @@ eti_dispose (GObject *object)
 		g_free (eti->height_cache);
 	eti->height_cache = NULL;
 
+	height_tree_free (eti);
+
 	/* Chain up to parent's dispose() method. */
 	G_OBJECT_CLASS (e_table_item_parent_class)->dispose (object);
 }
@@ -1722,6 +1947,8 @@ eti_get_property (GObject *object,
 static void
 e_table_item_init (ETableItem *eti)
 {
+	ETableItemPrivate *priv = E_TABLE_ITEM_GET_PRIVATE (eti);
+
 	/* eti->priv = E_TABLE_ITEM_GET_PRIVATE (eti); */
 
 	eti->motion_row = -1;
@@ -1742,6 +1969,8 @@ e_table_item_init (ETableItem *eti)
 	eti->height_cache_idle_id = 0;
 	eti->height_cache_idle_count = 0;
 
+	priv->estimated_row_height = -1;
+
 	eti->length_threshold = -1;
 	eti->uniform_row_height = FALSE;
 
@@ -1865,6 +2094,8 @@ eti_unrealize (GnomeCanvasItem *item)
 	eti->height_cache = NULL;
 	eti->height_cache_idle_count = 0;
 
+	height_tree_free (eti);
+
 	eti_unrealize_cell_views (eti);
 
 	eti->height = 0;
@@ -1974,31 +2205,24 @@ eti_draw (GnomeCanvasItem *item,
 		if (last_row > eti->rows)
 			last_row = eti->rows;
 	} else {
-		gint y1, y2;
-
-		y_offset = 0;
-		first_row = -1;
-
-		y1 = y2 = floor (eti_base_y) + height_extra;
-		for (row = 0; row < rows; row++, y1 = y2) {
+		gint y1;
 
-			y2 += ETI_ROW_HEIGHT (eti, row) + height_extra;
-
-			if (y1 > y + height)
-				break;
+		first_row = height_tree_find (eti, y - floor (eti_base_y) - height_extra - 1);
+		if (first_row >= rows)
+			return;
 
-			if (y2 < y)
-				continue;
+		y1 = floor (eti_base_y) + height_extra + height_tree_prefix (eti, first_row);
+		y_offset = y1 - y;
 
-			if (first_row == -1) {
-				y_offset = y1 - y;
-				first_row = row;
-			}
+		/* Measures the drawn rows, which changes only
+		 * the offsets of the rows after them */
+		for (row = first_row; row < rows && y1 <= y + height; row++) {
+			y1 += ETI_ROW_HEIGHT (eti, row) + height_extra;
 		}
 		last_row = row;
 
-		if (first_row == -1)
-			return;
+		/* Prepare the rows around for scrolling */
+		eti_schedule_height_cache_idle (eti);
 	}
 
 	if (first_row == -1)
@@ -2229,7 +2453,7 @@ find_cell (ETableItem *eti,
 {
 	const gint cols = eti->cols;
 	const gint rows = eti->rows;
-	gdouble x1, y1, x2, y2;
+	gdouble x1, y1, x2;
 	gint col, row;
 
 	gint height_extra = eti->horizontal_draw_grid ? 1 : 0;
@@ -2268,18 +2492,14 @@ find_cell (ETableItem *eti,
 		if (row >= eti->rows)
 			return FALSE;
 	} else {
-		y1 = y2 = height_extra;
 		if (y < height_extra)
 			return FALSE;
-		for (row = 0; row < rows; row++, y1 = y2) {
-			y2 += ETI_ROW_HEIGHT (eti, row) + height_extra;
 
-			if (y <= y2)
-				break;
-		}
-
-		if (row == rows)
+		row = height_tree_find (eti, ceil (y) - height_extra - 1);
+		if (row >= rows)
 			return FALSE;
+
+		y1 = height_extra + height_tree_prefix (eti, row);
 	}
 	*view_col_res = col;
 	if (x1_res)
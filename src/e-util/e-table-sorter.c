@@ -22,11 +22,16 @@
 
 #include <glib/gi18n.h>
 
+#include "e-misc-utils.h"
 #include "e-table-sorter.h"
 #include "e-table-sorting-utils.h"
 
 #define d(x)
 
+/* Drop the cached collation keys when there are more of them than
+ * this many times the rows count, thus they do not grow indefinitely. */
+#define COLLATE_KEYS_MAX_RATIO 2
+
 enum {
 	PROP_0,
 	PROP_SORT_INFO
@@ -91,6 +96,378 @@ qsort_callback (gconstpointer data1,
 	return comp_val;
 }
 
+/* Rows count from which the sort is split between more threads */
+#define PARALLEL_SORT_MIN_ROWS 10000
+#define PARALLEL_SORT_MAX_THREADS 8
+
+/* Sort keys extracted from the column values, for the built-in compare
+ * functions. Columns with a custom compare function use qsort_callback(). */
+typedef enum {
+	SORT_KEY_CUSTOM,
+	SORT_KEY_INT,		/* "integer" */
+	SORT_KEY_STRING_INT,	/* "string-integer" */
+	SORT_KEY_INT64_PTR,	/* "pointer-integer64" */
+	SORT_KEY_STRING,	/* "string" */
+	SORT_KEY_COLLATE,	/* "collate" */
+	SORT_KEY_STRING_CASE	/* "stringcase" */
+} SortKeyKind;
+
+#define SORT_KEY_IS_NUMERIC(_kind) ((_kind) == SORT_KEY_INT || \
+	(_kind) == SORT_KEY_STRING_INT || (_kind) == SORT_KEY_INT64_PTR)
+
+typedef struct _SortKeyColumn {
+	SortKeyKind kind;
+	gboolean ascending;
+	gint64 *nums;	/* for numeric kinds, indexed by row */
+	gchar **strs;	/* for string kinds, indexed by row; not owned */
+} SortKeyColumn;
+
+typedef struct _SortKeys {
+	SortKeyColumn *columns;
+	gint n_columns;
+	gpointer *vals;	/* the qsort_data::vals */
+	GHashTable *collate_keys;
+	GHashTable *casefold_keys;
+} SortKeys;
+
+typedef struct _SortChunk {
+	SortKeys *keys;
+	gint *rows;
+	gint n_rows;
+} SortChunk;
+
+static SortKeyKind
+table_sorter_get_key_kind (ETableCol *col)
+{
+	const gchar *compare_id = col->spec->compare;
+
+	if (col->compare == (GCompareDataFunc) e_str_compare)
+		return SORT_KEY_STRING;
+
+	if (col->compare == (GCompareDataFunc) e_int_compare)
+		return SORT_KEY_INT;
+
+	/* The other built-in compare functions are private
+	 * to ETableExtras, thus recognize them by their ID. */
+	if (g_strcmp0 (compare_id, "collate") == 0)
+		return SORT_KEY_COLLATE;
+
+	if (g_strcmp0 (compare_id, "stringcase") == 0)
+		return SORT_KEY_STRING_CASE;
+
+	if (g_strcmp0 (compare_id, "string-integer") == 0)
+		return SORT_KEY_STRING_INT;
+
+	if (g_strcmp0 (compare_id, "pointer-integer64") == 0)
+		return SORT_KEY_INT64_PTR;
+
+	return SORT_KEY_CUSTOM;
+}
+
+/* Fills the keys of rows from @first_row to @first_row + @n_rows - 1;
+ * it does not touch the model, thus it can run in a dedicated thread. */
+static void
+sort_keys_extract (SortKeys *keys,
+                   gint first_row,
+                   gint n_rows)
+{
+	gint ii, jj;
+
+	for (jj = 0; jj < keys->n_columns; jj++) {
+		SortKeyColumn *column = &keys->columns[jj];
+
+		for (ii = first_row; ii < first_row + n_rows; ii++) {
+			gpointer value = keys->vals[ii * keys->n_columns + jj];
+
+			switch (column->kind) {
+			case SORT_KEY_INT:
+				column->nums[ii] = GPOINTER_TO_INT (value);
+				break;
+			case SORT_KEY_STRING_INT:
+				column->nums[ii] = value ? atoi (value) : 0;
+				break;
+			case SORT_KEY_INT64_PTR:
+				/* Unset values sort before set values */
+				column->nums[ii] = value ? *((gint64 *) value) : G_MININT64;
+				break;
+			case SORT_KEY_STRING:
+				column->strs[ii] = value;
+				break;
+			case SORT_KEY_COLLATE:
+				/* Keys found in the cache are already set */
+				if (value && !column->strs[ii])
+					column->strs[ii] = g_utf8_collate_key (value, -1);
+				break;
+			case SORT_KEY_STRING_CASE:
+				if (value && !column->strs[ii]) {
+					gchar *tmp = g_utf8_casefold (value, -1);
+					column->strs[ii] = g_utf8_collate_key (tmp, -1);
+					g_free (tmp);
+				}
+				break;
+			case SORT_KEY_CUSTOM:
+				g_warn_if_reached ();
+				break;
+			}
+		}
+	}
+}
+
+/* The same order as qsort_callback(), only on the extracted keys */
+static gint
+sort_keys_compare (gconstpointer data1,
+                   gconstpointer data2,
+                   gpointer user_data)
+{
+	SortKeys *keys = user_data;
+	gint row1 = *(gint *) data1;
+	gint row2 = *(gint *) data2;
+	gint jj;
+	gint comp_val = 0;
+	gboolean ascending = TRUE;
+
+	for (jj = 0; jj < keys->n_columns; jj++) {
+		SortKeyColumn *column = &keys->columns[jj];
+
+		if (SORT_KEY_IS_NUMERIC (column->kind)) {
+			gint64 num1 = column->nums[row1];
+			gint64 num2 = column->nums[row2];
+
+			comp_val = (num1 == num2) ? 0 : (num1 < num2) ? -1 : 1;
+		} else {
+			comp_val = e_str_compare (column->strs[row1], column->strs[row2]);
+		}
+
+		ascending = column->ascending;
+		if (comp_val != 0)
+			break;
+	}
+
+	if (comp_val == 0) {
+		if (row1 < row2)
+			comp_val = -1;
+		if (row1 > row2)
+			comp_val = 1;
+	}
+
+	if (!ascending)
+		comp_val = -comp_val;
+
+	return comp_val;
+}
+
+static gpointer
+sort_keys_sort_chunk_thread (gpointer user_data)
+{
+	SortChunk *chunk = user_data;
+
+	/* The rows are not sorted yet, thus the chunk
+	 * covers a continuous range of row indexes. */
+	sort_keys_extract (chunk->keys, chunk->rows[0], chunk->n_rows);
+
+	g_qsort_with_data (
+		chunk->rows, chunk->n_rows, sizeof (gint),
+		sort_keys_compare, chunk->keys);
+
+	return NULL;
+}
+
+static void
+sort_keys_merge (SortKeys *keys,
+                 const SortChunk *chunk1,
+                 const SortChunk *chunk2,
+                 gint *dest)
+{
+	gint ii = 0, jj = 0, kk = 0;
+
+	while (ii < chunk1->n_rows && jj < chunk2->n_rows) {
+		if (sort_keys_compare (&chunk1->rows[ii], &chunk2->rows[jj], keys) <= 0)
+			dest[kk++] = chunk1->rows[ii++];
+		else
+			dest[kk++] = chunk2->rows[jj++];
+	}
+
+	if (ii < chunk1->n_rows)
+		memcpy (dest + kk, chunk1->rows + ii, sizeof (gint) * (chunk1->n_rows - ii));
+	else if (jj < chunk2->n_rows)
+		memcpy (dest + kk, chunk2->rows + jj, sizeof (gint) * (chunk2->n_rows - jj));
+}
+
+/* Extracts the keys and sorts the identity permutation @rows with them.
+ * Large tables are split into chunks, which are keyed and sorted each
+ * in its own thread, then merged together in the calling thread. */
+static void
+sort_keys_sort (SortKeys *keys,
+                gint *rows,
+                gint n_rows)
+{
+	SortChunk *chunks;
+	GThread **threads;
+	gint *buffer, *src, *dest;
+	gint n_chunks, ii;
+
+	if (n_rows <= 0)
+		return;
+
+	n_chunks = 1;
+	if (n_rows >= PARALLEL_SORT_MIN_ROWS)
+		n_chunks = CLAMP (g_get_num_processors (), 1, PARALLEL_SORT_MAX_THREADS);
+
+	chunks = g_new0 (SortChunk, n_chunks);
+	threads = g_new0 (GThread *, n_chunks);
+
+	for (ii = 0; ii < n_chunks; ii++) {
+		gint first_row = (gint) (((gint64) n_rows) * ii / n_chunks);
+		gint last_row = (gint) (((gint64) n_rows) * (ii + 1) / n_chunks);
+
+		chunks[ii].keys = keys;
+		chunks[ii].rows = rows + first_row;
+		chunks[ii].n_rows = last_row - first_row;
+	}
+
+	/* The first chunk is sorted in this thread; when a thread cannot
+	 * be created, then its chunk is sorted in this thread as well. */
+	for (ii = 1; ii < n_chunks; ii++) {
+		threads[ii] = g_thread_try_new (
+			"e-table-sorter", sort_keys_sort_chunk_thread,
+			&chunks[ii], NULL);
+	}
+
+	sort_keys_sort_chunk_thread (&chunks[0]);
+
+	for (ii = 1; ii < n_chunks; ii++) {
+		if (threads[ii])
+			g_thread_join (threads[ii]);
+		else
+			sort_keys_sort_chunk_thread (&chunks[ii]);
+	}
+
+	buffer = n_chunks > 1 ? g_new (gint, n_rows) : NULL;
+	src = rows;
+	dest = buffer;
+
+	/* Merge the sorted chunks pairwise, until only one is left */
+	while (n_chunks > 1) {
+		gint n_merged = 0;
+
+		for (ii = 0; ii < n_chunks; ii += 2) {
+			gint *chunk_dest = dest + (chunks[ii].rows - src);
+
+			if (ii + 1 < n_chunks) {
+				sort_keys_merge (keys, &chunks[ii], &chunks[ii + 1], chunk_dest);
+				chunks[n_merged].n_rows = chunks[ii].n_rows + chunks[ii + 1].n_rows;
+			} else {
+				memcpy (chunk_dest, chunks[ii].rows, sizeof (gint) * chunks[ii].n_rows);
+				chunks[n_merged].n_rows = chunks[ii].n_rows;
+			}
+
+			chunks[n_merged].rows = chunk_dest;
+			n_merged++;
+		}
+
+		n_chunks = n_merged;
+		dest = src;
+		src = chunks[0].rows;
+	}
+
+	if (src != rows)
+		memcpy (rows, src, sizeof (gint) * n_rows);
+
+	g_free (buffer);
+	g_free (threads);
+	g_free (chunks);
+}
+
+static GHashTable *
+sort_keys_get_cache (SortKeys *keys,
+                     SortKeyColumn *column)
+{
+	if (column->kind == SORT_KEY_COLLATE)
+		return keys->collate_keys;
+
+	if (column->kind == SORT_KEY_STRING_CASE)
+		return keys->casefold_keys;
+
+	return NULL;
+}
+
+/* Sets collation keys already known from the previous sorts,
+ * thus sort_keys_extract() computes only the missing keys. */
+static void
+sort_keys_lookup_cached (SortKeys *keys,
+                         gint n_rows)
+{
+	guint hits = 0, misses = 0;
+	gint ii, jj;
+
+	for (jj = 0; jj < keys->n_columns; jj++) {
+		SortKeyColumn *column = &keys->columns[jj];
+		GHashTable *cache = sort_keys_get_cache (keys, column);
+
+		if (!cache)
+			continue;
+
+		for (ii = 0; ii < n_rows; ii++) {
+			const gchar *value = keys->vals[ii * keys->n_columns + jj];
+
+			if (!value)
+				continue;
+
+			column->strs[ii] = (gchar *) e_table_sorting_utils_lookup_cmp_cache (cache, value);
+
+			if (column->strs[ii])
+				hits++;
+			else
+				misses++;
+		}
+	}
+
+	if (hits || misses)
+		g_debug ("%s: %d rows, collation keys: %u hits, %u misses", G_STRFUNC, n_rows, hits, misses);
+}
+
+/* Moves the newly computed collation keys into the caches */
+static void
+sort_keys_store_cached (SortKeys *keys,
+                        gint n_rows)
+{
+	gint ii, jj;
+
+	for (jj = 0; jj < keys->n_columns; jj++) {
+		SortKeyColumn *column = &keys->columns[jj];
+		GHashTable *cache = sort_keys_get_cache (keys, column);
+
+		if (!cache)
+			continue;
+
+		for (ii = 0; ii < n_rows; ii++) {
+			const gchar *value = keys->vals[ii * keys->n_columns + jj];
+
+			/* The same value can be on more rows, then the last
+			 * key replaces (and frees) the previously stored. */
+			if (value && column->strs[ii] &&
+			    column->strs[ii] != e_table_sorting_utils_lookup_cmp_cache (cache, value))
+				e_table_sorting_utils_add_to_cmp_cache (cache, value, column->strs[ii]);
+		}
+	}
+}
+
+static void
+sort_keys_clear (SortKeys *keys)
+{
+	gint jj;
+
+	for (jj = 0; jj < keys->n_columns; jj++) {
+		SortKeyColumn *column = &keys->columns[jj];
+
+		g_free (column->strs);
+		g_free (column->nums);
+	}
+
+	g_free (keys->columns);
+	keys->columns = NULL;
+}
+
 static void
 table_sorter_clean (ETableSorter *table_sorter)
 {
@@ -111,7 +488,9 @@ table_sorter_sort (ETableSorter *table_sorter)
 	gint j;
 	gint cols;
 	gint group_cols;
+	gboolean use_keys = TRUE;
 	struct qsort_data qd;
+	SortKeys keys;
 
 	if (table_sorter->sorted)
 		return;
@@ -132,6 +511,24 @@ table_sorter_sort (ETableSorter *table_sorter)
 	qd.compare = g_new (GCompareDataFunc, cols);
 	qd.cmp_cache = e_table_sorting_utils_create_cmp_cache ();
 
+	if (!table_sorter->collate_keys)
+		table_sorter->collate_keys = e_table_sorting_utils_create_cmp_cache ();
+	if (!table_sorter->casefold_keys)
+		table_sorter->casefold_keys = e_table_sorting_utils_create_cmp_cache ();
+
+	/* The keys are stored by the value, thus they cannot be stale,
+	 * but values not in the model anymore can pile up over time. */
+	if (g_hash_table_size (table_sorter->collate_keys) > COLLATE_KEYS_MAX_RATIO * rows)
+		g_hash_table_remove_all (table_sorter->collate_keys);
+	if (g_hash_table_size (table_sorter->casefold_keys) > COLLATE_KEYS_MAX_RATIO * rows)
+		g_hash_table_remove_all (table_sorter->casefold_keys);
+
+	keys.columns = g_new0 (SortKeyColumn, cols);
+	keys.n_columns = cols;
+	keys.vals = qd.vals;
+	keys.collate_keys = table_sorter->collate_keys;
+	keys.casefold_keys = table_sorter->casefold_keys;
+
 	for (j = 0; j < cols; j++) {
 		ETableColumnSpecification *spec;
 		ETableCol *col;
@@ -163,9 +560,29 @@ table_sorter_sort (ETableSorter *table_sorter)
 
 		qd.compare[j] = col->compare;
 		qd.ascending[j] = (sort_type == GTK_SORT_ASCENDING);
+
+		keys.columns[j].kind = table_sorter_get_key_kind (col);
+		keys.columns[j].ascending = qd.ascending[j];
+
+		if (keys.columns[j].kind == SORT_KEY_CUSTOM)
+			use_keys = FALSE;
+		else if (SORT_KEY_IS_NUMERIC (keys.columns[j].kind))
+			keys.columns[j].nums = g_new (gint64, rows);
+		else
+			keys.columns[j].strs = g_new0 (gchar *, rows);
+	}
+
+	/* Custom compare functions can be called only from this thread
+	 * and only with the values, thus sort with them as before. */
+	if (use_keys) {
+		sort_keys_lookup_cached (&keys, rows);
+		sort_keys_sort (&keys, table_sorter->sorted, rows);
+		sort_keys_store_cached (&keys, rows);
+	} else {
+		g_qsort_with_data (table_sorter->sorted, rows, sizeof (gint), qsort_callback, &qd);
 	}
 
-	g_qsort_with_data (table_sorter->sorted, rows, sizeof (gint), qsort_callback, &qd);
+	sort_keys_clear (&keys);
 
 	for (j = 0; j < cols; j++) {
 		ETableColumnSpecification *spec;
@@ -380,6 +797,9 @@ table_sorter_dispose (GObject *object)
 	g_clear_object (&table_sorter->full_header);
 	g_clear_object (&table_sorter->source);
 
+	g_clear_pointer (&table_sorter->collate_keys, e_table_sorting_utils_free_cmp_cache);
+	g_clear_pointer (&table_sorter->casefold_keys, e_table_sorting_utils_free_cmp_cache);
+
 	table_sorter_clean (table_sorter);
 
 	/* Chain up to parent's dispose() method. */
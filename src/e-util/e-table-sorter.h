@@ -66,6 +66,11 @@ struct _ETableSorter {
 	gint *sorted;
 	gint *backsorted;
 
+	/* Collation keys of string values, kept between sorts;
+	 * created by e_table_sorting_utils_create_cmp_cache(). */
+	GHashTable *collate_keys;
+	GHashTable *casefold_keys;
+
 	gulong table_model_changed_id;
 	gulong table_model_row_changed_id;
 	gulong table_model_cell_changed_id;
@@ -189,6 +189,36 @@ get_node (ETreeTableAdapter *etta,
 	return (node_t *) gnode->data;
 }
 
+static ETableSortInfo *
+get_children_sort_info (ETreeTableAdapter *etta,
+                        GNode *gnode)
+{
+	gint ii, len;
+
+	if (!etta->priv->sort_children_ascending || !gnode->parent)
+		return etta->priv->sort_info;
+
+	if (etta->priv->children_sort_info)
+		return etta->priv->children_sort_info;
+
+	etta->priv->children_sort_info = e_table_sort_info_duplicate (etta->priv->sort_info);
+
+	len = e_table_sort_info_sorting_get_count (etta->priv->children_sort_info);
+
+	for (ii = 0; ii < len; ii++) {
+		ETableColumnSpecification *spec;
+		GtkSortType sort_type;
+
+		spec = e_table_sort_info_sorting_get_nth (etta->priv->children_sort_info, ii, &sort_type);
+		if (spec) {
+			if (sort_type == GTK_SORT_DESCENDING)
+				e_table_sort_info_sorting_set_nth (etta->priv->children_sort_info, ii, spec, GTK_SORT_ASCENDING);
+		}
+	}
+
+	return etta->priv->children_sort_info;
+}
+
 static void
 resort_node (ETreeTableAdapter *etta,
              GNode *gnode,
@@ -221,34 +251,10 @@ resort_node (ETreeTableAdapter *etta,
 		paths[i] = path;
 
 	if (count > 1 && sort_needed) {
-		ETableSortInfo *use_sort_info;
-
-		use_sort_info = etta->priv->sort_info;
-
-		if (etta->priv->sort_children_ascending && gnode->parent) {
-			if (!etta->priv->children_sort_info) {
-				gint len;
-
-				etta->priv->children_sort_info = e_table_sort_info_duplicate (etta->priv->sort_info);
-
-				len = e_table_sort_info_sorting_get_count (etta->priv->children_sort_info);
-
-				for (i = 0; i < len; i++) {
-					ETableColumnSpecification *spec;
-					GtkSortType sort_type;
-
-					spec = e_table_sort_info_sorting_get_nth (etta->priv->children_sort_info, i, &sort_type);
-					if (spec) {
-						if (sort_type == GTK_SORT_DESCENDING)
-							e_table_sort_info_sorting_set_nth (etta->priv->children_sort_info, i, spec, GTK_SORT_ASCENDING);
-					}
-				}
-			}
-
-			use_sort_info = etta->priv->children_sort_info;
-		}
-
-		e_table_sorting_utils_tree_sort (etta->priv->source_model, use_sort_info, etta->priv->header, paths, count);
+		e_table_sorting_utils_tree_sort (
+			etta->priv->source_model,
+			get_children_sort_info (etta, gnode),
+			etta->priv->header, paths, count);
 	}
 
 	prev = NULL;
@@ -272,6 +278,105 @@ resort_node (ETreeTableAdapter *etta,
 	g_free (paths);
 }
 
+/* Inserts @gnode among the children of @parent_gnode, which are expected
+ * to be sorted already, thus a binary search is enough to find its place,
+ * instead of resorting all the children again. */
+static void
+insert_sorted_gnode (ETreeTableAdapter *etta,
+                     GNode *parent_gnode,
+                     GNode *gnode)
+{
+	ETreeModel *source_model = etta->priv->source_model;
+	ETableSortInfo *sort_info;
+	ETableCol **cols;
+	GtkSortType *sort_types;
+	GNode **children, *child;
+	gpointer *values;
+	gpointer cmp_cache;
+	guint n_children, lo, hi;
+	gint ii, n_cols;
+
+	if (!etta->priv->sort_info || e_table_sort_info_sorting_get_count (etta->priv->sort_info) <= 0) {
+		/* Follow the source model order instead */
+		g_node_append (parent_gnode, gnode);
+		resort_node (etta, parent_gnode, FALSE);
+		return;
+	}
+
+	n_children = g_node_n_children (parent_gnode);
+	if (n_children == 0) {
+		g_node_append (parent_gnode, gnode);
+		return;
+	}
+
+	sort_info = get_children_sort_info (etta, parent_gnode);
+	n_cols = e_table_sort_info_sorting_get_count (sort_info);
+
+	cols = g_new (ETableCol *, n_cols);
+	sort_types = g_new (GtkSortType, n_cols);
+	values = g_new (gpointer, n_cols);
+
+	for (ii = 0; ii < n_cols; ii++) {
+		ETableColumnSpecification *spec;
+
+		spec = e_table_sort_info_sorting_get_nth (sort_info, ii, &sort_types[ii]);
+
+		cols[ii] = e_table_header_get_column_by_spec (etta->priv->header, spec);
+		if (!cols[ii]) {
+			gint last = e_table_header_count (etta->priv->header) - 1;
+			cols[ii] = e_table_header_get_column (etta->priv->header, last);
+		}
+
+		values[ii] = e_tree_model_sort_value_at (source_model, ((node_t *) gnode->data)->path, cols[ii]->spec->compare_col);
+	}
+
+	children = g_new (GNode *, n_children);
+	for (ii = 0, child = parent_gnode->children; child; child = child->next, ii++)
+		children[ii] = child;
+
+	cmp_cache = e_table_sorting_utils_create_cmp_cache ();
+
+	/* Look for the first child sorting after the new node, thus
+	 * the new node is placed after any children equal to it. */
+	lo = 0;
+	hi = n_children;
+
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+		ETreePath path = ((node_t *) children[mid]->data)->path;
+		gint cmp = 0;
+
+		for (ii = 0; ii < n_cols && cmp == 0; ii++) {
+			gpointer value;
+
+			value = e_tree_model_sort_value_at (source_model, path, cols[ii]->spec->compare_col);
+			cmp = (*cols[ii]->compare) (values[ii], value, cmp_cache);
+			e_tree_model_free_value (source_model, cols[ii]->spec->compare_col, value);
+
+			if (sort_types[ii] == GTK_SORT_DESCENDING)
+				cmp = -cmp;
+		}
+
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	g_node_insert_before (parent_gnode, lo < n_children ? children[lo] : NULL, gnode);
+
+	e_table_sorting_utils_free_cmp_cache (cmp_cache);
+
+	for (ii = 0; ii < n_cols; ii++) {
+		e_tree_model_free_value (source_model, cols[ii]->spec->compare_col, values[ii]);
+	}
+
+	g_free (children);
+	g_free (values);
+	g_free (sort_types);
+	g_free (cols);
+}
+
 static void
 kill_gnode (GNode *node,
             ETreeTableAdapter *etta)
@@ -355,7 +460,8 @@ delete_node (ETreeTableAdapter *etta,
 			e_table_model_row_changed (E_TABLE_MODEL (etta), parent_row);
 		}
 
-		resort_node (etta, parent_gnode, FALSE);
+		/* Removing a child doesn't change the order of its siblings,
+		 * thus there's no need to resort the parent node here. */
 	}
 
 	e_table_model_rows_deleted (E_TABLE_MODEL (etta), row, to_remove);
@@ -484,9 +590,8 @@ insert_node (ETreeTableAdapter *etta,
 	if (node->expanded)
 		node->num_visible_children = insert_children (etta, gnode);
 
-	g_node_append (parent_gnode, gnode);
+	insert_sorted_gnode (etta, parent_gnode, gnode);
 	update_child_counts (parent_gnode, node->num_visible_children + 1);
-	resort_node (etta, parent_gnode, FALSE);
 	resort_node (etta, gnode, TRUE);
 
 	size = node->num_visible_children + 1;
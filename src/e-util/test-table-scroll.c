@@ -0,0 +1,376 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Scrolls an ETable with a large synthetic model, repainting the visible
+ * part of the table after each step, and prints the frames per second.
+ * Usage:
+ *    test-table-scroll [N_ROWS [N_FRAMES]]
+ */
+
+#include "evolution-config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+#include <e-util/e-util.h>
+
+#define N_COLUMNS 4
+#define BOLD_COLUMN 3
+
+static const gchar *spec_xml =
+	"<ETableSpecification draw-grid=\"true\">\n"
+	"  <ETableColumn model_col=\"0\" _title=\"Subject\" expansion=\"3.0\" minimum_width=\"10\" resizable=\"true\" cell=\"bench-string\" compare=\"string\" priority=\"0\"/>\n"
+	"  <ETableColumn model_col=\"1\" _title=\"From\" expansion=\"2.0\" minimum_width=\"10\" resizable=\"true\" cell=\"bench-string\" compare=\"string\" priority=\"0\"/>\n"
+	"  <ETableColumn model_col=\"2\" _title=\"Date\" expansion=\"1.0\" minimum_width=\"10\" resizable=\"true\" cell=\"bench-string\" compare=\"string\" priority=\"0\"/>\n"
+	"  <ETableState>\n"
+	"    <column source=\"0\"/>\n"
+	"    <column source=\"1\"/>\n"
+	"    <column source=\"2\"/>\n"
+	"    <grouping></grouping>\n"
+	"  </ETableState>\n"
+	"</ETableSpecification>\n";
+
+static const gchar *words[] = {
+	"meeting", "report", "quarterly", "Re:", "Fwd:", "invoice", "the", "project",
+	"schedule", "update", "P\xc5\x99\xc3\xadli\xc5\xa1", "\xc5\xbelu\xc5\xa5ou\xc4\x8dk\xc3\xbd",
+	"review", "notes", "draft", "budget"
+};
+
+/* A read-only model of generated strings */
+
+typedef struct _BenchModel {
+	GObject parent;
+
+	gint n_rows;
+	gchar **values; /* n_rows * (N_COLUMNS - 1) */
+} BenchModel;
+
+typedef struct _BenchModelClass {
+	GObjectClass parent_class;
+} BenchModelClass;
+
+static GType bench_model_get_type (void);
+static void bench_model_table_model_init (ETableModelInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (BenchModel, bench_model, G_TYPE_OBJECT,
+	G_IMPLEMENT_INTERFACE (E_TYPE_TABLE_MODEL, bench_model_table_model_init))
+
+static void
+bench_model_finalize (GObject *object)
+{
+	BenchModel *model = (BenchModel *) object;
+	gint ii;
+
+	for (ii = 0; ii < model->n_rows * (N_COLUMNS - 1); ii++)
+		g_free (model->values[ii]);
+	g_free (model->values);
+
+	/* Chain up to parent's method. */
+	G_OBJECT_CLASS (bench_model_parent_class)->finalize (object);
+}
+
+static gint
+bench_model_column_count (ETableModel *table_model)
+{
+	return N_COLUMNS;
+}
+
+static gint
+bench_model_row_count (ETableModel *table_model)
+{
+	return ((BenchModel *) table_model)->n_rows;
+}
+
+static gpointer
+bench_model_value_at (ETableModel *table_model,
+                      gint col,
+                      gint row)
+{
+	BenchModel *model = (BenchModel *) table_model;
+
+	if (row < 0 || row >= model->n_rows || col < 0 || col >= N_COLUMNS)
+		return NULL;
+
+	if (col == BOLD_COLUMN)
+		return GINT_TO_POINTER ((row % 7) == 0);
+
+	return model->values[row * (N_COLUMNS - 1) + col];
+}
+
+static gboolean
+bench_model_is_cell_editable (ETableModel *table_model,
+                              gint col,
+                              gint row)
+{
+	return FALSE;
+}
+
+static gpointer
+bench_model_duplicate_value (ETableModel *table_model,
+                             gint col,
+                             gconstpointer value)
+{
+	if (col == BOLD_COLUMN)
+		return (gpointer) value;
+
+	return g_strdup (value);
+}
+
+static void
+bench_model_free_value (ETableModel *table_model,
+                        gint col,
+                        gpointer value)
+{
+	/* The values returned by value_at() are owned by the model */
+}
+
+static gpointer
+bench_model_initialize_value (ETableModel *table_model,
+                              gint col)
+{
+	return NULL;
+}
+
+static gboolean
+bench_model_value_is_empty (ETableModel *table_model,
+                            gint col,
+                            gconstpointer value)
+{
+	return col == BOLD_COLUMN || !value || !*((const gchar *) value);
+}
+
+static gchar *
+bench_model_value_to_string (ETableModel *table_model,
+                             gint col,
+                             gconstpointer value)
+{
+	if (col == BOLD_COLUMN)
+		return g_strdup (value ? "1" : "0");
+
+	return g_strdup (value);
+}
+
+static void
+bench_model_class_init (BenchModelClass *class)
+{
+	GObjectClass *object_class;
+
+	object_class = G_OBJECT_CLASS (class);
+	object_class->finalize = bench_model_finalize;
+}
+
+static void
+bench_model_table_model_init (ETableModelInterface *iface)
+{
+	iface->column_count = bench_model_column_count;
+	iface->row_count = bench_model_row_count;
+	iface->value_at = bench_model_value_at;
+	iface->is_cell_editable = bench_model_is_cell_editable;
+	iface->duplicate_value = bench_model_duplicate_value;
+	iface->free_value = bench_model_free_value;
+	iface->initialize_value = bench_model_initialize_value;
+	iface->value_is_empty = bench_model_value_is_empty;
+	iface->value_to_string = bench_model_value_to_string;
+}
+
+static void
+bench_model_init (BenchModel *model)
+{
+}
+
+static gchar *
+generate_sentence (GRand *rand,
+                   gint n_words)
+{
+	GString *str;
+	gint ii;
+
+	str = g_string_new ("");
+
+	for (ii = 0; ii < n_words; ii++) {
+		if (ii)
+			g_string_append_c (str, ' ');
+		g_string_append (str, words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))]);
+	}
+
+	return g_string_free (str, FALSE);
+}
+
+static ETableModel *
+bench_model_new (gint n_rows)
+{
+	BenchModel *model;
+	GRand *rand;
+	gint row;
+
+	model = g_object_new (bench_model_get_type (), NULL);
+	model->n_rows = n_rows;
+	model->values = g_new0 (gchar *, n_rows * (N_COLUMNS - 1));
+
+	rand = g_rand_new_with_seed (42);
+
+	for (row = 0; row < n_rows; row++) {
+		gchar **values = model->values + row * (N_COLUMNS - 1);
+
+		values[0] = generate_sentence (rand, g_rand_int_range (rand, 2, 12));
+		values[1] = generate_sentence (rand, 2);
+		values[2] = g_strdup_printf ("%02d/%02d/%04d %02d:%02d",
+			g_rand_int_range (rand, 1, 13), g_rand_int_range (rand, 1, 29),
+			g_rand_int_range (rand, 2000, 2018), g_rand_int_range (rand, 0, 24),
+			g_rand_int_range (rand, 0, 60));
+	}
+
+	g_rand_free (rand);
+
+	return E_TABLE_MODEL (model);
+}
+
+static void
+process_pending_events (void)
+{
+	while (gtk_events_pending ())
+		gtk_main_iteration ();
+}
+
+/* Paints the visible part of the table the same way it would be exposed */
+static void
+paint_frame (GtkWidget *canvas,
+             cairo_surface_t *surface)
+{
+	cairo_t *cr;
+
+	process_pending_events ();
+
+	cr = cairo_create (surface);
+	gtk_widget_draw (canvas, cr);
+	cairo_destroy (cr);
+}
+
+static gdouble
+scroll_table (GtkWidget *canvas,
+              cairo_surface_t *surface,
+              GtkAdjustment *adjustment,
+              gdouble step,
+              gint n_frames)
+{
+	gdouble value, upper;
+	gint64 started, elapsed;
+	gint frame;
+
+	gtk_adjustment_set_value (adjustment, gtk_adjustment_get_lower (adjustment));
+	paint_frame (canvas, surface);
+
+	started = g_get_monotonic_time ();
+
+	for (frame = 0; frame < n_frames; frame++) {
+		value = gtk_adjustment_get_value (adjustment) + step;
+		upper = gtk_adjustment_get_upper (adjustment) - gtk_adjustment_get_page_size (adjustment);
+
+		/* Bounce at the ends */
+		if (value > upper || value < gtk_adjustment_get_lower (adjustment))
+			step = -step;
+
+		gtk_adjustment_set_value (adjustment, gtk_adjustment_get_value (adjustment) + step);
+		paint_frame (canvas, surface);
+	}
+
+	elapsed = g_get_monotonic_time () - started;
+
+	return n_frames / (MAX (elapsed, 1) / (gdouble) G_USEC_PER_SEC);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	ETableSpecification *specification;
+	ETableExtras *extras;
+	ETableModel *model;
+	ECell *cell;
+	GtkWidget *window, *scrolled, *table, *canvas;
+	GtkAdjustment *adjustment;
+	GtkAllocation allocation;
+	cairo_surface_t *surface;
+	GError *local_error = NULL;
+	gchar *spec_filename;
+	gint n_rows, n_frames, fd;
+
+	gtk_init (&argc, &argv);
+
+	n_rows = argc > 1 ? MAX (1, atoi (argv[1])) : 100000;
+	n_frames = argc > 2 ? MAX (1, atoi (argv[2])) : 500;
+
+	fd = g_file_open_tmp ("test-table-scroll-XXXXXX.etspec", &spec_filename, &local_error);
+	if (fd != -1)
+		g_close (fd, NULL);
+
+	if (fd == -1 || !g_file_set_contents (spec_filename, spec_xml, -1, &local_error)) {
+		fprintf (stderr, "Failed to write table specification: %s\n", local_error ? local_error->message : "Unknown error");
+		return 1;
+	}
+
+	specification = e_table_specification_new (spec_filename, &local_error);
+	g_unlink (spec_filename);
+	g_free (spec_filename);
+
+	if (!specification) {
+		fprintf (stderr, "Failed to load table specification: %s\n", local_error ? local_error->message : "Unknown error");
+		return 1;
+	}
+
+	cell = e_cell_text_new (NULL, GTK_JUSTIFY_LEFT);
+	g_object_set (cell, "bold_column", BOLD_COLUMN, NULL);
+
+	extras = e_table_extras_new ();
+	e_table_extras_add_cell (extras, "bench-string", cell);
+	g_object_unref (cell);
+
+	model = bench_model_new (n_rows);
+
+	window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+	gtk_window_set_default_size (GTK_WINDOW (window), 800, 600);
+
+	scrolled = gtk_scrolled_window_new (NULL, NULL);
+	gtk_container_add (GTK_CONTAINER (window), scrolled);
+
+	table = e_table_new (model, extras, specification);
+	gtk_container_add (GTK_CONTAINER (scrolled), table);
+
+	gtk_widget_show_all (window);
+
+	/* Let the table compute its row heights and allocate */
+	process_pending_events ();
+
+	canvas = GTK_WIDGET (E_TABLE (table)->table_canvas);
+	adjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (canvas));
+
+	gtk_widget_get_allocation (canvas, &allocation);
+	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, allocation.width, allocation.height);
+
+	printf ("Rows: %d, frames: %d, viewport: %dx%d\n", n_rows, n_frames, allocation.width, allocation.height);
+	printf ("Line scroll: %.1f frames/s\n", scroll_table (canvas, surface, adjustment,
+		gtk_adjustment_get_step_increment (adjustment), n_frames));
+	printf ("Page scroll: %.1f frames/s\n", scroll_table (canvas, surface, adjustment,
+		gtk_adjustment_get_page_increment (adjustment), n_frames));
+
+	cairo_surface_destroy (surface);
+	gtk_widget_destroy (window);
+	g_object_unref (model);
+	g_object_unref (extras);
+	g_object_unref (specification);
+
+	return 0;
+}
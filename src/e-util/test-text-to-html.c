@@ -0,0 +1,133 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Converts a synthetic plain text mail into HTML, both at once and fed
+ * in chunks, verifies both give the same result and prints the throughput.
+ * Usage:
+ *    test-text-to-html [SIZE_IN_MB [CHUNK_SIZE]]
+ */
+
+#include "evolution-config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <e-util/e-util.h>
+
+#define N_ROUNDS 5
+
+static const gchar *lines[] = {
+	"Hello,\n",
+	"the quick brown fox jumps over the lazy dog & the <cat>, \"again\".\n",
+	"See http://www.example.com/path/index.html?a=1&b=2 for details.\n",
+	"Or www.example.org/wiki/Main_Page, or write to john.doe@example.com.\n",
+	"> On Monday, someone wrote:\n",
+	"> > nested citation with a link https://example.net/x-y_z.\n",
+	">From the mbox-mangled line\n",
+	"\tindented\twith  tabs   and  spaces\n",
+	"Non-ASCII: P\xc5\x99\xc3\xadli\xc5\xa1 \xc5\xbelu\xc5\xa5ou\xc4\x8dk\xc3\xbd k\xc5\xaf\xc5\x88.\n",
+	"\n"
+};
+
+static GString *
+generate_text (gsize size)
+{
+	GRand *rand;
+	GString *text;
+
+	rand = g_rand_new_with_seed (42);
+	text = g_string_sized_new (size + 256);
+
+	while (text->len < size)
+		g_string_append (text, lines[g_rand_int_range (rand, 0, G_N_ELEMENTS (lines))]);
+
+	g_rand_free (rand);
+
+	return text;
+}
+
+static gdouble
+megabytes_per_second (gsize size,
+                      gint64 elapsed)
+{
+	return (((gdouble) size) * N_ROUNDS / (1024.0 * 1024.0)) / (MAX (elapsed, 1) / (gdouble) G_USEC_PER_SEC);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	GString *text, *html, *streamed;
+	gsize size, chunk_size;
+	guint flags;
+	gint64 started, elapsed;
+	gint round;
+
+	size = (argc > 1 ? MAX (1, atoi (argv[1])) : 16) * 1024 * 1024;
+	chunk_size = argc > 2 ? MAX (1, atoi (argv[2])) : 4096;
+
+	flags = E_TEXT_TO_HTML_CONVERT_NL |
+		E_TEXT_TO_HTML_CONVERT_SPACES |
+		E_TEXT_TO_HTML_CONVERT_URLS |
+		E_TEXT_TO_HTML_CONVERT_ADDRESSES |
+		E_TEXT_TO_HTML_MARK_CITATION;
+
+	text = generate_text (size);
+	html = g_string_sized_new (text->len * 2);
+	streamed = g_string_sized_new (text->len * 2);
+
+	started = g_get_monotonic_time ();
+
+	for (round = 0; round < N_ROUNDS; round++) {
+		g_string_truncate (html, 0);
+		e_text_to_html_append (html, text->str, flags, 0x737373);
+	}
+
+	elapsed = g_get_monotonic_time () - started;
+
+	printf ("Whole text:  %" G_GSIZE_FORMAT " bytes into %" G_GSIZE_FORMAT " bytes, %.1f MB/s\n",
+		text->len, html->len, megabytes_per_second (text->len, elapsed));
+
+	started = g_get_monotonic_time ();
+
+	for (round = 0; round < N_ROUNDS; round++) {
+		ETextToHtml *converter;
+		gsize offset;
+
+		g_string_truncate (streamed, 0);
+
+		converter = e_text_to_html_new (streamed, flags, 0x737373);
+
+		for (offset = 0; offset < text->len; offset += chunk_size)
+			e_text_to_html_feed (converter, text->str + offset, MIN (chunk_size, text->len - offset));
+
+		e_text_to_html_finish (converter);
+	}
+
+	elapsed = g_get_monotonic_time () - started;
+
+	printf ("Chunks of %" G_GSIZE_FORMAT ": %" G_GSIZE_FORMAT " bytes into %" G_GSIZE_FORMAT " bytes, %.1f MB/s\n",
+		chunk_size, text->len, streamed->len, megabytes_per_second (text->len, elapsed));
+
+	if (!g_string_equal (html, streamed)) {
+		fprintf (stderr, "The streamed output differs from the whole text output\n");
+		return 1;
+	}
+
+	g_string_free (streamed, TRUE);
+	g_string_free (html, TRUE);
+	g_string_free (text, TRUE);
+
+	return 0;
+}
@@ -379,6 +379,30 @@ e_mail_formatter_constructed (GObject *object)
 	e_extensible_load_extensions (E_EXTENSIBLE (object));
 }
 
+/* Adds newly added parts of the context's part list into the queue and
+ * returns the link of the first of them, or NULL when there are none. */
+static GList *
+mail_formatter_wait_for_parts (EMailFormatterContext *context,
+                               GQueue *queue,
+                               guint *n_parts,
+                               GCancellable *cancellable)
+{
+	GList *tail;
+	guint n_added;
+
+	tail = g_queue_peek_tail_link (queue);
+
+	n_added = e_mail_part_list_wait_for_parts (
+		context->part_list, *n_parts, queue, cancellable);
+
+	if (n_added == 0)
+		return NULL;
+
+	*n_parts += n_added;
+
+	return tail != NULL ? g_list_next (tail) : g_queue_peek_head_link (queue);
+}
+
 static void
 mail_formatter_run (EMailFormatter *formatter,
                     EMailFormatterContext *context,
@@ -387,6 +411,7 @@ mail_formatter_run (EMailFormatter *formatter,
 {
 	GQueue queue = G_QUEUE_INIT;
 	GList *head, *link;
+	guint n_parts;
 	gchar *hdr;
 	const gchar *string;
 
@@ -395,11 +420,17 @@ mail_formatter_run (EMailFormatter *formatter,
 		stream, hdr, strlen (hdr), NULL, cancellable, NULL);
 	g_free (hdr);
 
-	e_mail_part_list_queue_parts (context->part_list, NULL, &queue);
+	n_parts = e_mail_part_list_queue_parts (context->part_list, NULL, &queue);
 
 	head = g_queue_peek_head_link (&queue);
 
-	for (link = head; link != NULL; link = g_list_next (link)) {
+	/* The part list can be still being filled by the parser,
+	 * see e_mail_parser_parse_streaming(), thus wait for more
+	 * parts when reaching the end of the known parts. */
+	for (link = head;
+	     link != NULL || (link = mail_formatter_wait_for_parts (
+		context, &queue, &n_parts, cancellable)) != NULL;
+	     link = g_list_next (link)) {
 		EMailPart *part = link->data;
 		const gchar *part_id;
 		gboolean ok;
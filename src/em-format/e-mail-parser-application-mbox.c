@@ -146,6 +146,7 @@ empe_app_mbox_parse (EMailParserExtension *extension,
 		}
 
 		empe_app_mbox_add_message (parser, message, messages, part_id, cancellable, out_mail_parts);
+		e_mail_parser_flush_parts (parser, out_mail_parts);
 		messages++;
 
 		g_object_unref (message);
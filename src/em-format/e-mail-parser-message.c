@@ -54,6 +54,7 @@ empe_message_parse (EMailParserExtension *extension,
 	CamelContentType *ct;
 	EMailPart *mail_part;
 	gchar *mime_type;
+	gboolean body_flushed;
 
 	/* Headers */
 	e_mail_parser_parse_part_as (
@@ -80,15 +81,20 @@ empe_message_parse (EMailParserExtension *extension,
 
 	/* Actual message body */
 
+	e_mail_parser_stream_into (parser, out_mail_parts, &work_queue);
+
 	e_mail_parser_parse_part_as (
 		parser, part, part_id, mime_type,
 		cancellable, &work_queue);
 
+	/* The body parts can be already in the part list, when streaming */
+	body_flushed = e_mail_parser_stream_done (parser, &work_queue, out_mail_parts);
+
 	/* If the EMailPart representing the message body is marked as an
 	 * attachment, wrap it as such so it gets added to the attachment
 	 * bar but also set the "force_inline" flag since it doesn't make
 	 * sense to collapse the message body if we can render it. */
-	mail_part = g_queue_peek_head (&work_queue);
+	mail_part = body_flushed ? NULL : g_queue_peek_head (&work_queue);
 	if (mail_part != NULL && !E_IS_MAIL_PART_ATTACHMENT (mail_part)) {
 		if (e_mail_part_get_is_attachment (mail_part)) {
 			e_mail_parser_wrap_as_attachment (
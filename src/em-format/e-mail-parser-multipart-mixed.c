@@ -229,6 +229,7 @@ empe_mp_mixed_parse (EMailParserExtension *extension,
 		}
 
 		e_queue_transfer (&work_queue, out_mail_parts);
+		e_mail_parser_flush_parts (parser, out_mail_parts);
 
 		g_string_truncate (part_id, len);
 
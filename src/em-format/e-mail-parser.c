@@ -78,9 +78,51 @@ GType e_mail_parser_application_smime_get_type (void);
 
 static gpointer parent_class;
 
+/* State of a streaming parse, see e_mail_parser_parse_streaming().
+ * It's set for the thread the parse runs in, thus the parser extensions
+ * do not need to know whether they are part of a streaming parse. */
+typedef struct _MailParserRun {
+	EMailParser *parser;
+	EMailPartList *part_list;
+	CamelInternetAddress *from_address;
+
+	/* The queue, from which the parts are added to the part_list
+	 * by e_mail_parser_flush_parts(); NULL to not stream anymore. */
+	GQueue *stream_queue;
+
+	/* Set by e_mail_parser_stream_into() */
+	GQueue *redirected_queue;
+	GQueue held_parts;
+	guint n_flushed;
+} MailParserRun;
+
+static GPrivate mail_parser_run_key;
+
+static MailParserRun *
+mail_parser_get_run (EMailParser *parser)
+{
+	MailParserRun *run;
+
+	run = g_private_get (&mail_parser_run_key);
+
+	if (run != NULL && run->parser == parser)
+		return run;
+
+	return NULL;
+}
+
+static void
+mail_parser_run_add_part (MailParserRun *run,
+                          EMailPart *mail_part)
+{
+	e_mail_part_verify_validity_sender (mail_part, run->from_address);
+	e_mail_part_list_add_part (run->part_list, mail_part);
+}
+
 static void
 mail_parser_run (EMailParser *parser,
                  EMailPartList *part_list,
+                 gboolean streaming,
                  GCancellable *cancellable)
 {
 	EMailExtensionRegistry *reg;
@@ -90,6 +132,8 @@ mail_parser_run (EMailParser *parser,
 	GQueue mail_part_queue = G_QUEUE_INIT;
 	GList *iter;
 	GString *part_id;
+	MailParserRun run = { NULL, };
+	gpointer previous_run = NULL;
 
 	message = e_mail_part_list_get_message (part_list);
 
@@ -112,6 +156,20 @@ mail_parser_run (EMailParser *parser,
 	e_mail_part_list_add_part (part_list, mail_part);
 	g_object_unref (mail_part);
 
+	/* The headers of the message are formatted before the body, thus
+	 * they could miss its security status, which is known only after
+	 * the secured part is parsed. Do not stream such messages. */
+	if (streaming && !e_mail_parser_has_secured_part (CAMEL_MIME_PART (message))) {
+		run.parser = parser;
+		run.part_list = part_list;
+		run.from_address = camel_mime_message_get_from (message);
+		run.stream_queue = &mail_part_queue;
+		g_queue_init (&run.held_parts);
+
+		previous_run = g_private_get (&mail_parser_run_key);
+		g_private_set (&mail_parser_run_key, &run);
+	}
+
 	for (iter = parsers->head; iter; iter = iter->next) {
 		EMailParserExtension *extension;
 		gboolean message_handled;
@@ -132,6 +190,14 @@ mail_parser_run (EMailParser *parser,
 			break;
 	}
 
+	if (run.parser != NULL) {
+		g_private_set (&mail_parser_run_key, previous_run);
+
+		/* Should be empty, unless an extension forgot
+		 * to call e_mail_parser_stream_done(). */
+		e_queue_transfer (&run.held_parts, &mail_part_queue);
+	}
+
 	while (!g_queue_is_empty (&mail_part_queue)) {
 		mail_part = g_queue_pop_head (&mail_part_queue);
 		e_mail_part_list_add_part (part_list, mail_part);
@@ -356,7 +422,7 @@ e_mail_parser_parse_sync (EMailParser *parser,
 
 	part_list = e_mail_part_list_new (message, message_uid, folder);
 
-	mail_parser_run (parser, part_list, cancellable);
+	mail_parser_run (parser, part_list, FALSE, cancellable);
 
 	if (camel_debug_start ("emformat:parser")) {
 		GQueue queue = G_QUEUE_INIT;
@@ -400,8 +466,55 @@ mail_parser_parse_thread (GSimpleAsyncResult *simple,
 	part_list = g_simple_async_result_get_op_res_gpointer (simple);
 
 	mail_parser_run (
-		E_MAIL_PARSER (source_object),
-		part_list, cancellable);
+		E_MAIL_PARSER (source_object), part_list,
+		e_mail_part_list_get_in_progress (part_list),
+		cancellable);
+
+	e_mail_part_list_set_in_progress (part_list, FALSE);
+}
+
+/* Also when the thread did not run at all, due to cancellation */
+static void
+mail_parser_part_list_done (EMailPartList *part_list)
+{
+	e_mail_part_list_set_in_progress (part_list, FALSE);
+	g_object_unref (part_list);
+}
+
+static EMailPartList *
+mail_parser_parse_in_thread (EMailParser *parser,
+                             CamelFolder *folder,
+                             const gchar *message_uid,
+                             CamelMimeMessage *message,
+                             gboolean streaming,
+                             GAsyncReadyCallback callback,
+                             GCancellable *cancellable,
+                             gpointer user_data)
+{
+	GSimpleAsyncResult *simple;
+	EMailPartList *part_list;
+
+	/* The caller gets one reference, the thread another one */
+	part_list = e_mail_part_list_new (message, message_uid, folder);
+	e_mail_part_list_set_in_progress (part_list, streaming);
+
+	simple = g_simple_async_result_new (
+		G_OBJECT (parser), callback,
+		user_data, e_mail_parser_parse);
+
+	g_simple_async_result_set_check_cancellable (simple, cancellable);
+
+	g_simple_async_result_set_op_res_gpointer (
+		simple, g_object_ref (part_list),
+		(GDestroyNotify) mail_parser_part_list_done);
+
+	g_simple_async_result_run_in_thread (
+		simple, mail_parser_parse_thread,
+		G_PRIORITY_DEFAULT, cancellable);
+
+	g_object_unref (simple);
+
+	return part_list;
 }
 
 /**
@@ -423,28 +536,61 @@ e_mail_parser_parse (EMailParser *parser,
                      GCancellable *cancellable,
                      gpointer user_data)
 {
-	GSimpleAsyncResult *simple;
 	EMailPartList *part_list;
 
 	g_return_if_fail (E_IS_MAIL_PARSER (parser));
 	g_return_if_fail (CAMEL_IS_MIME_MESSAGE (message));
 
-	part_list = e_mail_part_list_new (message, message_uid, folder);
+	part_list = mail_parser_parse_in_thread (
+		parser, folder, message_uid, message, FALSE,
+		callback, cancellable, user_data);
 
-	simple = g_simple_async_result_new (
-		G_OBJECT (parser), callback,
-		user_data, e_mail_parser_parse);
+	g_object_unref (part_list);
+}
 
-	g_simple_async_result_set_check_cancellable (simple, cancellable);
+/**
+ * e_mail_parser_parse_streaming:
+ * @parser: an #EMailParser
+ * @folder: (allow none) a #CamelFolder containing the @message or %NULL
+ * @message_uid: (allow none) UID of the @message within the @folder or %NULL
+ * @message: a #CamelMimeMessage
+ * @callback: a #GAsyncReadyCallback
+ * @cancellable: (allow-none) a #GCancellable
+ * @user_data: (allow-none) user data passed to the callback
+ *
+ * Similar to e_mail_parser_parse(), only returns the #EMailPartList
+ * immediately. The parts are added into it while the @message is being
+ * parsed: the headers together with the first part of the message body,
+ * then the other parts of a multipart/mixed, a digest or an mbox body,
+ * each as soon as it is parsed. The returned part list is in progress
+ * until the parsing is finished, thus e_mail_formatter_format_sync()
+ * can format it in another thread while it's being filled.
+ *
+ * Finish the call with e_mail_parser_parse_finish().
+ *
+ * Returns: (transfer full): an #EMailPartList being filled
+ *
+ * Since: 3.28
+ */
+EMailPartList *
+e_mail_parser_parse_streaming (EMailParser *parser,
+                               CamelFolder *folder,
+                               const gchar *message_uid,
+                               CamelMimeMessage *message,
+                               GAsyncReadyCallback callback,
+                               GCancellable *cancellable,
+                               gpointer user_data)
+{
+	EMailPartList *part_list;
 
-	g_simple_async_result_set_op_res_gpointer (
-		simple, part_list, (GDestroyNotify) g_object_unref);
+	g_return_val_if_fail (E_IS_MAIL_PARSER (parser), NULL);
+	g_return_val_if_fail (CAMEL_IS_MIME_MESSAGE (message), NULL);
 
-	g_simple_async_result_run_in_thread (
-		simple, mail_parser_parse_thread,
-		G_PRIORITY_DEFAULT, cancellable);
+	part_list = mail_parser_parse_in_thread (
+		parser, folder, message_uid, message, TRUE,
+		callback, cancellable, user_data);
 
-	g_object_unref (simple);
+	return part_list;
 }
 
 EMailPartList *
@@ -808,6 +954,206 @@ e_mail_parser_wrap_as_attachment (EMailParser *parser,
 	g_queue_push_head (parts_queue, empa);
 }
 
+/**
+ * e_mail_parser_stream_into:
+ * @parser: an #EMailParser
+ * @out_mail_parts: the queue the extension was asked to parse into
+ * @work_queue: a queue the extension parses the content into
+ *
+ * Used by the parser extensions, which parse the content of a part into
+ * the @work_queue and move the result into the @out_mail_parts only after
+ * it's post-processed. When the @out_mail_parts is being streamed into
+ * the part list (see e_mail_parser_parse_streaming()), the @work_queue
+ * is streamed instead, from now on until e_mail_parser_stream_done().
+ * The parts currently in the @out_mail_parts are held and added before
+ * the first part flushed from the @work_queue.
+ *
+ * The extension should not prepend parts into the @work_queue,
+ * except of wrapping the first part as an attachment.
+ *
+ * Does nothing when the @out_mail_parts is not being streamed.
+ *
+ * Since: 3.28
+ **/
+void
+e_mail_parser_stream_into (EMailParser *parser,
+                           GQueue *out_mail_parts,
+                           GQueue *work_queue)
+{
+	MailParserRun *run;
+
+	g_return_if_fail (E_IS_MAIL_PARSER (parser));
+	g_return_if_fail (out_mail_parts != NULL);
+	g_return_if_fail (work_queue != NULL);
+
+	run = mail_parser_get_run (parser);
+
+	if (run == NULL ||
+	    run->stream_queue != out_mail_parts ||
+	    run->redirected_queue != NULL)
+		return;
+
+	e_queue_transfer (out_mail_parts, &run->held_parts);
+
+	run->redirected_queue = out_mail_parts;
+	run->stream_queue = work_queue;
+	run->n_flushed = 0;
+}
+
+/**
+ * e_mail_parser_stream_done:
+ * @parser: an #EMailParser
+ * @work_queue: a queue previously passed to e_mail_parser_stream_into()
+ * @out_mail_parts: a queue previously passed to e_mail_parser_stream_into()
+ *
+ * Stops streaming of the @work_queue and returns the held parts into
+ * the @out_mail_parts. The parts remaining in the @work_queue are
+ * to be moved into the @out_mail_parts by the caller, as usual.
+ *
+ * Returns: whether any part of the @work_queue was already added into
+ *    the part list; the extension should not wrap the first part
+ *    of the @work_queue as an attachment in such case
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_mail_parser_stream_done (EMailParser *parser,
+                           GQueue *work_queue,
+                           GQueue *out_mail_parts)
+{
+	MailParserRun *run;
+	gboolean any_flushed;
+
+	g_return_val_if_fail (E_IS_MAIL_PARSER (parser), FALSE);
+	g_return_val_if_fail (work_queue != NULL, FALSE);
+	g_return_val_if_fail (out_mail_parts != NULL, FALSE);
+
+	run = mail_parser_get_run (parser);
+
+	if (run == NULL || run->redirected_queue != out_mail_parts)
+		return FALSE;
+
+	e_queue_transfer (&run->held_parts, out_mail_parts);
+
+	any_flushed = run->n_flushed > 0;
+
+	/* The rest is added at the end of the parse */
+	run->redirected_queue = NULL;
+	run->stream_queue = NULL;
+	run->n_flushed = 0;
+
+	return any_flushed;
+}
+
+/**
+ * e_mail_parser_flush_parts:
+ * @parser: an #EMailParser
+ * @mail_parts: a queue of complete #EMailPart<!-- -->s
+ *
+ * Used by the parser extensions producing many parts, like multipart/mixed
+ * or application/mbox, after each complete subpart is moved into
+ * the @mail_parts. When the @mail_parts is being streamed into the part
+ * list (see e_mail_parser_parse_streaming()), the parts are moved from
+ * the @mail_parts into the part list, thus they can be formatted while
+ * the rest of the message is still being parsed.
+ *
+ * Does nothing when the @mail_parts is not being streamed.
+ *
+ * Since: 3.28
+ **/
+void
+e_mail_parser_flush_parts (EMailParser *parser,
+                           GQueue *mail_parts)
+{
+	MailParserRun *run;
+	EMailPart *mail_part;
+
+	g_return_if_fail (E_IS_MAIL_PARSER (parser));
+	g_return_if_fail (mail_parts != NULL);
+
+	run = mail_parser_get_run (parser);
+
+	if (run == NULL || run->stream_queue != mail_parts ||
+	    g_queue_is_empty (mail_parts))
+		return;
+
+	if (run->n_flushed == 0) {
+		mail_part = g_queue_peek_head (mail_parts);
+
+		/* The first part can be wrapped as an attachment
+		 * only after all of the parts are parsed. */
+		if (run->redirected_queue != NULL &&
+		    e_mail_part_get_is_attachment (mail_part) &&
+		    !E_IS_MAIL_PART_ATTACHMENT (mail_part)) {
+			run->stream_queue = NULL;
+			return;
+		}
+
+		while ((mail_part = g_queue_pop_head (&run->held_parts)) != NULL) {
+			mail_parser_run_add_part (run, mail_part);
+			g_object_unref (mail_part);
+		}
+	}
+
+	while ((mail_part = g_queue_pop_head (mail_parts)) != NULL) {
+		mail_parser_run_add_part (run, mail_part);
+		g_object_unref (mail_part);
+		run->n_flushed++;
+	}
+}
+
+/**
+ * e_mail_parser_has_secured_part:
+ * @part: a #CamelMimePart
+ *
+ * Checks whether the @part or any of its subparts is signed or encrypted,
+ * thus its parsing would verify or decrypt it.
+ *
+ * Returns: whether the @part contains a signed or encrypted part
+ *
+ * Since: 3.28
+ */
+gboolean
+e_mail_parser_has_secured_part (CamelMimePart *part)
+{
+	g_return_val_if_fail (CAMEL_IS_MIME_PART (part), FALSE);
+
+	CamelDataWrapper *content;
+	CamelContentType *ct;
+
+	ct = camel_mime_part_get_content_type (part);
+
+	if (ct != NULL && (
+	    camel_content_type_is (ct, "multipart", "signed") ||
+	    camel_content_type_is (ct, "multipart", "encrypted") ||
+	    camel_content_type_is (ct, "application", "pkcs7-mime") ||
+	    camel_content_type_is (ct, "application", "x-pkcs7-mime") ||
+	    camel_content_type_is (ct, "application", "pgp-encrypted") ||
+	    camel_content_type_is (ct, "application", "pgp-signature")))
+		return TRUE;
+
+	content = camel_medium_get_content (CAMEL_MEDIUM (part));
+
+	if (CAMEL_IS_MULTIPART (content)) {
+		guint ii, n_parts;
+
+		n_parts = camel_multipart_get_number (CAMEL_MULTIPART (content));
+
+		for (ii = 0; ii < n_parts; ii++) {
+			CamelMimePart *subpart;
+
+			subpart = camel_multipart_get_part (CAMEL_MULTIPART (content), ii);
+
+			if (subpart && e_mail_parser_has_secured_part (subpart))
+				return TRUE;
+		}
+	} else if (CAMEL_IS_MIME_MESSAGE (content)) {
+		return e_mail_parser_has_secured_part (CAMEL_MIME_PART (content));
+	}
+
+	return FALSE;
+}
+
 CamelSession *
 e_mail_parser_get_session (EMailParser *parser)
 {
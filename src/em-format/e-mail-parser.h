@@ -75,6 +75,14 @@ void		e_mail_parser_parse		(EMailParser *parser,
 						 GCancellable *cancellable,
 						 gpointer user_data);
 
+EMailPartList *	e_mail_parser_parse_streaming	(EMailParser *parser,
+						 CamelFolder *folder,
+						 const gchar *message_uid,
+						 CamelMimeMessage *message,
+						 GAsyncReadyCallback callback,
+						 GCancellable *cancellable,
+						 gpointer user_data);
+
 EMailPartList *	e_mail_parser_parse_finish	(EMailParser *parser,
 						 GAsyncResult *result,
 						 GError **error);
@@ -108,6 +116,17 @@ void		e_mail_parser_wrap_as_attachment
 						 GString *part_id,
 						 GQueue *parts_queue);
 
+void		e_mail_parser_stream_into	(EMailParser *parser,
+						 GQueue *out_mail_parts,
+						 GQueue *work_queue);
+gboolean	e_mail_parser_stream_done	(EMailParser *parser,
+						 GQueue *work_queue,
+						 GQueue *out_mail_parts);
+void		e_mail_parser_flush_parts	(EMailParser *parser,
+						 GQueue *mail_parts);
+
+gboolean	e_mail_parser_has_secured_part	(CamelMimePart *part);
+
 CamelSession *	e_mail_parser_get_session	(EMailParser *parser);
 
 EMailExtensionRegistry *
@@ -30,6 +30,10 @@ struct _EMailPartListPrivate {
 
 	GQueue queue;
 	GMutex queue_lock;
+	GCond queue_cond;
+
+	/* Whether parts are still being added */
+	gboolean in_progress;
 };
 
 enum {
@@ -178,6 +182,7 @@ mail_part_list_finalize (GObject *object)
 
 	g_warn_if_fail (g_queue_is_empty (&priv->queue));
 	g_mutex_clear (&priv->queue_lock);
+	g_cond_clear (&priv->queue_cond);
 
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (e_mail_part_list_parent_class)->finalize (object);
@@ -239,6 +244,7 @@ e_mail_part_list_init (EMailPartList *part_list)
 	part_list->priv = E_MAIL_PART_LIST_GET_PRIVATE (part_list);
 
 	g_mutex_init (&part_list->priv->queue_lock);
+	g_cond_init (&part_list->priv->queue_cond);
 }
 
 EMailPartList *
@@ -296,6 +302,8 @@ e_mail_part_list_add_part (EMailPartList *part_list,
 		&part_list->priv->queue,
 		g_object_ref (part));
 
+	g_cond_broadcast (&part_list->priv->queue_cond);
+
 	g_mutex_unlock (&part_list->priv->queue_lock);
 
 	e_mail_part_set_part_list (part, part_list);
@@ -396,6 +404,125 @@ e_mail_part_list_queue_parts (EMailPartList *part_list,
 	return parts_queued;
 }
 
+static void
+mail_part_list_cancelled_cb (GCancellable *cancellable,
+                             EMailPartList *part_list)
+{
+	g_mutex_lock (&part_list->priv->queue_lock);
+	g_cond_broadcast (&part_list->priv->queue_cond);
+	g_mutex_unlock (&part_list->priv->queue_lock);
+}
+
+/**
+ * e_mail_part_list_wait_for_parts:
+ * @part_list: an #EMailPartList
+ * @n_known: how many parts the caller already knows of
+ * @result_queue: a #GQueue in which to deposit #EMailPart instances
+ * @cancellable: (allow-none): optional #GCancellable object, or %NULL
+ *
+ * Waits until the @part_list contains more than @n_known parts, or until
+ * it is no longer in progress (see e_mail_part_list_set_in_progress()),
+ * then populates @result_queue with the parts following the first
+ * @n_known parts. Returns immediately for a @part_list not in progress.
+ *
+ * Each #EMailPart is referenced for thread-safety and should be unreferenced
+ * with g_object_unref().
+ *
+ * Returns: the number of parts added to @result_queue; zero means there
+ *    will be no more parts, or the @cancellable was cancelled
+ *
+ * Since: 3.28
+ **/
+guint
+e_mail_part_list_wait_for_parts (EMailPartList *part_list,
+                                 guint n_known,
+                                 GQueue *result_queue,
+                                 GCancellable *cancellable)
+{
+	GList *link;
+	gulong handler_id = 0;
+	guint parts_queued = 0;
+
+	g_return_val_if_fail (E_IS_MAIL_PART_LIST (part_list), 0);
+	g_return_val_if_fail (result_queue != NULL, 0);
+
+	if (cancellable != NULL)
+		handler_id = g_cancellable_connect (
+			cancellable,
+			G_CALLBACK (mail_part_list_cancelled_cb),
+			part_list, NULL);
+
+	g_mutex_lock (&part_list->priv->queue_lock);
+
+	while (part_list->priv->in_progress &&
+	       g_queue_get_length (&part_list->priv->queue) <= n_known &&
+	       !g_cancellable_is_cancelled (cancellable)) {
+		g_cond_wait (
+			&part_list->priv->queue_cond,
+			&part_list->priv->queue_lock);
+	}
+
+	link = g_queue_peek_nth_link (&part_list->priv->queue, n_known);
+
+	for (; link != NULL; link = g_list_next (link)) {
+		g_queue_push_tail (result_queue, g_object_ref (link->data));
+		parts_queued++;
+	}
+
+	g_mutex_unlock (&part_list->priv->queue_lock);
+
+	if (handler_id > 0)
+		g_cancellable_disconnect (cancellable, handler_id);
+
+	return parts_queued;
+}
+
+/**
+ * e_mail_part_list_set_in_progress:
+ * @part_list: an #EMailPartList
+ * @in_progress: whether parts are still being added
+ *
+ * Marks the @part_list as being filled, which the parser does when
+ * parsing in a streaming mode, see e_mail_parser_parse_streaming().
+ * While it is in progress, e_mail_part_list_wait_for_parts() waits
+ * for newly added parts.
+ *
+ * Since: 3.28
+ **/
+void
+e_mail_part_list_set_in_progress (EMailPartList *part_list,
+                                  gboolean in_progress)
+{
+	g_return_if_fail (E_IS_MAIL_PART_LIST (part_list));
+
+	g_mutex_lock (&part_list->priv->queue_lock);
+	part_list->priv->in_progress = in_progress;
+	g_cond_broadcast (&part_list->priv->queue_cond);
+	g_mutex_unlock (&part_list->priv->queue_lock);
+}
+
+/**
+ * e_mail_part_list_get_in_progress:
+ * @part_list: an #EMailPartList
+ *
+ * Returns: whether parts are still being added into the @part_list
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_mail_part_list_get_in_progress (EMailPartList *part_list)
+{
+	gboolean in_progress;
+
+	g_return_val_if_fail (E_IS_MAIL_PART_LIST (part_list), FALSE);
+
+	g_mutex_lock (&part_list->priv->queue_lock);
+	in_progress = part_list->priv->in_progress;
+	g_mutex_unlock (&part_list->priv->queue_lock);
+
+	return in_progress;
+}
+
 /**
  * e_mail_part_list_is_empty:
  * @part_list: an #EMailPartList
@@ -72,6 +72,15 @@ guint		e_mail_part_list_queue_parts	(EMailPartList *part_list,
 						 const gchar *part_id,
 						 GQueue *result_queue);
 gboolean	e_mail_part_list_is_empty	(EMailPartList *part_list);
+guint		e_mail_part_list_wait_for_parts	(EMailPartList *part_list,
+						 guint n_known,
+						 GQueue *result_queue,
+						 GCancellable *cancellable);
+void		e_mail_part_list_set_in_progress
+						(EMailPartList *part_list,
+						 gboolean in_progress);
+gboolean	e_mail_part_list_get_in_progress
+						(EMailPartList *part_list);
 
 CamelObjectBag *
 		e_mail_part_list_get_registry	(void);
@@ -656,96 +656,250 @@ mail_folder_find_duplicate_messages_thread (GSimpleAsyncResult *simple,
 		g_simple_async_result_take_error (simple, error);
 }
 
-static GHashTable *
-emfu_get_messages_hash_sync (CamelFolder *folder,
-                             GPtrArray *message_uids,
+/* Maximum number of messages being retrieved at once, when looking for duplicates */
+#define EMFU_HASH_MAX_THREADS 4
+
+/* EMailDigestStream computes a digest of the data written to it, except of
+ * the trailing white-spaces and empty lines, without holding the whole data
+ * in memory. Only the white-spaces at the end of the data written so far are
+ * held, until it's known whether they are trailing or not. */
+
+typedef struct _EMailDigestStream {
+	GOutputStream parent;
+
+	GChecksum *checksum;
+	GByteArray *spaces;
+	gboolean has_data;
+} EMailDigestStream;
+
+typedef struct _EMailDigestStreamClass {
+	GOutputStreamClass parent_class;
+} EMailDigestStreamClass;
+
+static GType e_mail_digest_stream_get_type (void);
+
+G_DEFINE_TYPE (EMailDigestStream, e_mail_digest_stream, G_TYPE_OUTPUT_STREAM)
+
+static gssize
+mail_digest_stream_write_fn (GOutputStream *output_stream,
+                             gconstpointer buffer,
+                             gsize count,
                              GCancellable *cancellable,
                              GError **error)
 {
-	GHashTable *hash_table;
-	CamelMimeMessage *message;
-	guint ii;
+	EMailDigestStream *stream = (EMailDigestStream *) output_stream;
+	const guint8 *data = buffer;
+	gsize data_len = count;
 
-	g_return_val_if_fail (CAMEL_IS_FOLDER (folder), NULL);
-	g_return_val_if_fail (message_uids != NULL, NULL);
+	while (data_len > 0 && g_ascii_isspace (data[data_len - 1]))
+		data_len--;
 
-	camel_operation_push_message (
-		cancellable,
-		ngettext (
-			"Retrieving %d message",
-			"Retrieving %d messages",
-			message_uids->len),
-		message_uids->len);
+	if (data_len > 0) {
+		if (stream->spaces->len > 0) {
+			g_checksum_update (stream->checksum, stream->spaces->data, stream->spaces->len);
+			g_byte_array_set_size (stream->spaces, 0);
+		}
 
-	hash_table = g_hash_table_new_full (
-		(GHashFunc) g_str_hash,
-		(GEqualFunc) g_str_equal,
-		(GDestroyNotify) g_free,
-		(GDestroyNotify) g_free);
+		g_checksum_update (stream->checksum, data, data_len);
+		stream->has_data = TRUE;
+	}
 
-	/* This is an all or nothing operation.  Destroy the
-	 * hash table if we fail to retrieve any message. */
+	if (data_len < count)
+		g_byte_array_append (stream->spaces, data + data_len, count - data_len);
 
-	for (ii = 0; ii < message_uids->len; ii++) {
-		const gchar *uid;
-		gint percent;
+	return count;
+}
 
-		uid = g_ptr_array_index (message_uids, ii);
-		percent = ((ii + 1) * 100) / message_uids->len;
+static void
+mail_digest_stream_finalize (GObject *object)
+{
+	EMailDigestStream *stream = (EMailDigestStream *) object;
 
-		message = camel_folder_get_message_sync (
-			folder, uid, cancellable, error);
+	g_checksum_free (stream->checksum);
+	g_byte_array_unref (stream->spaces);
 
-		camel_operation_progress (cancellable, percent);
+	/* Chain up to parent's finalize() method. */
+	G_OBJECT_CLASS (e_mail_digest_stream_parent_class)->finalize (object);
+}
 
-		if (CAMEL_IS_MIME_MESSAGE (message)) {
-			CamelDataWrapper *content;
-			gchar *digest = NULL;
+static void
+e_mail_digest_stream_class_init (EMailDigestStreamClass *class)
+{
+	GObjectClass *object_class;
+	GOutputStreamClass *output_stream_class;
 
-			/* Generate a digest string from the message's content. */
-			content = camel_medium_get_content (CAMEL_MEDIUM (message));
+	object_class = G_OBJECT_CLASS (class);
+	object_class->finalize = mail_digest_stream_finalize;
 
-			if (content != NULL) {
-				CamelStream *stream;
-				GByteArray *buffer;
-				gssize n_bytes;
+	output_stream_class = G_OUTPUT_STREAM_CLASS (class);
+	output_stream_class->write_fn = mail_digest_stream_write_fn;
+}
 
-				stream = camel_stream_mem_new ();
+static void
+e_mail_digest_stream_init (EMailDigestStream *stream)
+{
+	stream->checksum = g_checksum_new (G_CHECKSUM_SHA256);
+	stream->spaces = g_byte_array_new ();
+}
 
-				n_bytes = camel_data_wrapper_decode_to_stream_sync (
-					content, stream, cancellable, error);
+/* Returns the digest of the message content, or NULL when it's empty */
+static gchar *
+emfu_get_message_digest_sync (CamelMimeMessage *message,
+                              GCancellable *cancellable,
+                              GError **error)
+{
+	CamelDataWrapper *content;
+	EMailDigestStream *stream;
+	gchar *digest = NULL;
 
-				if (n_bytes >= 0) {
-					guint data_len;
+	content = camel_medium_get_content (CAMEL_MEDIUM (message));
+	if (!content)
+		return NULL;
 
-					/* The CamelStreamMem owns the buffer. */
-					buffer = camel_stream_mem_get_byte_array (
-						CAMEL_STREAM_MEM (stream));
-					g_return_val_if_fail (buffer != NULL, NULL);
+	stream = g_object_new (e_mail_digest_stream_get_type (), NULL);
 
-					data_len = buffer->len;
+	if (camel_data_wrapper_decode_to_output_stream_sync (
+		content, G_OUTPUT_STREAM (stream), cancellable, error) >= 0 &&
+	    stream->has_data)
+		digest = g_strdup (g_checksum_get_string (stream->checksum));
 
-					/* Strip trailing white-spaces and empty lines */
-					while (data_len > 0 && g_ascii_isspace (buffer->data[data_len - 1]))
-						data_len--;
+	g_object_unref (stream);
 
-					if (data_len > 0)
-						digest = g_compute_checksum_for_data (G_CHECKSUM_SHA256, buffer->data, data_len);
-				}
+	return digest;
+}
 
-				g_object_unref (stream);
-			}
+typedef struct _MessagesHashData {
+	CamelFolder *folder;
+	GPtrArray *message_uids;
+	GCancellable *cancellable;
+	gchar **digests;	/* indexed as the message_uids */
 
-			g_hash_table_insert (
-				hash_table, g_strdup (uid), digest);
-			g_object_unref (message);
+	GMutex lock;
+	gboolean failed;
+	GError *error;		/* the first error */
+	gint n_done;
+} MessagesHashData;
+
+static void
+emfu_get_message_hash_thread (gpointer index_ptr,
+                              gpointer user_data)
+{
+	MessagesHashData *data = user_data;
+	CamelMimeMessage *message = NULL;
+	guint index = GPOINTER_TO_UINT (index_ptr) - 1;
+	gboolean failed;
+	GError *local_error = NULL;
+
+	g_mutex_lock (&data->lock);
+	failed = data->failed;
+	g_mutex_unlock (&data->lock);
+
+	/* This is an all or nothing operation, thus
+	 * skip the rest of the messages on failure. */
+	if (failed || g_cancellable_set_error_if_cancelled (data->cancellable, &local_error)) {
+		failed = TRUE;
+	} else {
+		message = camel_folder_get_message_sync (
+			data->folder, g_ptr_array_index (data->message_uids, index),
+			data->cancellable, &local_error);
+
+		if (CAMEL_IS_MIME_MESSAGE (message)) {
+			data->digests[index] = emfu_get_message_digest_sync (
+				message, data->cancellable, &local_error);
+			failed = local_error != NULL;
 		} else {
-			g_hash_table_destroy (hash_table);
-			hash_table = NULL;
-			break;
+			failed = TRUE;
+		}
+
+		camel_operation_progress (
+			data->cancellable,
+			(g_atomic_int_add (&data->n_done, 1) + 1) * 100 / data->message_uids->len);
+	}
+
+	if (failed) {
+		g_mutex_lock (&data->lock);
+		data->failed = TRUE;
+		if (local_error && !data->error) {
+			data->error = local_error;
+			local_error = NULL;
+		}
+		g_mutex_unlock (&data->lock);
+	}
+
+	g_clear_error (&local_error);
+	g_clear_object (&message);
+}
+
+static GHashTable *
+emfu_get_messages_hash_sync (CamelFolder *folder,
+                             GPtrArray *message_uids,
+                             GCancellable *cancellable,
+                             GError **error)
+{
+	MessagesHashData data;
+	GThreadPool *thread_pool;
+	GHashTable *hash_table = NULL;
+	guint ii;
+
+	g_return_val_if_fail (CAMEL_IS_FOLDER (folder), NULL);
+	g_return_val_if_fail (message_uids != NULL, NULL);
+
+	camel_operation_push_message (
+		cancellable,
+		ngettext (
+			"Retrieving %d message",
+			"Retrieving %d messages",
+			message_uids->len),
+		message_uids->len);
+
+	data.folder = folder;
+	data.message_uids = message_uids;
+	data.cancellable = cancellable;
+	data.digests = g_new0 (gchar *, message_uids->len);
+	data.failed = FALSE;
+	data.error = NULL;
+	data.n_done = 0;
+	g_mutex_init (&data.lock);
+
+	/* The messages are retrieved and digested in a few threads;
+	 * freeing the pool waits for all of them to be processed. */
+	if (message_uids->len > 0) {
+		thread_pool = g_thread_pool_new (
+			emfu_get_message_hash_thread, &data,
+			MIN (EMFU_HASH_MAX_THREADS, message_uids->len),
+			FALSE, NULL);
+
+		for (ii = 0; ii < message_uids->len; ii++)
+			g_thread_pool_push (thread_pool, GUINT_TO_POINTER (ii + 1), NULL);
+
+		g_thread_pool_free (thread_pool, FALSE, TRUE);
+	}
+
+	if (!data.failed) {
+		hash_table = g_hash_table_new_full (
+			(GHashFunc) g_str_hash,
+			(GEqualFunc) g_str_equal,
+			(GDestroyNotify) g_free,
+			(GDestroyNotify) g_free);
+
+		for (ii = 0; ii < message_uids->len; ii++) {
+			g_hash_table_insert (
+				hash_table,
+				g_strdup (g_ptr_array_index (message_uids, ii)),
+				data.digests[ii]);
+			data.digests[ii] = NULL;
 		}
+	} else if (data.error) {
+		g_propagate_error (error, data.error);
+		data.error = NULL;
 	}
 
+	/* Not a NULL-terminated array, failed messages leave holes in it */
+	for (ii = 0; ii < message_uids->len; ii++)
+		g_free (data.digests[ii]);
+	g_free (data.digests);
+	g_mutex_clear (&data.lock);
+
 	camel_operation_pop_message (cancellable);
 
 	return hash_table;
@@ -757,90 +911,134 @@ e_mail_folder_find_duplicate_messages_sync (CamelFolder *folder,
                                             GCancellable *cancellable,
                                             GError **error)
 {
-	GQueue trash = G_QUEUE_INIT;
 	GHashTable *hash_table;
-	GHashTable *unique_ids;
-	GHashTableIter iter;
-	gpointer key, value;
+	GHashTable *message_ids;
+	GHashTable *unique_digests;
+	GPtrArray *candidates;
+	GArray *candidate_ids;
+	guint ii, n_candidates;
 
 	g_return_val_if_fail (CAMEL_IS_FOLDER (folder), NULL);
 	g_return_val_if_fail (message_uids != NULL, NULL);
 
-	/* hash_table = { MessageUID : digest-as-string } */
-	hash_table = emfu_get_messages_hash_sync (
-		folder, message_uids, cancellable, error);
-
-	if (hash_table == NULL)
-		return NULL;
-
-	camel_operation_push_message (
-		cancellable, _("Scanning messages for duplicates"));
+	/* Only messages with the same Message-ID can be duplicates, thus
+	 * bucket the messages by the Message-ID from the summary first and
+	 * retrieve only those, which share the Message-ID with another one. */
 
-	unique_ids = g_hash_table_new_full (
+	/* message_ids = { Message-ID : [Message-ID, count] } */
+	message_ids = g_hash_table_new_full (
 		(GHashFunc) g_int64_hash,
 		(GEqualFunc) g_int64_equal,
 		(GDestroyNotify) g_free,
-		(GDestroyNotify) g_free);
+		(GDestroyNotify) NULL);
 
-	g_hash_table_iter_init (&iter, hash_table);
+	candidates = g_ptr_array_sized_new (message_uids->len);
+	candidate_ids = g_array_sized_new (FALSE, FALSE, sizeof (gint64), message_uids->len);
 
-	while (g_hash_table_iter_next (&iter, &key, &value)) {
-		CamelSummaryMessageID message_id;
-		CamelMessageFlags flags;
+	for (ii = 0; ii < message_uids->len; ii++) {
+		const gchar *uid = g_ptr_array_index (message_uids, ii);
 		CamelMessageInfo *info;
-		gboolean duplicate;
-		const gchar *digest;
+		gint64 message_id;
+		gint64 *v_int64;
 
-		info = camel_folder_get_message_info (folder, key);
+		info = camel_folder_get_message_info (folder, uid);
 		if (!info)
 			continue;
 
-		message_id.id.id = camel_message_info_get_message_id (info);
-		flags = camel_message_info_get_flags (info);
-
 		/* Skip messages marked for deletion. */
-		if (flags & CAMEL_MESSAGE_DELETED) {
-			g_queue_push_tail (&trash, key);
+		if (camel_message_info_get_flags (info) & CAMEL_MESSAGE_DELETED) {
 			g_clear_object (&info);
 			continue;
 		}
 
-		digest = value;
+		message_id = (gint64) camel_message_info_get_message_id (info);
 
-		if (digest == NULL) {
-			g_queue_push_tail (&trash, key);
-			g_clear_object (&info);
-			continue;
+		g_clear_object (&info);
+
+		v_int64 = g_hash_table_lookup (message_ids, &message_id);
+		if (v_int64 == NULL) {
+			v_int64 = g_new0 (gint64, 2);
+			v_int64[0] = message_id;
+			g_hash_table_insert (message_ids, v_int64, v_int64);
 		}
 
-		/* Determine if the message a duplicate. */
+		v_int64[1]++;
 
-		value = g_hash_table_lookup (unique_ids, &message_id.id.id);
-		duplicate = (value != NULL) && g_str_equal (digest, value);
+		g_ptr_array_add (candidates, (gpointer) uid);
+		g_array_append_val (candidate_ids, message_id);
+	}
 
-		if (!duplicate) {
-			gint64 *v_int64;
+	/* Keep only the messages with a shared Message-ID, in the original order */
+	for (ii = 0, n_candidates = 0; ii < candidates->len; ii++) {
+		gint64 message_id = g_array_index (candidate_ids, gint64, ii);
+		const gint64 *v_int64;
 
-			/* XXX Might be better to create a GArray
-			 *     of 64-bit integers and have the hash
-			 *     table keys point to array elements. */
-			v_int64 = g_new0 (gint64, 1);
-			*v_int64 = (gint64) message_id.id.id;
+		v_int64 = g_hash_table_lookup (message_ids, &message_id);
 
-			g_hash_table_insert (unique_ids, v_int64, g_strdup (digest));
-			g_queue_push_tail (&trash, key);
+		if (v_int64[1] > 1) {
+			candidates->pdata[n_candidates] = candidates->pdata[ii];
+			g_array_index (candidate_ids, gint64, n_candidates) = message_id;
+			n_candidates++;
 		}
+	}
 
-		g_clear_object (&info);
+	g_ptr_array_set_size (candidates, n_candidates);
+	g_array_set_size (candidate_ids, n_candidates);
+
+	g_hash_table_destroy (message_ids);
+
+	/* hash_table = { MessageUID : digest-as-string } */
+	hash_table = emfu_get_messages_hash_sync (
+		folder, candidates, cancellable, error);
+
+	if (hash_table == NULL) {
+		g_ptr_array_unref (candidates);
+		g_array_unref (candidate_ids);
+		return NULL;
 	}
 
-	/* Delete all non-duplicate messages from the hash table. */
-	while ((key = g_queue_pop_head (&trash)) != NULL)
-		g_hash_table_remove (hash_table, key);
+	camel_operation_push_message (
+		cancellable, _("Scanning messages for duplicates"));
+
+	/* unique_digests = { "Message-ID digest" : NULL } */
+	unique_digests = g_hash_table_new_full (
+		(GHashFunc) g_str_hash,
+		(GEqualFunc) g_str_equal,
+		(GDestroyNotify) g_free,
+		(GDestroyNotify) NULL);
+
+	/* The first message of each Message-ID and content is the original,
+	 * the following ones are duplicates; remove the originals, and the
+	 * messages without content, from the hash table. */
+	for (ii = 0; ii < candidates->len; ii++) {
+		const gchar *uid = g_ptr_array_index (candidates, ii);
+		const gchar *digest;
+		gchar *unique_key;
+
+		digest = g_hash_table_lookup (hash_table, uid);
+
+		if (digest == NULL) {
+			g_hash_table_remove (hash_table, uid);
+			continue;
+		}
+
+		unique_key = g_strdup_printf (
+			"%" G_GINT64_FORMAT " %s",
+			g_array_index (candidate_ids, gint64, ii), digest);
+
+		if (g_hash_table_contains (unique_digests, unique_key)) {
+			g_free (unique_key);
+		} else {
+			g_hash_table_add (unique_digests, unique_key);
+			g_hash_table_remove (hash_table, uid);
+		}
+	}
 
 	camel_operation_pop_message (cancellable);
 
-	g_hash_table_destroy (unique_ids);
+	g_hash_table_destroy (unique_digests);
+	g_ptr_array_unref (candidates);
+	g_array_unref (candidate_ids);
 
 	return hash_table;
 }
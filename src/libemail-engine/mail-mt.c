@@ -399,6 +399,7 @@ mail_msg_init (void)
 {
 	g_mutex_init (&mail_msg_lock);
 	g_cond_init (&mail_msg_cond);
+	g_mutex_init (&executor_lock);
 
 	main_loop_queue = g_async_queue_new ();
 	msg_reply_queue = g_async_queue_new ();
@@ -420,19 +421,254 @@ mail_msg_compare (const MailMsg *msg1,
 	return (priority1 < priority2) ? 1 : -1;
 }
 
-static gpointer
-create_thread_pool (gpointer data)
+/* All the messages pushed to the threads are run by one executor. Messages
+ * with the same order key (see mail_msg_ordered_push()) are run one after
+ * another in the order they were pushed, while messages with different keys
+ * and unordered messages are run concurrently. Any idle thread takes the next
+ * runnable unordered message with the highest priority, thus a lengthy
+ * operation on one account does not hold back operations on other accounts.
+ *
+ * The ordered messages run in their own threads, one per order key at most,
+ * thus they cannot be starved by the unordered messages, nor wait for a free
+ * thread while a message they depend on is queued behind them. */
+
+#define MAIL_MSG_MIN_THREADS 12
+#define MAIL_MSG_MAX_ORDER_KEYS 2
+
+typedef struct _MailMsgLane {
+	gconstpointer order_key;
+	GQueue jobs;		/* MailMsgJob, waiting for the first one */
+} MailMsgLane;
+
+typedef struct _MailMsgJob {
+	MailMsg *msg;
+	MailMsgLane *lanes[MAIL_MSG_MAX_ORDER_KEYS];	/* empty for unordered messages */
+	guint n_lanes;
+	guint n_lanes_waiting;	/* lanes this job is not the first in yet */
+	gint64 queued_time;
+} MailMsgJob;
+
+static GMutex executor_lock;
+static GThreadPool *executor_pool;		/* runs the unordered messages */
+static GThreadPool *executor_lanes_pool;	/* runs the ordered messages */
+static GQueue executor_ready = G_QUEUE_INIT;	/* unordered MailMsgJob, by priority */
+static GHashTable *executor_lanes;		/* order key ~> MailMsgLane */
+
+/* Statistics, see mail_msg_get_queue_stats() */
+static guint executor_n_queued;
+static guint executor_n_running;
+static guint64 executor_n_started;
+static gint64 executor_total_wait;
+static gint64 executor_max_wait;
+
+/* Must hold executor_lock to call this. */
+static void
+executor_ready_insert (MailMsgJob *job)
+{
+	GList *link;
+
+	/* Higher priority first, the same priority in the push order;
+	 * the most common case is to append with the default priority. */
+	for (link = executor_ready.tail; link; link = g_list_previous (link)) {
+		MailMsgJob *other = link->data;
+
+		if (other->msg->priority >= job->msg->priority)
+			break;
+	}
+
+	if (link)
+		g_queue_insert_after (&executor_ready, link, job);
+	else
+		g_queue_push_head (&executor_ready, job);
+}
+
+static void
+executor_run_job (MailMsgJob *job)
+{
+	GSList *ready_jobs = NULL, *link;
+	gint64 waited;
+	guint ii;
+
+	g_mutex_lock (&executor_lock);
+
+	waited = g_get_monotonic_time () - job->queued_time;
+
+	executor_n_queued--;
+	executor_n_running++;
+	executor_n_started++;
+	executor_total_wait += waited;
+	executor_max_wait = MAX (executor_max_wait, waited);
+
+	g_mutex_unlock (&executor_lock);
+
+	mail_msg_proxy (job->msg);
+
+	g_mutex_lock (&executor_lock);
+
+	executor_n_running--;
+
+	for (ii = 0; ii < job->n_lanes; ii++) {
+		MailMsgLane *lane = job->lanes[ii];
+		MailMsgJob *next_job;
+
+		next_job = g_queue_pop_head (&lane->jobs);
+
+		if (next_job) {
+			/* Runs once it is the first in all its lanes */
+			next_job->n_lanes_waiting--;
+
+			if (!next_job->n_lanes_waiting)
+				ready_jobs = g_slist_prepend (ready_jobs, next_job);
+		} else {
+			g_hash_table_remove (executor_lanes, lane->order_key);
+			g_slice_free (MailMsgLane, lane);
+		}
+	}
+
+	g_mutex_unlock (&executor_lock);
+
+	for (link = ready_jobs; link; link = g_slist_next (link))
+		g_thread_pool_push (executor_lanes_pool, link->data, NULL);
+
+	g_slist_free (ready_jobs);
+	g_slice_free (MailMsgJob, job);
+}
+
+static void
+executor_run (gpointer token,
+              gpointer user_data)
 {
-	GThreadPool *thread_pool;
-	gint max_threads = GPOINTER_TO_INT (data);
+	MailMsgJob *job;
+
+	g_mutex_lock (&executor_lock);
+
+	/* Each push to the pool is for one ready job, but the jobs are
+	 * taken in the priority order, not in the order of the pushes. */
+	job = g_queue_pop_head (&executor_ready);
 
+	g_mutex_unlock (&executor_lock);
+
+	if (!job) {
+		g_warn_if_reached ();
+		return;
+	}
+
+	executor_run_job (job);
+}
+
+static void
+executor_run_ordered (gpointer data,
+                      gpointer user_data)
+{
+	executor_run_job (data);
+}
+
+static gpointer
+create_executor (gpointer data)
+{
 	/* once created, run forever */
-	thread_pool = g_thread_pool_new (
-		(GFunc) mail_msg_proxy, NULL, max_threads, FALSE, NULL);
-	g_thread_pool_set_sort_function (
-		thread_pool, (GCompareDataFunc) mail_msg_compare, NULL);
+	executor_lanes = g_hash_table_new (g_direct_hash, g_direct_equal);
+	executor_pool = g_thread_pool_new (
+		executor_run, NULL,
+		MAX (MAIL_MSG_MIN_THREADS, g_get_num_processors ()),
+		FALSE, NULL);
 
-	return thread_pool;
+	/* Not limited, there is at most one message running per order key */
+	executor_lanes_pool = g_thread_pool_new (
+		executor_run_ordered, NULL, -1, FALSE, NULL);
+
+	return executor_pool;
+}
+
+static void
+executor_push (MailMsg *msg,
+               const gconstpointer *order_keys,
+               guint n_order_keys)
+{
+	static GOnce once = G_ONCE_INIT;
+	MailMsgJob *job;
+	guint ii;
+
+	g_return_if_fail (n_order_keys <= MAIL_MSG_MAX_ORDER_KEYS);
+
+	g_once (&once, (GThreadFunc) create_executor, NULL);
+
+	job = g_slice_new0 (MailMsgJob);
+	job->msg = msg;
+	job->queued_time = g_get_monotonic_time ();
+
+	g_mutex_lock (&executor_lock);
+
+	executor_n_queued++;
+
+	for (ii = 0; ii < n_order_keys; ii++) {
+		MailMsgLane *lane;
+
+		if (!order_keys[ii] || (ii == 1 && order_keys[1] == order_keys[0]))
+			continue;
+
+		lane = g_hash_table_lookup (executor_lanes, order_keys[ii]);
+
+		if (lane) {
+			/* Runs when the previous messages are done */
+			g_queue_push_tail (&lane->jobs, job);
+			job->n_lanes_waiting++;
+		} else {
+			lane = g_slice_new0 (MailMsgLane);
+			lane->order_key = order_keys[ii];
+			g_queue_init (&lane->jobs);
+
+			g_hash_table_insert (executor_lanes, (gpointer) order_keys[ii], lane);
+		}
+
+		job->lanes[job->n_lanes++] = lane;
+	}
+
+	if (!job->n_lanes)
+		executor_ready_insert (job);
+
+	g_mutex_unlock (&executor_lock);
+
+	if (!job->n_lanes)
+		g_thread_pool_push (executor_pool, GINT_TO_POINTER (1), NULL);
+	else if (!job->n_lanes_waiting)
+		g_thread_pool_push (executor_lanes_pool, job, NULL);
+}
+
+/**
+ * mail_msg_get_queue_stats:
+ * @out_n_queued: (out) (optional): number of messages waiting to be run
+ * @out_n_running: (out) (optional): number of messages being run
+ * @out_average_wait: (out) (optional): average time in microseconds
+ *    the messages waited to be run
+ * @out_max_wait: (out) (optional): the longest time in microseconds
+ *    a message waited to be run
+ *
+ * Returns counters of the messages pushed to the threads, with any of
+ * the mail_msg_unordered_push(), mail_msg_ordered_push(),
+ * mail_msg_fast_ordered_push() and mail_msg_slow_ordered_push().
+ **/
+void
+mail_msg_get_queue_stats (guint *out_n_queued,
+                          guint *out_n_running,
+                          gint64 *out_average_wait,
+                          gint64 *out_max_wait)
+{
+	g_mutex_lock (&executor_lock);
+
+	if (out_n_queued)
+		*out_n_queued = executor_n_queued;
+
+	if (out_n_running)
+		*out_n_running = executor_n_running;
+
+	if (out_average_wait)
+		*out_average_wait = executor_n_started ? executor_total_wait / (gint64) executor_n_started : 0;
+
+	if (out_max_wait)
+		*out_max_wait = executor_max_wait;
+
+	g_mutex_unlock (&executor_lock);
 }
 
 void
@@ -454,31 +690,70 @@ mail_msg_main_loop_push (gpointer msg)
 void
 mail_msg_unordered_push (gpointer msg)
 {
-	static GOnce once = G_ONCE_INIT;
+	executor_push (msg, NULL, 0);
+}
 
-	g_once (&once, (GThreadFunc) create_thread_pool, GINT_TO_POINTER (10));
+/**
+ * mail_msg_ordered_push:
+ * @msg: a #MailMsg
+ * @order_key: a key of the order, usually the #CamelStore the @msg works with
+ *
+ * Runs the @msg in a dedicated thread after all the messages previously
+ * pushed with the same @order_key are done. Messages with different keys
+ * can run at the same time. When the @order_key is %NULL, then it's
+ * the same as mail_msg_slow_ordered_push().
+ **/
+void
+mail_msg_ordered_push (gpointer msg,
+                       gconstpointer order_key)
+{
+	mail_msg_ordered_push_full (msg, order_key, NULL);
+}
 
-	g_thread_pool_push ((GThreadPool *) once.retval, msg, NULL);
+/**
+ * mail_msg_ordered_push_full:
+ * @msg: a #MailMsg
+ * @order_key: a key of the order, usually the #CamelStore the @msg works with
+ * @order_key2: (nullable): another key of the order, or %NULL
+ *
+ * The same as mail_msg_ordered_push(), only the @msg is ordered with
+ * the messages pushed with any of the two keys, like a transfer between
+ * two stores is ordered with the other operations on both of them.
+ **/
+void
+mail_msg_ordered_push_full (gpointer msg,
+                            gconstpointer order_key,
+                            gconstpointer order_key2)
+{
+	gconstpointer order_keys[MAIL_MSG_MAX_ORDER_KEYS];
+
+	if (!order_key && !order_key2) {
+		mail_msg_slow_ordered_push (msg);
+		return;
+	}
+
+	order_keys[0] = order_key;
+	order_keys[1] = order_key2;
+
+	executor_push (msg, order_keys, 2);
 }
 
 void
 mail_msg_fast_ordered_push (gpointer msg)
 {
-	static GOnce once = G_ONCE_INIT;
+	static const gchar fast_order_key = 'f';
+	gconstpointer order_key = &fast_order_key;
 
-	g_once (&once, (GThreadFunc) create_thread_pool, GINT_TO_POINTER (1));
-
-	g_thread_pool_push ((GThreadPool *) once.retval, msg, NULL);
+	executor_push (msg, &order_key, 1);
 }
 
 void
 mail_msg_slow_ordered_push (gpointer msg)
 {
-	static GOnce once = G_ONCE_INIT;
-
-	g_once (&once, (GThreadFunc) create_thread_pool, GINT_TO_POINTER (1));
+	static const gchar slow_order_key = 's';
+	gconstpointer order_key = &slow_order_key;
 
-	g_thread_pool_push ((GThreadPool *) once.retval, msg, NULL);
+	executor_push (msg, &order_key, 1);
 }
 
 gboolean
@@ -97,9 +97,17 @@ gboolean mail_msg_active (void);
 /* dispatch a message */
 void mail_msg_main_loop_push (gpointer msg);
 void mail_msg_unordered_push (gpointer msg);
+void mail_msg_ordered_push (gpointer msg, gconstpointer order_key);
+void mail_msg_ordered_push_full (gpointer msg, gconstpointer order_key, gconstpointer order_key2);
 void mail_msg_fast_ordered_push (gpointer msg);
 void mail_msg_slow_ordered_push (gpointer msg);
 
+/* counters of the messages pushed to the threads */
+void mail_msg_get_queue_stats (guint *out_n_queued,
+			       guint *out_n_running,
+			       gint64 *out_average_wait,
+			       gint64 *out_max_wait);
+
 /* Call a function in the GUI thread, wait for it to return, type is
  * the marshaller to use.  FIXME This thing is horrible, please put
  * it out of its misery. */
@@ -1268,6 +1268,7 @@ mail_transfer_messages (EMailSession *session,
                         gpointer data)
 {
 	struct _transfer_msg *m;
+	CamelStore *dest_store = NULL;
 
 	g_return_if_fail (CAMEL_IS_FOLDER (source));
 	g_return_if_fail (uids != NULL);
@@ -1283,7 +1284,13 @@ mail_transfer_messages (EMailSession *session,
 	m->done = done;
 	m->data = data;
 
-	mail_msg_slow_ordered_push (m);
+	/* Order with the operations on both stores; the destination store
+	 * is only used as the key, thus it is fine to unref it here. */
+	e_mail_folder_uri_parse (CAMEL_SESSION (session), dest_uri, &dest_store, NULL, NULL);
+
+	mail_msg_ordered_push_full (m, camel_folder_get_parent_store (source), dest_store);
+
+	g_clear_object (&dest_store);
 }
 
 /* ** SYNC FOLDER ********************************************************* */
@@ -1403,7 +1410,7 @@ mail_sync_folder (CamelFolder *folder,
 	m->data = data;
 	m->done = done;
 
-	mail_msg_slow_ordered_push (m);
+	mail_msg_ordered_push (m, camel_folder_get_parent_store (folder));
 }
 
 /* ** SYNC STORE ********************************************************* */
@@ -1484,7 +1491,7 @@ mail_sync_store (CamelStore *store,
 	m->data = data;
 	m->done = done;
 
-	mail_msg_slow_ordered_push (m);
+	mail_msg_ordered_push (m, store);
 }
 
 /* ******************************************************************************** */
@@ -1560,7 +1567,7 @@ mail_empty_trash (CamelStore *store)
 	m = mail_msg_new (&empty_trash_info);
 	m->store = g_object_ref (store);
 
-	mail_msg_slow_ordered_push (m);
+	mail_msg_ordered_push (m, store);
 }
 
 /* ** Execute Shell Command ************************************************ */
@@ -70,6 +70,7 @@ struct _AsyncContext {
 	gint filter_type;
 	gboolean replace;
 	gboolean keep_signature;
+	gboolean streaming;
 };
 
 static void
@@ -91,6 +92,26 @@ async_context_free (AsyncContext *async_context)
 	g_slice_free (AsyncContext, async_context);
 }
 
+/* The part list can be still filled by the streaming parse, see
+   e_mail_reader_parse_message_streaming(), while the caller needs
+   all the parts of the message */
+static void
+mail_reader_wait_for_part_list (EMailPartList *part_list,
+                                GCancellable *cancellable)
+{
+	guint n_known = 0;
+
+	while (e_mail_part_list_get_in_progress (part_list) &&
+	       !g_cancellable_is_cancelled (cancellable)) {
+		GQueue queue = G_QUEUE_INIT;
+
+		n_known += e_mail_part_list_wait_for_parts (part_list, n_known, &queue, cancellable);
+
+		while (!g_queue_is_empty (&queue))
+			g_object_unref (g_queue_pop_head (&queue));
+	}
+}
+
 static gboolean
 mail_reader_is_special_local_folder (const gchar *name)
 {
@@ -2642,6 +2663,8 @@ e_mail_reader_reply_to_message (EMailReader *reader,
 	} else {
 		GQueue queue = G_QUEUE_INIT;
 
+		mail_reader_wait_for_part_list (part_list, NULL);
+
 		e_mail_part_list_queue_parts (part_list, NULL, &queue);
 
 		while (!g_queue_is_empty (&queue)) {
@@ -3194,6 +3217,24 @@ e_mail_reader_create_vfolder_from_selected (EMailReader *reader,
 	g_ptr_array_unref (uids);
 }
 
+static void
+mail_reader_parse_message_streamed_cb (GObject *source_object,
+                                       GAsyncResult *result,
+                                       gpointer user_data)
+{
+	GCancellable *cancellable = user_data;
+	EMailPartList *part_list;
+
+	part_list = e_mail_parser_parse_finish (E_MAIL_PARSER (source_object), result, NULL);
+
+	/* Do not keep a partially parsed message in the registry */
+	if (g_cancellable_is_cancelled (cancellable))
+		camel_object_bag_remove (e_mail_part_list_get_registry (), part_list);
+
+	g_object_unref (part_list);
+	g_clear_object (&cancellable);
+}
+
 static void
 mail_reader_parse_message_run (GSimpleAsyncResult *simple,
                                GObject *object,
@@ -3225,12 +3266,23 @@ mail_reader_parse_message_run (GSimpleAsyncResult *simple,
 
 		parser = e_mail_parser_new (CAMEL_SESSION (mail_session));
 
-		part_list = e_mail_parser_parse_sync (
-			parser,
-			async_context->folder,
-			async_context->message_uid,
-			async_context->message,
-			cancellable);
+		if (async_context->streaming) {
+			part_list = e_mail_parser_parse_streaming (
+				parser,
+				async_context->folder,
+				async_context->message_uid,
+				async_context->message,
+				mail_reader_parse_message_streamed_cb,
+				cancellable,
+				cancellable ? g_object_ref (cancellable) : NULL);
+		} else {
+			part_list = e_mail_parser_parse_sync (
+				parser,
+				async_context->folder,
+				async_context->message_uid,
+				async_context->message,
+				cancellable);
+		}
 
 		g_object_unref (parser);
 
@@ -3238,6 +3290,8 @@ mail_reader_parse_message_run (GSimpleAsyncResult *simple,
 			camel_object_bag_abort (registry, mail_uri);
 		else
 			camel_object_bag_add (registry, mail_uri, part_list);
+	} else if (!async_context->streaming) {
+		mail_reader_wait_for_part_list (part_list, cancellable);
 	}
 
 	g_free (mail_uri);
@@ -3248,24 +3302,20 @@ mail_reader_parse_message_run (GSimpleAsyncResult *simple,
 		g_simple_async_result_take_error (simple, local_error);
 }
 
-void
-e_mail_reader_parse_message (EMailReader *reader,
-                             CamelFolder *folder,
-                             const gchar *message_uid,
-                             CamelMimeMessage *message,
-                             GCancellable *cancellable,
-                             GAsyncReadyCallback callback,
-                             gpointer user_data)
+static void
+mail_reader_parse_message_internal (EMailReader *reader,
+                                    CamelFolder *folder,
+                                    const gchar *message_uid,
+                                    CamelMimeMessage *message,
+                                    gboolean streaming,
+                                    GCancellable *cancellable,
+                                    GAsyncReadyCallback callback,
+                                    gpointer user_data)
 {
 	GSimpleAsyncResult *simple;
 	AsyncContext *async_context;
 	EActivity *activity;
 
-	g_return_if_fail (E_IS_MAIL_READER (reader));
-	g_return_if_fail (CAMEL_IS_FOLDER (folder));
-	g_return_if_fail (message_uid != NULL);
-	g_return_if_fail (CAMEL_IS_MIME_MESSAGE (message));
-
 	activity = e_mail_reader_new_activity (reader);
 	e_activity_set_cancellable (activity, cancellable);
 	e_activity_set_text (activity, _("Parsing message"));
@@ -3275,6 +3325,7 @@ e_mail_reader_parse_message (EMailReader *reader,
 	async_context->folder = g_object_ref (folder);
 	async_context->message_uid = g_strdup (message_uid);
 	async_context->message = g_object_ref (message);
+	async_context->streaming = streaming;
 
 	simple = g_simple_async_result_new (
 		G_OBJECT (reader), callback, user_data,
@@ -3293,6 +3344,48 @@ e_mail_reader_parse_message (EMailReader *reader,
 	g_object_unref (activity);
 }
 
+void
+e_mail_reader_parse_message (EMailReader *reader,
+                             CamelFolder *folder,
+                             const gchar *message_uid,
+                             CamelMimeMessage *message,
+                             GCancellable *cancellable,
+                             GAsyncReadyCallback callback,
+                             gpointer user_data)
+{
+	g_return_if_fail (E_IS_MAIL_READER (reader));
+	g_return_if_fail (CAMEL_IS_FOLDER (folder));
+	g_return_if_fail (message_uid != NULL);
+	g_return_if_fail (CAMEL_IS_MIME_MESSAGE (message));
+
+	mail_reader_parse_message_internal (
+		reader, folder, message_uid, message, FALSE,
+		cancellable, callback, user_data);
+}
+
+/* Similar to e_mail_reader_parse_message(), only the callback is called
+   as soon as the parsing starts, with the part list still being filled,
+   see e_mail_parser_parse_streaming(), thus the mail display can format
+   the message while it's being parsed. */
+void
+e_mail_reader_parse_message_streaming (EMailReader *reader,
+                                       CamelFolder *folder,
+                                       const gchar *message_uid,
+                                       CamelMimeMessage *message,
+                                       GCancellable *cancellable,
+                                       GAsyncReadyCallback callback,
+                                       gpointer user_data)
+{
+	g_return_if_fail (E_IS_MAIL_READER (reader));
+	g_return_if_fail (CAMEL_IS_FOLDER (folder));
+	g_return_if_fail (message_uid != NULL);
+	g_return_if_fail (CAMEL_IS_MIME_MESSAGE (message));
+
+	mail_reader_parse_message_internal (
+		reader, folder, message_uid, message, TRUE,
+		cancellable, callback, user_data);
+}
+
 EMailPartList *
 e_mail_reader_parse_message_finish (EMailReader *reader,
                                     GAsyncResult *result,
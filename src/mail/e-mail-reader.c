@@ -99,8 +99,27 @@ struct _EMailReaderPrivate {
 	gpointer remote_content_alert; /* EAlert */
 
 	gpointer followup_alert; /* weak pointer to an EAlert */
+
+	/* Messages adjacent to the displayed one, downloaded and parsed
+	 * in the background; see the "message-prefetch-count" setting. */
+	GCancellable *prefetch_cancellable;
+	GHashTable *prefetched; /* gchar *uid ~> EMailPartList *, NULL while in progress */
+	CamelFolder *prefetch_folder;
+	gchar *prefetch_last_uid;
+	gboolean prefetch_backward;
+	guint prefetch_hits;
+	guint prefetch_misses;
 };
 
+typedef struct _PrefetchData {
+	GWeakRef *reader_weak_ref;
+	GCancellable *cancellable;
+	EMailSession *session;
+	CamelFolder *folder;
+	gchar *message_uid;
+	EMailPartList *part_list;
+} PrefetchData;
+
 enum {
 	CHANGED,
 	COMPOSER_CREATED,
@@ -153,9 +172,283 @@ mail_reader_private_free (EMailReaderPrivate *priv)
 		priv->retrieving_message = 0;
 	}
 
+	if (priv->prefetch_cancellable != NULL) {
+		g_cancellable_cancel (priv->prefetch_cancellable);
+		g_clear_object (&priv->prefetch_cancellable);
+	}
+
+	if (priv->prefetched != NULL)
+		g_hash_table_destroy (priv->prefetched);
+
+	g_clear_object (&priv->prefetch_folder);
+	g_free (priv->prefetch_last_uid);
+
 	g_slice_free (EMailReaderPrivate, priv);
 }
 
+static void
+prefetch_part_list_unref (gpointer part_list)
+{
+	/* In-progress requests have no part list yet */
+	if (part_list)
+		g_object_unref (part_list);
+}
+
+static void
+prefetch_data_free (PrefetchData *pd)
+{
+	if (pd) {
+		e_weak_ref_free (pd->reader_weak_ref);
+		g_clear_object (&pd->cancellable);
+		g_clear_object (&pd->session);
+		g_clear_object (&pd->folder);
+		g_clear_object (&pd->part_list);
+		g_free (pd->message_uid);
+		g_slice_free (PrefetchData, pd);
+	}
+}
+
+static gboolean
+mail_reader_prefetch_done_cb (gpointer user_data)
+{
+	PrefetchData *pd = user_data;
+	EMailReader *reader;
+
+	reader = g_weak_ref_get (pd->reader_weak_ref);
+	if (reader) {
+		EMailReaderPrivate *priv;
+
+		priv = E_MAIL_READER_GET_PRIVATE (reader);
+
+		/* Store the result only when the request was not dropped
+		 * meanwhile, by a direction or folder change or by moving
+		 * out of the prefetch window. */
+		if (pd->cancellable == priv->prefetch_cancellable &&
+		    priv->prefetched != NULL &&
+		    g_hash_table_contains (priv->prefetched, pd->message_uid)) {
+			if (pd->part_list) {
+				g_hash_table_insert (priv->prefetched, g_strdup (pd->message_uid), pd->part_list);
+				pd->part_list = NULL;
+			} else {
+				g_hash_table_remove (priv->prefetched, pd->message_uid);
+			}
+		}
+
+		g_object_unref (reader);
+	}
+
+	prefetch_data_free (pd);
+
+	return FALSE;
+}
+
+static void
+mail_reader_prefetch_thread (gpointer data,
+                             gpointer user_data)
+{
+	PrefetchData *pd = data;
+
+	if (!g_cancellable_is_cancelled (pd->cancellable)) {
+		CamelObjectBag *registry;
+		EMailPartList *part_list;
+		gchar *mail_uri;
+
+		registry = e_mail_part_list_get_registry ();
+		mail_uri = e_mail_part_build_uri (pd->folder, pd->message_uid, NULL, NULL);
+
+		part_list = camel_object_bag_peek (registry, mail_uri);
+		if (!part_list) {
+			CamelMimeMessage *message;
+
+			/* This also stores the message in the offline cache
+			 * of the folder, if it has any. */
+			message = camel_folder_get_message_sync (pd->folder, pd->message_uid, pd->cancellable, NULL);
+
+			/* Only download signed and encrypted messages; parsing
+			 * would decrypt them, possibly asking for a passphrase,
+			 * for a message the user did not open. */
+			if (message && !e_mail_parser_has_secured_part (CAMEL_MIME_PART (message))) {
+				part_list = camel_object_bag_reserve (registry, mail_uri);
+				if (!part_list) {
+					EMailParser *parser;
+
+					parser = e_mail_parser_new (CAMEL_SESSION (pd->session));
+					part_list = e_mail_parser_parse_sync (parser, pd->folder, pd->message_uid, message, pd->cancellable);
+					g_object_unref (parser);
+
+					if (part_list && g_cancellable_is_cancelled (pd->cancellable))
+						g_clear_object (&part_list);
+
+					if (part_list == NULL)
+						camel_object_bag_abort (registry, mail_uri);
+					else
+						camel_object_bag_add (registry, mail_uri, part_list);
+				}
+			}
+
+			g_clear_object (&message);
+		}
+
+		pd->part_list = part_list;
+
+		g_free (mail_uri);
+	}
+
+	g_idle_add_full (G_PRIORITY_LOW, mail_reader_prefetch_done_cb, pd, NULL);
+}
+
+static void
+mail_reader_prefetch_reset (EMailReaderPrivate *priv)
+{
+	if (priv->prefetch_cancellable != NULL) {
+		g_cancellable_cancel (priv->prefetch_cancellable);
+		g_clear_object (&priv->prefetch_cancellable);
+	}
+
+	if (priv->prefetched != NULL)
+		g_hash_table_remove_all (priv->prefetched);
+
+	priv->prefetch_cancellable = g_cancellable_new ();
+}
+
+static gboolean
+mail_reader_prefetch_uids_contain (GPtrArray *uids,
+                                   const gchar *uid)
+{
+	guint ii;
+
+	for (ii = 0; uid && ii < uids->len; ii++) {
+		if (g_strcmp0 (g_ptr_array_index (uids, ii), uid) == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Downloads and parses the messages following the displayed one, in the
+ * direction the user moves through the message list, so that moving to
+ * them does not wait for the server or for the parser. Signed and encrypted
+ * messages are only downloaded. The parsed part lists are kept alive by
+ * the prefetched hash table, which is what makes the registry lookup
+ * in mail_reader_set_display_formatter_for_message() succeed. */
+static void
+mail_reader_prefetch_adjacent (EMailReader *reader,
+                               CamelFolder *folder,
+                               const gchar *message_uid)
+{
+	static GThreadPool *prefetch_pool = NULL;
+	G_LOCK_DEFINE_STATIC (prefetch_pool);
+	EMailReaderPrivate *priv;
+	EMailBackend *backend;
+	EMailSession *session;
+	MessageList *message_list;
+	GPtrArray *next_uids, *prev_uids, *uids;
+	GHashTableIter iter;
+	GSettings *settings;
+	gpointer key;
+	gboolean backward;
+	gint max_count;
+	guint ii;
+
+	priv = E_MAIL_READER_GET_PRIVATE (reader);
+
+	settings = e_util_ref_settings ("org.gnome.evolution.mail");
+	max_count = g_settings_get_int (settings, "message-prefetch-count");
+	g_object_unref (settings);
+
+	if (max_count <= 0) {
+		if (priv->prefetched != NULL) {
+			mail_reader_prefetch_reset (priv);
+			g_clear_pointer (&priv->prefetched, g_hash_table_destroy);
+			g_clear_object (&priv->prefetch_folder);
+			g_clear_pointer (&priv->prefetch_last_uid, g_free);
+		}
+
+		return;
+	}
+
+	message_list = MESSAGE_LIST (e_mail_reader_get_message_list (reader));
+
+	if (!folder || !message_uid || !message_list ||
+	    g_strcmp0 (message_list->cursor_uid, message_uid) != 0)
+		return;
+
+	if (priv->prefetched == NULL) {
+		priv->prefetched = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, prefetch_part_list_unref);
+		mail_reader_prefetch_reset (priv);
+	}
+
+	next_uids = message_list_get_adjacent_uids (message_list, MESSAGE_LIST_SELECT_NEXT, max_count);
+	prev_uids = message_list_get_adjacent_uids (message_list, MESSAGE_LIST_SELECT_PREVIOUS, max_count);
+
+	backward = priv->prefetch_backward;
+
+	if (folder != priv->prefetch_folder) {
+		mail_reader_prefetch_reset (priv);
+		g_clear_object (&priv->prefetch_folder);
+		priv->prefetch_folder = g_object_ref (folder);
+		backward = FALSE;
+	} else if (priv->prefetch_last_uid) {
+		/* The previously displayed message is behind the user when
+		 * moving forward; when it cannot be found in either window,
+		 * the user jumped and the direction is kept. */
+		if (mail_reader_prefetch_uids_contain (prev_uids, priv->prefetch_last_uid))
+			backward = FALSE;
+		else if (mail_reader_prefetch_uids_contain (next_uids, priv->prefetch_last_uid))
+			backward = TRUE;
+
+		if (backward != priv->prefetch_backward)
+			mail_reader_prefetch_reset (priv);
+	}
+
+	priv->prefetch_backward = backward;
+
+	g_free (priv->prefetch_last_uid);
+	priv->prefetch_last_uid = g_strdup (message_uid);
+
+	uids = backward ? prev_uids : next_uids;
+
+	/* Release what fell out of the window; the displayed message
+	 * is referenced by the EMailDisplay already. */
+	g_hash_table_iter_init (&iter, priv->prefetched);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		if (!mail_reader_prefetch_uids_contain (uids, key))
+			g_hash_table_iter_remove (&iter);
+	}
+
+	backend = e_mail_reader_get_backend (reader);
+	session = e_mail_backend_get_session (backend);
+
+	for (ii = 0; ii < uids->len; ii++) {
+		const gchar *uid = g_ptr_array_index (uids, ii);
+		PrefetchData *pd;
+
+		if (g_hash_table_contains (priv->prefetched, uid))
+			continue;
+
+		g_hash_table_insert (priv->prefetched, g_strdup (uid), NULL);
+
+		pd = g_slice_new0 (PrefetchData);
+		pd->reader_weak_ref = e_weak_ref_new (reader);
+		pd->cancellable = g_object_ref (priv->prefetch_cancellable);
+		pd->session = g_object_ref (session);
+		pd->folder = g_object_ref (folder);
+		pd->message_uid = g_strdup (uid);
+
+		/* A single thread, thus the prefetch does not compete with
+		 * the retrieval of the message the user actually asked for
+		 * more than necessary, and the nearest messages come first. */
+		G_LOCK (prefetch_pool);
+		if (!prefetch_pool)
+			prefetch_pool = g_thread_pool_new (mail_reader_prefetch_thread, NULL, 1, FALSE, NULL);
+		g_thread_pool_push (prefetch_pool, pd, NULL);
+		G_UNLOCK (prefetch_pool);
+	}
+
+	g_ptr_array_unref (next_uids);
+	g_ptr_array_unref (prev_uids);
+}
+
 static void
 action_mail_add_sender_cb (GtkAction *action,
                            EMailReader *reader)
@@ -3483,6 +3776,13 @@ mail_reader_set_folder (EMailReader *reader,
 		if (CAMEL_IS_VEE_FOLDER (folder))
 			mail_sync_folder (folder, FALSE, NULL, NULL);
 
+		/* Messages prefetched from the previous folder are not needed anymore */
+		if (priv->prefetched != NULL) {
+			mail_reader_prefetch_reset (priv);
+			g_clear_object (&priv->prefetch_folder);
+			g_clear_pointer (&priv->prefetch_last_uid, g_free);
+		}
+
 		message_list_set_folder (MESSAGE_LIST (message_list), folder);
 
 		mail_reader_emit_folder_loaded (reader);
@@ -3566,8 +3866,26 @@ mail_reader_set_display_formatter_for_message (EMailReader *reader,
 	parts = camel_object_bag_peek (registry, mail_uri);
 	g_free (mail_uri);
 
+	if (priv->prefetched != NULL) {
+		gboolean hit;
+
+		hit = parts != NULL && g_hash_table_lookup (priv->prefetched, message_uid) != NULL;
+
+		if (hit)
+			priv->prefetch_hits++;
+		else
+			priv->prefetch_misses++;
+
+		if (camel_debug_start ("prefetch")) {
+			printf ("%s: %s '%s', hits:%u misses:%u\n", G_STRFUNC, hit ? "hit" : "miss",
+				message_uid, priv->prefetch_hits, priv->prefetch_misses);
+			camel_debug_end ();
+		}
+	}
+
 	if (parts == NULL) {
-		e_mail_reader_parse_message (
+		/* Formats the parts as they are parsed */
+		e_mail_reader_parse_message_streaming (
 			reader, folder, message_uid, message,
 			priv->retrieving_message,
 			set_mail_display_part_list, NULL);
@@ -3620,6 +3938,9 @@ mail_reader_message_loaded (EMailReader *reader,
 	mail_reader_set_display_formatter_for_message (
 		reader, display, message_uid, message, folder);
 
+	if (message != NULL)
+		mail_reader_prefetch_adjacent (reader, folder, message_uid);
+
 	/* Reset the shell view icon. */
 	e_shell_event (shell, "mail-icon", (gpointer) "evolution-mail");
 
@@ -5173,6 +5494,37 @@ e_mail_reader_set_delete_selects_previous (EMailReader *reader,
 	g_object_notify (G_OBJECT (reader), "delete-selects-previous");
 }
 
+/**
+ * e_mail_reader_get_prefetch_stats:
+ * @reader: an #EMailReader
+ * @out_hits: (out) (optional): return location for the number of hits, or %NULL
+ * @out_misses: (out) (optional): return location for the number of misses, or %NULL
+ *
+ * Returns how many of the messages displayed in the @reader had been
+ * already prefetched (hits) and how many had not (misses), while the
+ * "message-prefetch-count" setting was non-zero. Use it to tune
+ * the setting.
+ *
+ * Since: 3.28
+ **/
+void
+e_mail_reader_get_prefetch_stats (EMailReader *reader,
+                                  guint *out_hits,
+                                  guint *out_misses)
+{
+	EMailReaderPrivate *priv;
+
+	g_return_if_fail (E_IS_MAIL_READER (reader));
+
+	priv = E_MAIL_READER_GET_PRIVATE (reader);
+
+	if (out_hits)
+		*out_hits = priv->prefetch_hits;
+
+	if (out_misses)
+		*out_misses = priv->prefetch_misses;
+}
+
 void
 e_mail_reader_create_charset_menu (EMailReader *reader,
                                    GtkUIManager *ui_manager,
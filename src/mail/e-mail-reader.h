@@ -185,6 +185,10 @@ gboolean	e_mail_reader_get_delete_selects_previous
 void		e_mail_reader_set_delete_selects_previous
 						(EMailReader *reader,
 						 gboolean delete_selects_previous);
+void		e_mail_reader_get_prefetch_stats
+						(EMailReader *reader,
+						 guint *out_hits,
+						 guint *out_misses);
 void		e_mail_reader_create_charset_menu
 						(EMailReader *reader,
 						 GtkUIManager *ui_manager,
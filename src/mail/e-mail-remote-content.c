@@ -27,92 +27,35 @@
 
 #define CURRENT_VERSION 1
 
-#define RECENT_CACHE_SIZE 10
-
-typedef struct _RecentData {
-	gchar *value;
-	gboolean result;
-} RecentData;
-
 struct _EMailRemoteContentPrivate {
 	CamelDB *db;
 
-	GMutex recent_lock;
-	RecentData recent_mails[RECENT_CACHE_SIZE];
-	RecentData recent_sites[RECENT_CACHE_SIZE];
-	guint recent_last_mails;
-	guint recent_last_sites;
+	/* The whole content of the tables, with case-folded values as keys.
+	   The database is only written to, it's never queried after load. */
+	GRWLock lock;
+	GHashTable *sites;
+	GHashTable *mails;
 };
 
 G_DEFINE_TYPE (EMailRemoteContent, e_mail_remote_content, G_TYPE_OBJECT)
 
-static void
-e_mail_remote_content_add_to_recent_cache (EMailRemoteContent *content,
-					   const gchar *value,
-					   gboolean result,
-					   RecentData *recent_cache,
-					   guint *recent_last)
-{
-	gint ii, first_free = -1, index;
-
-	g_return_if_fail (E_IS_MAIL_REMOTE_CONTENT (content));
-	g_return_if_fail (value != NULL);
-	g_return_if_fail (recent_cache != NULL);
-	g_return_if_fail (recent_last != NULL);
-
-	g_mutex_lock (&content->priv->recent_lock);
-
-	for (ii = 0; ii < RECENT_CACHE_SIZE; ii++) {
-		index = (*recent_last + ii) % RECENT_CACHE_SIZE;
-
-		if (!recent_cache[index].value) {
-			if (first_free == -1)
-				first_free = index;
-		} else if (g_ascii_strcasecmp (recent_cache[index].value, value) == 0) {
-			recent_cache[index].result = result;
-			break;
-		}
-	}
-
-	if (ii == RECENT_CACHE_SIZE) {
-		if (first_free != -1) {
-			g_warn_if_fail (recent_cache[first_free].value == NULL);
-			recent_cache[first_free].value = g_strdup (value);
-			recent_cache[first_free].result = result;
-
-			if (first_free == (*recent_last + 1) % RECENT_CACHE_SIZE)
-				*recent_last = first_free;
-		} else {
-			index = (*recent_last + 1) % RECENT_CACHE_SIZE;
-
-			g_free (recent_cache[index].value);
-			recent_cache[index].value = g_strdup (value);
-			recent_cache[index].result = result;
-
-			*recent_last = index;
-		}
-	}
-
-	g_mutex_unlock (&content->priv->recent_lock);
-}
-
 static void
 e_mail_remote_content_add (EMailRemoteContent *content,
 			   const gchar *table,
-			   const gchar *value,
-			   RecentData *recent_cache,
-			   guint *recent_last)
+			   GHashTable *values_hash,
+			   const gchar *value)
 {
 	gchar *stmt;
 	GError *error = NULL;
 
 	g_return_if_fail (E_IS_MAIL_REMOTE_CONTENT (content));
 	g_return_if_fail (table != NULL);
+	g_return_if_fail (values_hash != NULL);
 	g_return_if_fail (value != NULL);
-	g_return_if_fail (recent_cache != NULL);
-	g_return_if_fail (recent_last != NULL);
 
-	e_mail_remote_content_add_to_recent_cache (content, value, TRUE, recent_cache, recent_last);
+	g_rw_lock_writer_lock (&content->priv->lock);
+	g_hash_table_add (values_hash, g_ascii_strdown (value, -1));
+	g_rw_lock_writer_unlock (&content->priv->lock);
 
 	if (!content->priv->db)
 		return;
@@ -130,33 +73,24 @@ e_mail_remote_content_add (EMailRemoteContent *content,
 static void
 e_mail_remote_content_remove (EMailRemoteContent *content,
 			      const gchar *table,
-			      const gchar *value,
-			      RecentData *recent_cache,
-			      guint *recent_last)
+			      GHashTable *values_hash,
+			      const gchar *value)
 {
-	gchar *stmt;
-	gint ii;
+	gchar *stmt, *folded;
 	GError *error = NULL;
 
 	g_return_if_fail (E_IS_MAIL_REMOTE_CONTENT (content));
 	g_return_if_fail (table != NULL);
+	g_return_if_fail (values_hash != NULL);
 	g_return_if_fail (value != NULL);
-	g_return_if_fail (recent_cache != NULL);
-	g_return_if_fail (recent_last != NULL);
 
-	g_mutex_lock (&content->priv->recent_lock);
+	folded = g_ascii_strdown (value, -1);
 
-	for (ii = 0; ii < RECENT_CACHE_SIZE; ii++) {
-		gint index = (*recent_last + ii) % RECENT_CACHE_SIZE;
+	g_rw_lock_writer_lock (&content->priv->lock);
+	g_hash_table_remove (values_hash, folded);
+	g_rw_lock_writer_unlock (&content->priv->lock);
 
-		if (recent_cache[index].value && g_ascii_strcasecmp (recent_cache[index].value, value) == 0) {
-			g_free (recent_cache[index].value);
-			recent_cache[index].value = NULL;
-			break;
-		}
-	}
-
-	g_mutex_unlock (&content->priv->recent_lock);
+	g_free (folded);
 
 	if (!content->priv->db)
 		return;
@@ -171,121 +105,52 @@ e_mail_remote_content_remove (EMailRemoteContent *content,
 	}
 }
 
-typedef struct _CheckFoundData {
-	gboolean found;
-	gboolean added_generic;
-	gboolean check_for_generic;
-	EMailRemoteContent *content;
-	RecentData *recent_cache;
-	guint *recent_last;
-} CheckFoundData;
-
-static gint
-e_mail_remote_content_check_found_cb (gpointer data,
-				      gint ncol,
-				      gchar **colvalues,
-				      gchar **colnames)
-{
-	CheckFoundData *cfd = data;
-
-	if (cfd) {
-		cfd->found = TRUE;
-
-		if (colvalues && *colvalues && **colvalues) {
-			if (cfd->check_for_generic && *colvalues[0] == '@')
-				cfd->added_generic = TRUE;
-
-			e_mail_remote_content_add_to_recent_cache (cfd->content, colvalues[0], TRUE, cfd->recent_cache, cfd->recent_last);
-		}
-	}
-
-	return 0;
-}
-
+/* Checks whether the @values_hash contains the @value, or any of its domain
+   suffixes, like "example.com" for "www.example.com"; when the @value is
+   a mail address, then also "@example.com" and "@www.example.com"
+   for "user@www.example.com". */
 static gboolean
 e_mail_remote_content_has (EMailRemoteContent *content,
-			   const gchar *table,
-			   const GSList *values,
-			   RecentData *recent_cache,
-			   guint *recent_last)
+			   GHashTable *values_hash,
+			   const gchar *value)
 {
-	GString *stmt;
-	gint ii;
-	gchar *tmp;
-	const GSList *link;
-	gboolean found = FALSE, recent_cache_found = FALSE, added_generic = FALSE;
+	gchar *folded, *domain, *ptr;
+	gboolean found;
 
 	g_return_val_if_fail (E_IS_MAIL_REMOTE_CONTENT (content), FALSE);
-	g_return_val_if_fail (table != NULL, FALSE);
-	g_return_val_if_fail (values != NULL, FALSE);
-	g_return_val_if_fail (recent_cache != NULL, FALSE);
-	g_return_val_if_fail (recent_last != NULL, FALSE);
-
-	g_mutex_lock (&content->priv->recent_lock);
+	g_return_val_if_fail (values_hash != NULL, FALSE);
+	g_return_val_if_fail (value != NULL, FALSE);
 
-	for (link = values; link && !found; link = g_slist_next (link)) {
-		const gchar *value = link->data;
-
-		for (ii = 0; ii < RECENT_CACHE_SIZE; ii++) {
-			gint index = (*recent_last + ii) % RECENT_CACHE_SIZE;
-
-			if (recent_cache[index].value && g_ascii_strcasecmp (recent_cache[index].value, value) == 0) {
-				recent_cache_found = TRUE;
-				found = recent_cache[index].result;
-				if (found)
-					break;
-			}
-		}
-	}
-
-	g_mutex_unlock (&content->priv->recent_lock);
-
-	if (recent_cache_found)
-		return found;
-
-	if (!content->priv->db)
+	if (!*value)
 		return FALSE;
 
-	stmt = g_string_new ("");
-
-	for (link = values; link; link = g_slist_next (link)) {
-		const gchar *value = link->data;
+	folded = g_ascii_strdown (value, -1);
 
-		if (!value || !*value)
-			continue;
-
-		if (stmt->len)
-			g_string_append (stmt, " OR ");
-
-		tmp = sqlite3_mprintf ("value=lower(%Q)", value);
-		g_string_append (stmt, tmp);
-		sqlite3_free (tmp);
-	}
+	g_rw_lock_reader_lock (&content->priv->lock);
 
-	if (stmt->len) {
-		CheckFoundData cfd;
+	found = g_hash_table_contains (values_hash, folded);
 
-		cfd.found = FALSE;
-		cfd.added_generic = FALSE;
-		cfd.check_for_generic = g_strcmp0 (table, "mail");
-		cfd.content = content;
-		cfd.recent_cache = recent_cache;
-		cfd.recent_last = recent_last;
+	domain = strchr (folded, '@');
 
-		tmp = sqlite3_mprintf ("SELECT value FROM %Q WHERE ", table);
-		g_string_prepend (stmt, tmp);
-		sqlite3_free (tmp);
+	if (domain) {
+		/* The generic "@domain" entries */
+		for (ptr = domain; !found && ptr; ptr = strchr (ptr + 1, '.')) {
+			gchar saved = *ptr;
 
-		camel_db_select (content->priv->db, stmt->str, e_mail_remote_content_check_found_cb, &cfd, NULL);
-
-		found = cfd.found;
-		added_generic = cfd.added_generic;
+			/* The buffer is ours, thus avoid allocating the "@suffix" */
+			*ptr = '@';
+			found = g_hash_table_contains (values_hash, ptr);
+			*ptr = saved;
+		}
+	} else {
+		for (ptr = strchr (folded, '.'); !found && ptr; ptr = strchr (ptr + 1, '.')) {
+			found = ptr[1] && g_hash_table_contains (values_hash, ptr + 1);
+		}
 	}
 
-	g_string_free (stmt, TRUE);
+	g_rw_lock_reader_unlock (&content->priv->lock);
 
-	if (!added_generic)
-		e_mail_remote_content_add_to_recent_cache (content, values->data, found, recent_cache, recent_last);
+	g_free (folded);
 
 	return found;
 }
@@ -298,63 +163,37 @@ e_mail_remote_content_get_values_cb (gpointer data,
 {
 	GHashTable *values_hash = data;
 
-	if (values_hash && colvalues && colvalues[0])
-		g_hash_table_insert (values_hash, g_strdup (colvalues[0]), NULL);
+	if (values_hash && colvalues && colvalues[0] && *colvalues[0])
+		g_hash_table_add (values_hash, g_ascii_strdown (colvalues[0], -1));
 
 	return 0;
 }
 
 static GSList *
 e_mail_remote_content_get (EMailRemoteContent *content,
-			   const gchar *table,
-			   RecentData *recent_cache,
-			   guint *recent_last)
+			   GHashTable *values_hash)
 {
-	GHashTable *values_hash;
 	GHashTableIter iter;
 	GSList *values = NULL;
-	gpointer itr_key, itr_value;
-	gint ii;
+	gpointer itr_key;
 
 	g_return_val_if_fail (E_IS_MAIL_REMOTE_CONTENT (content), NULL);
-	g_return_val_if_fail (table != NULL, NULL);
-	g_return_val_if_fail (recent_cache != NULL, NULL);
-	g_return_val_if_fail (recent_last != NULL, NULL);
-
-	values_hash = g_hash_table_new_full (camel_strcase_hash, camel_strcase_equal, g_free, NULL);
-
-	g_mutex_lock (&content->priv->recent_lock);
+	g_return_val_if_fail (values_hash != NULL, NULL);
 
-	for (ii = 0; ii < RECENT_CACHE_SIZE; ii++) {
-		gint index = (*recent_last + ii) % RECENT_CACHE_SIZE;
-
-		if (recent_cache[index].value && recent_cache[index].result) {
-			g_hash_table_insert (values_hash, g_strdup (recent_cache[index].value), NULL);
-		}
-	}
-
-	g_mutex_unlock (&content->priv->recent_lock);
-
-	if (content->priv->db) {
-		gchar *stmt;
-
-		stmt = sqlite3_mprintf ("SELECT value FROM %Q ORDER BY value", table);
-		camel_db_select (content->priv->db, stmt, e_mail_remote_content_get_values_cb, values_hash, NULL);
-		sqlite3_free (stmt);
-	}
+	g_rw_lock_reader_lock (&content->priv->lock);
 
 	g_hash_table_iter_init (&iter, values_hash);
 
-	while (g_hash_table_iter_next (&iter, &itr_key, &itr_value)) {
+	while (g_hash_table_iter_next (&iter, &itr_key, NULL)) {
 		const gchar *value = itr_key;
 
 		if (value && *value)
 			values = g_slist_prepend (values, g_strdup (value));
 	}
 
-	g_hash_table_destroy (values_hash);
+	g_rw_lock_reader_unlock (&content->priv->lock);
 
-	return g_slist_reverse (values);
+	return g_slist_sort (values, (GCompareFunc) g_strcmp0);
 }
 
 static gint
@@ -424,6 +263,14 @@ e_mail_remote_content_set_config_filename (EMailRemoteContent *content,
 		stmt = sqlite3_mprintf ("INSERT INTO %Q ('current') VALUES (%d);", "version", CURRENT_VERSION);
 		camel_db_command (content->priv->db, stmt, NULL);
 		sqlite3_free (stmt);
+
+		/* Load the whole content, it's looked up on each remote content request */
+		g_rw_lock_writer_lock (&content->priv->lock);
+
+		camel_db_select (content->priv->db, "SELECT value FROM 'sites'", e_mail_remote_content_get_values_cb, content->priv->sites, NULL);
+		camel_db_select (content->priv->db, "SELECT value FROM 'mails'", e_mail_remote_content_get_values_cb, content->priv->mails, NULL);
+
+		g_rw_lock_writer_unlock (&content->priv->lock);
 	}
 }
 
@@ -431,7 +278,6 @@ static void
 mail_remote_content_finalize (GObject *object)
 {
 	EMailRemoteContent *content;
-	gint ii;
 
 	content = E_MAIL_REMOTE_CONTENT (object);
 
@@ -448,18 +294,9 @@ mail_remote_content_finalize (GObject *object)
 		g_clear_object (&content->priv->db);
 	}
 
-	g_mutex_lock (&content->priv->recent_lock);
-
-	for (ii = 0; ii < RECENT_CACHE_SIZE; ii++) {
-		g_free (content->priv->recent_sites[ii].value);
-		g_free (content->priv->recent_mails[ii].value);
-
-		content->priv->recent_sites[ii].value = NULL;
-		content->priv->recent_mails[ii].value = NULL;
-	}
-
-	g_mutex_unlock (&content->priv->recent_lock);
-	g_mutex_clear (&content->priv->recent_lock);
+	g_hash_table_destroy (content->priv->sites);
+	g_hash_table_destroy (content->priv->mails);
+	g_rw_lock_clear (&content->priv->lock);
 
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (e_mail_remote_content_parent_class)->finalize (object);
@@ -481,7 +318,9 @@ e_mail_remote_content_init (EMailRemoteContent *content)
 {
 	content->priv = G_TYPE_INSTANCE_GET_PRIVATE (content, E_TYPE_MAIL_REMOTE_CONTENT, EMailRemoteContentPrivate);
 
-	g_mutex_init (&content->priv->recent_lock);
+	g_rw_lock_init (&content->priv->lock);
+	content->priv->sites = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	content->priv->mails = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 }
 
 EMailRemoteContent *
@@ -504,7 +343,7 @@ e_mail_remote_content_add_site (EMailRemoteContent *content,
 	g_return_if_fail (E_IS_MAIL_REMOTE_CONTENT (content));
 	g_return_if_fail (site != NULL);
 
-	e_mail_remote_content_add (content, "sites", site, content->priv->recent_sites, &content->priv->recent_last_sites);
+	e_mail_remote_content_add (content, "sites", content->priv->sites, site);
 }
 
 void
@@ -514,26 +353,17 @@ e_mail_remote_content_remove_site (EMailRemoteContent *content,
 	g_return_if_fail (E_IS_MAIL_REMOTE_CONTENT (content));
 	g_return_if_fail (site != NULL);
 
-	e_mail_remote_content_remove (content, "sites", site, content->priv->recent_sites, &content->priv->recent_last_sites);
+	e_mail_remote_content_remove (content, "sites", content->priv->sites, site);
 }
 
 gboolean
 e_mail_remote_content_has_site (EMailRemoteContent *content,
 				const gchar *site)
 {
-	GSList *values = NULL;
-	gboolean result;
-
 	g_return_val_if_fail (E_IS_MAIL_REMOTE_CONTENT (content), FALSE);
 	g_return_val_if_fail (site != NULL, FALSE);
 
-	values = g_slist_prepend (values, (gpointer) site);
-
-	result = e_mail_remote_content_has (content, "sites", values, content->priv->recent_sites, &content->priv->recent_last_sites);
-
-	g_slist_free (values);
-
-	return result;
+	return e_mail_remote_content_has (content, content->priv->sites, site);
 }
 
 /* Free the result with g_slist_free_full (values, g_free); */
@@ -542,7 +372,7 @@ e_mail_remote_content_get_sites (EMailRemoteContent *content)
 {
 	g_return_val_if_fail (E_IS_MAIL_REMOTE_CONTENT (content), NULL);
 
-	return e_mail_remote_content_get (content, "sites", content->priv->recent_sites, &content->priv->recent_last_sites);
+	return e_mail_remote_content_get (content, content->priv->sites);
 }
 
 void
@@ -552,7 +382,7 @@ e_mail_remote_content_add_mail (EMailRemoteContent *content,
 	g_return_if_fail (E_IS_MAIL_REMOTE_CONTENT (content));
 	g_return_if_fail (mail != NULL);
 
-	e_mail_remote_content_add (content, "mails", mail, content->priv->recent_mails, &content->priv->recent_last_mails);
+	e_mail_remote_content_add (content, "mails", content->priv->mails, mail);
 }
 
 void
@@ -562,30 +392,17 @@ e_mail_remote_content_remove_mail (EMailRemoteContent *content,
 	g_return_if_fail (E_IS_MAIL_REMOTE_CONTENT (content));
 	g_return_if_fail (mail != NULL);
 
-	e_mail_remote_content_remove (content, "mails", mail, content->priv->recent_mails, &content->priv->recent_last_mails);
+	e_mail_remote_content_remove (content, "mails", content->priv->mails, mail);
 }
 
 gboolean
 e_mail_remote_content_has_mail (EMailRemoteContent *content,
 				const gchar *mail)
 {
-	GSList *values = NULL;
-	const gchar *at;
-	gboolean result;
-
 	g_return_val_if_fail (E_IS_MAIL_REMOTE_CONTENT (content), FALSE);
 	g_return_val_if_fail (mail != NULL, FALSE);
 
-	at = strchr (mail, '@');
-	if (at)
-		values = g_slist_prepend (values, (gpointer) at);
-	values = g_slist_prepend (values, (gpointer) mail);
-
-	result = e_mail_remote_content_has (content, "mails", values, content->priv->recent_mails, &content->priv->recent_last_mails);
-
-	g_slist_free (values);
-
-	return result;
+	return e_mail_remote_content_has (content, content->priv->mails, mail);
 }
 
 /* Free the result with g_slist_free_full (values, g_free); */
@@ -594,5 +411,5 @@ e_mail_remote_content_get_mails (EMailRemoteContent *content)
 {
 	g_return_val_if_fail (E_IS_MAIL_REMOTE_CONTENT (content), NULL);
 
-	return e_mail_remote_content_get (content, "mails", content->priv->recent_mails, &content->priv->recent_last_mails);
+	return e_mail_remote_content_get (content, content->priv->mails);
 }
@@ -17,17 +17,24 @@
 
 #include "evolution-config.h"
 
+#include <errno.h>
+#include <string.h>
+
 #include <libsoup/soup.h>
 
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <camel/camel.h>
 #include <libedataserver/libedataserver.h>
+#include <libemail-engine/libemail-engine.h>
 
 #include "shell/e-shell.h"
 
 #include "em-format/e-mail-formatter.h"
 #include "em-format/e-mail-formatter-utils.h"
 #include "em-format/e-mail-formatter-print.h"
+#include "em-format/e-mail-part-attachment.h"
+#include "em-format/e-mail-part-headers.h"
 
 #include "em-utils.h"
 #include "e-mail-display.h"
@@ -84,6 +91,742 @@ save_gicon_to_stream (GIcon *icon,
 	g_object_unref (icon);
 }
 
+/* The formatted output of recently shown messages is kept in memory
+ * and on disk, thus re-displaying a message doesn't need to format it
+ * again. Entries are dropped when the message is removed, its content
+ * changes or it is shown with different headers; signed and encrypted
+ * messages are never cached. */
+#define RENDERED_CACHE_MEMORY_SIZE (32 * 1024 * 1024)
+#define RENDERED_CACHE_DISK_SIZE (256 * 1024 * 1024)
+#define RENDERED_CACHE_PRUNE_WRITES 32
+
+typedef struct _RenderedEntry {
+	gchar *key;
+	gchar *mail_uri;
+	gchar *stamp;
+	gchar *info_stamp;
+	gchar *mime_type;
+	GBytes *bytes;
+	gpointer folder; /* not referenced, only compared */
+} RenderedEntry;
+
+typedef struct _RenderedDiskJob {
+	gchar *mail_uri;
+	gchar *key; /* NULL to remove all entries of the mail_uri */
+	gchar *stamp;
+	gchar *mime_type;
+	GBytes *bytes;
+} RenderedDiskJob;
+
+G_LOCK_DEFINE_STATIC (rendered_cache);
+static GHashTable *rendered_entries = NULL; /* gchar *key ~> GList *, a link in the rendered_lru */
+static GQueue rendered_lru = G_QUEUE_INIT; /* RenderedEntry *, the most recently used first */
+static gsize rendered_memory_size = 0;
+static GHashTable *rendered_folders = NULL; /* CamelFolder *, with a "changed" handler connected */
+static GThreadPool *rendered_disk_pool = NULL;
+
+static void
+rendered_entry_free (gpointer ptr)
+{
+	RenderedEntry *entry = ptr;
+
+	if (entry) {
+		g_free (entry->key);
+		g_free (entry->mail_uri);
+		g_free (entry->stamp);
+		g_free (entry->info_stamp);
+		g_free (entry->mime_type);
+		g_bytes_unref (entry->bytes);
+		g_free (entry);
+	}
+}
+
+static void
+rendered_disk_job_free (RenderedDiskJob *job)
+{
+	if (job) {
+		g_free (job->mail_uri);
+		g_free (job->key);
+		g_free (job->stamp);
+		g_free (job->mime_type);
+		if (job->bytes)
+			g_bytes_unref (job->bytes);
+		g_free (job);
+	}
+}
+
+static gchar *
+rendered_cache_dup_dirname (const gchar *mail_uri)
+{
+	gchar *checksum, *dirname;
+
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, mail_uri, -1);
+	dirname = g_build_filename (mail_session_get_cache_dir (), "rendered", checksum, NULL);
+	g_free (checksum);
+
+	return dirname;
+}
+
+static gchar *
+rendered_cache_dup_filename (const gchar *mail_uri,
+			     const gchar *key)
+{
+	gchar *dirname, *checksum, *filename;
+
+	dirname = rendered_cache_dup_dirname (mail_uri);
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+	filename = g_build_filename (dirname, checksum, NULL);
+	g_free (checksum);
+	g_free (dirname);
+
+	return filename;
+}
+
+typedef struct _RenderedFile {
+	gchar *filename;
+	gint64 mtime;
+	goffset size;
+} RenderedFile;
+
+static gint
+rendered_file_compare_cb (gconstpointer ptr1,
+			  gconstpointer ptr2)
+{
+	const RenderedFile *file1 = *((const RenderedFile **) ptr1);
+	const RenderedFile *file2 = *((const RenderedFile **) ptr2);
+
+	return file1->mtime < file2->mtime ? -1 : file1->mtime > file2->mtime ? 1 : 0;
+}
+
+static void
+rendered_file_free (gpointer ptr)
+{
+	RenderedFile *file = ptr;
+
+	if (file) {
+		g_free (file->filename);
+		g_free (file);
+	}
+}
+
+/* Removes the oldest files, when the disk cache grows over its limit */
+static void
+rendered_cache_prune_disk (void)
+{
+	GPtrArray *files;
+	GDir *dir, *subdir;
+	const gchar *name, *subname;
+	gchar *rendered_dir;
+	goffset total = 0;
+	guint ii;
+
+	rendered_dir = g_build_filename (mail_session_get_cache_dir (), "rendered", NULL);
+
+	dir = g_dir_open (rendered_dir, 0, NULL);
+	if (!dir) {
+		g_free (rendered_dir);
+		return;
+	}
+
+	files = g_ptr_array_new_with_free_func (rendered_file_free);
+
+	while ((name = g_dir_read_name (dir))) {
+		gchar *dirname = g_build_filename (rendered_dir, name, NULL);
+
+		subdir = g_dir_open (dirname, 0, NULL);
+		while (subdir && (subname = g_dir_read_name (subdir))) {
+			RenderedFile *file;
+			GStatBuf st;
+
+			file = g_new0 (RenderedFile, 1);
+			file->filename = g_build_filename (dirname, subname, NULL);
+
+			if (g_stat (file->filename, &st) == 0) {
+				file->mtime = st.st_mtime;
+				file->size = st.st_size;
+				total += file->size;
+			}
+
+			g_ptr_array_add (files, file);
+		}
+
+		if (subdir)
+			g_dir_close (subdir);
+
+		g_free (dirname);
+	}
+
+	g_dir_close (dir);
+
+	if (total > RENDERED_CACHE_DISK_SIZE) {
+		g_ptr_array_sort (files, rendered_file_compare_cb);
+
+		for (ii = 0; ii < files->len && total > RENDERED_CACHE_DISK_SIZE * 3 / 4; ii++) {
+			RenderedFile *file = files->pdata[ii];
+			gchar *dirname;
+
+			g_unlink (file->filename);
+			total -= file->size;
+
+			/* Fails when not empty, which is fine */
+			dirname = g_path_get_dirname (file->filename);
+			g_rmdir (dirname);
+			g_free (dirname);
+		}
+	}
+
+	g_ptr_array_unref (files);
+	g_free (rendered_dir);
+}
+
+static void
+rendered_cache_disk_thread (gpointer data,
+			    gpointer user_data)
+{
+	RenderedDiskJob *job = data;
+	static guint n_writes = 0;
+
+	if (job->key) {
+		GError *local_error = NULL;
+		gchar *dirname, *filename, *header;
+		GString *content;
+
+		dirname = rendered_cache_dup_dirname (job->mail_uri);
+		filename = rendered_cache_dup_filename (job->mail_uri, job->key);
+
+		header = g_strconcat (job->stamp, "\n", job->mime_type, "\n", NULL);
+
+		content = g_string_sized_new (strlen (header) + g_bytes_get_size (job->bytes));
+		g_string_append (content, header);
+		g_string_append_len (content, g_bytes_get_data (job->bytes, NULL), g_bytes_get_size (job->bytes));
+
+		if (g_mkdir_with_parents (dirname, 0700) == -1 ||
+		    !g_file_set_contents (filename, content->str, content->len, &local_error)) {
+			if (camel_debug_start ("emformat:requests")) {
+				printf ("%s: failed to write '%s': %s\n", G_STRFUNC, filename,
+					local_error ? local_error->message : g_strerror (errno));
+				camel_debug_end ();
+			}
+
+			g_clear_error (&local_error);
+		}
+
+		g_string_free (content, TRUE);
+		g_free (header);
+		g_free (filename);
+		g_free (dirname);
+
+		n_writes++;
+		if (!(n_writes % RENDERED_CACHE_PRUNE_WRITES))
+			rendered_cache_prune_disk ();
+	} else {
+		GDir *dir;
+		gchar *dirname;
+
+		dirname = rendered_cache_dup_dirname (job->mail_uri);
+
+		dir = g_dir_open (dirname, 0, NULL);
+		if (dir) {
+			const gchar *name;
+
+			while ((name = g_dir_read_name (dir))) {
+				gchar *filename = g_build_filename (dirname, name, NULL);
+
+				g_unlink (filename);
+				g_free (filename);
+			}
+
+			g_dir_close (dir);
+			g_rmdir (dirname);
+		}
+
+		g_free (dirname);
+	}
+
+	rendered_disk_job_free (job);
+}
+
+/* Disk operations are done in a dedicated thread, in the order of their addition */
+static void
+rendered_cache_push_disk_job (RenderedDiskJob *job)
+{
+	G_LOCK (rendered_cache);
+
+	if (!rendered_disk_pool)
+		rendered_disk_pool = g_thread_pool_new (rendered_cache_disk_thread, NULL, 1, FALSE, NULL);
+
+	G_UNLOCK (rendered_cache);
+
+	g_thread_pool_push (rendered_disk_pool, job, NULL);
+}
+
+/* Call with the rendered_cache lock held */
+static void
+rendered_cache_remove_link_locked (GList *link)
+{
+	RenderedEntry *entry = link->data;
+
+	g_hash_table_remove (rendered_entries, entry->key);
+	g_queue_delete_link (&rendered_lru, link);
+
+	rendered_memory_size -= g_bytes_get_size (entry->bytes);
+	rendered_entry_free (entry);
+}
+
+/* Call with the rendered_cache lock held */
+static void
+rendered_cache_add_locked (RenderedEntry *entry)
+{
+	GList *link;
+
+	if (!rendered_entries)
+		rendered_entries = g_hash_table_new (g_str_hash, g_str_equal);
+
+	link = g_hash_table_lookup (rendered_entries, entry->key);
+	if (link)
+		rendered_cache_remove_link_locked (link);
+
+	/* Do not let a single message flush everything else */
+	if (g_bytes_get_size (entry->bytes) > RENDERED_CACHE_MEMORY_SIZE / 4) {
+		rendered_entry_free (entry);
+		return;
+	}
+
+	g_queue_push_head (&rendered_lru, entry);
+	g_hash_table_insert (rendered_entries, entry->key, rendered_lru.head);
+	rendered_memory_size += g_bytes_get_size (entry->bytes);
+
+	while (rendered_memory_size > RENDERED_CACHE_MEMORY_SIZE && rendered_lru.tail)
+		rendered_cache_remove_link_locked (rendered_lru.tail);
+}
+
+static void
+rendered_cache_remove_mail (const gchar *mail_uri)
+{
+	RenderedDiskJob *job;
+	GList *link, *next;
+
+	G_LOCK (rendered_cache);
+
+	for (link = rendered_lru.head; link; link = next) {
+		RenderedEntry *entry = link->data;
+
+		next = g_list_next (link);
+
+		if (g_strcmp0 (entry->mail_uri, mail_uri) == 0)
+			rendered_cache_remove_link_locked (link);
+	}
+
+	G_UNLOCK (rendered_cache);
+
+	job = g_new0 (RenderedDiskJob, 1);
+	job->mail_uri = g_strdup (mail_uri);
+
+	rendered_cache_push_disk_job (job);
+}
+
+/* Describes the content of the message, not its flags or tags, thus
+   a message stored under a reused UID gets a different one */
+static gchar *
+rendered_cache_dup_info_stamp (CamelFolder *folder,
+			       const gchar *message_uid)
+{
+	CamelMessageInfo *info;
+	gchar *info_stamp;
+
+	if (!folder || !message_uid)
+		return g_strdup ("");
+
+	info = camel_folder_get_message_info (folder, message_uid);
+	if (!info)
+		return g_strdup ("");
+
+	camel_message_info_property_lock (info);
+
+	info_stamp = g_strdup_printf ("%" G_GUINT64_FORMAT "\n%" G_GUINT32_FORMAT "\n%" G_GINT64_FORMAT "\n%" G_GINT64_FORMAT "\n%s",
+		camel_message_info_get_message_id (info),
+		camel_message_info_get_size (info),
+		(gint64) camel_message_info_get_date_sent (info),
+		(gint64) camel_message_info_get_date_received (info),
+		camel_message_info_get_subject (info) ? camel_message_info_get_subject (info) : "");
+
+	camel_message_info_property_unlock (info);
+	g_object_unref (info);
+
+	return info_stamp;
+}
+
+/* Drops the memory entries of the message, whose content does not match
+   the @info_stamp; the disk entries are verified against the stamp when read */
+static void
+rendered_cache_verify_mail (const gchar *mail_uri,
+			    const gchar *info_stamp)
+{
+	GList *link;
+	gboolean changed = FALSE;
+
+	G_LOCK (rendered_cache);
+
+	for (link = rendered_lru.head; link && !changed; link = g_list_next (link)) {
+		RenderedEntry *entry = link->data;
+
+		if (g_strcmp0 (entry->mail_uri, mail_uri) == 0)
+			changed = g_strcmp0 (entry->info_stamp, info_stamp) != 0;
+	}
+
+	G_UNLOCK (rendered_cache);
+
+	if (changed)
+		rendered_cache_remove_mail (mail_uri);
+}
+
+static void
+rendered_cache_folder_changed_cb (CamelFolder *folder,
+				  CamelFolderChangeInfo *changes,
+				  gpointer user_data)
+{
+	guint ii;
+
+	if (!changes)
+		return;
+
+	for (ii = 0; changes->uid_removed && ii < changes->uid_removed->len; ii++) {
+		const gchar *uid = changes->uid_removed->pdata[ii];
+		gchar *mail_uri;
+
+		if (!uid || !*uid)
+			continue;
+
+		mail_uri = e_mail_part_build_uri (folder, uid, NULL, NULL);
+		rendered_cache_remove_mail (mail_uri);
+		g_free (mail_uri);
+	}
+
+	/* Only the content changes matter, not the flags or tags,
+	   which are not part of the output */
+	for (ii = 0; changes->uid_changed && ii < changes->uid_changed->len; ii++) {
+		const gchar *uid = changes->uid_changed->pdata[ii];
+		gchar *mail_uri, *info_stamp;
+
+		if (!uid || !*uid)
+			continue;
+
+		mail_uri = e_mail_part_build_uri (folder, uid, NULL, NULL);
+		info_stamp = rendered_cache_dup_info_stamp (folder, uid);
+
+		rendered_cache_verify_mail (mail_uri, info_stamp);
+
+		g_free (info_stamp);
+		g_free (mail_uri);
+	}
+}
+
+static void
+rendered_cache_folder_gone_cb (gpointer user_data,
+			       GObject *where_the_object_was)
+{
+	GList *link, *next;
+
+	G_LOCK (rendered_cache);
+
+	g_hash_table_remove (rendered_folders, where_the_object_was);
+
+	/* Changes of the folder cannot be noticed anymore; the disk
+	   entries are verified against the stamp when read */
+	for (link = rendered_lru.head; link; link = next) {
+		RenderedEntry *entry = link->data;
+
+		next = g_list_next (link);
+
+		if (entry->folder == where_the_object_was)
+			rendered_cache_remove_link_locked (link);
+	}
+
+	G_UNLOCK (rendered_cache);
+}
+
+static void
+rendered_cache_watch_folder (CamelFolder *folder)
+{
+	gboolean connect;
+
+	G_LOCK (rendered_cache);
+
+	if (!rendered_folders)
+		rendered_folders = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	connect = !g_hash_table_contains (rendered_folders, folder);
+	if (connect)
+		g_hash_table_add (rendered_folders, folder);
+
+	G_UNLOCK (rendered_cache);
+
+	if (connect) {
+		g_signal_connect (folder, "changed", G_CALLBACK (rendered_cache_folder_changed_cb), NULL);
+		g_object_weak_ref (G_OBJECT (folder), rendered_cache_folder_gone_cb, NULL);
+	}
+}
+
+/* The stamp identifies the message by its Message-ID, date and size,
+   thus the disk entries are not used for another message stored under
+   the same UID, and it changes when the part list is set to show different
+   headers; the message flags and tags are not part of the output, thus
+   marking the message as read or flagging it does not invalidate the entries */
+static gchar *
+rendered_cache_dup_stamp (EMailPartList *part_list,
+			  const gchar *info_stamp)
+{
+	CamelMimeMessage *message;
+	GQueue queue = G_QUEUE_INIT;
+	GString *str;
+	gchar *stamp;
+
+	str = g_string_new (e_mail_part_list_get_message_uid (part_list));
+
+	message = e_mail_part_list_get_message (part_list);
+	if (message) {
+		gint offset = 0;
+		time_t date;
+
+		date = camel_mime_message_get_date (message, &offset);
+
+		g_string_append_printf (str, "\n%s\n%" G_GINT64_FORMAT " %d",
+			camel_mime_message_get_message_id (message) ? camel_mime_message_get_message_id (message) : "",
+			(gint64) date, offset);
+	}
+
+	g_string_append_c (str, '\n');
+	g_string_append (str, info_stamp);
+
+	e_mail_part_list_queue_parts (part_list, NULL, &queue);
+
+	while (!g_queue_is_empty (&queue)) {
+		EMailPart *part = g_queue_pop_head (&queue);
+
+		if (E_IS_MAIL_PART_HEADERS (part)) {
+			gchar **headers;
+			guint ii;
+
+			headers = e_mail_part_headers_dup_default_headers (E_MAIL_PART_HEADERS (part));
+
+			for (ii = 0; headers && headers[ii]; ii++) {
+				g_string_append_c (str, '\n');
+				g_string_append (str, headers[ii]);
+			}
+
+			g_strfreev (headers);
+		}
+
+		g_object_unref (part);
+	}
+
+	stamp = g_compute_checksum_for_string (G_CHECKSUM_SHA1, str->str, str->len);
+
+	g_string_free (str, TRUE);
+
+	return stamp;
+}
+
+/* Parts of signed or encrypted messages are never stored, not to leave
+   the decrypted content around; any part of the message can carry its
+   validity, thus it's checked also when storing a single part.
+   Attachments and signature buttons are tied to the objects of the part
+   list, like the attachment bar, thus such output cannot be reused */
+static gboolean
+rendered_cache_can_store (EMailPartList *part_list,
+			  const gchar *part_id)
+{
+	GQueue queue = G_QUEUE_INIT;
+	gboolean can_store = TRUE;
+
+	if (e_mail_part_list_get_in_progress (part_list))
+		return FALSE;
+
+	e_mail_part_list_queue_parts (part_list, NULL, &queue);
+
+	while (!g_queue_is_empty (&queue)) {
+		EMailPart *part = g_queue_pop_head (&queue);
+
+		if (e_mail_part_has_validity (part))
+			can_store = FALSE;
+		else if (!part_id && (E_IS_MAIL_PART_ATTACHMENT (part) ||
+			 g_strcmp0 (e_mail_part_get_mime_type (part), "application/vnd.evolution.secure-button") == 0))
+			can_store = FALSE;
+
+		g_object_unref (part);
+	}
+
+	return can_store;
+}
+
+static gchar *
+rendered_cache_dup_key (const gchar *mail_uri,
+			EMailFormatter *formatter,
+			EMailFormatterContext *context,
+			const gchar *charset,
+			const gchar *default_charset,
+			const gchar *part_id,
+			const gchar *mime_type)
+{
+	GString *key;
+	gint ii;
+
+	key = g_string_new (mail_uri);
+
+	g_string_append_printf (key, "\n%d\n%u\n%s\n%s\n%s\n%s\n%d%d%d%d%d",
+		context->mode, context->flags,
+		charset ? charset : "",
+		default_charset ? default_charset : "",
+		part_id ? part_id : "",
+		mime_type ? mime_type : "",
+		e_mail_formatter_get_image_loading_policy (formatter),
+		e_mail_formatter_get_mark_citations (formatter),
+		e_mail_formatter_get_show_sender_photo (formatter),
+		e_mail_formatter_get_show_real_date (formatter),
+		e_mail_formatter_get_animate_images (formatter));
+
+	for (ii = 0; ii < E_MAIL_FORMATTER_NUM_COLOR_TYPES; ii++) {
+		gchar *color;
+
+		color = gdk_rgba_to_string (e_mail_formatter_get_color (formatter, ii));
+		g_string_append_c (key, '\n');
+		g_string_append (key, color);
+		g_free (color);
+	}
+
+	return g_string_free (key, FALSE);
+}
+
+/* Without the part list the stamp cannot be verified, thus only the
+   memory entries, which are dropped on folder changes, can be used */
+static gboolean
+rendered_cache_lookup (const gchar *key,
+		       const gchar *mail_uri,
+		       EMailPartList *part_list,
+		       GBytes **out_bytes,
+		       gchar **out_mime_type)
+{
+	GList *link;
+	gchar *stamp = NULL, *info_stamp = NULL, *filename, *content = NULL;
+	gsize length = 0;
+	gboolean found = FALSE;
+
+	if (part_list) {
+		info_stamp = rendered_cache_dup_info_stamp (
+			e_mail_part_list_get_folder (part_list),
+			e_mail_part_list_get_message_uid (part_list));
+		stamp = rendered_cache_dup_stamp (part_list, info_stamp);
+	}
+
+	G_LOCK (rendered_cache);
+
+	link = rendered_entries ? g_hash_table_lookup (rendered_entries, key) : NULL;
+	if (link) {
+		RenderedEntry *entry = link->data;
+
+		if (!stamp || g_strcmp0 (entry->stamp, stamp) == 0) {
+			g_queue_unlink (&rendered_lru, link);
+			g_queue_push_head_link (&rendered_lru, link);
+
+			*out_bytes = g_bytes_ref (entry->bytes);
+			*out_mime_type = g_strdup (entry->mime_type);
+			found = TRUE;
+		} else {
+			rendered_cache_remove_link_locked (link);
+		}
+	}
+
+	G_UNLOCK (rendered_cache);
+
+	if (found || !stamp) {
+		g_free (info_stamp);
+		g_free (stamp);
+		return found;
+	}
+
+	filename = rendered_cache_dup_filename (mail_uri, key);
+
+	if (g_file_get_contents (filename, &content, &length, NULL)) {
+		gchar *stamp_end, *mime_type_end = NULL;
+
+		stamp_end = memchr (content, '\n', length);
+		if (stamp_end)
+			mime_type_end = memchr (stamp_end + 1, '\n', length - (stamp_end + 1 - content));
+
+		if (mime_type_end && (gsize) (stamp_end - content) == strlen (stamp) &&
+		    strncmp (content, stamp, stamp_end - content) == 0) {
+			RenderedEntry *entry;
+			gsize offset = mime_type_end + 1 - content;
+
+			entry = g_new0 (RenderedEntry, 1);
+			entry->key = g_strdup (key);
+			entry->mail_uri = g_strdup (mail_uri);
+			entry->stamp = g_strdup (stamp);
+			entry->info_stamp = g_strdup (info_stamp);
+			entry->mime_type = g_strndup (stamp_end + 1, mime_type_end - stamp_end - 1);
+			entry->bytes = g_bytes_new (content + offset, length - offset);
+			entry->folder = e_mail_part_list_get_folder (part_list);
+
+			*out_bytes = g_bytes_ref (entry->bytes);
+			*out_mime_type = g_strdup (entry->mime_type);
+			found = TRUE;
+
+			if (entry->folder)
+				rendered_cache_watch_folder (entry->folder);
+
+			G_LOCK (rendered_cache);
+			rendered_cache_add_locked (entry);
+			G_UNLOCK (rendered_cache);
+		}
+
+		g_free (content);
+	}
+
+	g_free (filename);
+	g_free (info_stamp);
+	g_free (stamp);
+
+	return found;
+}
+
+static void
+rendered_cache_store (const gchar *key,
+		      const gchar *mail_uri,
+		      EMailPartList *part_list,
+		      GBytes *bytes,
+		      const gchar *mime_type)
+{
+	RenderedEntry *entry;
+	RenderedDiskJob *job;
+
+	entry = g_new0 (RenderedEntry, 1);
+	entry->key = g_strdup (key);
+	entry->mail_uri = g_strdup (mail_uri);
+	entry->info_stamp = rendered_cache_dup_info_stamp (
+		e_mail_part_list_get_folder (part_list),
+		e_mail_part_list_get_message_uid (part_list));
+	entry->stamp = rendered_cache_dup_stamp (part_list, entry->info_stamp);
+	entry->mime_type = g_strdup (mime_type);
+	entry->bytes = g_bytes_ref (bytes);
+	entry->folder = e_mail_part_list_get_folder (part_list);
+
+	if (entry->folder)
+		rendered_cache_watch_folder (entry->folder);
+
+	job = g_new0 (RenderedDiskJob, 1);
+	job->mail_uri = g_strdup (mail_uri);
+	job->key = g_strdup (key);
+	job->stamp = g_strdup (entry->stamp);
+	job->mime_type = g_strdup (mime_type);
+	job->bytes = g_bytes_ref (bytes);
+
+	G_LOCK (rendered_cache);
+	rendered_cache_add_locked (entry);
+	G_UNLOCK (rendered_cache);
+
+	rendered_cache_push_disk_job (job);
+}
+
 static gboolean
 mail_request_process_mail_sync (EContentRequest *request,
 				SoupURI *suri,
@@ -101,21 +844,21 @@ mail_request_process_mail_sync (EContentRequest *request,
 	GOutputStream *output_stream;
 	GBytes *bytes;
 	gchar *tmp, *use_mime_type = NULL;
+	gchar *mail_uri, *cache_key = NULL;
 	const gchar *val;
 	const gchar *default_charset, *charset;
 	gboolean part_converted_to_utf8 = FALSE;
+	gboolean formatted = FALSE;
 
 	EMailFormatterContext context = { 0 };
 
 	if (g_cancellable_set_error_if_cancelled (cancellable, error))
 		return FALSE;
 
-	tmp = g_strdup_printf ("%s://%s%s", suri->scheme, suri->host, suri->path);
+	mail_uri = g_strdup_printf ("%s://%s%s", suri->scheme, suri->host, suri->path);
 
 	registry = e_mail_part_list_get_registry ();
-	part_list = camel_object_bag_get (registry, tmp);
-
-	g_free (tmp);
+	part_list = camel_object_bag_get (registry, mail_uri);
 
 	context.uri = soup_uri_to_string (suri, FALSE);
 
@@ -124,11 +867,6 @@ mail_request_process_mail_sync (EContentRequest *request,
 		camel_debug_end ();
 	}
 
-	if (!part_list) {
-		g_free (context.uri);
-		return FALSE;
-	}
-
 	val = g_hash_table_lookup (uri_query, "headers_collapsed");
 	if (val != NULL && atoi (val) == 1)
 		context.flags |= E_MAIL_FORMATTER_HEADER_FLAG_COLLAPSED;
@@ -144,6 +882,42 @@ mail_request_process_mail_sync (EContentRequest *request,
 	default_charset = g_hash_table_lookup (uri_query, "formatter_default_charset");
 	charset = g_hash_table_lookup (uri_query, "formatter_charset");
 
+	if (E_IS_MAIL_DISPLAY (requester) &&
+	    context.mode != E_MAIL_FORMATTER_MODE_PRINTING &&
+	    !g_hash_table_lookup (uri_query, "attachment_icon")) {
+		cache_key = rendered_cache_dup_key (
+			mail_uri, e_mail_display_get_formatter (E_MAIL_DISPLAY (requester)),
+			&context, charset, default_charset,
+			g_hash_table_lookup (uri_query, "part_id"),
+			g_hash_table_lookup (uri_query, "mime_type"));
+
+		if (rendered_cache_lookup (cache_key, mail_uri, part_list, &bytes, &use_mime_type)) {
+			if (camel_debug_start ("emformat:requests")) {
+				printf ("%s: using cached output for full_uri '%s'\n", G_STRFUNC, context.uri);
+				camel_debug_end ();
+			}
+
+			*out_stream = g_memory_input_stream_new_from_bytes (bytes);
+			*out_stream_length = g_bytes_get_size (bytes);
+			*out_mime_type = use_mime_type;
+
+			g_clear_object (&part_list);
+			g_bytes_unref (bytes);
+			g_free (cache_key);
+			g_free (mail_uri);
+			g_free (context.uri);
+
+			return TRUE;
+		}
+	}
+
+	if (!part_list) {
+		g_free (cache_key);
+		g_free (mail_uri);
+		g_free (context.uri);
+		return FALSE;
+	}
+
 	context.part_list = g_object_ref (part_list);
 
 	if (context.mode == E_MAIL_FORMATTER_MODE_PRINTING)
@@ -244,6 +1018,7 @@ mail_request_process_mail_sync (EContentRequest *request,
 			cancellable);
 
 		part_converted_to_utf8 = e_mail_part_get_converted_to_utf8 (part);
+		formatted = TRUE;
 
 		g_object_unref (part);
 
@@ -251,6 +1026,7 @@ mail_request_process_mail_sync (EContentRequest *request,
 		e_mail_formatter_format_sync (
 			formatter, part_list, output_stream,
 			context.flags, context.mode, cancellable);
+		formatted = TRUE;
 	}
 
  no_part:
@@ -282,6 +1058,10 @@ mail_request_process_mail_sync (EContentRequest *request,
 		use_mime_type = tmp;
 	}
 
+	if (cache_key && formatted && !g_cancellable_is_cancelled (cancellable) &&
+	    rendered_cache_can_store (part_list, g_hash_table_lookup (uri_query, "part_id")))
+		rendered_cache_store (cache_key, mail_uri, part_list, bytes, use_mime_type);
+
 	*out_stream = g_memory_input_stream_new_from_bytes (bytes);
 	*out_stream_length = g_bytes_get_size (bytes);
 	*out_mime_type = use_mime_type;
@@ -290,6 +1070,8 @@ mail_request_process_mail_sync (EContentRequest *request,
 	g_object_unref (part_list);
 	g_object_unref (formatter);
 	g_bytes_unref (bytes);
+	g_free (cache_key);
+	g_free (mail_uri);
 	g_free (context.uri);
 
 	return TRUE;
@@ -102,20 +102,40 @@ decode_mozilla_status (const gchar *tmp)
 	return flags;
 }
 
-static void
-import_mbox_add_message (CamelFolder *folder,
-			 CamelMimeMessage *msg,
-			 GCancellable *cancellable,
-			 GError **error)
+/* The mbox is parsed in batches of at most this many messages or bytes,
+ * the next batch being parsed in worker threads while the current one
+ * is being appended to the folder. */
+#define IMPORT_MBOX_BATCH_MESSAGES 64
+#define IMPORT_MBOX_BATCH_BYTES (16 * 1024 * 1024)
+
+typedef struct _ImportMboxBatch ImportMboxBatch;
+typedef struct _ImportMboxItem ImportMboxItem;
+
+struct _ImportMboxBatch {
+	GMutex lock;
+	GCond cond;
+	GPtrArray *items; /* ImportMboxItem * */
+	guint n_pending;
+	GCancellable *cancellable;
+};
+
+struct _ImportMboxItem {
+	ImportMboxBatch *batch;
+	GBytes *bytes; /* the message, without the "From " line */
+	goffset end_offset;
+
+	/* Set by the worker thread */
+	CamelMimeMessage *message;
+	guint32 flags;
+};
+
+static guint32
+import_mbox_get_flags (CamelMimeMessage *msg)
 {
-	CamelMessageInfo *info;
 	CamelMedium *medium;
 	guint32 flags = 0;
 	const gchar *tmp;
 
-	g_return_if_fail (CAMEL_IS_FOLDER (folder));
-	g_return_if_fail (CAMEL_IS_MIME_MESSAGE (msg));
-
 	medium = CAMEL_MEDIUM (msg);
 
 	tmp = camel_medium_get_header (medium, "X-Mozilla-Status");
@@ -128,13 +148,323 @@ import_mbox_add_message (CamelFolder *folder,
 	if (tmp)
 		flags |= decode_status (tmp);
 
+	return flags;
+}
+
+static gboolean
+import_mbox_append_message (CamelFolder *folder,
+                            CamelMimeMessage *msg,
+                            guint32 flags,
+                            GCancellable *cancellable,
+                            GError **error)
+{
+	CamelMessageInfo *info;
+	gboolean success;
+
+	g_return_val_if_fail (CAMEL_IS_FOLDER (folder), FALSE);
+	g_return_val_if_fail (CAMEL_IS_MIME_MESSAGE (msg), FALSE);
+
 	info = camel_message_info_new (NULL);
 
 	camel_message_info_set_flags (info, flags, ~0);
-	camel_folder_append_message_sync (
+	success = camel_folder_append_message_sync (
 		folder, msg, info, NULL,
 		cancellable, error);
 	g_clear_object (&info);
+
+	return success;
+}
+
+/* Returns offset of the first line beginning with "From " which starts
+ * at or after @pos, or @len, when there is none. */
+static gsize
+import_mbox_find_from_line (const gchar *data,
+                            gsize len,
+                            gsize pos)
+{
+	if (pos == 0 && len >= 5 && strncmp (data, "From ", 5) == 0)
+		return 0;
+
+	if (pos > 0)
+		pos--;
+
+	while (pos < len) {
+		const gchar *eol;
+
+		eol = memchr (data + pos, '\n', len - pos);
+		if (!eol)
+			break;
+
+		pos = eol - data + 1;
+
+		if (len - pos >= 5 && strncmp (data + pos, "From ", 5) == 0)
+			return pos;
+	}
+
+	return len;
+}
+
+static void
+import_mbox_item_free (gpointer ptr)
+{
+	ImportMboxItem *item = ptr;
+
+	if (item) {
+		g_bytes_unref (item->bytes);
+		g_clear_object (&item->message);
+		g_free (item);
+	}
+}
+
+static void
+import_mbox_parse_thread (gpointer data,
+                          gpointer user_data)
+{
+	ImportMboxItem *item = data;
+	ImportMboxBatch *batch = item->batch;
+
+	if (!g_cancellable_is_cancelled (batch->cancellable)) {
+		GInputStream *input_stream;
+		CamelMimeParser *mp;
+		CamelMimeMessage *msg;
+
+		input_stream = g_memory_input_stream_new_from_bytes (item->bytes);
+
+		mp = camel_mime_parser_new ();
+		camel_mime_parser_scan_from (mp, FALSE);
+		camel_mime_parser_init_with_input_stream (mp, input_stream);
+
+		msg = camel_mime_message_new ();
+		if (camel_mime_part_construct_from_parser_sync (
+			(CamelMimePart *) msg, mp, NULL, NULL)) {
+			item->flags = import_mbox_get_flags (msg);
+			item->message = msg;
+		} else {
+			g_object_unref (msg);
+		}
+
+		g_object_unref (mp);
+		g_object_unref (input_stream);
+	}
+
+	g_mutex_lock (&batch->lock);
+	batch->n_pending--;
+	if (!batch->n_pending)
+		g_cond_signal (&batch->cond);
+	g_mutex_unlock (&batch->lock);
+}
+
+/* Splits the next messages of the mbox, starting with the "From " line
+ * at @inout_pos, and lets the @pool parse them. */
+static ImportMboxBatch *
+import_mbox_batch_new (GBytes *mapped_bytes,
+                       gsize *inout_pos,
+                       GThreadPool *pool,
+                       GCancellable *cancellable)
+{
+	ImportMboxBatch *batch;
+	const gchar *data;
+	gsize len, pos, batch_bytes = 0;
+	guint ii;
+
+	data = g_bytes_get_data (mapped_bytes, &len);
+	pos = *inout_pos;
+
+	batch = g_new0 (ImportMboxBatch, 1);
+	g_mutex_init (&batch->lock);
+	g_cond_init (&batch->cond);
+	batch->items = g_ptr_array_new_with_free_func (import_mbox_item_free);
+	batch->cancellable = cancellable;
+
+	while (pos < len &&
+	       batch->items->len < IMPORT_MBOX_BATCH_MESSAGES &&
+	       batch_bytes < IMPORT_MBOX_BATCH_BYTES) {
+		ImportMboxItem *item;
+		const gchar *eol;
+		gsize start, end, next;
+
+		next = import_mbox_find_from_line (data, len, pos + 1);
+
+		eol = memchr (data + pos, '\n', next - pos);
+		start = eol ? eol - data + 1 : next;
+		end = next;
+
+		/* The empty line before the next "From " line is a separator */
+		if (end < len && end - start >= 2 && data[end - 1] == '\n' && data[end - 2] == '\n')
+			end--;
+
+		item = g_new0 (ImportMboxItem, 1);
+		item->batch = batch;
+		item->bytes = g_bytes_new_from_bytes (mapped_bytes, start, end - start);
+		item->end_offset = next;
+
+		g_ptr_array_add (batch->items, item);
+
+		batch_bytes += next - pos;
+		pos = next;
+	}
+
+	*inout_pos = pos;
+
+	batch->n_pending = batch->items->len;
+
+	for (ii = 0; ii < batch->items->len; ii++)
+		g_thread_pool_push (pool, batch->items->pdata[ii], NULL);
+
+	return batch;
+}
+
+static void
+import_mbox_batch_wait (ImportMboxBatch *batch)
+{
+	g_mutex_lock (&batch->lock);
+	while (batch->n_pending)
+		g_cond_wait (&batch->cond, &batch->lock);
+	g_mutex_unlock (&batch->lock);
+}
+
+static void
+import_mbox_batch_free (ImportMboxBatch *batch)
+{
+	g_ptr_array_unref (batch->items);
+	g_mutex_clear (&batch->lock);
+	g_cond_clear (&batch->cond);
+	g_free (batch);
+}
+
+/* Appends the parsed messages of the @batch in the mbox order; returns
+ * FALSE when the import should stop. */
+static gboolean
+import_mbox_batch_append (CamelFolder *folder,
+                          ImportMboxBatch *batch,
+                          gsize file_size,
+                          GCancellable *cancellable,
+                          GError **error)
+{
+	guint ii;
+
+	for (ii = 0; ii < batch->items->len; ii++) {
+		ImportMboxItem *item = batch->items->pdata[ii];
+
+		if (g_cancellable_is_cancelled (cancellable))
+			return FALSE;
+
+		/* set exception? */
+		if (!item->message)
+			return FALSE;
+
+		if (!import_mbox_append_message (folder, item->message, item->flags, cancellable, error))
+			return FALSE;
+
+		camel_operation_progress (cancellable, (gint) (100.0 * ((gdouble) item->end_offset / (gdouble) file_size)));
+
+		/* Release the message as soon as possible */
+		g_clear_object (&item->message);
+	}
+
+	return TRUE;
+}
+
+/**
+ * mail_importer_import_mbox_file_sync:
+ * @folder: a #CamelFolder to import to
+ * @path: a path to an mbox file
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Imports all messages from the mbox file @path into the @folder. The file
+ * is memory-mapped and its messages are parsed in worker threads, while
+ * the calling thread appends them to the @folder in the mbox order. When
+ * the file is not an mbox, it is imported as a single message.
+ *
+ * Returns: whether succeeded
+ *
+ * Since: 3.28
+ **/
+gboolean
+mail_importer_import_mbox_file_sync (CamelFolder *folder,
+                                     const gchar *path,
+                                     GCancellable *cancellable,
+                                     GError **error)
+{
+	GMappedFile *mapped_file;
+	GBytes *mapped_bytes;
+	GThreadPool *pool;
+	ImportMboxBatch *batch = NULL;
+	gsize len, pos;
+	gboolean success = TRUE;
+
+	g_return_val_if_fail (CAMEL_IS_FOLDER (folder), FALSE);
+	g_return_val_if_fail (path != NULL, FALSE);
+
+	mapped_file = g_mapped_file_new (path, FALSE, error);
+	if (!mapped_file)
+		return FALSE;
+
+	mapped_bytes = g_mapped_file_get_bytes (mapped_file);
+	g_mapped_file_unref (mapped_file);
+
+	len = g_bytes_get_size (mapped_bytes);
+
+	pool = g_thread_pool_new (import_mbox_parse_thread, NULL, g_get_num_processors (), FALSE, NULL);
+
+	camel_operation_push_message (
+		cancellable, _("Importing “%s”"),
+		camel_folder_get_display_name (folder));
+	camel_folder_freeze (folder);
+
+	pos = len ? import_mbox_find_from_line (g_bytes_get_data (mapped_bytes, NULL), len, 0) : 0;
+
+	if (pos < len) {
+		camel_operation_progress (cancellable, (gint) (100.0 * ((gdouble) pos / (gdouble) len)));
+
+		batch = import_mbox_batch_new (mapped_bytes, &pos, pool, cancellable);
+	} else if (!g_cancellable_is_cancelled (cancellable)) {
+		CamelStream *stream;
+
+		/* Not an mbox, try to import it as a single message */
+		stream = camel_stream_fs_new_with_name (path, O_RDONLY, 0, NULL);
+		if (stream) {
+			CamelMimeMessage *msg;
+
+			msg = camel_mime_message_new ();
+
+			if (camel_data_wrapper_construct_from_stream_sync ((CamelDataWrapper *) msg, stream, NULL, NULL))
+				success = import_mbox_append_message (folder, msg, import_mbox_get_flags (msg), cancellable, error);
+
+			g_object_unref (msg);
+			g_object_unref (stream);
+		}
+	}
+
+	while (batch) {
+		ImportMboxBatch *next_batch = NULL;
+
+		/* Parse the next batch while appending this one */
+		if (pos < len && !g_cancellable_is_cancelled (cancellable))
+			next_batch = import_mbox_batch_new (mapped_bytes, &pos, pool, cancellable);
+
+		import_mbox_batch_wait (batch);
+
+		if (success && !import_mbox_batch_append (folder, batch, len, cancellable, error)) {
+			success = FALSE;
+			pos = len;
+		}
+
+		import_mbox_batch_free (batch);
+		batch = next_batch;
+	}
+
+	g_thread_pool_free (pool, FALSE, TRUE);
+
+	/* Not passing a GCancellable or GError here. */
+	camel_folder_synchronize_sync (folder, FALSE, NULL, NULL);
+	camel_folder_thaw (folder);
+	camel_operation_pop_message (cancellable);
+
+	g_bytes_unref (mapped_bytes);
+
+	return success && !(error && *error);
 }
 
 static void
@@ -143,9 +473,7 @@ import_mbox_exec (struct _import_mbox_msg *m,
                   GError **error)
 {
 	CamelFolder *folder;
-	CamelMimeParser *mp = NULL;
 	struct stat st;
-	gint fd;
 
 	if (g_stat (m->path, &st) == -1) {
 		g_warning (
@@ -166,88 +494,23 @@ import_mbox_exec (struct _import_mbox_msg *m,
 		return;
 
 	if (S_ISREG (st.st_mode)) {
-		gboolean any_read = FALSE;
+		GError *local_error = NULL;
 
-		fd = g_open (m->path, O_RDONLY | O_BINARY, 0);
-		if (fd == -1) {
+		if (!mail_importer_import_mbox_file_sync (folder, m->path, cancellable, &local_error) &&
+		    local_error && local_error->domain == G_FILE_ERROR) {
 			g_warning (
 				"cannot find source file to import '%s': %s",
-				m->path, g_strerror (errno));
-			goto fail1;
-		}
-
-		mp = camel_mime_parser_new ();
-		camel_mime_parser_scan_from (mp, TRUE);
-		if (camel_mime_parser_init_with_fd (mp, fd) == -1) {
-			/* will never happen - 0 is unconditionally returned */
-			goto fail2;
+				m->path, local_error->message);
+			g_clear_error (&local_error);
 		}
 
-		camel_operation_push_message (
-			cancellable, _("Importing “%s”"),
-			camel_folder_get_display_name (folder));
-		camel_folder_freeze (folder);
-		while (camel_mime_parser_step (mp, NULL, NULL) == CAMEL_MIME_PARSER_STATE_FROM &&
-		       !g_cancellable_is_cancelled (cancellable)) {
-
-			CamelMimeMessage *msg;
-			gint pc = 0;
-
-			any_read = TRUE;
-
-			if (st.st_size > 0)
-				pc = (gint) (100.0 * ((gdouble)
-					camel_mime_parser_tell (mp) /
-					(gdouble) st.st_size));
-			camel_operation_progress (cancellable, pc);
-
-			msg = camel_mime_message_new ();
-			if (!camel_mime_part_construct_from_parser_sync (
-				(CamelMimePart *) msg, mp, NULL, NULL)) {
-				/* set exception? */
-				g_object_unref (msg);
-				break;
-			}
-
-			import_mbox_add_message (folder, msg, cancellable, error);
-
-			g_object_unref (msg);
-
-			if (error && *error != NULL)
-				break;
-
-			camel_mime_parser_step (mp, NULL, NULL);
-		}
-
-		if (!any_read && !g_cancellable_is_cancelled (cancellable)) {
-			CamelStream *stream;
-
-			stream = camel_stream_fs_new_with_name (m->path, O_RDONLY, 0, NULL);
-			if (stream) {
-				CamelMimeMessage *msg;
-
-				msg = camel_mime_message_new ();
-
-				if (camel_data_wrapper_construct_from_stream_sync ((CamelDataWrapper *) msg, stream, NULL, NULL))
-					import_mbox_add_message (folder, msg, cancellable, error);
-
-				g_object_unref (msg);
-				g_object_unref (stream);
-			}
-		}
-		/* Not passing a GCancellable or GError here. */
-		camel_folder_synchronize_sync (folder, FALSE, NULL, NULL);
-		camel_folder_thaw (folder);
-		camel_operation_pop_message (cancellable);
-	fail2:
-		g_object_unref (mp);
+		if (local_error)
+			g_propagate_error (error, local_error);
 	}
-fail1:
+
 	/* Not passing a GCancellable or GError here. */
 	camel_folder_synchronize_sync (folder, FALSE, NULL, NULL);
 	g_object_unref (folder);
-	/* 'fd' is freed together with 'mp' */
-	/* coverity[leaked_handle] */
 }
 
 static void
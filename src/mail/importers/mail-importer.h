@@ -57,6 +57,11 @@ void		mail_importer_import_mbox_sync	(EMailSession *session,
 						 const gchar *path,
 						 const gchar *folderuri,
 						 GCancellable *cancellable);
+gboolean	mail_importer_import_mbox_file_sync
+						(CamelFolder *folder,
+						 const gchar *path,
+						 GCancellable *cancellable,
+						 GError **error);
 
 gint		mail_importer_import_kmail      (EMailSession *session,
 						 const gchar *path,
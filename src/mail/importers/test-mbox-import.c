@@ -0,0 +1,209 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Imports a synthetic mbox into a temporary maildir folder, verifies
+ * the message count and prints the messages per second.
+ * Usage:
+ *    test-mbox-import [N_MESSAGES]
+ */
+
+#include "evolution-config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glib/gstdio.h>
+
+#include "mail-importer.h"
+
+typedef CamelSession BenchSession;
+typedef CamelSessionClass BenchSessionClass;
+
+static GType bench_session_get_type (void);
+
+G_DEFINE_TYPE (BenchSession, bench_session, CAMEL_TYPE_SESSION)
+
+static void
+bench_session_class_init (BenchSessionClass *class)
+{
+}
+
+static void
+bench_session_init (BenchSession *session)
+{
+}
+
+static const gchar *status_headers[] = {
+	"",
+	"Status: RO\n",
+	"X-Mozilla-Status: 0005\n",
+	"Status: R\nX-Status: F\n"
+};
+
+static gchar *
+generate_mbox (const gchar *tmp_dir,
+               gint n_messages)
+{
+	GRand *rand;
+	GString *mbox;
+	gchar *filename;
+	gint ii, jj;
+
+	rand = g_rand_new_with_seed (42);
+	mbox = g_string_sized_new (n_messages * 1536);
+
+	for (ii = 0; ii < n_messages; ii++) {
+		g_string_append_printf (mbox,
+			"From user%d@example.com Mon Jan  1 00:00:00 2018\n"
+			"From: User %d <user%d@example.com>\n"
+			"To: someone@example.com\n"
+			"Subject: Message %d\n"
+			"Date: Mon, 1 Jan 2018 00:%02d:00 +0000\n"
+			"Message-ID: <%d@example.com>\n"
+			"MIME-Version: 1.0\n"
+			"Content-Type: text/plain; charset=utf-8\n"
+			"%s"
+			"\n",
+			ii % 100, ii % 100, ii % 100, ii, ii % 60, ii,
+			status_headers[ii % G_N_ELEMENTS (status_headers)]);
+
+		for (jj = g_rand_int_range (rand, 5, 40); jj > 0; jj--)
+			g_string_append (mbox, "The quick brown fox jumps over the lazy dog, again and again.\n");
+
+		/* A line needing the mbox escaping */
+		g_string_append (mbox, ">From the archive\n\n");
+	}
+
+	g_rand_free (rand);
+
+	filename = g_build_filename (tmp_dir, "bench.mbox", NULL);
+
+	if (!g_file_set_contents (filename, mbox->str, mbox->len, NULL)) {
+		g_free (filename);
+		filename = NULL;
+	}
+
+	g_string_free (mbox, TRUE);
+
+	return filename;
+}
+
+static void
+remove_recursively (const gchar *path)
+{
+	GDir *dir;
+
+	dir = g_dir_open (path, 0, NULL);
+	if (dir) {
+		const gchar *name;
+
+		while ((name = g_dir_read_name (dir))) {
+			gchar *child = g_build_filename (path, name, NULL);
+
+			remove_recursively (child);
+			g_free (child);
+		}
+
+		g_dir_close (dir);
+	}
+
+	g_remove (path);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	CamelSession *session;
+	CamelService *service;
+	CamelSettings *settings;
+	CamelFolder *folder;
+	GError *local_error = NULL;
+	gchar *tmp_dir, *mbox_filename, *store_dir;
+	gint64 started, elapsed;
+	gint n_messages, n_imported;
+	gint res = 0;
+
+	n_messages = argc > 1 ? MAX (1, atoi (argv[1])) : 10000;
+
+	tmp_dir = g_dir_make_tmp ("test-mbox-import-XXXXXX", &local_error);
+	if (!tmp_dir) {
+		fprintf (stderr, "Failed to create temporary directory: %s\n", local_error->message);
+		return 1;
+	}
+
+	store_dir = g_build_filename (tmp_dir, "store", NULL);
+	mbox_filename = generate_mbox (tmp_dir, n_messages);
+
+	camel_init (tmp_dir, FALSE);
+	camel_provider_init ();
+
+	session = g_object_new (bench_session_get_type (),
+		"user-data-dir", tmp_dir,
+		"user-cache-dir", tmp_dir,
+		NULL);
+
+	service = camel_session_add_service (session, "bench-store", "maildir", CAMEL_PROVIDER_STORE, &local_error);
+	if (!service) {
+		fprintf (stderr, "Failed to create a maildir store: %s\n", local_error->message);
+		res = 1;
+		goto exit;
+	}
+
+	settings = camel_service_ref_settings (service);
+	camel_local_settings_set_path (CAMEL_LOCAL_SETTINGS (settings), store_dir);
+	g_object_unref (settings);
+
+	folder = camel_store_get_folder_sync (CAMEL_STORE (service), "Inbox", CAMEL_STORE_FOLDER_CREATE, NULL, &local_error);
+	if (!folder) {
+		fprintf (stderr, "Failed to open the folder: %s\n", local_error->message);
+		res = 1;
+		goto exit;
+	}
+
+	started = g_get_monotonic_time ();
+
+	if (!mbox_filename || !mail_importer_import_mbox_file_sync (folder, mbox_filename, NULL, &local_error)) {
+		fprintf (stderr, "Failed to import: %s\n", local_error ? local_error->message : "Unknown error");
+		res = 1;
+	}
+
+	elapsed = g_get_monotonic_time () - started;
+
+	n_imported = camel_folder_get_message_count (folder);
+
+	printf ("Imported %d of %d messages in %.2f s, %.1f messages/s\n",
+		n_imported, n_messages, elapsed / (gdouble) G_USEC_PER_SEC,
+		n_imported / (MAX (elapsed, 1) / (gdouble) G_USEC_PER_SEC));
+
+	if (n_imported != n_messages) {
+		fprintf (stderr, "Expected %d messages, but the folder has %d\n", n_messages, n_imported);
+		res = 1;
+	}
+
+	g_object_unref (folder);
+
+exit:
+	g_clear_error (&local_error);
+	g_clear_object (&service);
+	g_object_unref (session);
+
+	remove_recursively (tmp_dir);
+
+	g_free (mbox_filename);
+	g_free (store_dir);
+	g_free (tmp_dir);
+
+	return res;
+}
@@ -71,6 +71,11 @@
 #define EXCLUDE_DELETED_MESSAGES_EXPR	"(not (system-flag \"deleted\"))"
 #define EXCLUDE_JUNK_MESSAGES_EXPR	"(not (system-flag \"junk\"))"
 
+/* Up to this many folder changes are applied to the existing tree with
+ * a notification for each node, more than that are applied with frozen
+ * tree model, letting the table adapter regenerate itself only once. */
+#define REGEN_CHANGES_NOTIFY_LIMIT	100
+
 typedef struct _ExtendedGNode ExtendedGNode;
 typedef struct _RegenData RegenData;
 
@@ -129,6 +134,20 @@ struct _MessageListPrivate {
 	gchar **re_separators;
 	GMutex re_prefixes_lock;
 
+	/* Guards the normalised_hash, which is used also from
+	 * the regen thread, and its hit/miss statistics. */
+	GMutex normalised_lock;
+	guint normalised_hits;
+	guint normalised_misses;
+	/* The regen thread sorts by the cached keys without copying them,
+	 * thus the entries dropped meanwhile are freed after it finishes. */
+	gint normalised_readers;
+	GSList *normalised_stale; /* EPoolv * */
+
+	/* Compare cache of the regen thread sort, kept for the folder */
+	GMutex sort_cmp_cache_lock;
+	gpointer sort_cmp_cache;
+
 	GdkRGBA *new_mail_bg_color;
 };
 
@@ -157,6 +176,15 @@ struct _RegenData {
 	 * we received a "folder-changed" signal from our CamelFolder. */
 	gboolean folder_changed;
 
+	/* When set, only these changes are applied to the existing tree,
+	 * instead of rebuilding it from scratch.  The regen thread splits
+	 * the changed UIDs into those to be shown (CamelMessageInfo-s)
+	 * and those to be hidden (UIDs from camel_pstring_strdup()). */
+	CamelFolderChangeInfo *changes;
+	GPtrArray *changes_shown;
+	GPtrArray *changes_hidden;
+	gboolean changes_have_replies; /* to an added message, in threads */
+
 	CamelFolder *folder;
 	GPtrArray *summary;
 
@@ -284,7 +312,8 @@ static gint	on_click			(ETree *tree,
 
 static void	mail_regen_list			(MessageList *message_list,
 						 const gchar *search,
-						 gboolean folder_changed);
+						 gboolean folder_changed,
+						 CamelFolderChangeInfo *changes);
 static void	mail_regen_cancel		(MessageList *message_list);
 
 static void	clear_info			(gchar *key,
@@ -516,6 +545,15 @@ regen_data_unref (RegenData *regen_data)
 
 		g_free (regen_data->search);
 
+		if (regen_data->changes != NULL)
+			camel_folder_change_info_free (regen_data->changes);
+
+		if (regen_data->changes_shown != NULL)
+			g_ptr_array_unref (regen_data->changes_shown);
+
+		if (regen_data->changes_hidden != NULL)
+			g_ptr_array_unref (regen_data->changes_hidden);
+
 		if (regen_data->thread_tree != NULL)
 			camel_folder_thread_messages_unref (
 				regen_data->thread_tree);
@@ -744,6 +782,65 @@ get_message_info (MessageList *message_list,
 	return node->data;
 }
 
+/* Logs and resets the normalised_hash statistics;
+ * the caller should hold the normalised_lock. */
+static void
+message_list_report_normalised_stats (MessageList *message_list,
+                                      const gchar *where)
+{
+	if (message_list->priv->normalised_hits || message_list->priv->normalised_misses) {
+		g_debug (
+			"%s: collation keys: %u hits, %u misses, %u messages cached", where,
+			message_list->priv->normalised_hits,
+			message_list->priv->normalised_misses,
+			g_hash_table_size (message_list->normalised_hash));
+	}
+
+	message_list->priv->normalised_hits = 0;
+	message_list->priv->normalised_misses = 0;
+}
+
+/* Frees the @poolv, or postpones it while the regen thread may use
+ * its strings; the caller should hold the normalised_lock. */
+static void
+message_list_release_normalised (MessageList *message_list,
+                                 EPoolv *poolv)
+{
+	if (message_list->priv->normalised_readers > 0)
+		message_list->priv->normalised_stale = g_slist_prepend (message_list->priv->normalised_stale, poolv);
+	else
+		e_poolv_destroy (poolv);
+}
+
+/* Drops the cached keys of the @uid, or of all messages when it is %NULL;
+ * the caller should hold the normalised_lock. */
+static void
+message_list_drop_normalised (MessageList *message_list,
+                              const gchar *uid)
+{
+	gpointer key, value;
+
+	if (uid) {
+		if (g_hash_table_lookup_extended (message_list->normalised_hash, uid, &key, &value)) {
+			g_hash_table_steal (message_list->normalised_hash, uid);
+			camel_pstring_free (key);
+			message_list_release_normalised (message_list, value);
+		}
+	} else {
+		GHashTableIter iter;
+
+		g_hash_table_iter_init (&iter, message_list->normalised_hash);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			g_hash_table_iter_steal (&iter);
+			camel_pstring_free (key);
+			message_list_release_normalised (message_list, value);
+		}
+	}
+}
+
+/* Returns the normalised (collation key for the subject) string, owned by
+ * the normalised_hash; it stays valid until the message changes, or, for
+ * the regen thread, until its sort finishes. */
 static const gchar *
 get_normalised_string (MessageList *message_list,
                        CamelMessageInfo *info,
@@ -777,16 +874,27 @@ get_normalised_string (MessageList *message_list,
 	if (string == NULL || string[0] == '\0')
 		return "";
 
+	g_mutex_lock (&message_list->priv->normalised_lock);
+
 	poolv = g_hash_table_lookup (message_list->normalised_hash, camel_message_info_get_uid (info));
 	if (poolv == NULL) {
 		poolv = e_poolv_new (NORMALISED_LAST);
-		g_hash_table_insert (message_list->normalised_hash, (gchar *) camel_message_info_get_uid (info), poolv);
+		g_hash_table_insert (
+			message_list->normalised_hash,
+			(gchar *) camel_pstring_strdup (camel_message_info_get_uid (info)),
+			poolv);
 	} else {
 		str = e_poolv_get (poolv, index);
-		if (*str)
+		if (*str) {
+			message_list->priv->normalised_hits++;
+			g_mutex_unlock (&message_list->priv->normalised_lock);
+
 			return str;
+		}
 	}
 
+	message_list->priv->normalised_misses++;
+
 	if (col == COL_SUBJECT_NORM) {
 		gint skip_len;
 		const gchar *subject;
@@ -820,8 +928,11 @@ get_normalised_string (MessageList *message_list,
 	}
 
 	e_poolv_set (poolv, index, normalised, TRUE);
+	str = e_poolv_get (poolv, index);
+
+	g_mutex_unlock (&message_list->priv->normalised_lock);
 
-	return e_poolv_get (poolv, index);
+	return str;
 }
 
 static void
@@ -1160,6 +1271,70 @@ message_list_can_select (MessageList *message_list,
 	return ml_search_path (message_list, direction, flags, mask) != NULL;
 }
 
+/**
+ * message_list_get_adjacent_uids:
+ * @message_list: a #MessageList
+ * @direction: a #MessageListSelectDirection, only the direction bit is used
+ * @max_count: how many UIDs to return at most
+ *
+ * Returns UIDs of up to @max_count messages following or preceding
+ * the cursor row, in the current view order, nearest first. Rows
+ * hidden inside collapsed threads are not included.
+ *
+ * Free the returned array with g_ptr_array_unref().
+ *
+ * Returns: (transfer container) (element-type utf8): a #GPtrArray of UIDs
+ *
+ * Since: 3.28
+ **/
+GPtrArray *
+message_list_get_adjacent_uids (MessageList *message_list,
+                                MessageListSelectDirection direction,
+                                guint max_count)
+{
+	ETreeTableAdapter *adapter;
+	GPtrArray *uids;
+	GNode *node;
+	gint row_count, row, step;
+
+	g_return_val_if_fail (IS_MESSAGE_LIST (message_list), NULL);
+
+	uids = g_ptr_array_new_with_free_func ((GDestroyNotify) camel_pstring_free);
+
+	if (message_list->cursor_uid == NULL || max_count == 0)
+		return uids;
+
+	node = g_hash_table_lookup (
+		message_list->uid_nodemap,
+		message_list->cursor_uid);
+	if (node == NULL)
+		return uids;
+
+	adapter = e_tree_get_table_adapter (E_TREE (message_list));
+	row_count = e_table_model_row_count (E_TABLE_MODEL (adapter));
+
+	row = e_tree_table_adapter_row_of_node (adapter, node);
+	if (row == -1)
+		return uids;
+
+	if ((direction & MESSAGE_LIST_SELECT_DIRECTION) == MESSAGE_LIST_SELECT_NEXT)
+		step = 1;
+	else
+		step = -1;
+
+	for (row += step; row >= 0 && row < row_count && uids->len < max_count; row += step) {
+		node = e_tree_table_adapter_node_at_row (adapter, row);
+
+		/* Skip dummy thread nodes */
+		if (node == NULL || node->data == NULL)
+			continue;
+
+		g_ptr_array_add (uids, (gpointer) camel_pstring_strdup (get_message_uid (message_list, node)));
+	}
+
+	return uids;
+}
+
 /**
  * message_list_select_uid:
  * @message_list:
@@ -2799,7 +2974,7 @@ ml_tree_sorting_changed (ETreeTableAdapter *adapter,
 		/* Invalidate the thread tree. */
 		message_list_set_thread_tree (message_list, NULL);
 
-		mail_regen_list (message_list, NULL, FALSE);
+		mail_regen_list (message_list, NULL, FALSE, NULL);
 
 		return TRUE;
 	} else if (group_by_threads) {
@@ -3082,7 +3257,9 @@ message_list_finalize (GObject *object)
 {
 	MessageList *message_list = MESSAGE_LIST (object);
 
+	message_list_drop_normalised (message_list, NULL);
 	g_hash_table_destroy (message_list->normalised_hash);
+	g_slist_free_full (message_list->priv->normalised_stale, (GDestroyNotify) e_poolv_destroy);
 
 	if (message_list->priv->thread_tree != NULL)
 		camel_folder_thread_messages_unref (
@@ -3097,6 +3274,11 @@ message_list_finalize (GObject *object)
 	g_mutex_clear (&message_list->priv->regen_lock);
 	g_mutex_clear (&message_list->priv->thread_tree_lock);
 	g_mutex_clear (&message_list->priv->re_prefixes_lock);
+	g_mutex_clear (&message_list->priv->normalised_lock);
+	g_mutex_clear (&message_list->priv->sort_cmp_cache_lock);
+
+	if (message_list->priv->sort_cmp_cache)
+		e_table_sorting_utils_free_cmp_cache (message_list->priv->sort_cmp_cache);
 
 	clear_selection (message_list, &message_list->priv->clipboard);
 
@@ -3781,8 +3963,8 @@ message_list_init (MessageList *message_list)
 
 	message_list->normalised_hash = g_hash_table_new_full (
 		g_str_hash, g_str_equal,
-		(GDestroyNotify) NULL,
-		(GDestroyNotify) e_poolv_destroy);
+		(GDestroyNotify) camel_pstring_free,
+		(GDestroyNotify) NULL);
 
 	message_list->uid_nodemap = g_hash_table_new (g_str_hash, g_str_equal);
 
@@ -3792,6 +3974,8 @@ message_list_init (MessageList *message_list)
 	g_mutex_init (&message_list->priv->regen_lock);
 	g_mutex_init (&message_list->priv->thread_tree_lock);
 	g_mutex_init (&message_list->priv->re_prefixes_lock);
+	g_mutex_init (&message_list->priv->normalised_lock);
+	g_mutex_init (&message_list->priv->sort_cmp_cache_lock);
 
 	/* TODO: Should this only get the selection if we're realised? */
 	p = message_list->priv;
@@ -4781,10 +4965,16 @@ message_list_folder_changed (CamelFolder *folder,
 		changes ? changes->uid_recent->len : -1,
 		camel_folder_get_full_name (folder)));
 	if (changes != NULL) {
+		g_mutex_lock (&message_list->priv->normalised_lock);
+
 		for (i = 0; i < changes->uid_removed->len; i++)
-			g_hash_table_remove (
-				message_list->normalised_hash,
-				changes->uid_removed->pdata[i]);
+			message_list_drop_normalised (message_list, changes->uid_removed->pdata[i]);
+
+		/* The subject or the addresses could be changed too */
+		for (i = 0; i < changes->uid_changed->len; i++)
+			message_list_drop_normalised (message_list, changes->uid_changed->pdata[i]);
+
+		g_mutex_unlock (&message_list->priv->normalised_lock);
 
 		/* Check if the hidden state has changed.
 		 * If so, modify accordingly and regenerate. */
@@ -4826,7 +5016,7 @@ message_list_folder_changed (CamelFolder *folder,
 		   had been set. There could happen a race condition on folder enter which prevented
 		   the message list to scroll to the cursor position due to the folder_changed = TRUE,
 		   by cancelling the full rebuild request. */
-		mail_regen_list (message_list, NULL, !message_list->just_set_folder);
+		mail_regen_list (message_list, NULL, !message_list->just_set_folder, altered_changes);
 	}
 
 	if (altered_changes != NULL)
@@ -4883,7 +5073,17 @@ message_list_set_folder (MessageList *message_list,
 	}
 
 	/* reset the normalised sort performance hack */
-	g_hash_table_remove_all (message_list->normalised_hash);
+	g_mutex_lock (&message_list->priv->normalised_lock);
+	message_list_report_normalised_stats (message_list, G_STRFUNC);
+	message_list_drop_normalised (message_list, NULL);
+	g_mutex_unlock (&message_list->priv->normalised_lock);
+
+	g_mutex_lock (&message_list->priv->sort_cmp_cache_lock);
+	if (message_list->priv->sort_cmp_cache) {
+		e_table_sorting_utils_free_cmp_cache (message_list->priv->sort_cmp_cache);
+		message_list->priv->sort_cmp_cache = NULL;
+	}
+	g_mutex_unlock (&message_list->priv->sort_cmp_cache_lock);
 
 	mail_regen_cancel (message_list);
 
@@ -4977,7 +5177,7 @@ message_list_set_folder (MessageList *message_list,
 		message_list->priv->folder_changed_handler_id = handler_id;
 
 		if (message_list->frozen == 0)
-			mail_regen_list (message_list, NULL, FALSE);
+			mail_regen_list (message_list, NULL, FALSE, NULL);
 		else
 			message_list->priv->thaw_needs_regen = TRUE;
 	}
@@ -5032,7 +5232,7 @@ message_list_set_group_by_threads (MessageList *message_list,
 
 	/* Changing this property triggers a message list regen. */
 	if (message_list->frozen == 0)
-		mail_regen_list (message_list, NULL, FALSE);
+		mail_regen_list (message_list, NULL, FALSE, NULL);
 	else
 		message_list->priv->thaw_needs_regen = TRUE;
 }
@@ -5063,7 +5263,7 @@ message_list_set_show_deleted (MessageList *message_list,
 
 	/* Changing this property triggers a message list regen. */
 	if (message_list->frozen == 0)
-		mail_regen_list (message_list, NULL, FALSE);
+		mail_regen_list (message_list, NULL, FALSE, NULL);
 	else
 		message_list->priv->thaw_needs_regen = TRUE;
 }
@@ -5094,7 +5294,7 @@ message_list_set_show_junk (MessageList *message_list,
 
 	/* Changing this property triggers a message list regen. */
 	if (message_list->frozen == 0)
-		mail_regen_list (message_list, NULL, FALSE);
+		mail_regen_list (message_list, NULL, FALSE, NULL);
 	else
 		message_list->priv->thaw_needs_regen = TRUE;
 }
@@ -5132,7 +5332,7 @@ message_list_set_show_subject_above_sender (MessageList *message_list,
 		if (message_list->priv->folder &&
 		    gtk_widget_get_realized (GTK_WIDGET (message_list)) &&
 		    gtk_widget_get_visible (GTK_WIDGET (message_list)))
-			mail_regen_list (message_list, NULL, FALSE);
+			mail_regen_list (message_list, NULL, FALSE, NULL);
 	}
 
 	g_object_notify (G_OBJECT (message_list), "show-subject-above-sender");
@@ -5583,7 +5783,7 @@ message_list_thaw (MessageList *message_list)
 		else
 			search = NULL;
 
-		mail_regen_list (message_list, search, FALSE);
+		mail_regen_list (message_list, search, FALSE, NULL);
 
 		g_free (message_list->frozen_search);
 		message_list->frozen_search = NULL;
@@ -5601,7 +5801,7 @@ message_list_set_threaded_expand_all (MessageList *message_list)
 		message_list->expand_all = 1;
 
 		if (message_list->frozen == 0)
-			mail_regen_list (message_list, NULL, FALSE);
+			mail_regen_list (message_list, NULL, FALSE, NULL);
 		else
 			message_list->priv->thaw_needs_regen = TRUE;
 	}
@@ -5616,7 +5816,7 @@ message_list_set_threaded_collapse_all (MessageList *message_list)
 		message_list->collapse_all = 1;
 
 		if (message_list->frozen == 0)
-			mail_regen_list (message_list, NULL, FALSE);
+			mail_regen_list (message_list, NULL, FALSE, NULL);
 		else
 			message_list->priv->thaw_needs_regen = TRUE;
 	}
@@ -5648,7 +5848,7 @@ message_list_set_search (MessageList *message_list,
 	message_list_set_thread_tree (message_list, NULL);
 
 	if (message_list->frozen == 0)
-		mail_regen_list (message_list, search ? search : "", FALSE);
+		mail_regen_list (message_list, search ? search : "", FALSE, NULL);
 	else {
 		g_free (message_list->frozen_search);
 		message_list->frozen_search = g_strdup (search);
@@ -5809,7 +6009,7 @@ ml_sort_uids_by_tree (MessageList *message_list,
 	sort_data.folder = folder;
 	sort_data.sort_columns = g_ptr_array_sized_new (len);
 	sort_data.message_infos = g_hash_table_new (g_str_hash, g_str_equal);
-	sort_data.cmp_cache = e_table_sorting_utils_create_cmp_cache ();
+	sort_data.cmp_cache = NULL;
 	sort_data.cancellable = cancellable;
 
 	for (i = 0;
@@ -5860,7 +6060,28 @@ ml_sort_uids_by_tree (MessageList *message_list,
 		g_hash_table_insert (sort_data.message_infos, uid, md);
 	}
 
-	if (!g_cancellable_is_cancelled (cancellable))
+	/* The normalised values are used without copying them */
+	g_mutex_lock (&message_list->priv->normalised_lock);
+	message_list->priv->normalised_readers++;
+	g_mutex_unlock (&message_list->priv->normalised_lock);
+
+	if (!g_cancellable_is_cancelled (cancellable)) {
+		/* The compare cache is kept between the sorts, as the keys
+		 * are the values themselves; only drop it when it contains
+		 * too many values which are not used anymore. */
+		g_mutex_lock (&message_list->priv->sort_cmp_cache_lock);
+
+		if (message_list->priv->sort_cmp_cache &&
+		    g_hash_table_size (message_list->priv->sort_cmp_cache) > 2 * uids->len) {
+			e_table_sorting_utils_free_cmp_cache (message_list->priv->sort_cmp_cache);
+			message_list->priv->sort_cmp_cache = NULL;
+		}
+
+		if (!message_list->priv->sort_cmp_cache)
+			message_list->priv->sort_cmp_cache = e_table_sorting_utils_create_cmp_cache ();
+
+		sort_data.cmp_cache = message_list->priv->sort_cmp_cache;
+
 		g_qsort_with_data (
 			uids->pdata,
 			uids->len,
@@ -5868,6 +6089,9 @@ ml_sort_uids_by_tree (MessageList *message_list,
 			cmp_array_uids,
 			&sort_data);
 
+		g_mutex_unlock (&message_list->priv->sort_cmp_cache_lock);
+	}
+
 	camel_folder_summary_unlock (camel_folder_get_folder_summary (folder));
 
 	/* FIXME Teach the hash table to destroy its own data. */
@@ -5877,11 +6101,17 @@ ml_sort_uids_by_tree (MessageList *message_list,
 		&sort_data);
 	g_hash_table_destroy (sort_data.message_infos);
 
+	g_mutex_lock (&message_list->priv->normalised_lock);
+	message_list->priv->normalised_readers--;
+	if (!message_list->priv->normalised_readers) {
+		g_slist_free_full (message_list->priv->normalised_stale, (GDestroyNotify) e_poolv_destroy);
+		message_list->priv->normalised_stale = NULL;
+	}
+	g_mutex_unlock (&message_list->priv->normalised_lock);
+
 	g_ptr_array_foreach (sort_data.sort_columns, (GFunc) g_free, NULL);
 	g_ptr_array_free (sort_data.sort_columns, TRUE);
 
-	e_table_sorting_utils_free_cmp_cache (sort_data.cmp_cache);
-
 	g_object_unref (folder);
 }
 
@@ -5946,6 +6176,167 @@ message_list_regen_tweak_search_results (MessageList *message_list,
 	g_clear_object (&info);
 }
 
+/* Whether any message, other than the added ones, replies to an added
+ * message; such replies would be moved under the added message, thus
+ * the threads need to be rebuilt. The "references" search can return
+ * false positives, which only cause an unnecessary rebuild. */
+static gboolean
+message_list_regen_added_have_replies (CamelFolder *folder,
+                                       GPtrArray *added_uids,
+                                       GCancellable *cancellable)
+{
+	GHashTable *added;
+	GPtrArray *uids;
+	GString *expr;
+	gboolean have_replies = FALSE;
+	guint ii, n_ids = 0;
+
+	added = g_hash_table_new (g_str_hash, g_str_equal);
+	expr = g_string_new ("(match-all (or");
+
+	for (ii = 0; ii < added_uids->len; ii++) {
+		const gchar *uid = added_uids->pdata[ii];
+		CamelMessageInfo *info;
+		CamelSummaryMessageID msgid;
+
+		g_hash_table_add (added, (gpointer) uid);
+
+		info = camel_folder_get_message_info (folder, uid);
+		if (!info)
+			continue;
+
+		msgid.id.id = camel_message_info_get_message_id (info);
+		if (msgid.id.id) {
+			g_string_append_printf (expr, " (= \"references\" \"%lu %lu\")", (gulong) msgid.id.part.hi, (gulong) msgid.id.part.lo);
+			n_ids++;
+		}
+
+		g_object_unref (info);
+	}
+
+	g_string_append (expr, "))");
+
+	if (n_ids > 0) {
+		uids = camel_folder_search_by_expression (folder, expr->str, cancellable, NULL);
+
+		if (uids) {
+			for (ii = 0; ii < uids->len && !have_replies; ii++) {
+				have_replies = !g_hash_table_contains (added, uids->pdata[ii]);
+			}
+
+			camel_folder_search_free (folder, uids);
+		} else {
+			/* Cannot tell */
+			have_replies = TRUE;
+		}
+	}
+
+	g_string_free (expr, TRUE);
+	g_hash_table_destroy (added);
+
+	return have_replies;
+}
+
+/* Splits the UIDs from regen_data->changes into those which should be
+ * shown in the message list and those which should be hidden from it,
+ * evaluating the search expression only on the changed UIDs. */
+static void
+message_list_regen_changes (MessageList *message_list,
+                            RegenData *regen_data,
+                            const gchar *expr,
+                            gboolean show_deleted,
+                            gboolean show_junk,
+                            GCancellable *cancellable,
+                            GError **error)
+{
+	CamelFolderChangeInfo *changes = regen_data->changes;
+	CamelFolder *folder = regen_data->folder;
+	GPtrArray *candidates, *matches = NULL;
+	GHashTable *matches_hash = NULL;
+	guint ii;
+
+	regen_data->changes_shown = g_ptr_array_new_with_free_func (g_object_unref);
+	regen_data->changes_hidden = g_ptr_array_new_with_free_func ((GDestroyNotify) camel_pstring_free);
+
+	for (ii = 0; ii < changes->uid_removed->len; ii++) {
+		g_ptr_array_add (
+			regen_data->changes_hidden,
+			(gpointer) camel_pstring_strdup (changes->uid_removed->pdata[ii]));
+	}
+
+	candidates = g_ptr_array_sized_new (changes->uid_added->len + changes->uid_changed->len);
+
+	for (ii = 0; ii < changes->uid_added->len; ii++)
+		g_ptr_array_add (candidates, changes->uid_added->pdata[ii]);
+
+	for (ii = 0; ii < changes->uid_changed->len; ii++)
+		g_ptr_array_add (candidates, changes->uid_changed->pdata[ii]);
+
+	if (candidates->len > 0 && expr && *expr) {
+		matches = camel_folder_search_by_uids (folder, expr, candidates, cancellable, error);
+
+		if (!matches) {
+			g_ptr_array_free (candidates, TRUE);
+			return;
+		}
+
+		matches_hash = g_hash_table_new (g_str_hash, g_str_equal);
+
+		for (ii = 0; ii < matches->len; ii++)
+			g_hash_table_add (matches_hash, matches->pdata[ii]);
+	}
+
+	for (ii = 0; ii < candidates->len && !g_cancellable_is_cancelled (cancellable); ii++) {
+		const gchar *uid = candidates->pdata[ii];
+		CamelMessageInfo *info;
+		gboolean shown;
+
+		shown = !matches_hash || g_hash_table_contains (matches_hash, uid);
+		info = camel_folder_get_message_info (folder, uid);
+
+		/* The same as message_list_regen_tweak_search_results() does,
+		 * keep the displayed message even when it doesn't match the
+		 * search any more, so it doesn't suddenly disappear. */
+		if (!shown && info && g_strcmp0 (uid, message_list->cursor_uid) == 0) {
+			CamelMessageFlags flags;
+			gboolean uid_is_deleted;
+			gboolean uid_is_junk;
+
+			flags = camel_message_info_get_flags (info);
+			uid_is_deleted = ((flags & CAMEL_MESSAGE_DELETED) != 0);
+			uid_is_junk = ((flags & CAMEL_MESSAGE_JUNK) != 0);
+
+			if (!folder_store_supports_vjunk_folder (folder))
+				uid_is_junk = FALSE;
+
+			shown =
+				(!uid_is_junk || show_junk) &&
+				(!uid_is_deleted || show_deleted);
+		}
+
+		if (shown && info) {
+			g_ptr_array_add (regen_data->changes_shown, info);
+		} else {
+			g_ptr_array_add (regen_data->changes_hidden, (gpointer) camel_pstring_strdup (uid));
+			g_clear_object (&info);
+		}
+	}
+
+	if (regen_data->group_by_threads && !regen_data->thread_subject &&
+	    changes->uid_added->len > 0 && !g_cancellable_is_cancelled (cancellable)) {
+		regen_data->changes_have_replies = message_list_regen_added_have_replies (
+			folder, changes->uid_added, cancellable);
+	}
+
+	if (matches_hash)
+		g_hash_table_destroy (matches_hash);
+
+	if (matches)
+		camel_folder_search_free (folder, matches);
+
+	g_ptr_array_free (candidates, TRUE);
+}
+
 static void
 message_list_regen_thread (GSimpleAsyncResult *simple,
                            GObject *source_object,
@@ -6012,6 +6403,30 @@ message_list_regen_thread (GSimpleAsyncResult *simple,
 		}
 	}
 
+	/* Only the changed messages need to be searched. */
+
+	if (regen_data->changes != NULL) {
+		message_list_regen_changes (
+			message_list, regen_data, expr->str,
+			!hide_deleted, !hide_junk,
+			cancellable, &local_error);
+
+		g_string_free (expr, TRUE);
+
+		if (local_error == NULL) {
+			/* coverity[unchecked_value] */
+			g_cancellable_set_error_if_cancelled (
+				cancellable, &local_error);
+		}
+
+		if (local_error != NULL)
+			g_simple_async_result_take_error (simple, local_error);
+
+		g_object_unref (folder);
+
+		return;
+	}
+
 	/* Execute the search. */
 
 	if (expr->len == 0) {
@@ -6121,6 +6536,304 @@ exit:
 	g_object_unref (folder);
 }
 
+/* Finds the thread parent of each new message the same way as
+ * camel_folder_thread_messages_new() does: the message it replies to,
+ * or, when that is not in the folder, the closest message from its
+ * references, which is in the list. Returns the new messages ordered
+ * such that the parents come before their replies, and their parent
+ * UIDs, NULL for the top level, in the same order. Returns FALSE when
+ * the threads need to be rebuilt: when a message has references, but
+ * none of them is in the list, because such messages can be joined
+ * together at the top level. */
+static gboolean
+message_list_thread_new_messages (MessageList *message_list,
+                                  GPtrArray *new_infos,
+                                  GPtrArray **out_ordered,
+                                  GPtrArray **out_parent_uids)
+{
+	GHashTable *new_ids; /* guint64 * ~> index into new_infos + 1 */
+	GHashTable *wanted; /* guint64 * ~> GNode * */
+	GArray **references;
+	guint64 *ids;
+	GNode **parent_nodes;
+	gint *parent_indexes; /* into new_infos, -1 when not a new message */
+	guint *depths;
+	guint ii, jj, depth, max_depth = 0;
+	gboolean success = TRUE;
+
+	ids = g_new0 (guint64, new_infos->len);
+	references = g_new0 (GArray *, new_infos->len);
+	parent_nodes = g_new0 (GNode *, new_infos->len);
+	parent_indexes = g_new0 (gint, new_infos->len);
+	depths = g_new0 (guint, new_infos->len);
+
+	new_ids = g_hash_table_new (g_int64_hash, g_int64_equal);
+	wanted = g_hash_table_new (g_int64_hash, g_int64_equal);
+
+	for (ii = 0; ii < new_infos->len; ii++) {
+		ids[ii] = camel_message_info_get_message_id (new_infos->pdata[ii]);
+		if (ids[ii])
+			g_hash_table_insert (new_ids, &ids[ii], GUINT_TO_POINTER (ii + 1));
+
+		references[ii] = camel_message_info_dup_references (new_infos->pdata[ii]);
+		parent_indexes[ii] = -1;
+	}
+
+	for (ii = 0; ii < new_infos->len; ii++) {
+		for (jj = 0; references[ii] && jj < references[ii]->len; jj++) {
+			guint64 *ref = &g_array_index (references[ii], guint64, jj);
+
+			if (!g_hash_table_contains (new_ids, ref))
+				g_hash_table_insert (wanted, ref, NULL);
+		}
+	}
+
+	/* Look up the referenced messages in the list */
+	if (g_hash_table_size (wanted) > 0) {
+		GHashTableIter iter;
+		gpointer value;
+
+		g_hash_table_iter_init (&iter, message_list->uid_nodemap);
+		while (g_hash_table_iter_next (&iter, NULL, &value)) {
+			GNode *node = value;
+			guint64 id;
+
+			id = camel_message_info_get_message_id (node->data);
+
+			/* Keeps the original key */
+			if (id && g_hash_table_contains (wanted, &id))
+				g_hash_table_insert (wanted, &id, node);
+		}
+	}
+
+	/* The first reference is the message it replies to */
+	for (ii = 0; ii < new_infos->len && success; ii++) {
+		for (jj = 0; references[ii] && jj < references[ii]->len; jj++) {
+			guint64 *ref = &g_array_index (references[ii], guint64, jj);
+			guint index;
+
+			index = GPOINTER_TO_UINT (g_hash_table_lookup (new_ids, ref));
+			if (index > 0 && index - 1 != ii) {
+				parent_indexes[ii] = index - 1;
+				break;
+			}
+
+			parent_nodes[ii] = g_hash_table_lookup (wanted, ref);
+			if (parent_nodes[ii])
+				break;
+		}
+
+		success = !references[ii] || !references[ii]->len ||
+			parent_nodes[ii] || parent_indexes[ii] != -1;
+	}
+
+	/* A parent, which is a new message, is inserted before its replies */
+	for (ii = 0; ii < new_infos->len && success; ii++) {
+		gint index = ii;
+
+		for (depth = 0; parent_indexes[index] != -1 && success; depth++) {
+			index = parent_indexes[index];
+
+			/* A loop in the references */
+			if (depth >= new_infos->len)
+				success = FALSE;
+		}
+
+		depths[ii] = depth;
+		max_depth = MAX (max_depth, depth);
+	}
+
+	if (success) {
+		*out_ordered = g_ptr_array_sized_new (new_infos->len);
+		*out_parent_uids = g_ptr_array_sized_new (new_infos->len);
+
+		for (depth = 0; depth <= max_depth; depth++) {
+			for (ii = 0; ii < new_infos->len; ii++) {
+				const gchar *parent_uid = NULL;
+
+				if (depths[ii] != depth)
+					continue;
+
+				if (parent_indexes[ii] != -1)
+					parent_uid = camel_message_info_get_uid (new_infos->pdata[parent_indexes[ii]]);
+				else if (parent_nodes[ii])
+					parent_uid = camel_message_info_get_uid (parent_nodes[ii]->data);
+
+				g_ptr_array_add (*out_ordered, new_infos->pdata[ii]);
+				g_ptr_array_add (*out_parent_uids, (gpointer) parent_uid);
+			}
+		}
+	}
+
+	for (ii = 0; ii < new_infos->len; ii++) {
+		if (references[ii])
+			g_array_unref (references[ii]);
+	}
+
+	g_hash_table_destroy (wanted);
+	g_hash_table_destroy (new_ids);
+	g_free (depths);
+	g_free (parent_indexes);
+	g_free (parent_nodes);
+	g_free (references);
+	g_free (ids);
+
+	return success;
+}
+
+/* Applies the changes prepared by message_list_regen_changes() to the
+ * existing tree.  Returns FALSE when they cannot be applied in place,
+ * in which case nothing is changed and a full regen is needed. */
+static gboolean
+message_list_regen_apply_changes (MessageList *message_list,
+                                  RegenData *regen_data)
+{
+	ETreeModel *tree_model;
+	ETableItem *table_item;
+	GPtrArray *selected;
+	GPtrArray *new_infos = NULL, *new_parent_uids = NULL;
+	gboolean tree_model_frozen;
+	guint ii, n_changes;
+#ifdef TIMEIT
+	struct timeval start, end;
+	gulong diff;
+
+	printf ("Applying changes\n");
+	gettimeofday (&start, NULL);
+#endif
+
+	g_return_val_if_fail (regen_data->changes_shown != NULL, FALSE);
+	g_return_val_if_fail (regen_data->changes_hidden != NULL, FALSE);
+
+	if (message_list->priv->tree_model_root == NULL)
+		return FALSE;
+
+	n_changes = regen_data->changes_shown->len + regen_data->changes_hidden->len;
+
+	if (regen_data->group_by_threads) {
+		GPtrArray *added;
+		gboolean can_thread;
+
+		/* Threads can be kept only when none of the hidden messages
+		 * has any children, when no message in the list replies to
+		 * a new message and when the new messages are not threaded
+		 * by their subject. */
+		if (n_changes > REGEN_CHANGES_NOTIFY_LIMIT || regen_data->changes_have_replies)
+			return FALSE;
+
+		for (ii = 0; ii < regen_data->changes_hidden->len; ii++) {
+			GNode *node;
+
+			node = g_hash_table_lookup (message_list->uid_nodemap, regen_data->changes_hidden->pdata[ii]);
+			if (node && node->children)
+				return FALSE;
+		}
+
+		added = g_ptr_array_new ();
+
+		for (ii = 0; ii < regen_data->changes_shown->len; ii++) {
+			CamelMessageInfo *info = regen_data->changes_shown->pdata[ii];
+
+			if (!g_hash_table_lookup (message_list->uid_nodemap, camel_message_info_get_uid (info)))
+				g_ptr_array_add (added, info);
+		}
+
+		can_thread = !added->len || (!regen_data->thread_subject &&
+			message_list_thread_new_messages (message_list, added, &new_infos, &new_parent_uids));
+
+		g_ptr_array_free (added, TRUE);
+
+		if (!can_thread)
+			return FALSE;
+	}
+
+	tree_model = E_TREE_MODEL (message_list);
+	table_item = e_tree_get_item (E_TREE (message_list));
+
+	selected = message_list_get_selected (message_list);
+
+	tree_model_frozen = n_changes > REGEN_CHANGES_NOTIFY_LIMIT;
+
+	if (table_item)
+		e_table_item_freeze (table_item);
+
+	if (tree_model_frozen)
+		message_list_tree_model_freeze (message_list);
+
+	for (ii = 0; ii < regen_data->changes_hidden->len; ii++) {
+		GNode *node;
+
+		node = g_hash_table_lookup (message_list->uid_nodemap, regen_data->changes_hidden->pdata[ii]);
+		if (node)
+			remove_node_diff (message_list, node, 0);
+	}
+
+	for (ii = 0; ii < regen_data->changes_shown->len; ii++) {
+		CamelMessageInfo *info = regen_data->changes_shown->pdata[ii];
+		GNode *node;
+
+		node = g_hash_table_lookup (message_list->uid_nodemap, camel_message_info_get_uid (info));
+		if (node == NULL) {
+			/* Inserted below, under their thread parents */
+			if (!new_infos)
+				ml_uid_nodemap_insert (message_list, info, NULL, -1);
+		} else if (!tree_model_frozen) {
+			e_tree_model_pre_change (tree_model);
+			e_tree_model_node_data_changed (tree_model, node);
+
+			message_list_change_first_visible_parent (message_list, node);
+		}
+	}
+
+	for (ii = 0; new_infos && ii < new_infos->len; ii++) {
+		const gchar *parent_uid = new_parent_uids->pdata[ii];
+		GNode *parent = NULL, *node;
+
+		if (parent_uid)
+			parent = g_hash_table_lookup (message_list->uid_nodemap, parent_uid);
+
+		node = ml_uid_nodemap_insert (message_list, new_infos->pdata[ii], parent, -1);
+
+		if (parent && !tree_model_frozen)
+			message_list_change_first_visible_parent (message_list, node);
+	}
+
+	if (new_infos) {
+		g_ptr_array_free (new_infos, TRUE);
+		g_ptr_array_free (new_parent_uids, TRUE);
+	}
+
+	if (tree_model_frozen)
+		message_list_tree_model_thaw (message_list);
+
+	message_list_set_selected (message_list, selected);
+	g_ptr_array_unref (selected);
+
+	if (table_item) {
+		/* Do not scroll to the cursor, this is
+		 * a response to the "folder-changed" signal. */
+		table_item->queue_show_cursor = FALSE;
+		e_table_item_thaw (table_item);
+	}
+
+	if (message_list->cursor_uid && !g_hash_table_lookup (message_list->uid_nodemap, message_list->cursor_uid)) {
+		g_free (message_list->cursor_uid);
+		message_list->cursor_uid = NULL;
+		g_signal_emit (
+			message_list,
+			signals[MESSAGE_SELECTED], 0, NULL);
+	}
+
+#ifdef TIMEIT
+	gettimeofday (&end, NULL);
+	diff = end.tv_sec * 1000 + end.tv_usec / 1000;
+	diff -= start.tv_sec * 1000 + start.tv_usec / 1000;
+	printf ("Applying %u changes took %ld.%03ld seconds\n", n_changes, diff / 1000, diff % 1000);
+#endif
+
+	return TRUE;
+}
+
 static void
 message_list_regen_done_cb (GObject *source_object,
                             GAsyncResult *result,
@@ -6184,7 +6897,16 @@ message_list_regen_done_cb (GObject *source_object,
 
 	is_searching = message_list_is_searching (message_list);
 
-	if (regen_data->group_by_threads) {
+	if (regen_data->changes != NULL) {
+		if (!message_list_regen_apply_changes (message_list, regen_data)) {
+			g_signal_handlers_unblock_by_func (
+				adapter, ml_tree_sorting_changed, message_list);
+
+			/* Fall back to the full regen. */
+			mail_regen_list (message_list, NULL, TRUE, NULL);
+			return;
+		}
+	} else if (regen_data->group_by_threads) {
 		ETableItem *table_item = e_tree_get_item (E_TREE (message_list));
 		GPtrArray *selected;
 		gchar *saveuid = NULL;
@@ -6388,6 +7110,10 @@ message_list_regen_done_cb (GObject *source_object,
 
 	message_list->priv->any_row_changed = FALSE;
 	message_list->just_set_folder = FALSE;
+
+	g_mutex_lock (&message_list->priv->normalised_lock);
+	message_list_report_normalised_stats (message_list, G_STRFUNC);
+	g_mutex_unlock (&message_list->priv->normalised_lock);
 }
 
 static gboolean
@@ -6421,7 +7147,10 @@ message_list_regen_idle_cb (gpointer user_data)
 	adapter = e_tree_get_table_adapter (E_TREE (message_list));
 	row_count = e_table_model_row_count (E_TABLE_MODEL (adapter));
 
-	if (row_count <= 0) {
+	if (regen_data->changes != NULL) {
+		/* The tree is only updated, not rebuilt,
+		 * thus there is no expand state to restore. */
+	} else if (row_count <= 0) {
 		if (gtk_widget_get_visible (GTK_WIDGET (message_list))) {
 			gchar *txt;
 
@@ -6491,10 +7220,34 @@ mail_regen_cancel (MessageList *message_list)
 	}
 }
 
+/* Whether the @changes can be applied to the existing tree, without
+ * rebuilding it. The search is evaluated only on the changed messages,
+ * which doesn't work for expressions depending on other messages. */
+static gboolean
+mail_regen_can_apply_changes (MessageList *message_list,
+                              const gchar *search,
+                              CamelFolderChangeInfo *changes)
+{
+	if (changes == NULL || message_list->just_set_folder)
+		return FALSE;
+
+	if (message_list->priv->tree_model_root == NULL ||
+	    g_hash_table_size (message_list->uid_nodemap) == 0)
+		return FALSE;
+
+	if (search != NULL && strstr (search, "match-threads") != NULL)
+		return FALSE;
+
+	return TRUE;
+}
+
+/* Passing @changes regenerates only the part of the message list affected
+ * by them, otherwise the whole message list is rebuilt. */
 static void
 mail_regen_list (MessageList *message_list,
                  const gchar *search,
-                 gboolean folder_changed)
+                 gboolean folder_changed,
+                 CamelFolderChangeInfo *changes)
 {
 	GSimpleAsyncResult *simple;
 	GCancellable *cancellable;
@@ -6570,6 +7323,17 @@ mail_regen_list (MessageList *message_list,
 		if (!folder_changed)
 			old_regen_data->folder_changed = folder_changed;
 
+		/* Accumulate the changes for the scheduled regen, unless it
+		 * is going to rebuild the whole message list anyway. */
+		if (old_regen_data->changes != NULL) {
+			if (mail_regen_can_apply_changes (message_list, old_regen_data->search, changes)) {
+				camel_folder_change_info_cat (old_regen_data->changes, changes);
+			} else {
+				camel_folder_change_info_free (old_regen_data->changes);
+				old_regen_data->changes = NULL;
+			}
+		}
+
 		/* Avoid cancelling on the way out. */
 		old_regen_data = NULL;
 
@@ -6582,6 +7346,19 @@ mail_regen_list (MessageList *message_list,
 	new_regen_data->search = g_strdup (search);
 	new_regen_data->folder_changed = folder_changed;
 
+	/* The running regen is cancelled below, thus its changes are not
+	 * applied and need to be applied by this one.  When it had been
+	 * a full regen, this one has to be a full regen too. */
+	if (mail_regen_can_apply_changes (message_list, search, changes) &&
+	    (old_regen_data == NULL || old_regen_data->changes != NULL)) {
+		new_regen_data->changes = camel_folder_change_info_new ();
+
+		if (old_regen_data != NULL)
+			camel_folder_change_info_cat (new_regen_data->changes, old_regen_data->changes);
+
+		camel_folder_change_info_cat (new_regen_data->changes, changes);
+	}
+
 	/* We generate the message list content in a worker thread, and
 	 * then supply our own GAsyncReadyCallback to redraw the widget. */
 
@@ -201,6 +201,9 @@ gboolean	message_list_can_select		(MessageList *message_list,
 						 MessageListSelectDirection direction,
 						 guint32 flags,
 						 guint32 mask);
+GPtrArray *	message_list_get_adjacent_uids	(MessageList *message_list,
+						 MessageListSelectDirection direction,
+						 guint max_count);
 void		message_list_select_uid		(MessageList *message_list,
 						 const gchar *uid,
 						 gboolean with_fallback);
@@ -0,0 +1,396 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Fills a temporary mbox folder with synthetic messages, every fifth of
+ * them a reply to the previous one, shows it in a message list and prints
+ * how long the full rebuild of the list takes, compared to applying a new
+ * message and a flag change to it, both in the flat and in the threaded
+ * view. It verifies the new reply is inserted under its thread parent.
+ * It needs the evolution-source-registry service and the installed
+ * message list specification.
+ * Usage:
+ *    test-message-list [N_MESSAGES]
+ */
+
+#include "evolution-config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glib/gstdio.h>
+
+#include "message-list.h"
+
+#define WAIT_TIMEOUT_SECONDS 900
+
+typedef struct _BenchData {
+	GMainLoop *main_loop;
+	gboolean built;
+} BenchData;
+
+static void
+bench_message_list_built_cb (MessageList *message_list,
+                             BenchData *bd)
+{
+	bd->built = TRUE;
+	g_main_loop_quit (bd->main_loop);
+}
+
+static gboolean
+bench_timeout_cb (gpointer user_data)
+{
+	BenchData *bd = user_data;
+
+	g_main_loop_quit (bd->main_loop);
+
+	return FALSE;
+}
+
+/* Returns seconds since the 'started' until the message list is built,
+   or a negative value on timeout */
+static gdouble
+bench_wait_built (BenchData *bd,
+                  gint64 started)
+{
+	guint timeout_id;
+
+	bd->built = FALSE;
+
+	timeout_id = g_timeout_add_seconds (WAIT_TIMEOUT_SECONDS, bench_timeout_cb, bd);
+	g_main_loop_run (bd->main_loop);
+
+	if (!bd->built)
+		return -1.0;
+
+	g_source_remove (timeout_id);
+
+	return (g_get_monotonic_time () - started) / (gdouble) G_USEC_PER_SEC;
+}
+
+static void
+bench_report (const gchar *what,
+              gdouble seconds,
+              gint *res)
+{
+	if (seconds < 0) {
+		fprintf (stderr, "%s: Timed out\n", what);
+		*res = 1;
+	} else {
+		printf ("%-40s %.3f s\n", what, seconds);
+	}
+}
+
+static gboolean
+generate_mbox (const gchar *filename,
+               gint n_messages)
+{
+	FILE *file;
+	gint ii;
+
+	file = g_fopen (filename, "wb");
+	if (!file)
+		return FALSE;
+
+	for (ii = 0; ii < n_messages; ii++) {
+		fprintf (file,
+			"From user%d@example.com Mon Jan  1 00:00:00 2018\n"
+			"From: User %d <user%d@example.com>\n"
+			"To: someone@example.com\n"
+			"Subject: %sMessage %d\n"
+			"Date: Mon, 1 Jan 2018 %02d:%02d:%02d +0000\n"
+			"Message-ID: <%d@example.com>\n",
+			ii % 100, ii % 100, ii % 100,
+			(ii % 5) ? "Re: " : "", ii - (ii % 5),
+			(ii / 3600) % 24, (ii / 60) % 60, ii % 60, ii);
+
+		if (ii % 5)
+			fprintf (file, "In-Reply-To: <%d@example.com>\n", ii - 1);
+
+		fprintf (file,
+			"MIME-Version: 1.0\n"
+			"Content-Type: text/plain; charset=utf-8\n"
+			"\n"
+			"Message body %d\n"
+			"\n", ii);
+	}
+
+	return fclose (file) == 0;
+}
+
+static CamelMimeMessage *
+create_message (gint index,
+                gint reply_to)
+{
+	CamelMimeMessage *message;
+	CamelInternetAddress *address;
+	gchar *value;
+
+	message = camel_mime_message_new ();
+
+	address = camel_internet_address_new ();
+	camel_internet_address_add (address, "New User", "new@example.com");
+	camel_mime_message_set_from (message, address);
+	g_object_unref (address);
+
+	value = g_strdup_printf ("New message %d", index);
+	camel_mime_message_set_subject (message, value);
+	g_free (value);
+
+	value = g_strdup_printf ("%d@example.com", index);
+	camel_mime_message_set_message_id (message, value);
+	g_free (value);
+
+	if (reply_to >= 0) {
+		value = g_strdup_printf ("<%d@example.com>", reply_to);
+		camel_medium_set_header (CAMEL_MEDIUM (message), "In-Reply-To", value);
+		g_free (value);
+	}
+
+	camel_mime_message_set_date (message, CAMEL_MESSAGE_DATE_CURRENT, 0);
+	camel_mime_part_set_content (CAMEL_MIME_PART (message), "New message body\n", 17, "text/plain");
+
+	return message;
+}
+
+/* Appends a new message, optionally a reply to the message with
+   the 'reply_to' index, and returns its UID */
+static gchar *
+append_message (CamelFolder *folder,
+                gint index,
+                gint reply_to,
+                GError **error)
+{
+	CamelMimeMessage *message;
+	gchar *appended_uid = NULL;
+
+	message = create_message (index, reply_to);
+
+	if (!camel_folder_append_message_sync (folder, message, NULL, &appended_uid, NULL, error))
+		g_clear_pointer (&appended_uid, g_free);
+
+	g_object_unref (message);
+
+	return appended_uid;
+}
+
+static gboolean
+verify_thread_parent (MessageList *message_list,
+                      const gchar *uid,
+                      const gchar *parent_uid)
+{
+	GNode *node;
+
+	node = g_hash_table_lookup (message_list->uid_nodemap, uid);
+
+	return node && node->parent && node->parent->data &&
+		g_strcmp0 (camel_message_info_get_uid (node->parent->data), parent_uid) == 0;
+}
+
+static void
+remove_recursively (const gchar *path)
+{
+	GDir *dir;
+
+	dir = g_dir_open (path, 0, NULL);
+	if (dir) {
+		const gchar *name;
+
+		while ((name = g_dir_read_name (dir))) {
+			gchar *child = g_build_filename (path, name, NULL);
+
+			remove_recursively (child);
+			g_free (child);
+		}
+
+		g_dir_close (dir);
+	}
+
+	g_remove (path);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	ESourceRegistry *registry = NULL;
+	EMailSession *session = NULL;
+	CamelService *service = NULL;
+	CamelSettings *settings;
+	CamelFolder *folder = NULL;
+	GtkWidget *window = NULL, *message_list;
+	BenchData bd = { NULL, FALSE };
+	GPtrArray *uids;
+	GError *local_error = NULL;
+	gchar *tmp_dir, *dir, *store_dir, *mbox_filename;
+	gchar *uid, *parent_uid = NULL;
+	gint64 started;
+	gint n_messages;
+	gint res = 0;
+
+	n_messages = argc > 1 ? MAX (10, atoi (argv[1])) : 500000;
+
+	tmp_dir = g_dir_make_tmp ("test-message-list-XXXXXX", &local_error);
+	if (!tmp_dir) {
+		fprintf (stderr, "Failed to create temporary directory: %s\n", local_error->message);
+		return 1;
+	}
+
+	/* Do not touch the user's mail data */
+	dir = g_build_filename (tmp_dir, "data", NULL);
+	g_setenv ("XDG_DATA_HOME", dir, TRUE);
+	g_free (dir);
+
+	dir = g_build_filename (tmp_dir, "cache", NULL);
+	g_setenv ("XDG_CACHE_HOME", dir, TRUE);
+	g_free (dir);
+
+	gtk_init (&argc, &argv);
+
+	store_dir = g_build_filename (tmp_dir, "store", NULL);
+	g_mkdir_with_parents (store_dir, 0700);
+
+	mbox_filename = g_build_filename (store_dir, "Inbox", NULL);
+
+	if (!generate_mbox (mbox_filename, n_messages)) {
+		fprintf (stderr, "Failed to write '%s'\n", mbox_filename);
+		res = 1;
+		goto exit;
+	}
+
+	registry = e_source_registry_new_sync (NULL, &local_error);
+	if (!registry) {
+		fprintf (stderr, "Failed to create source registry: %s\n", local_error->message);
+		res = 1;
+		goto exit;
+	}
+
+	session = e_mail_session_new (registry);
+
+	service = camel_session_add_service (CAMEL_SESSION (session), "test-message-list", "mbox", CAMEL_PROVIDER_STORE, &local_error);
+	if (!service) {
+		fprintf (stderr, "Failed to create an mbox store: %s\n", local_error->message);
+		res = 1;
+		goto exit;
+	}
+
+	settings = camel_service_ref_settings (service);
+	camel_local_settings_set_path (CAMEL_LOCAL_SETTINGS (settings), store_dir);
+	g_object_unref (settings);
+
+	started = g_get_monotonic_time ();
+
+	folder = camel_store_get_folder_sync (CAMEL_STORE (service), "Inbox", 0, NULL, &local_error);
+	if (!folder) {
+		fprintf (stderr, "Failed to open the folder: %s\n", local_error->message);
+		res = 1;
+		goto exit;
+	}
+
+	printf ("%-40s %.3f s\n", "Opening the folder",
+		(g_get_monotonic_time () - started) / (gdouble) G_USEC_PER_SEC);
+
+	if (camel_folder_get_message_count (folder) != n_messages) {
+		fprintf (stderr, "Expected %d messages, but the folder has %d\n", n_messages, camel_folder_get_message_count (folder));
+		res = 1;
+		goto exit;
+	}
+
+	bd.main_loop = g_main_loop_new (NULL, FALSE);
+
+	window = gtk_offscreen_window_new ();
+	gtk_window_set_default_size (GTK_WINDOW (window), 800, 600);
+
+	message_list = message_list_new (session);
+	gtk_container_add (GTK_CONTAINER (window), message_list);
+	gtk_widget_show_all (window);
+
+	g_signal_connect (message_list, "message_list_built", G_CALLBACK (bench_message_list_built_cb), &bd);
+
+	/* Flat view */
+	started = g_get_monotonic_time ();
+	message_list_set_folder (MESSAGE_LIST (message_list), folder);
+	bench_report ("Full rebuild, flat", bench_wait_built (&bd, started), &res);
+
+	uid = append_message (folder, n_messages, -1, &local_error);
+	if (!uid) {
+		fprintf (stderr, "Failed to append a message: %s\n", local_error ? local_error->message : "Unknown error");
+		res = 1;
+		goto exit;
+	}
+
+	started = g_get_monotonic_time ();
+	bench_report ("New message, flat", bench_wait_built (&bd, started), &res);
+
+	started = g_get_monotonic_time ();
+	camel_folder_set_message_flags (folder, uid, CAMEL_MESSAGE_SEEN, CAMEL_MESSAGE_SEEN);
+	bench_report ("Flag change, flat", bench_wait_built (&bd, started), &res);
+
+	g_free (uid);
+
+	/* Threaded view */
+	started = g_get_monotonic_time ();
+	message_list_set_group_by_threads (MESSAGE_LIST (message_list), TRUE);
+	bench_report ("Full rebuild, threaded", bench_wait_built (&bd, started), &res);
+
+	/* The parent, message with index 0, is the first one in the folder */
+	uids = camel_folder_get_uids (folder);
+	camel_folder_sort_uids (folder, uids);
+	if (uids->len > 0)
+		parent_uid = g_strdup (uids->pdata[0]);
+	camel_folder_free_uids (folder, uids);
+
+	uid = append_message (folder, n_messages + 1, 0, &local_error);
+	if (!uid) {
+		fprintf (stderr, "Failed to append a message: %s\n", local_error ? local_error->message : "Unknown error");
+		res = 1;
+		goto exit;
+	}
+
+	started = g_get_monotonic_time ();
+	bench_report ("New reply, threaded", bench_wait_built (&bd, started), &res);
+
+	if (!verify_thread_parent (MESSAGE_LIST (message_list), uid, parent_uid)) {
+		fprintf (stderr, "The new reply is not under its thread parent\n");
+		res = 1;
+	}
+
+	started = g_get_monotonic_time ();
+	camel_folder_set_message_flags (folder, uid, CAMEL_MESSAGE_SEEN, CAMEL_MESSAGE_SEEN);
+	bench_report ("Flag change, threaded", bench_wait_built (&bd, started), &res);
+
+	g_free (uid);
+
+exit:
+	g_clear_error (&local_error);
+
+	if (window)
+		gtk_widget_destroy (window);
+
+	g_clear_object (&folder);
+	g_clear_object (&service);
+	g_clear_object (&session);
+	g_clear_object (&registry);
+
+	if (bd.main_loop)
+		g_main_loop_unref (bd.main_loop);
+
+	remove_recursively (tmp_dir);
+
+	g_free (parent_uid);
+	g_free (mbox_filename);
+	g_free (store_dir);
+	g_free (tmp_dir);
+
+	return res;
+}
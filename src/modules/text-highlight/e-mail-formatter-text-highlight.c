@@ -18,6 +18,7 @@
 #include "evolution-config.h"
 
 #include "e-mail-formatter-text-highlight.h"
+#include "highlighter.h"
 #include "languages.h"
 
 #include <em-format/e-mail-formatter-extension.h>
@@ -47,6 +48,18 @@ struct _TextHighlightClosure {
 	GError *error;
 };
 
+typedef struct _TextHighlightCache TextHighlightCache;
+
+/* The HTML of the part, as produced by the built-in highlighter */
+struct _TextHighlightCache {
+	gchar *key;
+	GBytes *html;
+};
+
+#define TEXT_HIGHLIGHT_CACHE_KEY "text-highlight-cache"
+
+G_LOCK_DEFINE_STATIC (text_highlight_cache);
+
 GType e_mail_formatter_text_highlight_get_type (void);
 
 G_DEFINE_DYNAMIC_TYPE (
@@ -217,6 +230,142 @@ text_highlight_feed_data (GOutputStream *output_stream,
 	return success && closure.wrote_anything;
 }
 
+static void
+text_highlight_cache_free (gpointer ptr)
+{
+	TextHighlightCache *cache = ptr;
+
+	if (cache) {
+		g_free (cache->key);
+		g_bytes_unref (cache->html);
+		g_free (cache);
+	}
+}
+
+static GBytes *
+text_highlight_cache_lookup (EMailPart *part,
+                             const gchar *key)
+{
+	TextHighlightCache *cache;
+	GBytes *html = NULL;
+
+	G_LOCK (text_highlight_cache);
+
+	cache = g_object_get_data (G_OBJECT (part), TEXT_HIGHLIGHT_CACHE_KEY);
+	if (cache && g_strcmp0 (cache->key, key) == 0)
+		html = g_bytes_ref (cache->html);
+
+	G_UNLOCK (text_highlight_cache);
+
+	return html;
+}
+
+static void
+text_highlight_cache_store (EMailPart *part,
+                            const gchar *key,
+                            GBytes *html)
+{
+	TextHighlightCache *cache;
+
+	cache = g_new0 (TextHighlightCache, 1);
+	cache->key = g_strdup (key);
+	cache->html = g_bytes_ref (html);
+
+	G_LOCK (text_highlight_cache);
+
+	g_object_set_data_full (G_OBJECT (part), TEXT_HIGHLIGHT_CACHE_KEY, cache, text_highlight_cache_free);
+
+	G_UNLOCK (text_highlight_cache);
+}
+
+/* Highlights the part in-process, without spawning the 'highlight' tool */
+static gboolean
+text_highlight_format_builtin (EMailPart *part,
+                               CamelDataWrapper *data_wrapper,
+                               const gchar *syntax,
+                               const gchar *theme,
+                               const gchar *font_family,
+                               gint font_size,
+                               GOutputStream *output_stream,
+                               GCancellable *cancellable,
+                               GError **error)
+{
+	GBytes *html;
+	gchar *key;
+	gboolean success;
+
+	key = g_strdup_printf ("%s\n%s\n%s\n%d", syntax, theme, font_family, font_size);
+	html = text_highlight_cache_lookup (part, key);
+
+	if (!html) {
+		CamelContentType *content_type;
+		CamelStream *mem_stream, *write_stream;
+		GByteArray *byte_array;
+		GString *buffer;
+
+		mem_stream = camel_stream_mem_new ();
+		write_stream = g_object_ref (mem_stream);
+
+		content_type = camel_data_wrapper_get_mime_type_field (data_wrapper);
+		if (content_type) {
+			const gchar *charset = camel_content_type_param (content_type, "charset");
+
+			if (charset && g_ascii_strcasecmp (charset, "utf-8") != 0) {
+				CamelMimeFilter *filter;
+
+				filter = camel_mime_filter_charset_new (charset, "UTF-8");
+				if (filter != NULL) {
+					g_object_unref (write_stream);
+					write_stream = camel_stream_filter_new (mem_stream);
+					camel_stream_filter_add (CAMEL_STREAM_FILTER (write_stream), filter);
+					g_object_unref (filter);
+				}
+			}
+		}
+
+		if (camel_data_wrapper_decode_to_stream_sync (data_wrapper, write_stream, cancellable, error) < 0 ||
+		    camel_stream_flush (write_stream, cancellable, error) < 0) {
+			g_object_unref (write_stream);
+			g_object_unref (mem_stream);
+			g_free (key);
+
+			return FALSE;
+		}
+
+		g_object_unref (write_stream);
+
+		byte_array = camel_stream_mem_get_byte_array (CAMEL_STREAM_MEM (mem_stream));
+		buffer = g_string_sized_new (byte_array->len * 2 + 1024);
+
+		if (g_utf8_validate ((const gchar *) byte_array->data, byte_array->len, NULL)) {
+			highlighter_format_html (syntax, font_family, font_size,
+				(const gchar *) byte_array->data, byte_array->len, buffer);
+		} else {
+			gchar *valid;
+
+			valid = e_util_utf8_data_make_valid ((const gchar *) byte_array->data, byte_array->len);
+			highlighter_format_html (syntax, font_family, font_size, valid, strlen (valid), buffer);
+			g_free (valid);
+		}
+
+		g_object_unref (mem_stream);
+
+		html = g_string_free_to_bytes (buffer);
+
+		text_highlight_cache_store (part, key, html);
+	}
+
+	g_free (key);
+
+	success = g_output_stream_write_all (output_stream,
+		g_bytes_get_data (html, NULL), g_bytes_get_size (html),
+		NULL, cancellable, error);
+
+	g_bytes_unref (html);
+
+	return success;
+}
+
 static gboolean
 emfe_text_highlight_format (EMailFormatterExtension *extension,
                             EMailFormatter *formatter,
@@ -319,6 +468,32 @@ emfe_text_highlight_format (EMailFormatterExtension *extension,
 			theme = g_strdup ("bclear");
 		}
 
+		if (highlighter_supports_syntax (syntax) && highlighter_supports_theme (theme)) {
+			GError *local_error = NULL;
+
+			success = text_highlight_format_builtin (
+				part, dw, syntax, theme,
+				pango_font_description_get_family (fd),
+				pango_font_description_get_size (fd) / PANGO_SCALE,
+				stream, cancellable, &local_error);
+
+			if (success || g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+				g_clear_error (&local_error);
+				g_free (font_family);
+				g_free (font_size);
+				g_free (syntax);
+				g_free (theme);
+				pango_font_description_free (fd);
+				goto done;
+			}
+
+			/* Fall back to the 'highlight' tool */
+			if (local_error)
+				g_warning ("%s: %s", G_STRFUNC, local_error->message);
+
+			g_clear_error (&local_error);
+		}
+
 		argv[1] = font_family;
 		argv[2] = font_size;
 		argv[3] = g_strdup_printf ("--syntax=%s", syntax);
@@ -439,6 +614,7 @@ emfe_text_highlight_format (EMailFormatterExtension *extension,
 		g_free (uri);
 	}
 
+done:
 	success = TRUE;
 
 exit:
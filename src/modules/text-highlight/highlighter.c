@@ -0,0 +1,709 @@
+/*
+ * highlighter.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* A built-in highlighter of the most common syntaxes, which saves spawning
+ * the 'highlight' tool for each highlighted part. It recognizes tokens
+ * according to simple per-language tables, not a full grammar, and the
+ * produced HTML resembles the tool's output with its default "bclear" style. */
+
+#include "evolution-config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "highlighter.h"
+
+typedef enum {
+	TOKEN_NONE,
+	TOKEN_KEYWORD,
+	TOKEN_TYPE,
+	TOKEN_STRING,
+	TOKEN_NUMBER,
+	TOKEN_COMMENT,
+	TOKEN_DIRECTIVE,
+	TOKEN_VARIABLE,
+	TOKEN_ADDED,
+	TOKEN_REMOVED
+} TokenKind;
+
+/* CSS classes of the TokenKind-s */
+static const gchar *token_classes[] = {
+	NULL, "kwa", "kwb", "str", "num", "com", "ppc", "kwc", "add", "rem"
+};
+
+typedef struct _CodeRules {
+	const gchar **keywords;		/* sorted */
+	gsize n_keywords;
+	const gchar **types;		/* sorted */
+	gsize n_types;
+	const gchar *line_comment;
+	const gchar *block_comment_start;
+	const gchar *block_comment_end;
+	const gchar *quotes;
+	gboolean triple_quotes;		/* Python's """ and ''' strings */
+	gboolean multiline_strings;
+	gboolean directives;		/* '#' at the line start, like in C */
+	gboolean variables;		/* $name, like in shell */
+} CodeRules;
+
+static const gchar *c_keywords[] = {
+	"auto", "break", "case", "catch", "class", "const", "constexpr",
+	"continue", "default", "delete", "do", "else", "enum", "explicit",
+	"extern", "for", "friend", "goto", "if", "inline", "namespace", "new",
+	"noexcept", "nullptr", "operator", "private", "protected", "public",
+	"register", "return", "sizeof", "static", "static_cast", "struct",
+	"switch", "template", "this", "throw", "try", "typedef", "typename",
+	"union", "using", "virtual", "volatile", "while"
+};
+
+static const gchar *c_types[] = {
+	"bool", "char", "double", "float", "gboolean", "gchar",
+	"gconstpointer", "gdouble", "gint", "gint64", "glong", "gpointer",
+	"gsize", "gssize", "guint", "guint64", "gulong", "int", "long",
+	"short", "signed", "size_t", "ssize_t", "unsigned", "void"
+};
+
+static const gchar *python_keywords[] = {
+	"False", "None", "True", "and", "as", "assert", "async", "await",
+	"break", "class", "continue", "def", "del", "elif", "else", "except",
+	"finally", "for", "from", "global", "if", "import", "in", "is",
+	"lambda", "nonlocal", "not", "or", "pass", "raise", "return", "try",
+	"while", "with", "yield"
+};
+
+static const gchar *python_types[] = {
+	"bool", "bytes", "dict", "float", "int", "list", "object", "self",
+	"set", "str", "tuple"
+};
+
+static const gchar *sh_keywords[] = {
+	"break", "case", "continue", "declare", "do", "done", "elif", "else",
+	"esac", "exit", "export", "fi", "for", "function", "if", "in", "local",
+	"readonly", "return", "select", "set", "shift", "source", "then",
+	"trap", "unset", "until", "while"
+};
+
+static const CodeRules c_rules = {
+	c_keywords, G_N_ELEMENTS (c_keywords),
+	c_types, G_N_ELEMENTS (c_types),
+	"//", "/*", "*/", "\"'",
+	FALSE, FALSE, TRUE, FALSE
+};
+
+static const CodeRules python_rules = {
+	python_keywords, G_N_ELEMENTS (python_keywords),
+	python_types, G_N_ELEMENTS (python_types),
+	"#", NULL, NULL, "\"'",
+	TRUE, FALSE, FALSE, FALSE
+};
+
+static const CodeRules sh_rules = {
+	sh_keywords, G_N_ELEMENTS (sh_keywords),
+	NULL, 0,
+	"#", NULL, NULL, "\"'`",
+	FALSE, TRUE, FALSE, TRUE
+};
+
+static const gchar *json_keywords[] = {
+	"false", "null", "true"
+};
+
+static void
+append_escaped (GString *html,
+                const gchar *text,
+                gsize len)
+{
+	const gchar *end = text + len, *start = text;
+
+	for (; text < end; text++) {
+		const gchar *entity;
+
+		switch (*text) {
+		case '&':
+			entity = "&amp;";
+			break;
+		case '<':
+			entity = "&lt;";
+			break;
+		case '>':
+			entity = "&gt;";
+			break;
+		case '"':
+			entity = "&quot;";
+			break;
+		case '\0':
+			entity = "";
+			break;
+		default:
+			continue;
+		}
+
+		g_string_append_len (html, start, text - start);
+		g_string_append (html, entity);
+		start = text + 1;
+	}
+
+	g_string_append_len (html, start, end - start);
+}
+
+static void
+append_token (GString *html,
+              TokenKind kind,
+              const gchar *text,
+              gsize len)
+{
+	if (!len)
+		return;
+
+	if (kind == TOKEN_NONE) {
+		append_escaped (html, text, len);
+		return;
+	}
+
+	g_string_append (html, "<span class=\"");
+	g_string_append (html, token_classes[kind]);
+	g_string_append (html, "\">");
+	append_escaped (html, text, len);
+	g_string_append (html, "</span>");
+}
+
+static gboolean
+has_prefix_at (const gchar *text,
+               gsize len,
+               gsize pos,
+               const gchar *prefix)
+{
+	gsize prefix_len = strlen (prefix);
+
+	return pos + prefix_len <= len && strncmp (text + pos, prefix, prefix_len) == 0;
+}
+
+/* Returns the position after the first @needle at or after @pos, or @len */
+static gsize
+find_after (const gchar *text,
+            gsize len,
+            gsize pos,
+            const gchar *needle)
+{
+	gsize needle_len = strlen (needle);
+
+	while (pos + needle_len <= len) {
+		const gchar *found;
+
+		found = memchr (text + pos, *needle, len - pos - needle_len + 1);
+		if (!found)
+			break;
+
+		pos = found - text;
+
+		if (strncmp (found, needle, needle_len) == 0)
+			return pos + needle_len;
+
+		pos++;
+	}
+
+	return len;
+}
+
+static gsize
+find_line_end (const gchar *text,
+               gsize len,
+               gsize pos)
+{
+	const gchar *found;
+
+	found = memchr (text + pos, '\n', len - pos);
+
+	return found ? (gsize) (found - text) : len;
+}
+
+static gboolean
+is_ident_start (gchar chr)
+{
+	return g_ascii_isalpha (chr) || chr == '_';
+}
+
+static gboolean
+is_ident_char (gchar chr)
+{
+	return g_ascii_isalnum (chr) || chr == '_';
+}
+
+typedef struct _WordKey {
+	const gchar *word;
+	gsize len;
+} WordKey;
+
+static gint
+compare_word_cb (gconstpointer key,
+                 gconstpointer item)
+{
+	const WordKey *word_key = key;
+	const gchar *word = *((const gchar * const *) item);
+	gint res;
+
+	res = strncmp (word_key->word, word, word_key->len);
+
+	/* The key is a prefix of the word, thus it sorts before it */
+	if (res == 0 && word[word_key->len] != '\0')
+		res = -1;
+
+	return res;
+}
+
+static gboolean
+is_word_in (const gchar **words,
+            gsize n_words,
+            const gchar *word,
+            gsize len)
+{
+	WordKey key;
+
+	if (!words || !n_words)
+		return FALSE;
+
+	key.word = word;
+	key.len = len;
+
+	return bsearch (&key, words, n_words, sizeof (gchar *), compare_word_cb) != NULL;
+}
+
+/* Returns the position after the string starting with the @quote at @pos */
+static gsize
+scan_string (const gchar *text,
+             gsize len,
+             gsize pos,
+             gchar quote,
+             gboolean multiline,
+             gboolean escapes)
+{
+	gsize end;
+
+	for (end = pos + 1; end < len; end++) {
+		gchar chr = text[end];
+
+		if (escapes && chr == '\\' && end + 1 < len) {
+			end++;
+			continue;
+		}
+
+		if (chr == quote)
+			return end + 1;
+
+		if (chr == '\n' && !multiline)
+			return end;
+	}
+
+	return len;
+}
+
+/* Returns the position after the shell variable at @pos, or 0 */
+static gsize
+scan_variable (const gchar *text,
+               gsize len,
+               gsize pos)
+{
+	gsize end = pos + 1;
+
+	if (end >= len)
+		return 0;
+
+	if (text[end] == '{') {
+		gsize line_end = find_line_end (text, len, end);
+		const gchar *found;
+
+		found = memchr (text + end, '}', line_end - end);
+
+		return found ? (gsize) (found - text) + 1 : 0;
+	}
+
+	if (is_ident_start (text[end])) {
+		while (end < len && is_ident_char (text[end]))
+			end++;
+
+		return end;
+	}
+
+	if (g_ascii_isdigit (text[end]) || strchr ("#?@*$!-", text[end]))
+		return end + 1;
+
+	return 0;
+}
+
+static gsize
+scan_number (const gchar *text,
+             gsize len,
+             gsize pos)
+{
+	gsize end;
+
+	for (end = pos + 1; end < len; end++) {
+		gchar chr = text[end];
+
+		if (!g_ascii_isalnum (chr) && chr != '.' && chr != '_')
+			break;
+	}
+
+	return end;
+}
+
+static void
+highlight_code (const CodeRules *rules,
+                const gchar *text,
+                gsize len,
+                GString *html)
+{
+	gsize pos = 0, plain_start = 0;
+	gboolean line_start = TRUE;
+
+	while (pos < len) {
+		TokenKind kind = TOKEN_NONE;
+		gchar chr = text[pos];
+		gsize end = 0;
+
+		if (line_start && rules->directives && chr == '#') {
+			/* Including the continuation lines */
+			end = pos;
+			do {
+				end = find_line_end (text, len, end);
+				if (end > pos && end < len && text[end - 1] == '\\')
+					end++;
+				else
+					break;
+			} while (end < len);
+
+			kind = TOKEN_DIRECTIVE;
+		} else if (rules->block_comment_start && has_prefix_at (text, len, pos, rules->block_comment_start)) {
+			end = find_after (text, len, pos + strlen (rules->block_comment_start), rules->block_comment_end);
+			kind = TOKEN_COMMENT;
+		} else if (rules->line_comment && has_prefix_at (text, len, pos, rules->line_comment) &&
+			   (!rules->variables || pos == 0 || g_ascii_isspace (text[pos - 1]) || text[pos - 1] == ';')) {
+			end = find_line_end (text, len, pos);
+			kind = TOKEN_COMMENT;
+		} else if (rules->triple_quotes && (has_prefix_at (text, len, pos, "\"\"\"") || has_prefix_at (text, len, pos, "'''"))) {
+			gchar triple[4] = { chr, chr, chr, '\0' };
+
+			end = find_after (text, len, pos + 3, triple);
+			kind = TOKEN_STRING;
+		} else if (chr != '\0' && rules->quotes && strchr (rules->quotes, chr)) {
+			/* Shell's single-quoted strings have no escapes */
+			end = scan_string (text, len, pos, chr, rules->multiline_strings, !rules->variables || chr != '\'');
+			kind = TOKEN_STRING;
+		} else if (rules->variables && chr == '$') {
+			end = scan_variable (text, len, pos);
+			if (end)
+				kind = TOKEN_VARIABLE;
+		} else if (g_ascii_isdigit (chr)) {
+			end = scan_number (text, len, pos);
+			kind = TOKEN_NUMBER;
+		} else if (is_ident_start (chr)) {
+			for (end = pos + 1; end < len && is_ident_char (text[end]); end++) {
+				/* just skip the identifier */
+			}
+
+			if (is_word_in (rules->keywords, rules->n_keywords, text + pos, end - pos))
+				kind = TOKEN_KEYWORD;
+			else if (is_word_in (rules->types, rules->n_types, text + pos, end - pos))
+				kind = TOKEN_TYPE;
+		}
+
+		if (kind == TOKEN_NONE) {
+			if (end > pos) {
+				/* an ordinary identifier */
+				pos = end;
+				line_start = FALSE;
+			} else {
+				if (chr == '\n')
+					line_start = TRUE;
+				else if (!g_ascii_isspace (chr))
+					line_start = FALSE;
+				pos++;
+			}
+			continue;
+		}
+
+		append_token (html, TOKEN_NONE, text + plain_start, pos - plain_start);
+		append_token (html, kind, text + pos, end - pos);
+
+		pos = end;
+		plain_start = pos;
+		line_start = FALSE;
+	}
+
+	append_token (html, TOKEN_NONE, text + plain_start, pos - plain_start);
+}
+
+static void
+highlight_diff (const gchar *text,
+                gsize len,
+                GString *html)
+{
+	gsize pos = 0;
+
+	while (pos < len) {
+		TokenKind kind = TOKEN_NONE;
+		gsize end;
+
+		end = find_line_end (text, len, pos);
+
+		if (has_prefix_at (text, len, pos, "+++ ") ||
+		    has_prefix_at (text, len, pos, "--- ") ||
+		    has_prefix_at (text, len, pos, "diff ") ||
+		    has_prefix_at (text, len, pos, "index ") ||
+		    has_prefix_at (text, len, pos, "new file ") ||
+		    has_prefix_at (text, len, pos, "deleted file "))
+			kind = TOKEN_DIRECTIVE;
+		else if (has_prefix_at (text, len, pos, "@@"))
+			kind = TOKEN_TYPE;
+		else if (text[pos] == '+')
+			kind = TOKEN_ADDED;
+		else if (text[pos] == '-')
+			kind = TOKEN_REMOVED;
+
+		append_token (html, kind, text + pos, end - pos);
+
+		if (end < len)
+			g_string_append_c (html, '\n');
+
+		pos = end + 1;
+	}
+}
+
+static gboolean
+is_xml_name_char (gchar chr)
+{
+	return g_ascii_isalnum (chr) || chr == '_' || chr == ':' || chr == '-' || chr == '.' || (chr & 0x80) != 0;
+}
+
+static void
+highlight_xml (const gchar *text,
+               gsize len,
+               GString *html)
+{
+	gsize pos = 0, plain_start = 0;
+
+	while (pos < len) {
+		TokenKind kind = TOKEN_NONE;
+		gsize end = 0;
+
+		if (text[pos] == '<') {
+			if (has_prefix_at (text, len, pos, "<!--")) {
+				end = find_after (text, len, pos + 4, "-->");
+				kind = TOKEN_COMMENT;
+			} else if (has_prefix_at (text, len, pos, "<![CDATA[")) {
+				end = find_after (text, len, pos + 9, "]]>");
+				kind = TOKEN_STRING;
+			} else if (has_prefix_at (text, len, pos, "<?") ||
+				   has_prefix_at (text, len, pos, "<!")) {
+				end = find_after (text, len, pos + 2, ">");
+				kind = TOKEN_DIRECTIVE;
+			} else {
+				append_token (html, TOKEN_NONE, text + plain_start, pos - plain_start);
+
+				/* The tag name */
+				end = pos + 1;
+				if (end < len && text[end] == '/')
+					end++;
+				while (end < len && is_xml_name_char (text[end]))
+					end++;
+
+				append_token (html, TOKEN_KEYWORD, text + pos, end - pos);
+				pos = end;
+
+				/* The attributes */
+				while (pos < len && text[pos] != '>' && text[pos] != '<') {
+					gchar chr = text[pos];
+
+					if (chr == '"' || chr == '\'') {
+						end = scan_string (text, len, pos, chr, TRUE, FALSE);
+						append_token (html, TOKEN_STRING, text + pos, end - pos);
+					} else if (is_xml_name_char (chr)) {
+						for (end = pos + 1; end < len && is_xml_name_char (text[end]); end++) {
+							/* just skip the name */
+						}
+						append_token (html, TOKEN_TYPE, text + pos, end - pos);
+					} else {
+						end = pos + 1;
+						append_token (html, TOKEN_NONE, text + pos, 1);
+					}
+
+					pos = end;
+				}
+
+				if (pos < len && text[pos] == '>') {
+					append_token (html, TOKEN_KEYWORD, text + pos, 1);
+					pos++;
+				}
+
+				plain_start = pos;
+				continue;
+			}
+		} else if (text[pos] == '&') {
+			for (end = pos + 1; end < len && end - pos < 32 && (g_ascii_isalnum (text[end]) || text[end] == '#'); end++) {
+				/* just skip the entity name */
+			}
+
+			if (end < len && text[end] == ';' && end > pos + 1) {
+				end++;
+				kind = TOKEN_VARIABLE;
+			}
+		}
+
+		if (kind == TOKEN_NONE) {
+			pos++;
+			continue;
+		}
+
+		append_token (html, TOKEN_NONE, text + plain_start, pos - plain_start);
+		append_token (html, kind, text + pos, end - pos);
+
+		pos = end;
+		plain_start = pos;
+	}
+
+	append_token (html, TOKEN_NONE, text + plain_start, pos - plain_start);
+}
+
+static void
+highlight_json (const gchar *text,
+                gsize len,
+                GString *html)
+{
+	gsize pos = 0, plain_start = 0;
+
+	while (pos < len) {
+		TokenKind kind = TOKEN_NONE;
+		gchar chr = text[pos];
+		gsize end = 0;
+
+		if (chr == '"') {
+			gsize after;
+
+			end = scan_string (text, len, pos, '"', FALSE, TRUE);
+
+			for (after = end; after < len && g_ascii_isspace (text[after]); after++) {
+				/* just skip the white space */
+			}
+
+			/* Member names differ from the values */
+			kind = after < len && text[after] == ':' ? TOKEN_TYPE : TOKEN_STRING;
+		} else if (g_ascii_isdigit (chr) || (chr == '-' && pos + 1 < len && g_ascii_isdigit (text[pos + 1]))) {
+			for (end = pos + 1; end < len && (g_ascii_isalnum (text[end]) || strchr (".+-", text[end])); end++) {
+				/* just skip the number */
+			}
+			kind = TOKEN_NUMBER;
+		} else if (is_ident_start (chr)) {
+			for (end = pos + 1; end < len && is_ident_char (text[end]); end++) {
+				/* just skip the word */
+			}
+
+			if (is_word_in (json_keywords, G_N_ELEMENTS (json_keywords), text + pos, end - pos))
+				kind = TOKEN_KEYWORD;
+		}
+
+		if (kind == TOKEN_NONE) {
+			pos = end > pos ? end : pos + 1;
+			continue;
+		}
+
+		append_token (html, TOKEN_NONE, text + plain_start, pos - plain_start);
+		append_token (html, kind, text + pos, end - pos);
+
+		pos = end;
+		plain_start = pos;
+	}
+
+	append_token (html, TOKEN_NONE, text + plain_start, pos - plain_start);
+}
+
+gboolean
+highlighter_supports_syntax (const gchar *syntax)
+{
+	return g_strcmp0 (syntax, "c") == 0 ||
+		g_strcmp0 (syntax, "python") == 0 ||
+		g_strcmp0 (syntax, "sh") == 0 ||
+		g_strcmp0 (syntax, "diff") == 0 ||
+		g_strcmp0 (syntax, "xml") == 0 ||
+		g_strcmp0 (syntax, "json") == 0;
+}
+
+gboolean
+highlighter_supports_theme (const gchar *theme)
+{
+	/* Other themes are left on the 'highlight' tool */
+	return !theme || !*theme || g_strcmp0 (theme, "bclear") == 0;
+}
+
+/* Converts the UTF-8 @text into a complete HTML document, into @html */
+void
+highlighter_format_html (const gchar *syntax,
+                         const gchar *font_family,
+                         gint font_size,
+                         const gchar *text,
+                         gsize text_len,
+                         GString *html)
+{
+	gchar *family;
+
+	g_return_if_fail (highlighter_supports_syntax (syntax));
+	g_return_if_fail (text != NULL);
+	g_return_if_fail (html != NULL);
+
+	/* It's put into the style sheet, thus do not let it break it */
+	family = g_strdup (font_family ? font_family : "monospace");
+	g_strcanon (family, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789 -_.,", ' ');
+
+	g_string_append_printf (html,
+		"<!DOCTYPE html>\n"
+		"<html>\n"
+		"<head>\n"
+		"<meta http-equiv=\"content-type\" content=\"text/html; charset=utf-8\">\n"
+		"<style type=\"text/css\">\n"
+		"body.hl { background-color:#ffffff; }\n"
+		"pre.hl { color:#000000; background-color:#ffffff; font-size:%dpt; font-family:'%s'; }\n"
+		".hl .kwa { color:#000000; font-weight:bold; }\n"
+		".hl .kwb { color:#0057ae; }\n"
+		".hl .kwc { color:#008080; }\n"
+		".hl .str { color:#bf0303; }\n"
+		".hl .num { color:#b07e00; }\n"
+		".hl .com { color:#888786; font-style:italic; }\n"
+		".hl .ppc { color:#006e28; }\n"
+		".hl .add { color:#006e28; }\n"
+		".hl .rem { color:#bf0303; }\n"
+		"</style>\n"
+		"</head>\n"
+		"<body class=\"hl\">\n"
+		"<pre class=\"hl\">",
+		font_size, family);
+
+	g_free (family);
+
+	if (g_strcmp0 (syntax, "diff") == 0)
+		highlight_diff (text, text_len, html);
+	else if (g_strcmp0 (syntax, "xml") == 0)
+		highlight_xml (text, text_len, html);
+	else if (g_strcmp0 (syntax, "json") == 0)
+		highlight_json (text, text_len, html);
+	else if (g_strcmp0 (syntax, "python") == 0)
+		highlight_code (&python_rules, text, text_len, html);
+	else if (g_strcmp0 (syntax, "sh") == 0)
+		highlight_code (&sh_rules, text, text_len, html);
+	else
+		highlight_code (&c_rules, text, text_len, html);
+
+	g_string_append (html, "</pre>\n</body>\n</html>\n");
+}
@@ -0,0 +1,33 @@
+/*
+ * highlighter.h
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HIGHLIGHTER_H
+#define HIGHLIGHTER_H
+
+#include <glib.h>
+
+gboolean	highlighter_supports_syntax	(const gchar *syntax);
+gboolean	highlighter_supports_theme	(const gchar *theme);
+
+void		highlighter_format_html		(const gchar *syntax,
+						 const gchar *font_family,
+						 gint font_size,
+						 const gchar *text,
+						 gsize text_len,
+						 GString *html);
+
+#endif /* HIGHLIGHTER_H */
@@ -87,6 +87,11 @@ static Language languages[] = {
 			      (gchar[]) { "application/x-javascript" }, NULL }
 	},
 
+	{ "json", N_("_JSON"),
+	  (const gchar *[]) { (gchar[]) { "json" }, NULL },
+	  (const gchar *[]) { (gchar[]) { "application/json" }, NULL }
+	},
+
 	{ "diff", N_("_Patch/diff"),
 	  (const gchar *[]) { (gchar[]) { "diff" }, (gchar[]) { "patch" }, NULL },
 	  (const gchar *[]) { (gchar[]) { "text/x-diff" },
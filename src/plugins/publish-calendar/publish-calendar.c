@@ -45,6 +45,10 @@ static GSList *publish_uris = NULL;
 static GSList *queued_publishes = NULL;
 static gint online = 0;
 
+/* gchar *location ~> gchar *digest of the last published content */
+static GHashTable *published_digests = NULL;
+static GMutex published_digests_lock;
+
 static GSList *error_queue = NULL;
 static GMutex error_queue_lock;
 static guint error_queue_show_idle_id = 0;
@@ -189,6 +193,40 @@ publish_uri_async (EPublishUri *uri)
 	}
 }
 
+/* Whether the @digest differs from the one of the content last
+ * published to the @location; it is remembered as the new one then. */
+static gboolean
+published_digest_changed (const gchar *location,
+                          const gchar *digest)
+{
+	gboolean changed;
+
+	g_mutex_lock (&published_digests_lock);
+
+	if (!published_digests)
+		published_digests = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+	changed = g_strcmp0 (g_hash_table_lookup (published_digests, location), digest) != 0;
+
+	if (changed)
+		g_hash_table_insert (published_digests, g_strdup (location), g_strdup (digest));
+
+	g_mutex_unlock (&published_digests_lock);
+
+	return changed;
+}
+
+static void
+published_digest_forget (const gchar *location)
+{
+	g_mutex_lock (&published_digests_lock);
+
+	if (published_digests)
+		g_hash_table_remove (published_digests, location);
+
+	g_mutex_unlock (&published_digests_lock);
+}
+
 static void
 publish_online (EPublishUri *uri,
                 GFile *file,
@@ -196,56 +234,107 @@ publish_online (EPublishUri *uri,
                 gboolean can_report_success)
 {
 	GOutputStream *stream;
+	GFileIOStream *tmp_stream = NULL;
+	GFile *tmp_file;
+	GChecksum *checksum;
 	GError *error = NULL;
 
-	stream = G_OUTPUT_STREAM (g_file_replace (
-		file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, &error));
-
-	/* Sanity check. */
-	g_return_if_fail (
-		((stream != NULL) && (error == NULL)) ||
-		((stream == NULL) && (error != NULL)));
+	/* The content is written into a local temporary file first,
+	 * thus it is not uploaded when it did not change since the last
+	 * publish, and neither kept in memory as a whole. */
+	tmp_file = g_file_new_tmp ("evolution-publish-XXXXXX", &tmp_stream, &error);
 
 	if (error != NULL) {
-		if (perror != NULL) {
-			*perror = error;
-		} else {
-			error_queue_add (
-				g_strdup_printf (
-					_("Could not open %s:"),
-					uri->location),
-				error);
-		}
+		error_queue_add (
+			g_strdup_printf (
+				_("There was an error while publishing to %s:"),
+				uri->location),
+			error);
 		return;
 	}
 
+	checksum = g_checksum_new (G_CHECKSUM_SHA256);
+
 	switch (uri->publish_format) {
 		case URI_PUBLISH_AS_ICAL:
-			publish_calendar_as_ical (stream, uri, &error);
+			publish_calendar_as_ical (g_io_stream_get_output_stream (G_IO_STREAM (tmp_stream)), uri, checksum, &error);
 			break;
 		case URI_PUBLISH_AS_FB:
 		case URI_PUBLISH_AS_FB_WITH_DETAILS:
-			publish_calendar_as_fb (stream, uri, &error);
+			publish_calendar_as_fb (g_io_stream_get_output_stream (G_IO_STREAM (tmp_stream)), uri, checksum, &error);
 			break;
 	}
 
-	if (error != NULL)
+	if (error == NULL)
+		g_seekable_seek (G_SEEKABLE (tmp_stream), 0, G_SEEK_SET, NULL, &error);
+
+	/* A publish requested by the user is done regardless */
+	if (error == NULL && !can_report_success &&
+	    !published_digest_changed (uri->location, g_checksum_get_string (checksum))) {
+		update_timestamp (uri);
+		goto exit;
+	}
+
+	if (error == NULL) {
+		stream = G_OUTPUT_STREAM (g_file_replace (
+			file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, &error));
+
+		/* Sanity check. */
+		g_warn_if_fail (
+			((stream != NULL) && (error == NULL)) ||
+			((stream == NULL) && (error != NULL)));
+
+		if (error != NULL) {
+			published_digest_forget (uri->location);
+
+			if (perror != NULL) {
+				*perror = error;
+			} else {
+				error_queue_add (
+					g_strdup_printf (
+						_("Could not open %s:"),
+						uri->location),
+					error);
+			}
+
+			goto exit;
+		}
+
+		g_output_stream_splice (
+			stream, g_io_stream_get_input_stream (G_IO_STREAM (tmp_stream)),
+			G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET, NULL, &error);
+
+		g_object_unref (stream);
+	}
+
+	if (error != NULL) {
+		published_digest_forget (uri->location);
+
 		error_queue_add (
 			g_strdup_printf (
 				_("There was an error while publishing to %s:"),
 				uri->location),
 			error);
-	else if (can_report_success)
-		error_queue_add (
-			g_strdup_printf (
-				_("Publishing to %s finished successfully"),
-				uri->location),
-			NULL);
+	} else {
+		/* Remembered also when published by the user */
+		published_digest_changed (uri->location, g_checksum_get_string (checksum));
+
+		if (can_report_success)
+			error_queue_add (
+				g_strdup_printf (
+					_("Publishing to %s finished successfully"),
+					uri->location),
+				NULL);
+	}
 
 	update_timestamp (uri);
 
-	g_output_stream_close (stream, NULL, NULL);
-	g_object_unref (stream);
+exit:
+	g_io_stream_close (G_IO_STREAM (tmp_stream), NULL, NULL);
+	g_file_delete (tmp_file, NULL, NULL);
+	g_object_unref (tmp_stream);
+	g_object_unref (tmp_file);
+	g_checksum_free (checksum);
 }
 
 static void
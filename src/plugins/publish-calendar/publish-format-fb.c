@@ -28,11 +28,13 @@
 #include <shell/e-shell.h>
 
 #include "publish-format-fb.h"
+#include "publish-format-ical.h"
 
 static gboolean
 write_calendar (const gchar *uid,
                 GOutputStream *stream,
-		gboolean with_details,
+                GChecksum *checksum,
+                gboolean with_details,
                 gint dur_type,
                 gint dur_value,
                 GError **error)
@@ -44,7 +46,6 @@ write_calendar (const gchar *uid,
 	GSList *objects = NULL;
 	icaltimezone *utc;
 	time_t start = time (NULL), end;
-	icalcomponent *top_level;
 	gchar *email = NULL;
 	GSList *users = NULL;
 	gboolean success = FALSE;
@@ -91,22 +92,22 @@ write_calendar (const gchar *uid,
 			users = g_slist_append (users, email);
 	}
 
-	top_level = e_cal_util_new_top_level ();
-
 	success = e_cal_client_get_free_busy_sync (
 		E_CAL_CLIENT (client), start, end, users, &objects, NULL, error);
 
 	if (success) {
-		gchar *ical_string;
 		GSList *iter;
 
-		for (iter = objects; iter; iter = iter->next) {
+		success = publish_format_ical_write_begin (stream, checksum, error);
+
+		for (iter = objects; iter && success; iter = iter->next) {
 			ECalComponent *comp = iter->data;
-			icalcomponent *icalcomp = icalcomponent_new_clone (e_cal_component_get_icalcomponent (comp));
+			icalcomponent *icalcomp = e_cal_component_get_icalcomponent (comp);
 
 			if (!icalcomp)
 				continue;
 
+			/* The components are owned here, no need to copy them */
 			if (!with_details) {
 				icalproperty *prop;
 
@@ -118,18 +119,13 @@ write_calendar (const gchar *uid,
 				}
 			}
 
-			icalcomponent_add_component (top_level, icalcomp);
+			success = publish_format_ical_write_component (stream, checksum, icalcomp, error);
 		}
 
-		ical_string = icalcomponent_as_ical_string_r (top_level);
-
-		success = g_output_stream_write_all (
-			stream, ical_string,
-			strlen (ical_string),
-			NULL, NULL, error);
+		if (success)
+			success = publish_format_ical_write_end (stream, checksum, error);
 
 		e_cal_client_free_ecalcomp_slist (objects);
-		g_free (ical_string);
 	}
 
 	if (users)
@@ -137,7 +133,6 @@ write_calendar (const gchar *uid,
 
 	g_free (email);
 	g_object_unref (client);
-	icalcomponent_free (top_level);
 
 	return success;
 }
@@ -145,6 +140,7 @@ write_calendar (const gchar *uid,
 void
 publish_calendar_as_fb (GOutputStream *stream,
                         EPublishUri *uri,
+                        GChecksum *checksum,
                         GError **error)
 {
 	GSList *l;
@@ -154,7 +150,7 @@ publish_calendar_as_fb (GOutputStream *stream,
 	l = uri->events;
 	while (l) {
 		gchar *uid = l->data;
-		if (!write_calendar (uid, stream, with_details, uri->fb_duration_type, uri->fb_duration_value, error))
+		if (!write_calendar (uid, stream, checksum, with_details, uri->fb_duration_type, uri->fb_duration_value, error))
 			break;
 		l = g_slist_next (l);
 	}
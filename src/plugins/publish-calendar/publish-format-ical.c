@@ -30,22 +30,22 @@
 
 typedef struct {
 	GHashTable *zones;
+	GPtrArray *zone_comps;
 	ECalClient *client;
 } CompTzData;
 
- static void
+static void
 insert_tz_comps (icalparameter *param,
                  gpointer cb_data)
 {
 	const gchar *tzid;
 	CompTzData *tdata = cb_data;
 	icaltimezone *zone = NULL;
-	icalcomponent *tzcomp;
 	GError *error = NULL;
 
 	tzid = icalparameter_get_tzid (param);
 
-	if (g_hash_table_lookup (tdata->zones, tzid))
+	if (g_hash_table_contains (tdata->zones, tzid))
 		return;
 
 	e_cal_client_get_timezone_sync (
@@ -59,30 +59,151 @@ insert_tz_comps (icalparameter *param,
 		return;
 	}
 
-	tzcomp = icalcomponent_new_clone (icaltimezone_get_component (zone));
-	g_hash_table_insert (tdata->zones, (gpointer) tzid, (gpointer) tzcomp);
+	/* The zone is owned by the client, which outlives the write */
+	g_hash_table_add (tdata->zones, g_strdup (tzid));
+	g_ptr_array_add (tdata->zone_comps, icaltimezone_get_component (zone));
 }
 
+/* Adds the @ical_string to the @checksum, except of the DTSTAMP
+ * properties, which change with each fetch of the data, even when
+ * the components themselves did not change. */
 static void
-append_tz_to_comp (gpointer key,
-                   gpointer value,
-                   icalcomponent *toplevel)
+checksum_update_ical_string (GChecksum *checksum,
+                             const gchar *ical_string,
+                             gsize len)
 {
-	icalcomponent_add_component (toplevel, (icalcomponent *) value);
+	const gchar *line = ical_string, *end = ical_string + len;
+	gboolean skipping = FALSE;
+
+	while (line < end) {
+		const gchar *next = memchr (line, '\n', end - line);
+		gsize line_len = next ? next - line + 1 : end - line;
+
+		/* Folded lines continue the previous property */
+		if (*line != ' ' && *line != '\t') {
+			skipping = line_len > 8 && strncmp (line, "DTSTAMP", 7) == 0 &&
+				(line[7] == ':' || line[7] == ';');
+		}
+
+		if (!skipping)
+			g_checksum_update (checksum, (const guchar *) line, line_len);
+
+		line += line_len;
+	}
+}
+
+static gboolean
+write_ical_string (GOutputStream *stream,
+                   GChecksum *checksum,
+                   const gchar *ical_string,
+                   gsize len,
+                   GError **error)
+{
+	if (checksum)
+		checksum_update_ical_string (checksum, ical_string, len);
+
+	return g_output_stream_write_all (stream, ical_string, len, NULL, NULL, error);
+}
+
+/**
+ * publish_format_ical_write_begin:
+ * @stream: a #GOutputStream to write to
+ * @checksum: (nullable): a #GChecksum to add the written data to, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Writes the beginning of a VCALENDAR object, with the properties
+ * of e_cal_util_new_top_level(). The components are written with
+ * publish_format_ical_write_component() one by one and the object
+ * is finished with publish_format_ical_write_end(), thus the whole
+ * calendar does not need to be in memory as one string.
+ *
+ * Returns: whether succeeded
+ **/
+gboolean
+publish_format_ical_write_begin (GOutputStream *stream,
+                                 GChecksum *checksum,
+                                 GError **error)
+{
+	icalcomponent *top_level;
+	gchar *ical_string;
+	const gchar *end;
+	gboolean success;
+
+	top_level = e_cal_util_new_top_level ();
+	ical_string = icalcomponent_as_ical_string_r (top_level);
+	icalcomponent_free (top_level);
+
+	/* Everything except of the END:VCALENDAR line */
+	end = g_strrstr (ical_string, "END:VCALENDAR");
+	success = write_ical_string (stream, checksum, ical_string, end ? end - ical_string : strlen (ical_string), error);
+
+	g_free (ical_string);
+
+	return success;
+}
+
+/**
+ * publish_format_ical_write_component:
+ * @stream: a #GOutputStream to write to
+ * @checksum: (nullable): a #GChecksum to add the written data to, or %NULL
+ * @icalcomp: an #icalcomponent to write
+ * @error: return location for a #GError, or %NULL
+ *
+ * Writes the @icalcomp as a subcomponent of the VCALENDAR object
+ * started with publish_format_ical_write_begin().
+ *
+ * Returns: whether succeeded
+ **/
+gboolean
+publish_format_ical_write_component (GOutputStream *stream,
+                                     GChecksum *checksum,
+                                     icalcomponent *icalcomp,
+                                     GError **error)
+{
+	gchar *ical_string;
+	gboolean success;
+
+	ical_string = icalcomponent_as_ical_string_r (icalcomp);
+	success = write_ical_string (stream, checksum, ical_string, strlen (ical_string), error);
+	g_free (ical_string);
+
+	return success;
+}
+
+/**
+ * publish_format_ical_write_end:
+ * @stream: a #GOutputStream to write to
+ * @checksum: (nullable): a #GChecksum to add the written data to, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes the VCALENDAR object started with publish_format_ical_write_begin().
+ *
+ * Returns: whether succeeded
+ **/
+gboolean
+publish_format_ical_write_end (GOutputStream *stream,
+                               GChecksum *checksum,
+                               GError **error)
+{
+	const gchar *end = "END:VCALENDAR\r\n";
+
+	return write_ical_string (stream, checksum, end, strlen (end), error);
 }
 
 static gboolean
 write_calendar (const gchar *uid,
                 GOutputStream *stream,
+                GChecksum *checksum,
                 GError **error)
 {
 	EShell *shell;
 	ESource *source;
 	ESourceRegistry *registry;
 	EClient *client = NULL;
-	GSList *objects = NULL;
-	icalcomponent *top_level;
-	gboolean res = FALSE;
+	GSList *objects = NULL, *iter;
+	CompTzData tdata;
+	guint ii;
+	gboolean res;
 
 	shell = e_shell_get_default ();
 	registry = e_shell_get_registry (shell);
@@ -105,38 +226,37 @@ write_calendar (const gchar *uid,
 	if (client == NULL)
 		return FALSE;
 
-	top_level = e_cal_util_new_top_level ();
-
-	e_cal_client_get_object_list_sync (
-		E_CAL_CLIENT (client), "#t", &objects, NULL, error);
+	if (!e_cal_client_get_object_list_sync (E_CAL_CLIENT (client), "#t", &objects, NULL, error)) {
+		g_object_unref (client);
+		return FALSE;
+	}
 
-	if (objects != NULL) {
-		GSList *iter;
-		gchar *ical_string;
-		CompTzData tdata;
+	tdata.zones = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	tdata.zone_comps = g_ptr_array_new ();
+	tdata.client = E_CAL_CLIENT (client);
 
-		tdata.zones = g_hash_table_new (g_str_hash, g_str_equal);
-		tdata.client = E_CAL_CLIENT (client);
+	/* The components are written as they are, without copying them
+	 * into a new top-level component first */
+	res = publish_format_ical_write_begin (stream, checksum, error);
 
-		for (iter = objects; iter; iter = iter->next) {
-			icalcomponent *icalcomp = icalcomponent_new_clone (iter->data);
-			icalcomponent_foreach_tzid (icalcomp, insert_tz_comps, &tdata);
-			icalcomponent_add_component (top_level, icalcomp);
-		}
+	for (iter = objects; iter && res; iter = iter->next) {
+		icalcomponent_foreach_tzid (iter->data, insert_tz_comps, &tdata);
+		res = publish_format_ical_write_component (stream, checksum, iter->data, error);
+	}
 
-		g_hash_table_foreach (tdata.zones, (GHFunc) append_tz_to_comp, top_level);
+	/* In the order of use, to have the same checksum for the same data */
+	for (ii = 0; ii < tdata.zone_comps->len && res; ii++) {
+		res = publish_format_ical_write_component (stream, checksum, tdata.zone_comps->pdata[ii], error);
+	}
 
-		g_hash_table_destroy (tdata.zones);
-		tdata.zones = NULL;
+	if (res)
+		res = publish_format_ical_write_end (stream, checksum, error);
 
-		ical_string = icalcomponent_as_ical_string_r (top_level);
-		res = g_output_stream_write_all (stream, ical_string, strlen (ical_string), NULL, NULL, error);
-		g_free (ical_string);
-		e_cal_client_free_icalcomp_slist (objects);
-	}
+	g_hash_table_destroy (tdata.zones);
+	g_ptr_array_unref (tdata.zone_comps);
 
+	e_cal_client_free_icalcomp_slist (objects);
 	g_object_unref (client);
-	icalcomponent_free (top_level);
 
 	return res;
 }
@@ -144,6 +264,7 @@ write_calendar (const gchar *uid,
 void
 publish_calendar_as_ical (GOutputStream *stream,
                           EPublishUri *uri,
+                          GChecksum *checksum,
                           GError **error)
 {
 	GSList *l;
@@ -152,7 +273,7 @@ publish_calendar_as_ical (GOutputStream *stream,
 	l = uri->events;
 	while (l) {
 		gchar *uid = l->data;
-		if (!write_calendar (uid, stream, error))
+		if (!write_calendar (uid, stream, checksum, error))
 			break;
 		l = g_slist_next (l);
 	}
@@ -0,0 +1,378 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* The export engine shared by the format handlers */
+
+#include "evolution-config.h"
+
+#include <string.h>
+#include <glib/gi18n.h>
+
+#include "format-handler.h"
+
+/* The formatted data is written out once it grows over this size */
+#define EXPORT_BUFFER_SIZE (64 * 1024)
+
+static void
+display_error_message (GtkWidget *parent,
+                       const gchar *message)
+{
+	GtkWidget *dialog;
+
+	dialog = gtk_message_dialog_new (
+		GTK_WINDOW (parent), 0,
+		GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE,
+		"%s", message);
+	gtk_dialog_run (GTK_DIALOG (dialog));
+	gtk_widget_destroy (dialog);
+}
+
+/* Returns output stream for the uri, or NULL on any error.
+ * When done with the stream, just g_output_stream_close and g_object_unref it.
+ * It will ask for overwrite if file already exists.
+*/
+GOutputStream *
+open_for_writing (GtkWindow *parent,
+                  const gchar *uri,
+                  GError **error)
+{
+	GFile *file;
+	GFileOutputStream *fostream;
+	GError *err = NULL;
+
+	g_return_val_if_fail (uri != NULL, NULL);
+
+	file = g_file_new_for_uri (uri);
+
+	g_return_val_if_fail (file != NULL, NULL);
+
+	fostream = g_file_create (file, G_FILE_CREATE_NONE, NULL, &err);
+
+	if (err && err->code == G_IO_ERROR_EXISTS) {
+		gint response;
+		g_clear_error (&err);
+
+		response = e_alert_run_dialog_for_args (
+			parent, E_ALERT_ASK_FILE_EXISTS_OVERWRITE,
+			uri, NULL);
+		if (response == GTK_RESPONSE_OK) {
+			fostream = g_file_replace (
+				file, NULL, FALSE, G_FILE_CREATE_NONE,
+				NULL, &err);
+
+			if (err && fostream) {
+				g_object_unref (fostream);
+				fostream = NULL;
+			}
+		} else if (fostream) {
+			g_object_unref (fostream);
+			fostream = NULL;
+		}
+	}
+
+	g_object_unref (file);
+
+	if (error && err)
+		*error = err;
+	else if (err)
+		g_error_free (err);
+
+	if (fostream)
+		return G_OUTPUT_STREAM (fostream);
+
+	return NULL;
+}
+
+static gboolean
+export_flush (GOutputStream *stream,
+              GString *buffer,
+              GCancellable *cancellable,
+              GError **error)
+{
+	gboolean success;
+
+	if (!buffer->len)
+		return TRUE;
+
+	success = g_output_stream_write_all (stream, buffer->str, buffer->len, NULL, cancellable, error);
+
+	/* The allocated memory is reused for the next records */
+	g_string_truncate (buffer, 0);
+
+	return success;
+}
+
+/**
+ * format_handler_export_objects_sync:
+ * @handler: a #FormatHandler
+ * @client: (nullable): an #ECalClient the @icalcomps are from, or %NULL
+ * @icalcomps: (transfer full) (element-type icalcomponent): the components to export
+ * @stream: a #GOutputStream to write to
+ * @export_data: the data returned by the @handler's export_data_new function
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Formats the @icalcomps one by one with the @handler into a buffer, which
+ * is written to the @stream whenever it grows large enough. Each component
+ * is passed to the @handler, which frees it as soon as it is formatted.
+ * The progress is reported on the @cancellable, when it is a #CamelOperation.
+ *
+ * Returns: whether succeeded
+ **/
+gboolean
+format_handler_export_objects_sync (FormatHandler *handler,
+                                    ECalClient *client,
+                                    GSList *icalcomps,
+                                    GOutputStream *stream,
+                                    gpointer export_data,
+                                    GCancellable *cancellable,
+                                    GError **error)
+{
+	GString *buffer;
+	guint n_total, n_done = 0;
+	gint last_percent = -1;
+	gboolean success = TRUE;
+
+	g_return_val_if_fail (handler != NULL, FALSE);
+	g_return_val_if_fail (handler->export_object != NULL, FALSE);
+	g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), FALSE);
+
+	buffer = g_string_sized_new (EXPORT_BUFFER_SIZE + 4096);
+	n_total = g_slist_length (icalcomps);
+
+	if (handler->export_begin)
+		handler->export_begin (buffer, export_data);
+
+	while (icalcomps && success) {
+		icalcomponent *icalcomp = icalcomps->data;
+		gint percent;
+
+		icalcomps = g_slist_delete_link (icalcomps, icalcomps);
+
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			icalcomponent_free (icalcomp);
+			success = FALSE;
+			break;
+		}
+
+		/* The handler frees the icalcomp, thus it does not need to copy it */
+		handler->export_object (client, icalcomp, buffer, export_data);
+
+		if (buffer->len >= EXPORT_BUFFER_SIZE)
+			success = export_flush (stream, buffer, cancellable, error);
+
+		n_done++;
+		percent = n_done * 100 / n_total;
+
+		if (percent != last_percent) {
+			camel_operation_progress (cancellable, percent);
+			last_percent = percent;
+		}
+	}
+
+	if (success) {
+		if (handler->export_end)
+			handler->export_end (client, buffer, export_data);
+
+		success = export_flush (stream, buffer, cancellable, error);
+	}
+
+	g_slist_free_full (icalcomps, (GDestroyNotify) icalcomponent_free);
+	g_string_free (buffer, TRUE);
+
+	return success;
+}
+
+/**
+ * format_handler_export_sync:
+ * @handler: a #FormatHandler
+ * @client: an #ECalClient to export
+ * @stream: a #GOutputStream to write to
+ * @export_data: the data returned by the @handler's export_data_new function
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Exports all the components of the @client in the @handler's format.
+ * See format_handler_export_objects_sync().
+ *
+ * Returns: whether succeeded
+ **/
+gboolean
+format_handler_export_sync (FormatHandler *handler,
+                            ECalClient *client,
+                            GOutputStream *stream,
+                            gpointer export_data,
+                            GCancellable *cancellable,
+                            GError **error)
+{
+	GSList *icalcomps = NULL;
+
+	g_return_val_if_fail (E_IS_CAL_CLIENT (client), FALSE);
+
+	if (!e_cal_client_get_object_list_sync (client, "#t", &icalcomps, cancellable, error))
+		return FALSE;
+
+	return format_handler_export_objects_sync (handler, client, icalcomps, stream, export_data, cancellable, error);
+}
+
+typedef struct _SaveData {
+	/* Copy of the handler, which is freed with the dialog */
+	FormatHandler handler;
+	gpointer export_data;
+
+	EClientCache *client_cache;
+	ESource *source;
+	gchar *extension_name;
+	GFile *file;
+	GOutputStream *stream;
+	/* Whether the file did not exist before, thus it can be deleted on failure */
+	gboolean created;
+} SaveData;
+
+static void
+save_data_free (gpointer ptr)
+{
+	SaveData *sd = ptr;
+
+	if (sd) {
+		if (sd->handler.export_data_free)
+			sd->handler.export_data_free (sd->export_data);
+
+		g_clear_object (&sd->client_cache);
+		g_clear_object (&sd->source);
+		g_clear_object (&sd->file);
+		g_clear_object (&sd->stream);
+		g_free (sd->extension_name);
+		g_free (sd);
+	}
+}
+
+static void
+format_handler_save_thread (EAlertSinkThreadJobData *job_data,
+                            gpointer user_data,
+                            GCancellable *cancellable,
+                            GError **error)
+{
+	SaveData *sd = user_data;
+	EClient *client;
+	gboolean success = FALSE;
+
+	client = e_client_cache_get_client_sync (sd->client_cache, sd->source, sd->extension_name, 30, cancellable, error);
+
+	if (client) {
+		success = format_handler_export_sync (&sd->handler, E_CAL_CLIENT (client), sd->stream, sd->export_data, cancellable, error);
+
+		g_object_unref (client);
+	}
+
+	if (success) {
+		success = g_output_stream_close (sd->stream, cancellable, error);
+	} else {
+		GCancellable *abandon;
+
+		/* Closing with a cancelled cancellable abandons the replace,
+		 * thus an overwritten file keeps its original content */
+		abandon = g_cancellable_new ();
+		g_cancellable_cancel (abandon);
+
+		g_output_stream_close (sd->stream, abandon, NULL);
+
+		g_object_unref (abandon);
+	}
+
+	/* Do not leave a partial new file behind */
+	if (!success && sd->created)
+		g_file_delete (sd->file, NULL, NULL);
+}
+
+/**
+ * format_handler_save:
+ * @handler: a #FormatHandler
+ * @shell_view: an #EShellView to show the progress in
+ * @selector: an #ESourceSelector
+ * @client_cache: an #EClientCache
+ * @dest_uri: URI of the file to save to
+ *
+ * Saves the primary selection of the @selector into the @dest_uri in
+ * the @handler's format. The data is read and written in a dedicated
+ * thread, with the progress shown in the @shell_view, where the save
+ * can be also cancelled.
+ **/
+void
+format_handler_save (FormatHandler *handler,
+                     EShellView *shell_view,
+                     ESourceSelector *selector,
+                     EClientCache *client_cache,
+                     const gchar *dest_uri)
+{
+	GtkWidget *toplevel;
+	GFile *file;
+	GOutputStream *stream;
+	EActivity *activity;
+	SaveData *sd;
+	gchar *description, *alert_arg_0;
+	gboolean created;
+	GError *error = NULL;
+
+	g_return_if_fail (handler != NULL);
+	g_return_if_fail (E_IS_SHELL_VIEW (shell_view));
+	g_return_if_fail (E_IS_SOURCE_SELECTOR (selector));
+
+	if (!dest_uri)
+		return;
+
+	toplevel = gtk_widget_get_toplevel (GTK_WIDGET (selector));
+
+	file = g_file_new_for_uri (dest_uri);
+	created = !g_file_query_exists (file, NULL);
+
+	stream = open_for_writing (GTK_WINDOW (toplevel), dest_uri, &error);
+
+	if (!stream) {
+		if (error) {
+			display_error_message (toplevel, error->message);
+			g_error_free (error);
+		}
+
+		g_object_unref (file);
+
+		return;
+	}
+
+	sd = g_new0 (SaveData, 1);
+	sd->handler = *handler;
+	sd->handler.options_widget = NULL;
+	sd->handler.data = NULL;
+	sd->client_cache = g_object_ref (client_cache);
+	sd->source = e_source_selector_ref_primary_selection (selector);
+	sd->extension_name = g_strdup (e_source_selector_get_extension_name (selector));
+	sd->file = file;
+	sd->stream = stream;
+	sd->created = created;
+
+	if (handler->export_data_new)
+		sd->export_data = handler->export_data_new (handler, sd->source);
+
+	description = g_strdup_printf (_("Saving “%s”"), e_source_get_display_name (sd->source));
+	alert_arg_0 = g_strdup_printf (_("Failed to save “%s”"), e_source_get_display_name (sd->source));
+
+	activity = e_shell_view_submit_thread_job (
+		shell_view, description, "system:generic-error", alert_arg_0,
+		format_handler_save_thread, sd, save_data_free);
+
+	g_clear_object (&activity);
+	g_free (description);
+	g_free (alert_arg_0);
+}
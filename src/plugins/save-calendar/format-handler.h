@@ -24,8 +24,24 @@
 
 #include <e-util/e-util.h>
 
+#include <shell/e-shell-view.h>
+
 typedef struct _FormatHandler FormatHandler;
 
+/* The export functions are called in a dedicated thread. They append
+ * the formatted data to the @buffer, which is written to the output
+ * and emptied whenever it grows large enough. The export_object
+ * function takes ownership of the @icalcomp. */
+typedef void	(*FormatExportBeginFunc)	(GString *buffer,
+						 gpointer export_data);
+typedef void	(*FormatExportObjectFunc)	(ECalClient *client,
+						 icalcomponent *icalcomp,
+						 GString *buffer,
+						 gpointer export_data);
+typedef void	(*FormatExportEndFunc)		(ECalClient *client,
+						 GString *buffer,
+						 gpointer export_data);
+
 struct _FormatHandler
 {
 	gboolean isdefault;
@@ -35,10 +51,15 @@ struct _FormatHandler
 
 	gpointer data;
 
-	void	(*save)		(FormatHandler *handler,
-				 ESourceSelector *selector,
-				 EClientCache *client_cache,
-				 gchar *dest_uri);
+	/* Called in the UI thread, to collect the export options,
+	 * which are passed as the export_data to the functions below */
+	gpointer (*export_data_new)	(FormatHandler *handler,
+					 ESource *source);
+	GDestroyNotify export_data_free;
+
+	FormatExportBeginFunc export_begin;
+	FormatExportObjectFunc export_object;
+	FormatExportEndFunc export_end;
 };
 
 FormatHandler *csv_format_handler_new (void);
@@ -46,3 +67,7 @@ FormatHandler *ical_format_handler_new (void);
 FormatHandler *rdf_format_handler_new (void);
 
 GOutputStream *open_for_writing (GtkWindow *parent, const gchar *uri, GError **error);
+
+gboolean format_handler_export_objects_sync (FormatHandler *handler, ECalClient *client, GSList *icalcomps, GOutputStream *stream, gpointer export_data, GCancellable *cancellable, GError **error);
+gboolean format_handler_export_sync (FormatHandler *handler, ECalClient *client, GOutputStream *stream, gpointer export_data, GCancellable *cancellable, GError **error);
+void format_handler_save (FormatHandler *handler, EShellView *shell_view, ESourceSelector *selector, EClientCache *client_cache, const gchar *dest_uri);
@@ -27,22 +27,39 @@
 
 #include "format-handler.h"
 
+typedef struct {
+	/* tzid-s of the zones already in the tz_buffer */
+	GHashTable *zones;
+	GString *tz_buffer;
+} IcalExportData;
+
+static gpointer
+ical_export_data_new (FormatHandler *handler,
+                      ESource *source)
+{
+	IcalExportData *ied;
+
+	ied = g_new0 (IcalExportData, 1);
+	ied->zones = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	ied->tz_buffer = g_string_new ("");
+
+	return ied;
+}
+
 static void
-display_error_message (GtkWidget *parent,
-                       const gchar *message)
+ical_export_data_free (gpointer ptr)
 {
-	GtkWidget *dialog;
-
-	dialog = gtk_message_dialog_new (
-		GTK_WINDOW (parent), 0,
-		GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE,
-		"%s", message);
-	gtk_dialog_run (GTK_DIALOG (dialog));
-	gtk_widget_destroy (dialog);
+	IcalExportData *ied = ptr;
+
+	if (ied) {
+		g_hash_table_destroy (ied->zones);
+		g_string_free (ied->tz_buffer, TRUE);
+		g_free (ied);
+	}
 }
 
 typedef struct {
-	GHashTable *zones;
+	IcalExportData *ied;
 	ECalClient *client;
 } CompTzData;
 
@@ -53,12 +70,12 @@ insert_tz_comps (icalparameter *param,
 	const gchar *tzid;
 	CompTzData *tdata = cb_data;
 	icaltimezone *zone = NULL;
-	icalcomponent *tzcomp;
+	gchar *ical_str;
 	GError *error = NULL;
 
 	tzid = icalparameter_get_tzid (param);
 
-	if (g_hash_table_lookup (tdata->zones, tzid))
+	if (g_hash_table_contains (tdata->ied->zones, tzid))
 		return;
 
 	e_cal_client_get_timezone_sync (
@@ -72,104 +89,67 @@ insert_tz_comps (icalparameter *param,
 		return;
 	}
 
-	tzcomp = icalcomponent_new_clone (icaltimezone_get_component (zone));
-	g_hash_table_insert (tdata->zones, (gpointer) tzid, (gpointer) tzcomp);
-}
+	g_hash_table_add (tdata->ied->zones, g_strdup (tzid));
 
-static void
-append_tz_to_comp (gpointer key,
-                   gpointer value,
-                   icalcomponent *toplevel)
-{
-	icalcomponent_add_component (toplevel, (icalcomponent *) value);
+	ical_str = icalcomponent_as_ical_string_r (icaltimezone_get_component (zone));
+	g_string_append (tdata->ied->tz_buffer, ical_str);
+	g_free (ical_str);
 }
 
 static void
-do_save_calendar_ical (FormatHandler *handler,
-                       ESourceSelector *selector,
-		       EClientCache *client_cache,
-                       gchar *dest_uri)
+ical_export_begin (GString *buffer,
+                   gpointer export_data)
 {
-	ESource *primary_source;
-	EClient *source_client;
-	GError *error = NULL;
-	GSList *objects = NULL;
-	icalcomponent *top_level = NULL;
-
-	if (!dest_uri)
-		return;
-
-	/* open source client */
-	primary_source = e_source_selector_ref_primary_selection (selector);
-	source_client = e_client_cache_get_client_sync (client_cache,
-		primary_source, e_source_selector_get_extension_name (selector), 30, NULL, &error);
-	g_object_unref (primary_source);
-
-	/* Sanity check. */
-	g_return_if_fail (
-		((source_client != NULL) && (error == NULL)) ||
-		((source_client == NULL) && (error != NULL)));
-
-	if (error != NULL) {
-		display_error_message (
-			gtk_widget_get_toplevel (GTK_WIDGET (selector)),
-			error->message);
-		g_error_free (error);
-		return;
-	}
+	icalcomponent *top_level;
+	gchar *ical_str, *end;
 
-	/* create destination file */
 	top_level = e_cal_util_new_top_level ();
+	ical_str = icalcomponent_as_ical_string_r (top_level);
+	icalcomponent_free (top_level);
 
-	e_cal_client_get_object_list_sync (
-		E_CAL_CLIENT (source_client), "#t", &objects, NULL, &error);
-
-	if (objects != NULL) {
-		CompTzData tdata;
-		GOutputStream *stream;
-		GSList *iter;
-
-		tdata.zones = g_hash_table_new (g_str_hash, g_str_equal);
-		tdata.client = E_CAL_CLIENT (source_client);
-
-		for (iter = objects; iter; iter = iter->next) {
-			icalcomponent *icalcomp = icalcomponent_new_clone (iter->data);
+	/* The components are written between these two */
+	end = g_strrstr (ical_str, "END:VCALENDAR");
+	if (end)
+		*end = '\0';
 
-			icalcomponent_foreach_tzid (icalcomp, insert_tz_comps, &tdata);
-			icalcomponent_add_component (top_level, icalcomp);
-		}
+	g_string_append (buffer, ical_str);
 
-		g_hash_table_foreach (tdata.zones, (GHFunc) append_tz_to_comp, top_level);
+	g_free (ical_str);
+}
 
-		g_hash_table_destroy (tdata.zones);
-		tdata.zones = NULL;
+static void
+ical_export_object (ECalClient *client,
+                    icalcomponent *icalcomp,
+                    GString *buffer,
+                    gpointer export_data)
+{
+	gchar *ical_str;
 
-		/* save the file */
-		stream = open_for_writing (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (selector))), dest_uri, &error);
+	if (client) {
+		CompTzData tdata;
 
-		if (stream) {
-			gchar *ical_str = icalcomponent_as_ical_string_r (top_level);
+		tdata.ied = export_data;
+		tdata.client = client;
 
-			g_output_stream_write_all (stream, ical_str, strlen (ical_str), NULL, NULL, &error);
-			g_output_stream_close (stream, NULL, NULL);
+		icalcomponent_foreach_tzid (icalcomp, insert_tz_comps, &tdata);
+	}
 
-			g_object_unref (stream);
-			g_free (ical_str);
-		}
+	ical_str = icalcomponent_as_ical_string_r (icalcomp);
+	g_string_append (buffer, ical_str);
+	g_free (ical_str);
 
-		e_cal_client_free_icalcomp_slist (objects);
-	}
+	icalcomponent_free (icalcomp);
+}
 
-	if (error != NULL) {
-		display_error_message (
-			gtk_widget_get_toplevel (GTK_WIDGET (selector)),
-			error->message);
-		g_error_free (error);
-	}
+static void
+ical_export_end (ECalClient *client,
+                 GString *buffer,
+                 gpointer export_data)
+{
+	IcalExportData *ied = export_data;
 
-	/* terminate */
-	g_object_unref (source_client);
-	icalcomponent_free (top_level);
+	g_string_append_len (buffer, ied->tz_buffer->str, ied->tz_buffer->len);
+	g_string_append (buffer, "END:VCALENDAR\r\n");
 }
 
 FormatHandler *
@@ -181,7 +161,11 @@ ical_format_handler_new (void)
 	handler->combo_label = _("iCalendar (.ics)");
 	handler->filename_ext = ".ics";
 	handler->options_widget = NULL;
-	handler->save = do_save_calendar_ical;
+	handler->export_data_new = ical_export_data_new;
+	handler->export_data_free = ical_export_data_free;
+	handler->export_begin = ical_export_begin;
+	handler->export_object = ical_export_object;
+	handler->export_end = ical_export_end;
 	handler->data = NULL;
 
 	return handler;
@@ -24,17 +24,10 @@
 #include <string.h>
 #include <glib/gi18n.h>
 
-#include <libxml/xmlmemory.h>
-#include <libxml/parser.h>
-#include <libxml/tree.h>
-#include <libxml/xmlIO.h>
-#include <libxml/xpath.h>
-
 #include "format-handler.h"
 
-static void	add_string_to_rdf		(xmlNodePtr node,
-						 const gchar *tag,
-						 const gchar *value);
+#define RDF_DATATYPE_STRING "http://www.w3.org/2001/XMLSchema#string"
+#define RDF_DATATYPE_INTEGER "http://www.w3.org/2001/XMLSchema#integer"
 
 /* Use { */
 
@@ -67,22 +60,48 @@ enum { /* XML helper enum */
 	CONSTCHAR
 };
 
+typedef struct _RdfExportData {
+	gchar *source_uid;
+	gchar *display_name;
+	gchar *timezone;
+	/* The datatype of the time values, the same for all of them */
+	gchar *time_datatype;
+} RdfExportData;
+
+/* Some helpers for the xml stuff */
 static void
-display_error_message (GtkWidget *parent,
-                       const gchar *error_message)
+add_element_to_rdf (GString *buffer,
+                    gint indent,
+                    const gchar *tag,
+                    const gchar *datatype,
+                    const gchar *value)
 {
-	GtkWidget *dialog;
+	gchar *escaped;
 
-	dialog = gtk_message_dialog_new (
-		GTK_WINDOW (parent), 0, GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE,
-		"%s", error_message);
-	gtk_dialog_run (GTK_DIALOG (dialog));
-	gtk_widget_destroy (dialog);
+	g_string_append_printf (buffer, "%*s<%s", indent, "", tag);
+
+	if (datatype) {
+		escaped = g_markup_escape_text (datatype, -1);
+		g_string_append_printf (buffer, " rdf:datatype=\"%s\"", escaped);
+		g_free (escaped);
+	}
+
+	escaped = g_markup_escape_text (value ? value : "", -1);
+	g_string_append_printf (buffer, ">%s</%s>\n", escaped, tag);
+	g_free (escaped);
+}
+
+static void
+add_string_to_rdf (GString *buffer,
+                   const gchar *tag,
+                   const gchar *value)
+{
+	if (value)
+		add_element_to_rdf (buffer, 8, tag, RDF_DATATYPE_STRING, value);
 }
 
-/* Some helpers for the xml stuff */
 static void
-add_list_to_rdf (xmlNodePtr node,
+add_list_to_rdf (GString *buffer,
                  const gchar *tag,
                  GSList *list_in,
                  gint type)
@@ -106,7 +125,7 @@ add_list_to_rdf (xmlNodePtr node,
 				break;
 			}
 
-			add_string_to_rdf (node, tag, str);
+			add_string_to_rdf (buffer, tag, str);
 
 			list = g_slist_next (list);
 		}
@@ -114,264 +133,212 @@ add_list_to_rdf (xmlNodePtr node,
 }
 
 static void
-add_nummeric_to_rdf (xmlNodePtr node,
+add_nummeric_to_rdf (GString *buffer,
                      const gchar *tag,
                      gint *nummeric)
 {
 	if (nummeric) {
 		gchar *value = g_strdup_printf ("%d", *nummeric);
-		xmlNodePtr cur_node = xmlNewChild (node, NULL, (guchar *) tag, (guchar *) value);
-		xmlSetProp (cur_node, (const guchar *)"rdf:datatype", (const guchar *)"http://www.w3.org/2001/XMLSchema#integer");
+		add_element_to_rdf (buffer, 8, tag, RDF_DATATYPE_INTEGER, value);
 		g_free (value);
 	}
 }
 
 static void
-add_time_to_rdf (xmlNodePtr node,
+add_time_to_rdf (GString *buffer,
                  const gchar *tag,
-                 icaltimetype *time)
+                 icaltimetype *time,
+                 RdfExportData *data)
 {
 	if (time) {
-		xmlNodePtr cur_node = NULL;
 		struct tm mytm = icaltimetype_to_tm (time);
-		gchar *str = (gchar *) g_malloc (sizeof (gchar) * 200);
-		gchar *tmp = NULL;
-		gchar *timezone;
+		gchar str[200];
 		/*
 		 * Translator: the %FT%T is the thirth argument for a strftime function.
 		 * It lets you define the formatting of the date in the rdf-file.
 		 * Also check out http://www.w3.org/2002/12/cal/tzd
 		 * */
-		e_utf8_strftime (str, 200, _("%FT%T"), &mytm);
-
-		cur_node = xmlNewChild (node, NULL, (guchar *) tag, (guchar *) str);
+		e_utf8_strftime (str, sizeof (str), _("%FT%T"), &mytm);
 
 		/* Not sure about this property */
-		timezone = calendar_config_get_timezone ();
-		tmp = g_strdup_printf ("http://www.w3.org/2002/12/cal/tzd/%s#tz", timezone);
-		xmlSetProp (cur_node, (const guchar *)"rdf:datatype", (guchar *) tmp);
-		g_free (tmp);
-		g_free (timezone);
-		g_free (str);
+		add_element_to_rdf (buffer, 8, tag, data->time_datatype, str);
 	}
 }
 
-static void
-add_string_to_rdf (xmlNodePtr node,
-                   const gchar *tag,
-                   const gchar *value)
+static gpointer
+rdf_export_data_new (FormatHandler *handler,
+                     ESource *source)
 {
-	if (value) {
-		xmlNodePtr cur_node = NULL;
-		cur_node = xmlNewChild (node, NULL, (guchar *) tag, (guchar *) value);
-		xmlSetProp (cur_node, (const guchar *)"rdf:datatype", (const guchar *)"http://www.w3.org/2001/XMLSchema#string");
-	}
+	RdfExportData *data;
+
+	data = g_new0 (RdfExportData, 1);
+	data->source_uid = g_strdup (e_source_get_uid (source));
+	data->display_name = e_source_dup_display_name (source);
+	data->timezone = calendar_config_get_timezone ();
+	data->time_datatype = g_strdup_printf ("http://www.w3.org/2002/12/cal/tzd/%s#tz", data->timezone);
+
+	return data;
 }
 
 static void
-do_save_calendar_rdf (FormatHandler *handler,
-                      ESourceSelector *selector,
-		      EClientCache *client_cache,
-                      gchar *dest_uri)
+rdf_export_data_free (gpointer ptr)
 {
-
-	/*
-	 * According to some documentation about CSV, newlines 'are' allowed
-	 * in CSV-files. But you 'do' have to put the value between quotes.
-	 * The helper 'string_needsquotes' will check for that
-	 *
-	 * http://www.creativyst.com/Doc/Articles/CSV/CSV01.htm
-	 * http://www.creativyst.com/cgi-bin/Prod/15/eg/csv2xml.pl
-	 */
-
-	ESource *primary_source;
-	EClient *source_client;
-	GError *error = NULL;
-	GSList *objects = NULL;
-	gchar *temp = NULL;
-	GOutputStream *stream;
-
-	if (!dest_uri)
-		return;
-
-	/* open source client */
-	primary_source = e_source_selector_ref_primary_selection (selector);
-	source_client = e_client_cache_get_client_sync (client_cache,
-		primary_source, e_source_selector_get_extension_name (selector), 30, NULL, &error);
-	g_object_unref (primary_source);
-
-	/* Sanity check. */
-	g_return_if_fail (
-		((source_client != NULL) && (error == NULL)) ||
-		((source_client == NULL) && (error != NULL)));
-
-	if (source_client == NULL) {
-		display_error_message (
-			gtk_widget_get_toplevel (GTK_WIDGET (selector)),
-			error->message);
-		g_error_free (error);
-		return;
+	RdfExportData *data = ptr;
+
+	if (data) {
+		g_free (data->source_uid);
+		g_free (data->display_name);
+		g_free (data->timezone);
+		g_free (data->time_datatype);
+		g_free (data);
 	}
+}
 
-	stream = open_for_writing (GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (selector))), dest_uri, &error);
-
-	if (stream && e_cal_client_get_object_list_as_comps_sync (E_CAL_CLIENT (source_client), "#t", &objects, NULL, NULL)) {
-		GSList *iter;
-
-		xmlBufferPtr buffer = xmlBufferCreate ();
-		xmlDocPtr doc = xmlNewDoc ((xmlChar *) "1.0");
-		xmlNodePtr fnode;
-
-		doc->children = xmlNewDocNode (doc, NULL, (const guchar *)"rdf:RDF", NULL);
-		xmlSetProp (doc->children, (const guchar *)"xmlns:rdf", (const guchar *)"http://www.w3.org/1999/02/22-rdf-syntax-ns#");
-		xmlSetProp (doc->children, (const guchar *)"xmlns", (const guchar *)"http://www.w3.org/2002/12/cal/ical#");
-
-		fnode = xmlNewChild (doc->children, NULL, (const guchar *)"Vcalendar", NULL);
-
-		/* Should Evolution publicise these? */
-		xmlSetProp (fnode, (const guchar *)"xmlns:x-wr", (const guchar *)"http://www.w3.org/2002/12/cal/prod/Apple_Comp_628d9d8459c556fa#");
-		xmlSetProp (fnode, (const guchar *)"xmlns:x-lic", (const guchar *)"http://www.w3.org/2002/12/cal/prod/Apple_Comp_628d9d8459c556fa#");
-
-		/* Not sure if it's correct like this */
-		xmlNewChild (fnode, NULL, (const guchar *)"prodid", (const guchar *)"-//" PACKAGE " " VERSION VERSION_SUBSTRING " " VERSION_COMMENT "//iCal 1.0//EN");
-
-		/* Assuming GREGORIAN is the only supported calendar scale */
-		xmlNewChild (fnode, NULL, (const guchar *)"calscale", (const guchar *)"GREGORIAN");
-
-		temp = calendar_config_get_timezone ();
-		xmlNewChild (fnode, NULL, (const guchar *)"x-wr:timezone", (guchar *) temp);
-		g_free (temp);
-
-		xmlNewChild (fnode, NULL, (const guchar *)"method", (const guchar *)"PUBLISH");
-
-		xmlNewChild (fnode, NULL, (const guchar *)"x-wr:relcalid", (guchar *) e_source_get_uid (primary_source));
-
-		xmlNewChild (fnode, NULL, (const guchar *)"x-wr:calname", (guchar *) e_source_get_display_name (primary_source));
-
-		/* Version of this RDF-format */
-		xmlNewChild (fnode, NULL, (const guchar *)"version", (const guchar *)"2.0");
-
-		for (iter = objects; iter; iter = iter->next) {
-			ECalComponent *comp = iter->data;
-			const gchar *temp_constchar;
-			gchar *tmp_str = NULL;
-			GSList *temp_list;
-			ECalComponentDateTime temp_dt;
-			struct icaltimetype *temp_time;
-			gint *temp_int;
-			ECalComponentText temp_comptext;
-			xmlNodePtr c_node = xmlNewChild (fnode, NULL, (const guchar *)"component", NULL);
-			xmlNodePtr node = xmlNewChild (c_node, NULL, (const guchar *)"Vevent", NULL);
-
-			/* Getting the stuff */
-			e_cal_component_get_uid (comp, &temp_constchar);
-			tmp_str = g_strdup_printf ("#%s", temp_constchar);
-			xmlSetProp (node, (const guchar *)"about", (guchar *) tmp_str);
-			g_free (tmp_str);
-			add_string_to_rdf (node, "uid",temp_constchar);
-
-			e_cal_component_get_summary (comp, &temp_comptext);
-			add_string_to_rdf (node, "summary", temp_comptext.value);
-
-			e_cal_component_get_description_list (comp, &temp_list);
-			add_list_to_rdf (node, "description", temp_list, ECALCOMPONENTTEXT);
-			if (temp_list)
-				e_cal_component_free_text_list (temp_list);
-
-			e_cal_component_get_categories_list (comp, &temp_list);
-			add_list_to_rdf (node, "categories", temp_list, CONSTCHAR);
-			if (temp_list)
-				e_cal_component_free_categories_list (temp_list);
-
-			e_cal_component_get_comment_list (comp, &temp_list);
-			add_list_to_rdf (node, "comment", temp_list, ECALCOMPONENTTEXT);
-
-			if (temp_list)
-				e_cal_component_free_text_list (temp_list);
-
-			e_cal_component_get_completed (comp, &temp_time);
-			add_time_to_rdf (node, "completed", temp_time);
-			if (temp_time)
-				e_cal_component_free_icaltimetype (temp_time);
-
-			e_cal_component_get_created (comp, &temp_time);
-			add_time_to_rdf (node, "created", temp_time);
-			if (temp_time)
-				e_cal_component_free_icaltimetype (temp_time);
-
-			e_cal_component_get_contact_list (comp, &temp_list);
-			add_list_to_rdf (node, "contact", temp_list, ECALCOMPONENTTEXT);
-			if (temp_list)
-				e_cal_component_free_text_list (temp_list);
-
-			e_cal_component_get_dtstart (comp, &temp_dt);
-			add_time_to_rdf (node, "dtstart", temp_dt.value ? temp_dt.value : NULL);
-			e_cal_component_free_datetime (&temp_dt);
+static void
+rdf_export_begin (GString *buffer,
+                  gpointer export_data)
+{
+	RdfExportData *data = export_data;
 
-			e_cal_component_get_dtend (comp, &temp_dt);
-			add_time_to_rdf (node, "dtend", temp_dt.value ? temp_dt.value : NULL);
-			e_cal_component_free_datetime (&temp_dt);
+	g_string_append (buffer,
+		"<rdf:RDF xmlns:rdf=\"http://www.w3.org/1999/02/22-rdf-syntax-ns#\""
+		" xmlns=\"http://www.w3.org/2002/12/cal/ical#\">\n");
 
-			e_cal_component_get_due (comp, &temp_dt);
-			add_time_to_rdf (node, "due", temp_dt.value ? temp_dt.value : NULL);
-			e_cal_component_free_datetime (&temp_dt);
+	/* Should Evolution publicise these? */
+	g_string_append (buffer,
+		"  <Vcalendar xmlns:x-wr=\"http://www.w3.org/2002/12/cal/prod/Apple_Comp_628d9d8459c556fa#\""
+		" xmlns:x-lic=\"http://www.w3.org/2002/12/cal/prod/Apple_Comp_628d9d8459c556fa#\">\n");
 
-			e_cal_component_get_percent (comp, &temp_int);
-			add_nummeric_to_rdf (node, "percentComplete", temp_int);
-
-			e_cal_component_get_priority (comp, &temp_int);
-			add_nummeric_to_rdf (node, "priority", temp_int);
+	/* Not sure if it's correct like this */
+	add_element_to_rdf (buffer, 4, "prodid", NULL, "-//" PACKAGE " " VERSION VERSION_SUBSTRING " " VERSION_COMMENT "//iCal 1.0//EN");
 
-			e_cal_component_get_url (comp, &temp_constchar);
-			add_string_to_rdf (node, "URL", temp_constchar);
+	/* Assuming GREGORIAN is the only supported calendar scale */
+	add_element_to_rdf (buffer, 4, "calscale", NULL, "GREGORIAN");
+	add_element_to_rdf (buffer, 4, "x-wr:timezone", NULL, data->timezone);
+	add_element_to_rdf (buffer, 4, "method", NULL, "PUBLISH");
+	add_element_to_rdf (buffer, 4, "x-wr:relcalid", NULL, data->source_uid);
+	add_element_to_rdf (buffer, 4, "x-wr:calname", NULL, data->display_name);
 
-			if (e_cal_component_has_attendees (comp)) {
-				e_cal_component_get_attendee_list (comp, &temp_list);
-				add_list_to_rdf (node, "attendee", temp_list, ECALCOMPONENTATTENDEE);
-				if (temp_list)
-					e_cal_component_free_attendee_list (temp_list);
-			}
+	/* Version of this RDF-format */
+	add_element_to_rdf (buffer, 4, "version", NULL, "2.0");
+}
 
-			e_cal_component_get_location (comp, &temp_constchar);
-			add_string_to_rdf (node, "location", temp_constchar);
-
-			e_cal_component_get_last_modified (comp, &temp_time);
-			add_time_to_rdf (node, "lastModified",temp_time);
-
-			/* Important note!
-			 * The documentation is not requiring this!
-			 *
-			 * if (temp_time) e_cal_component_free_icaltimetype (temp_time);
-			 *
-			 * Please uncomment and fix documentation if untrue
-			 * http://www.gnome.org/projects/evolution/developer-doc/libecal/ECalComponent.html
-			 *	#e-cal-component-get-last-modified
-			 */
-		}
+static void
+rdf_export_object (ECalClient *client,
+                   icalcomponent *icalcomp,
+                   GString *buffer,
+                   gpointer export_data)
+{
+	RdfExportData *data = export_data;
+	ECalComponent *comp;
+	const gchar *temp_constchar;
+	gchar *tmp_str = NULL;
+	GSList *temp_list;
+	ECalComponentDateTime temp_dt;
+	struct icaltimetype *temp_time;
+	gint *temp_int;
+	ECalComponentText temp_comptext;
+
+	comp = e_cal_component_new_from_icalcomponent (icalcomp);
+	if (!comp)
+		return;
 
-		/* I used a buffer rather than xmlDocDump: I want gio support */
-		xmlNodeDump (buffer, doc, doc->children, 2, 1);
+	/* Getting the stuff */
+	e_cal_component_get_uid (comp, &temp_constchar);
+	tmp_str = g_markup_printf_escaped ("    <component>\n      <Vevent about=\"#%s\">\n", temp_constchar ? temp_constchar : "");
+	g_string_append (buffer, tmp_str);
+	g_free (tmp_str);
+	add_string_to_rdf (buffer, "uid", temp_constchar);
+
+	e_cal_component_get_summary (comp, &temp_comptext);
+	add_string_to_rdf (buffer, "summary", temp_comptext.value);
+
+	e_cal_component_get_description_list (comp, &temp_list);
+	add_list_to_rdf (buffer, "description", temp_list, ECALCOMPONENTTEXT);
+	if (temp_list)
+		e_cal_component_free_text_list (temp_list);
+
+	e_cal_component_get_categories_list (comp, &temp_list);
+	add_list_to_rdf (buffer, "categories", temp_list, CONSTCHAR);
+	if (temp_list)
+		e_cal_component_free_categories_list (temp_list);
+
+	e_cal_component_get_comment_list (comp, &temp_list);
+	add_list_to_rdf (buffer, "comment", temp_list, ECALCOMPONENTTEXT);
+
+	if (temp_list)
+		e_cal_component_free_text_list (temp_list);
+
+	e_cal_component_get_completed (comp, &temp_time);
+	add_time_to_rdf (buffer, "completed", temp_time, data);
+	if (temp_time)
+		e_cal_component_free_icaltimetype (temp_time);
+
+	e_cal_component_get_created (comp, &temp_time);
+	add_time_to_rdf (buffer, "created", temp_time, data);
+	if (temp_time)
+		e_cal_component_free_icaltimetype (temp_time);
+
+	e_cal_component_get_contact_list (comp, &temp_list);
+	add_list_to_rdf (buffer, "contact", temp_list, ECALCOMPONENTTEXT);
+	if (temp_list)
+		e_cal_component_free_text_list (temp_list);
+
+	e_cal_component_get_dtstart (comp, &temp_dt);
+	add_time_to_rdf (buffer, "dtstart", temp_dt.value ? temp_dt.value : NULL, data);
+	e_cal_component_free_datetime (&temp_dt);
+
+	e_cal_component_get_dtend (comp, &temp_dt);
+	add_time_to_rdf (buffer, "dtend", temp_dt.value ? temp_dt.value : NULL, data);
+	e_cal_component_free_datetime (&temp_dt);
+
+	e_cal_component_get_due (comp, &temp_dt);
+	add_time_to_rdf (buffer, "due", temp_dt.value ? temp_dt.value : NULL, data);
+	e_cal_component_free_datetime (&temp_dt);
+
+	e_cal_component_get_percent (comp, &temp_int);
+	add_nummeric_to_rdf (buffer, "percentComplete", temp_int);
+
+	e_cal_component_get_priority (comp, &temp_int);
+	add_nummeric_to_rdf (buffer, "priority", temp_int);
+
+	e_cal_component_get_url (comp, &temp_constchar);
+	add_string_to_rdf (buffer, "URL", temp_constchar);
+
+	if (e_cal_component_has_attendees (comp)) {
+		e_cal_component_get_attendee_list (comp, &temp_list);
+		add_list_to_rdf (buffer, "attendee", temp_list, ECALCOMPONENTATTENDEE);
+		if (temp_list)
+			e_cal_component_free_attendee_list (temp_list);
+	}
 
-		g_output_stream_write_all (stream, xmlBufferContent (buffer), xmlBufferLength (buffer), NULL, NULL, &error);
-		g_output_stream_close (stream, NULL, NULL);
+	e_cal_component_get_location (comp, &temp_constchar);
+	add_string_to_rdf (buffer, "location", temp_constchar);
 
-		e_cal_client_free_ecalcomp_slist (objects);
+	e_cal_component_get_last_modified (comp, &temp_time);
+	add_time_to_rdf (buffer, "lastModified", temp_time, data);
 
-		xmlBufferFree (buffer);
-		xmlFreeDoc (doc);
-	}
+	/* Important note!
+	 * The documentation is not requiring this!
+	 *
+	 * if (temp_time) e_cal_component_free_icaltimetype (temp_time);
+	 *
+	 * Please uncomment and fix documentation if untrue
+	 * http://www.gnome.org/projects/evolution/developer-doc/libecal/ECalComponent.html
+	 *	#e-cal-component-get-last-modified
+	 */
 
-	if (stream)
-		g_object_unref (stream);
+	g_string_append (buffer, "      </Vevent>\n    </component>\n");
 
-	g_object_unref (source_client);
+	g_object_unref (comp);
+}
 
-	if (error != NULL) {
-		display_error_message (
-			gtk_widget_get_toplevel (GTK_WIDGET (selector)),
-			error->message);
-		g_error_free (error);
-	}
+static void
+rdf_export_end (ECalClient *client,
+                GString *buffer,
+                gpointer export_data)
+{
+	g_string_append (buffer, "  </Vcalendar>\n</rdf:RDF>\n");
 }
 
 FormatHandler *
@@ -383,7 +350,11 @@ rdf_format_handler_new (void)
 	handler->combo_label = _("RDF (.rdf)");
 	handler->filename_ext = ".rdf";
 	handler->options_widget = NULL;
-	handler->save = do_save_calendar_rdf;
+	handler->export_data_new = rdf_export_data_new;
+	handler->export_data_free = rdf_export_data_free;
+	handler->export_begin = rdf_export_begin;
+	handler->export_object = rdf_export_object;
+	handler->export_end = rdf_export_end;
 
 	return handler;
 }
@@ -107,8 +107,9 @@ format_handlers_foreach_free (gpointer data)
 }
 
 static void
-ask_destination_and_save (ESourceSelector *selector,
-			  EClientCache *client_cache)
+ask_destination_and_save (EShellView *shell_view,
+                          ESourceSelector *selector,
+                          EClientCache *client_cache)
 {
 	FormatHandler *handler = NULL;
 
@@ -221,7 +222,7 @@ ask_destination_and_save (ESourceSelector *selector,
 				dest_uri = temp;
 			}
 
-			handler->save (handler, selector, client_cache, dest_uri);
+			format_handler_save (handler, shell_view, selector, client_cache, dest_uri);
 		} else {
 			g_warn_if_reached ();
 		}
@@ -236,62 +237,6 @@ ask_destination_and_save (ESourceSelector *selector,
 
 }
 
-/* Returns output stream for the uri, or NULL on any error.
- * When done with the stream, just g_output_stream_close and g_object_unref it.
- * It will ask for overwrite if file already exists.
-*/
-GOutputStream *
-open_for_writing (GtkWindow *parent,
-                  const gchar *uri,
-                  GError **error)
-{
-	GFile *file;
-	GFileOutputStream *fostream;
-	GError *err = NULL;
-
-	g_return_val_if_fail (uri != NULL, NULL);
-
-	file = g_file_new_for_uri (uri);
-
-	g_return_val_if_fail (file != NULL, NULL);
-
-	fostream = g_file_create (file, G_FILE_CREATE_NONE, NULL, &err);
-
-	if (err && err->code == G_IO_ERROR_EXISTS) {
-		gint response;
-		g_clear_error (&err);
-
-		response = e_alert_run_dialog_for_args (
-			parent, E_ALERT_ASK_FILE_EXISTS_OVERWRITE,
-			uri, NULL);
-		if (response == GTK_RESPONSE_OK) {
-			fostream = g_file_replace (
-				file, NULL, FALSE, G_FILE_CREATE_NONE,
-				NULL, &err);
-
-			if (err && fostream) {
-				g_object_unref (fostream);
-				fostream = NULL;
-			}
-		} else if (fostream) {
-			g_object_unref (fostream);
-			fostream = NULL;
-		}
-	}
-
-	g_object_unref (file);
-
-	if (error && err)
-		*error = err;
-	else if (err)
-		g_error_free (err);
-
-	if (fostream)
-		return G_OUTPUT_STREAM (fostream);
-
-	return NULL;
-}
-
 static void
 save_general (EShellView *shell_view)
 {
@@ -306,7 +251,7 @@ save_general (EShellView *shell_view)
 	g_object_get (shell_sidebar, "selector", &selector, NULL);
 	g_return_if_fail (selector != NULL);
 
-	ask_destination_and_save (selector, e_shell_get_client_cache (shell));
+	ask_destination_and_save (shell_view, selector, e_shell_get_client_cache (shell));
 
 	g_object_unref (selector);
 }
@@ -0,0 +1,164 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Exports generated events with each of the format handlers into memory,
+ * verifying the export succeeds, and prints the throughput of each.
+ * Usage:
+ *    test-save-calendar [N_EVENTS]
+ */
+
+#include "evolution-config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "format-handler.h"
+
+static GSList *
+generate_events (gint n_events)
+{
+	GSList *icalcomps = NULL;
+	struct icaltimetype start;
+	gint ii;
+
+	start = icaltime_from_timet_with_zone (time (NULL), FALSE, icaltimezone_get_utc_timezone ());
+
+	for (ii = 0; ii < n_events; ii++) {
+		icalcomponent *icalcomp;
+		struct icaltimetype dtstart, dtend;
+		gchar *value;
+
+		icalcomp = icalcomponent_new (ICAL_VEVENT_COMPONENT);
+
+		value = g_strdup_printf ("test-save-calendar-%d", ii);
+		icalcomponent_set_uid (icalcomp, value);
+		g_free (value);
+
+		value = g_strdup_printf ("Event %d, with \"quotes\", <markup> & a comma", ii);
+		icalcomponent_set_summary (icalcomp, value);
+		g_free (value);
+
+		icalcomponent_set_description (icalcomp, "A longer description\nspanning two lines");
+		icalcomponent_set_location (icalcomp, "Meeting room");
+
+		dtstart = start;
+		icaltime_adjust (&dtstart, ii % 365, ii % 24, 0, 0);
+		dtend = dtstart;
+		icaltime_adjust (&dtend, 0, 1, 0, 0);
+
+		icalcomponent_set_dtstart (icalcomp, dtstart);
+		icalcomponent_set_dtend (icalcomp, dtend);
+		icalcomponent_add_property (icalcomp, icalproperty_new_created (start));
+		icalcomponent_add_property (icalcomp, icalproperty_new_lastmodified (start));
+
+		icalcomps = g_slist_prepend (icalcomps, icalcomp);
+	}
+
+	return g_slist_reverse (icalcomps);
+}
+
+static gboolean
+bench_handler (FormatHandler *handler,
+               ESource *source,
+               gint n_events)
+{
+	GOutputStream *stream;
+	gpointer export_data = NULL;
+	gint64 started, elapsed;
+	gsize size;
+	gboolean success;
+	GError *error = NULL;
+
+	stream = g_memory_output_stream_new_resizable ();
+
+	if (handler->export_data_new)
+		export_data = handler->export_data_new (handler, source);
+
+	started = g_get_monotonic_time ();
+
+	/* Without a client, like for the components of a file */
+	success = format_handler_export_objects_sync (handler, NULL, generate_events (n_events),
+		stream, export_data, NULL, &error);
+
+	elapsed = MAX (g_get_monotonic_time () - started, 1);
+
+	if (success)
+		success = g_output_stream_close (stream, NULL, &error);
+
+	size = g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (stream));
+
+	if (!success) {
+		fprintf (stderr, "%s: Export failed: %s\n", handler->combo_label, error ? error->message : "Unknown error");
+	} else if (!size) {
+		fprintf (stderr, "%s: Nothing exported\n", handler->combo_label);
+		success = FALSE;
+	} else {
+		printf ("%-32s %d events in %.3f s, %.0f events/s, %.1f MB/s\n", handler->combo_label, n_events,
+			elapsed / (gdouble) G_USEC_PER_SEC,
+			n_events / (elapsed / (gdouble) G_USEC_PER_SEC),
+			(size / (1024.0 * 1024.0)) / (elapsed / (gdouble) G_USEC_PER_SEC));
+	}
+
+	if (handler->export_data_free)
+		handler->export_data_free (export_data);
+
+	g_clear_error (&error);
+	g_object_unref (stream);
+
+	return success;
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	FormatHandler *handlers[3];
+	ESource *source;
+	gint n_events, ii;
+	gint res = 0;
+	GError *error = NULL;
+
+	gtk_init (&argc, &argv);
+
+	n_events = argc > 1 ? MAX (1, atoi (argv[1])) : 10000;
+
+	source = e_source_new_with_uid ("test-save-calendar", NULL, &error);
+	if (!source) {
+		fprintf (stderr, "Failed to create source: %s\n", error ? error->message : "Unknown error");
+		g_clear_error (&error);
+		return 1;
+	}
+
+	e_source_set_display_name (source, "Test Calendar");
+
+	handlers[0] = ical_format_handler_new ();
+	handlers[1] = csv_format_handler_new ();
+	handlers[2] = rdf_format_handler_new ();
+
+	for (ii = 0; ii < G_N_ELEMENTS (handlers); ii++) {
+		FormatHandler *handler = handlers[ii];
+
+		if (!bench_handler (handler, source, n_events))
+			res = 1;
+
+		if (handler->options_widget)
+			gtk_widget_destroy (handler->options_widget);
+		g_free (handler->data);
+		g_free (handler);
+	}
+
+	g_object_unref (source);
+
+	return res;
+}